@@ -0,0 +1,184 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "meerkat_assert/asserts.h"
+
+#include "manifest.h"
+
+static char* read_file(const char* filename);
+static int   parse_job(BatchJob* job, char* line);
+static int   parse_coordinate(size_t* coordinate, const char* field);
+
+int manifest_load(BatchManifest* manifest, const char* filename)
+{
+    SAFE_BLOCK_START    // Validate parameters
+    {
+        ASSERT_TRUE_MESSAGE(manifest != NULL, "manifest");
+        ASSERT_TRUE_MESSAGE(filename != NULL, "filename");
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    manifest->job_count = 0;
+    manifest->jobs      = NULL;
+    manifest->text      = NULL;
+
+    SAFE_BLOCK_START    // Parse jobs
+    {
+        manifest->text = read_file(filename);
+        ASSERT_TRUE_MESSAGE(manifest->text != NULL, filename);
+
+        // Every job takes at least one line
+        size_t line_count = 1;
+        for (const char* c = manifest->text; *c; ++c)
+            line_count += *c == '\n';
+
+        manifest->jobs = (BatchJob*) calloc(line_count,
+                                            sizeof(*manifest->jobs));
+        ASSERT_TRUE_MESSAGE(manifest->jobs != NULL,
+                            "Failed to allocate memory");
+
+        char* line_state = NULL;
+        for (char* line = strtok_r(manifest->text, "\n", &line_state);
+             line != NULL;
+             line = strtok_r(NULL, "\n", &line_state))
+        {
+            line += strspn(line, " \t\r");
+            if (*line == '\0' || *line == '#')
+                continue;
+
+            ASSERT_ZERO_MESSAGE(
+                    parse_job(&manifest->jobs[manifest->job_count], line),
+                    "Invalid job description");
+            manifest->job_count++;
+        }
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        manifest_dispose(manifest);
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    return 0;
+}
+
+void manifest_dispose(BatchManifest* manifest)
+{
+    SAFE_BLOCK_START
+    {
+        ASSERT_TRUE_MESSAGE(manifest != NULL, "manifest");
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        return;
+    }
+    SAFE_BLOCK_END
+
+    free(manifest->jobs);
+    free(manifest->text);
+
+    manifest->job_count = 0;
+    manifest->jobs      = NULL;
+    manifest->text      = NULL;
+}
+
+static char* read_file(const char* filename)
+{
+    FILE* file = fopen(filename, "rb");
+    if (!file)
+        return NULL;
+
+    char* text = NULL;
+
+    SAFE_BLOCK_START
+    {
+        ASSERT_ZERO(
+                fseek(file, 0, SEEK_END));
+
+        const long file_size = ftell(file);
+        ASSERT_NON_NEGATIVE(file_size);
+
+        ASSERT_ZERO(
+                fseek(file, 0, SEEK_SET));
+
+        text = (char*) calloc((size_t) file_size + 1, sizeof(*text));
+        ASSERT_TRUE_MESSAGE(text != NULL, "Failed to allocate memory");
+
+        ASSERT_EQUAL(
+                fread(text, sizeof(*text), (size_t) file_size, file),
+                (size_t) file_size);
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        free(text);
+        text = NULL;
+    }
+    SAFE_BLOCK_END
+
+    fclose(file);
+
+    return text;
+}
+
+static int parse_job(BatchJob* job, char* line)
+{
+    static const char separators[] = " \t\r";
+
+    char* field_state = NULL;
+    const char* fields[5] = {};
+
+    fields[0] = strtok_r(line, separators, &field_state);
+    for (size_t i = 1; i < 5; ++i)
+        fields[i] = strtok_r(NULL, separators, &field_state);
+
+    SAFE_BLOCK_START
+    {
+        ASSERT_TRUE_MESSAGE(fields[4] != NULL, "Too few fields");
+        ASSERT_TRUE_MESSAGE(strtok_r(NULL, separators, &field_state) == NULL,
+                            "Too many fields");
+
+        ASSERT_ZERO_MESSAGE(
+                parse_coordinate(&job->fg_pos.x, fields[3]), fields[3]);
+        ASSERT_ZERO_MESSAGE(
+                parse_coordinate(&job->fg_pos.y, fields[4]), fields[4]);
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    job->fg_image_name  = fields[0];
+    job->bg_image_name  = fields[1];
+    job->out_image_name = fields[2];
+
+    return 0;
+}
+
+static int parse_coordinate(size_t* coordinate, const char* field)
+{
+    if (*field < '0' || *field > '9')
+        return -1;
+
+    char* end = NULL;
+    errno = 0;
+    const unsigned long long value = strtoull(field, &end, 10);
+
+    if (errno != 0 || *end != '\0')
+        return -1;
+
+    *coordinate = (size_t) value;
+    return 0;
+}
@@ -0,0 +1,57 @@
+/**
+ * @file manifest.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief List of offline compositing jobs
+ *
+ * @version 0.1
+ * @date 2023-04-30
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __MANIFEST_H
+#define __MANIFEST_H
+
+#include "commons/definitions.h"
+
+/**
+ * @brief Blend foreground image on top of background one at `fg_pos` and
+ * save result to output file
+ */
+struct BatchJob
+{
+    const char* fg_image_name;
+    const char* bg_image_name;
+    const char* out_image_name;
+
+    SizeVector2 fg_pos;
+};
+
+struct BatchManifest
+{
+    size_t    job_count;
+    BatchJob* jobs;
+
+    char*     text;     // Manifest file contents, job names point into it
+};
+
+/**
+ * @brief Read jobs from manifest file. Every non-empty line, which does not
+ * start with '#', describes one job as whitespace-separated fields:
+ * `<foreground> <background> <output> <x> <y>`
+ *
+ * @param[out] manifest	- Read manifest
+ * @param[in]  filename	- Name of manifest file
+ *
+ * @return 0 upon success, -1 upon error
+ */
+int manifest_load(BatchManifest* manifest, const char* filename);
+
+/**
+ * @brief Free memory, allocated in `manifest_load`
+ *
+ * @param[inout] manifest	- Previously loaded manifest
+ */
+void manifest_dispose(BatchManifest* manifest);
+
+#endif /* manifest.h */
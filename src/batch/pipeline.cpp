@@ -0,0 +1,319 @@
+#include <stdlib.h>
+#include <time.h>
+
+#include "meerkat_assert/asserts.h"
+#include "commons/bounded_queue.h"
+#include "commons/thread_pool.h"
+#include "blending/blender.h"
+#include "sfml_wrapped/loader.h"
+
+#include "manifest.h"
+#include "pipeline.h"
+
+struct BatchItem
+{
+    const BatchJob* job;
+
+    ImageFile  foreground;
+    ImageFile  background;      // Blended in place
+
+    bool       is_failed;
+};
+
+struct BatchPipeline
+{
+    const BatchManifest* manifest;
+    BlendMode            blend_mode;
+
+    BoundedQueue         decoded;   // Loaded images, waiting for workers
+    BoundedQueue         composed;  // Blended images, waiting for writer
+
+    PixelPool            pixels;    // Buffers of converted images, reused
+                                    // by later jobs
+
+    size_t               saved_count;   // Written by writing thread only
+    size_t               pixel_count;   // Written by writing thread only
+};
+
+static void* decode_main   (void* pipeline_ptr);
+static void* composite_main(void* pipeline_ptr);
+static void* write_main    (void* pipeline_ptr);
+static void  dispose_item  (BatchItem* item);
+static int   run_pipeline  (BatchPipeline* pipeline, size_t worker_count);
+
+__always_inline
+static double get_seconds(void)
+{
+    timespec now = {};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (double) now.tv_sec + (double) now.tv_nsec * 1e-9;
+}
+
+int run_batch(const BatchConfig* config, BatchStats* stats)
+{
+    SAFE_BLOCK_START    // Validate parameters
+    {
+        ASSERT_TRUE_MESSAGE(config != NULL, "config");
+        ASSERT_TRUE_MESSAGE(stats  != NULL, "stats");
+        ASSERT_TRUE_MESSAGE(config->manifest_name != NULL, "manifest_name");
+        ASSERT_LESS(config->blend_mode, BLEND_MODE_COUNT);
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    const double start_time = get_seconds();
+
+    size_t worker_count = config->worker_count;
+    if (worker_count == 0)
+    {
+        // Decoding and writing threads mostly wait for disk
+        const size_t cpu_count = get_allowed_cpu_count();
+        worker_count = cpu_count > 3 ? cpu_count - 2 : 1;
+    }
+
+    const size_t queue_capacity = config->queue_capacity
+                                ? config->queue_capacity
+                                : 2 * worker_count;
+
+    BatchManifest manifest = {};
+    BatchPipeline pipeline = {
+        .manifest    = &manifest,
+        .blend_mode  = config->blend_mode,
+        .decoded     = {},
+        .composed    = {},
+        .pixels      = {},
+        .saved_count = 0,
+        .pixel_count = 0
+    };
+
+    bool has_decoded  = false;
+    bool has_composed = false;
+    bool has_pixels   = false;
+    int  result       = 0;
+
+    SAFE_BLOCK_START
+    {
+        ASSERT_ZERO_MESSAGE(
+                manifest_load(&manifest, config->manifest_name),
+                config->manifest_name);
+
+        ASSERT_ZERO(
+                bounded_queue_init(&pipeline.decoded, queue_capacity));
+        has_decoded = true;
+
+        ASSERT_ZERO(
+                bounded_queue_init(&pipeline.composed, queue_capacity));
+        has_composed = true;
+
+        // Cached buffers are bounded by the number of images in flight
+        ASSERT_ZERO(
+                pixel_pool_init(&pipeline.pixels, 0, /* prefault */ true));
+        has_pixels = true;
+
+        ASSERT_ZERO(
+                run_pipeline(&pipeline, worker_count));
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        result = -1;
+    }
+    SAFE_BLOCK_END
+
+    if (has_pixels)
+        pixel_pool_dispose(&pipeline.pixels);
+    if (has_composed)
+        bounded_queue_dispose(&pipeline.composed);
+    if (has_decoded)
+        bounded_queue_dispose(&pipeline.decoded);
+
+    stats->job_count       = manifest.job_count;
+    stats->failed_count    = manifest.job_count - pipeline.saved_count;
+    stats->pixel_count     = pipeline.pixel_count;
+    stats->elapsed_seconds = get_seconds() - start_time;
+
+    manifest_dispose(&manifest);
+
+    if (stats->failed_count > 0)
+        result = -1;
+
+    return result;
+}
+
+/*
+ * Every stage drains its input queue before exiting, so the queues are
+ * closed in pipeline order: each one after all of its producers have
+ * been joined. This also shuts down correctly if some threads failed
+ * to start.
+ */
+static int run_pipeline(BatchPipeline* pipeline, size_t worker_count)
+{
+    pthread_t  decoder = {};
+    pthread_t  writer  = {};
+    pthread_t* workers = (pthread_t*) calloc(worker_count, sizeof(*workers));
+
+    if (!workers)
+        return -1;
+
+    bool   has_writer  = false;
+    bool   has_decoder = false;
+    size_t started_workers = 0;
+
+    SAFE_BLOCK_START    // Start stages, consumers first
+    {
+        ASSERT_ZERO_MESSAGE(
+                pthread_create(&writer, NULL, write_main, pipeline),
+                "Failed to start writing thread");
+        has_writer = true;
+
+        for (; started_workers < worker_count; ++started_workers)
+        {
+            if (pthread_create(&workers[started_workers], NULL,
+                               composite_main, pipeline) != 0)
+                break;
+        }
+        ASSERT_EQUAL_MESSAGE(started_workers, worker_count,
+                             "Failed to start compositing thread");
+
+        ASSERT_ZERO_MESSAGE(
+                pthread_create(&decoder, NULL, decode_main, pipeline),
+                "Failed to start decoding thread");
+        has_decoder = true;
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+    }
+    SAFE_BLOCK_END
+
+    if (has_decoder)
+        pthread_join(decoder, NULL);
+    bounded_queue_close(&pipeline->decoded);
+
+    for (size_t i = 0; i < started_workers; ++i)
+        pthread_join(workers[i], NULL);
+    bounded_queue_close(&pipeline->composed);
+
+    if (has_writer)
+        pthread_join(writer, NULL);
+
+    free(workers);
+
+    return has_decoder ? 0 : -1;
+}
+
+static void* decode_main(void* pipeline_ptr)
+{
+    BatchPipeline* pipeline = (BatchPipeline*) pipeline_ptr;
+    const BatchManifest* manifest = pipeline->manifest;
+
+    for (size_t i = 0; i < manifest->job_count; ++i)
+    {
+        BatchItem* item = (BatchItem*) calloc(1, sizeof(*item));
+        if (!item)
+            continue;   // Counted as failed, since it is never saved
+
+        item->job = &manifest->jobs[i];
+
+        SAFE_BLOCK_START
+        {
+            ASSERT_ZERO_MESSAGE(
+                    load_image_file(&item->foreground,
+                                    item->job->fg_image_name,
+                                    &pipeline->pixels),
+                    item->job->fg_image_name);
+            ASSERT_ZERO_MESSAGE(
+                    load_image_file(&item->background,
+                                    item->job->bg_image_name,
+                                    &pipeline->pixels),
+                    item->job->bg_image_name);
+        }
+        SAFE_BLOCK_HANDLE_ERRORS
+        {
+            // TODO: Logs
+            item->is_failed = true;
+        }
+        SAFE_BLOCK_END
+
+        // Failed jobs skip compositing, but are still released by writer
+        BoundedQueue* next_stage = item->is_failed ? &pipeline->composed
+                                                   : &pipeline->decoded;
+        if (bounded_queue_push(next_stage, item) != 0)
+            dispose_item(item);
+    }
+
+    return NULL;
+}
+
+static void* composite_main(void* pipeline_ptr)
+{
+    BatchPipeline* pipeline = (BatchPipeline*) pipeline_ptr;
+
+    void* item_ptr = NULL;
+    while (bounded_queue_pop(&pipeline->decoded, &item_ptr) == 0)
+    {
+        BatchItem* item = (BatchItem*) item_ptr;
+
+        // Every foreground is blended only once, so it is not worth
+        // premultiplying or indexing it
+        const MovedImage moved_fg = {
+            .size        = item->foreground.image.size,
+            .pos         = item->job->fg_pos,
+            .pixel_array = item->foreground.image.pixel_array,
+            .blend_mode  = pipeline->blend_mode,
+            .spans       = NULL,
+            .modulation  = NULL
+        };
+
+        if (blend_pixels_optimized(&item->background.image, &moved_fg) != 0)
+            item->is_failed = true;
+
+        // Free foreground before the item waits for writer
+        unload_image_file(&item->foreground);
+
+        if (bounded_queue_push(&pipeline->composed, item) != 0)
+            dispose_item(item);
+    }
+
+    return NULL;
+}
+
+static void* write_main(void* pipeline_ptr)
+{
+    BatchPipeline* pipeline = (BatchPipeline*) pipeline_ptr;
+
+    void* item_ptr = NULL;
+    while (bounded_queue_pop(&pipeline->composed, &item_ptr) == 0)
+    {
+        BatchItem* item = (BatchItem*) item_ptr;
+
+        if (!item->is_failed &&
+            save_image_to_file(&item->background.image,
+                               item->job->out_image_name) == 0)
+        {
+            pipeline->saved_count++;
+            pipeline->pixel_count += item->background.image.size.x
+                                   * item->background.image.size.y;
+        }
+
+        dispose_item(item);
+    }
+
+    return NULL;
+}
+
+static void dispose_item(BatchItem* item)
+{
+    if (item->foreground.image.pixel_array)
+        unload_image_file(&item->foreground);
+    if (item->background.image.pixel_array)
+        unload_image_file(&item->background);
+
+    free(item);
+}
@@ -0,0 +1,53 @@
+/**
+ * @file pipeline.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Headless compositing of many images, overlapping disk I/O
+ * and decoding with blending
+ *
+ * @version 0.1
+ * @date 2023-04-30
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __PIPELINE_H
+#define __PIPELINE_H
+
+#include "commons/definitions.h"
+
+struct BatchConfig
+{
+    const char* manifest_name;  // See `batch/manifest.h`
+
+    size_t worker_count;        // Zero means one worker per allowed CPU,
+                                // excluding decoding and writing threads
+    size_t queue_capacity;      // Zero means twice the number of workers
+
+    BlendMode blend_mode;
+};
+
+struct BatchStats
+{
+    size_t job_count;
+    size_t failed_count;        // Jobs, which could not be loaded, blended
+                                // or saved
+    size_t pixel_count;         // Total size of saved images
+
+    double elapsed_seconds;     // Wall time, including manifest parsing
+};
+
+/**
+ * @brief Run every job from manifest in three-stage pipeline.
+ * Decoding thread loads images, compositing workers blend them with
+ * `blend_pixels_optimized` and writing thread saves results. Stages are
+ * connected by bounded queues, so at most `2*queue_capacity + worker_count`
+ * images are held in memory at once.
+ *
+ * @param[in]  config	- Pipeline parameters
+ * @param[out] stats	- Throughput statistics
+ *
+ * @return 0 if every job was run successfully, -1 otherwise
+ */
+int run_batch(const BatchConfig* config, BatchStats* stats);
+
+#endif /* pipeline.h */
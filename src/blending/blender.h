@@ -12,8 +12,9 @@
 #ifndef __BLENDER_H
 #define __BLENDER_H
 
-#include <immintrin.h>
+#include "commons/intrinsics.h"
 #include "commons/definitions.h"
+#include "commons/thread_pool.h"
 
 /**
  * @brief Blend foreground on top of background
@@ -25,7 +26,59 @@
 void combine_pixels(Pixel* bg, const Pixel* fg);
 
 /**
- * @brief Blend several 16 foreground pixels on top of background
+ * @brief Blend foreground on top of background. Unlike `combine_pixels`,
+ * division by 255 is correctly rounded, so that opaque foreground is
+ * reproduced exactly and repeated blending does not darken image.
+ *
+ * @param[inout] bg - Background pixel
+ * @param[in]    fg - Foreground pixel
+ *
+ */
+void combine_pixels_exact(Pixel* bg, const Pixel* fg);
+
+/**
+ * @brief Blend premultiplied foreground on top of background. Requires
+ * only one multiplication per channel: `(bg*(255 - a) + (fg << 8)) >> 8`
+ *
+ * @param[inout] bg - Background pixel
+ * @param[in]    fg - Foreground pixel, premultiplied by its alpha
+ *
+ */
+void combine_pixels_premultiplied(Pixel* bg, const Pixel* fg);
+
+/**
+ * @brief Blend premultiplied foreground on top of background with
+ * correctly rounded division: `round(bg*(255 - a) / 255) + fg`
+ *
+ * @param[inout] bg - Background pixel
+ * @param[in]    fg - Foreground pixel, premultiplied by its alpha
+ *
+ */
+void combine_pixels_premultiplied_exact(Pixel* bg, const Pixel* fg);
+
+/**
+ * @brief Blend foreground on top of background in linear light. Channels
+ * are decoded from sRGB, blended with 16-bit precision and encoded back,
+ * so that anti-aliased edges do not look darker than they should.
+ * Background alpha is left unchanged.
+ *
+ * @param[inout] bg - Background pixel
+ * @param[in]    fg - Foreground pixel
+ *
+ */
+void combine_pixels_linear(Pixel* bg, const Pixel* fg);
+
+/**
+ * @brief Multiply color channels of every pixel by its alpha.
+ * Intended to be run once, when foreground image is loaded.
+ *
+ * @param[inout] image	- Image to be converted
+ */
+void premultiply_alpha(PixelImage* image);
+
+/**
+ * @brief Blend 16 foreground pixels on top of background.
+ * Requires AVX-512F and AVX-512BW.
  *
  * @param[inout] bg - Background pixels
  * @param[in]    fg - Foreground pixels
@@ -33,9 +86,62 @@ void combine_pixels(Pixel* bg, const Pixel* fg);
  */
 __m512i combine_pixels_simd(__m512i bg, __m512i fg);
 
+/**
+ * @brief Blend 8 foreground pixels on top of background.
+ * Requires AVX2. Results match `combine_pixels_simd` exactly.
+ *
+ * @param[inout] bg - Background pixels
+ * @param[in]    fg - Foreground pixels
+ *
+ */
+__m256i combine_pixels_simd256(__m256i bg, __m256i fg);
+
+/**
+ * @brief Blend 4 foreground pixels on top of background.
+ * Requires SSE4.1. Results match `combine_pixels_simd` exactly.
+ *
+ * @param[inout] bg - Background pixels
+ * @param[in]    fg - Foreground pixels
+ *
+ */
+__m128i combine_pixels_simd128(__m128i bg, __m128i fg);
+
+/**
+ * @brief Blend 16 foreground pixels on top of background with correctly
+ * rounded division. Requires AVX-512F and AVX-512BW.
+ * Results match `combine_pixels_exact` exactly.
+ *
+ * @param[inout] bg - Background pixels
+ * @param[in]    fg - Foreground pixels
+ *
+ */
+__m512i combine_pixels_simd_exact(__m512i bg, __m512i fg);
+
+/**
+ * @brief Blend 8 foreground pixels on top of background with correctly
+ * rounded division. Requires AVX2.
+ * Results match `combine_pixels_exact` exactly.
+ *
+ * @param[inout] bg - Background pixels
+ * @param[in]    fg - Foreground pixels
+ *
+ */
+__m256i combine_pixels_simd256_exact(__m256i bg, __m256i fg);
+
+/**
+ * @brief Blend 4 foreground pixels on top of background with correctly
+ * rounded division. Requires SSE4.1.
+ * Results match `combine_pixels_exact` exactly.
+ *
+ * @param[inout] bg - Background pixels
+ * @param[in]    fg - Foreground pixels
+ *
+ */
+__m128i combine_pixels_simd128_exact(__m128i bg, __m128i fg);
+
 /**
  * @brief Blend foreground on top of backround and store result
- * in background
+ * in background. Foreground modulation is applied to every pixel.
  *
  * @param[inout] background	- Image background
  * @param[in]    foreground	- Image foreground
@@ -47,7 +153,11 @@ int blend_pixels_simple(PixelImage* background,
 
 /**
  * @brief Blend foreground on top of backround and store result
- * in background
+ * in background. Uses the widest vector instructions supported by CPU
+ * and division, selected by `foreground->blend_mode`. If foreground has
+ * span index, transparent runs are skipped and opaque runs are copied.
+ * If foreground has modulation, it is applied in registers, right before
+ * blending, and opaque runs are blended as well.
  *
  * @param[inout] background	- Image background
  * @param[in]    foreground	- Image foreground
@@ -57,4 +167,54 @@ int blend_pixels_simple(PixelImage* background,
 int blend_pixels_optimized(PixelImage* background,
                             const MovedImage* foreground);
 
+/**
+ * @brief Blend foreground on top of backround and store result
+ * in background. Rows are split into bands, processed by pool threads.
+ *
+ * @param[inout] background	- Image background
+ * @param[in]    foreground	- Image foreground
+ * @param[inout] pool	    - Worker threads. If NULL, only the calling
+ *                            thread is used
+ *
+ * @return 0 upon success, -1 upon invalid arguments
+ */
+int blend_pixels_parallel(PixelImage* background,
+                           const MovedImage* foreground,
+                           ThreadPool* pool);
+
+/**
+ * @brief Blend foreground, premultiplied by `premultiply_alpha`, on top
+ * of backround and store result in background. Division is selected by
+ * `foreground->blend_mode`. Modulation scales all four premultiplied
+ * channels by opacity, and color channels by tint as well.
+ *
+ * @param[inout] background	- Image background
+ * @param[in]    foreground	- Premultiplied image foreground
+ * @param[inout] pool	    - Worker threads. If NULL, only the calling
+ *                            thread is used
+ *
+ * @return 0 upon success, -1 upon invalid arguments
+ */
+int blend_premultiplied(PixelImage* background,
+                        const MovedImage* foreground,
+                        ThreadPool* pool);
+
+/**
+ * @brief Blend foreground on top of backround in linear light with
+ * `combine_pixels_linear` and store result in background.
+ * `foreground->blend_mode` is ignored. If foreground has span index,
+ * transparent runs are skipped and opaque runs are copied. Modulation
+ * is not supported.
+ *
+ * @param[inout] background	- Image background
+ * @param[in]    foreground	- Image foreground
+ * @param[inout] pool	    - Worker threads. If NULL, only the calling
+ *                            thread is used
+ *
+ * @return 0 upon success, -1 upon invalid arguments
+ */
+int blend_pixels_linear(PixelImage* background,
+                        const MovedImage* foreground,
+                        ThreadPool* pool);
+
 #endif /* blender.h */
@@ -0,0 +1,236 @@
+#include <stdlib.h>
+
+#include "meerkat_assert/asserts.h"
+#include "commons/cpu_features.h"
+
+#include "blender16.h"
+#include "blender16_rows.h"
+
+// Indexed by SimdLevel
+static blend_row16_t* const BLEND_ROW16_KERNELS[SIMD_LEVEL_COUNT] = {
+    blend_row16_scalar,
+    blend_row16_sse4,
+    blend_row16_avx2,
+    blend_row16_avx512
+};
+
+// Indexed by SimdLevel
+static pack_row16_t* const PACK_ROW16_KERNELS[SIMD_LEVEL_COUNT] = {
+    pack_row16_scalar,
+    pack_row16_sse4,
+    pack_row16_avx2,
+    pack_row16_avx512
+};
+
+int pixel_image16_init(PixelImage16* image, SizeVector2 size)
+{
+    SAFE_BLOCK_START    // Validate parameters
+    {
+        ASSERT_TRUE_MESSAGE(image != NULL, "image");
+        ASSERT_POSITIVE_MESSAGE(size.x, "size.x");
+        ASSERT_POSITIVE_MESSAGE(size.y, "size.y");
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    const size_t pixel_count = size.x * size.y;
+
+    SAFE_BLOCK_START
+    {
+        ASSERT_TRUE_MESSAGE_CALLBACK(
+                pixel_count / size.x == size.y &&
+                pixel_count * sizeof(Pixel16) / sizeof(Pixel16)
+                    == pixel_count,
+                "Integer multiplication overflow",
+                errno = EOVERFLOW);
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    Pixel16* pixels = NULL;
+    if (posix_memalign((void**) &pixels, PIXEL_ALIGNMENT,
+                       pixel_count * sizeof(*pixels)) != 0)
+    {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    image->size        = size;
+    image->pixel_array = pixels;
+
+    return 0;
+}
+
+void pixel_image16_dispose(PixelImage16* image)
+{
+    free(image->pixel_array);
+    image->pixel_array = NULL;
+}
+
+__always_inline
+static uint16_t widen_channel(uint8_t channel)
+{
+    return (uint16_t) (channel * 257);
+}
+
+/*
+ * round(c*257 * a*257 / 65535) == round(c*a*257 / 255)
+ */
+__always_inline
+static uint16_t widen_premultiplied(uint8_t channel, uint8_t alpha)
+{
+    return (uint16_t) ((channel * alpha * 257u + 127) / 255);
+}
+
+int widen_pixels(PixelImage16* dst, const PixelImage* src, bool premultiply)
+{
+    SAFE_BLOCK_START
+    {
+        ASSERT_EQUAL(dst->size.x, src->size.x);
+        ASSERT_EQUAL(dst->size.y, src->size.y);
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    const size_t pixel_count = src->size.x * src->size.y;
+
+    for (size_t i = 0; i < pixel_count; ++i)
+    {
+        const Pixel* pixel = src->pixel_array + i;
+        const uint8_t alpha = premultiply ? pixel->alpha : 255;
+
+        dst->pixel_array[i] = {
+            .red   = widen_premultiplied(pixel->red,   alpha),
+            .green = widen_premultiplied(pixel->green, alpha),
+            .blue  = widen_premultiplied(pixel->blue,  alpha),
+            .alpha = widen_channel(pixel->alpha)
+        };
+    }
+
+    return 0;
+}
+
+struct BlendRows16Task
+{
+    Pixel16*       bg_pixels;
+    size_t         bg_size_x;
+
+    const Pixel16* fg_pixels;
+    size_t         fg_size_x;
+
+    blend_row16_t* blend_row;
+};
+
+static void blend_rows16(void* task_ptr, size_t begin, size_t end)
+{
+    const BlendRows16Task* task = (const BlendRows16Task*) task_ptr;
+
+    Pixel16* bg_row = task->bg_pixels + begin * task->bg_size_x;
+    const Pixel16* fg_row = task->fg_pixels + begin * task->fg_size_x;
+
+    for (size_t y = begin; y < end; ++y)
+    {
+        task->blend_row(bg_row, fg_row, task->fg_size_x);
+
+        fg_row += task->fg_size_x;
+        bg_row += task->bg_size_x;
+    }
+}
+
+int blend_pixels16(PixelImage16* background, const MovedImage16* foreground,
+                   ThreadPool* pool)
+{
+    const size_t bg_size_x = background->size.x;
+
+    SAFE_BLOCK_START
+    {
+        ASSERT_LESS_EQUAL(
+                foreground->pos.x + foreground->size.x, bg_size_x);
+        ASSERT_LESS_EQUAL(
+                foreground->pos.y + foreground->size.y, background->size.y);
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    BlendRows16Task task = {
+        .bg_pixels = background->pixel_array
+                     + bg_size_x * foreground->pos.y + foreground->pos.x,
+        .bg_size_x = bg_size_x,
+        .fg_pixels = foreground->pixel_array,
+        .fg_size_x = foreground->size.x,
+        .blend_row = BLEND_ROW16_KERNELS[get_simd_level()]
+    };
+
+    if (pool)
+        thread_pool_run(pool, blend_rows16, &task, foreground->size.y);
+    else
+        blend_rows16(&task, 0, foreground->size.y);
+
+    return 0;
+}
+
+struct PackRows16Task
+{
+    Pixel*         dst_pixels;
+    const Pixel16* src_pixels;
+    size_t         size_x;
+
+    pack_row16_t*  pack_row;
+};
+
+static void pack_rows16(void* task_ptr, size_t begin, size_t end)
+{
+    const PackRows16Task* task = (const PackRows16Task*) task_ptr;
+
+    for (size_t y = begin; y < end; ++y)
+        task->pack_row(task->dst_pixels + y * task->size_x,
+                       task->src_pixels + y * task->size_x,
+                       task->size_x, y);
+}
+
+int pack_pixels16(PixelImage* dst, const PixelImage16* src, ThreadPool* pool)
+{
+    SAFE_BLOCK_START
+    {
+        ASSERT_EQUAL(dst->size.x, src->size.x);
+        ASSERT_EQUAL(dst->size.y, src->size.y);
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    PackRows16Task task = {
+        .dst_pixels = dst->pixel_array,
+        .src_pixels = src->pixel_array,
+        .size_x     = src->size.x,
+        .pack_row   = PACK_ROW16_KERNELS[get_simd_level()]
+    };
+
+    if (pool)
+        thread_pool_run(pool, pack_rows16, &task, src->size.y);
+    else
+        pack_rows16(&task, 0, src->size.y);
+
+    return 0;
+}
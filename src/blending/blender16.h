@@ -0,0 +1,124 @@
+/**
+ * @file blender16.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief High-precision compositing with 16 bits per channel. Layers are
+ * blended without rounding to 8 bits, and only the final image is packed.
+ *
+ * @version 0.1
+ * @date 2023-05-07
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __BLENDER16_H
+#define __BLENDER16_H
+
+#include "commons/intrinsics.h"
+#include "commons/definitions.h"
+#include "commons/thread_pool.h"
+
+/**
+ * @brief Blend premultiplied foreground on top of background:
+ * `bg*(65535 - a) >> 16 + fg`. Background alpha is left unchanged.
+ *
+ * @param[inout] bg - Background pixel
+ * @param[in]    fg - Foreground pixel, premultiplied by its alpha
+ */
+void combine_pixels16(Pixel16* bg, const Pixel16* fg);
+
+/**
+ * @brief Blend 8 premultiplied foreground pixels on top of background.
+ * Requires AVX-512F and AVX-512BW. Results match `combine_pixels16` exactly.
+ *
+ * @param[in] bg - Background pixels
+ * @param[in] fg - Foreground pixels, premultiplied by their alpha
+ *
+ * @return Blended pixels
+ */
+__m512i combine_pixels16_simd(__m512i bg, __m512i fg);
+
+/**
+ * @brief Blend 4 premultiplied foreground pixels on top of background.
+ * Requires AVX2. Results match `combine_pixels16` exactly.
+ *
+ * @param[in] bg - Background pixels
+ * @param[in] fg - Foreground pixels, premultiplied by their alpha
+ *
+ * @return Blended pixels
+ */
+__m256i combine_pixels16_simd256(__m256i bg, __m256i fg);
+
+/**
+ * @brief Blend 2 premultiplied foreground pixels on top of background.
+ * Requires SSE4.1. Results match `combine_pixels16` exactly.
+ *
+ * @param[in] bg - Background pixels
+ * @param[in] fg - Foreground pixels, premultiplied by their alpha
+ *
+ * @return Blended pixels
+ */
+__m128i combine_pixels16_simd128(__m128i bg, __m128i fg);
+
+/**
+ * @brief Allocate image of given size. Pixel values are unspecified.
+ *
+ * @param[out] image	- Image to be initialized
+ * @param[in]  size	    - Image size in pixels
+ *
+ * @return 0 upon success, -1 upon error
+ */
+int pixel_image16_init(PixelImage16* image, SizeVector2 size);
+
+/**
+ * @brief Free pixels, allocated in `pixel_image16_init`
+ *
+ * @param[inout] image	- Previously initialized image
+ */
+void pixel_image16_dispose(PixelImage16* image);
+
+/**
+ * @brief Convert 8-bit image into 16-bit one of the same size. Intended
+ * to be run once, when image is loaded.
+ *
+ * @param[out] dst	        - Destination image
+ * @param[in]  src	        - Source image
+ * @param[in]  premultiply	- Whether color channels are multiplied by
+ *                            alpha, as foregrounds require. Result is
+ *                            rounded only once, after multiplication.
+ *
+ * @return 0 upon success, -1 upon invalid arguments
+ */
+int widen_pixels(PixelImage16* dst, const PixelImage* src, bool premultiply);
+
+/**
+ * @brief Blend premultiplied foreground on top of background and store
+ * result in background with `combine_pixels16`. Every blend is off by
+ * less than 1/256 of an 8-bit step, so many layers can be blended without
+ * banding.
+ *
+ * @param[inout] background	- Image background
+ * @param[in]    foreground	- Image foreground, premultiplied by alpha
+ * @param[inout] pool	    - Worker threads. If NULL, only the calling
+ *                            thread is used
+ *
+ * @return 0 upon success, -1 upon invalid arguments
+ */
+int blend_pixels16(PixelImage16* background, const MovedImage16* foreground,
+                   ThreadPool* pool);
+
+/**
+ * @brief Pack 16-bit image into 8-bit one of the same size with ordered
+ * dithering: a 4x4 Bayer threshold is added to every channel before it is
+ * divided by 257. Values, which were widened from 8 bits, are restored
+ * exactly.
+ *
+ * @param[out]   dst	- Destination image
+ * @param[in]    src	- Source image
+ * @param[inout] pool	- Worker threads. If NULL, only the calling
+ *                        thread is used
+ *
+ * @return 0 upon success, -1 upon invalid arguments
+ */
+int pack_pixels16(PixelImage* dst, const PixelImage16* src, ThreadPool* pool);
+
+#endif /* blender16.h */
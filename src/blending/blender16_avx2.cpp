@@ -0,0 +1,93 @@
+#include "commons/intrinsics.h"
+
+#include "blender16.h"
+#include "blender16_rows.h"
+#include "shuffle_masks.h"
+
+__m256i combine_pixels16_simd256(__m256i bg, __m256i fg)
+{
+    const __m256i MASK_SPREAD_ALPHA = _mm256_set_epi8(
+        MASK_SPREAD_ALPHA16_ROW,
+        MASK_SPREAD_ALPHA16_ROW
+    );
+
+    const __m256i ALL_BITS = _mm256_set1_epi16(-1);
+
+    const __m256i fg_alpha = _mm256_shuffle_epi8(fg, MASK_SPREAD_ALPHA);
+    const __m256i bg_alpha = _mm256_xor_si256(fg_alpha, ALL_BITS);
+
+    const __m256i sum = _mm256_add_epi16(_mm256_mulhi_epu16(bg, bg_alpha),
+                                         fg);
+
+    // Restore background alpha
+    return _mm256_blend_epi16(bg, sum, IGNORE_ALPHA_BLEND);
+}
+
+void blend_row16_avx2(Pixel16* bg, const Pixel16* fg, size_t count)
+{
+    const size_t pixels_per_vector = sizeof(__m256i) / sizeof(Pixel16);
+
+    size_t x = 0;
+    for (; x + pixels_per_vector <= count; x += pixels_per_vector)
+    {
+        __m256i bg_pixels = _mm256_loadu_si256((const __m256i*)(bg + x));
+        __m256i fg_pixels = _mm256_loadu_si256((const __m256i*)(fg + x));
+        __m256i result = combine_pixels16_simd256(bg_pixels, fg_pixels);
+        _mm256_storeu_si256((__m256i*)(bg + x), result);
+    }
+
+    // Remaining pixels
+    for (; x < count; ++x)
+        combine_pixels16(bg + x, fg + x);
+}
+
+__always_inline
+static __m256i pack_pixels16_simd256(__m256i pixels, __m256i thresholds)
+{
+    const __m256i DIV_MULT = _mm256_set1_epi16((short) DIV_257_MULTIPLIER);
+
+    pixels = _mm256_adds_epu16(pixels, thresholds);
+    pixels = _mm256_mulhi_epu16(pixels, DIV_MULT);
+
+    return _mm256_srli_epi16(pixels, DIV_257_SHIFT);
+}
+
+void pack_row16_avx2(Pixel* dst, const Pixel16* src, size_t count, size_t y)
+{
+    const size_t pixels_per_vector = sizeof(__m256i) / sizeof(Pixel16);
+
+    // Vector covers a single period of dither matrix row
+    const DitherRow dither_row = get_dither_row(y);
+    const __m256i thresholds = _mm256_load_si256(
+                                (const __m256i*) dither_row.thresholds);
+
+    size_t x = 0;
+    for (; x + 2*pixels_per_vector <= count; x += 2*pixels_per_vector)
+    {
+        const __m256i* pixels = (const __m256i*) (src + x);
+
+        const __m256i low  = pack_pixels16_simd256(
+                                _mm256_loadu_si256(pixels + 0), thresholds);
+        const __m256i high = pack_pixels16_simd256(
+                                _mm256_loadu_si256(pixels + 1), thresholds);
+
+        // Packing works within lanes, so qwords have to be reordered
+        const __m256i packed = _mm256_permute4x64_epi64(
+                                    _mm256_packus_epi16(low, high), 0xD8);
+
+        _mm256_storeu_si256((__m256i*) (dst + x), packed);
+    }
+
+    // Remaining pixels
+    for (; x < count; ++x)
+    {
+        const uint16_t threshold = get_dither_threshold(x, y);
+
+        dst[x] = {
+            .red   = pack_channel16(src[x].red,   threshold),
+            .green = pack_channel16(src[x].green, threshold),
+            .blue  = pack_channel16(src[x].blue,  threshold),
+            .alpha = pack_channel16(src[x].alpha, threshold)
+        };
+    }
+}
@@ -0,0 +1,98 @@
+#include "commons/intrinsics.h"
+
+#include "blender16.h"
+#include "blender16_rows.h"
+#include "shuffle_masks.h"
+
+__m512i combine_pixels16_simd(__m512i bg, __m512i fg)
+{
+    const __m512i MASK_SPREAD_ALPHA = _mm512_set_epi8(
+        MASK_SPREAD_ALPHA16_ROW,
+        MASK_SPREAD_ALPHA16_ROW,
+        MASK_SPREAD_ALPHA16_ROW,
+        MASK_SPREAD_ALPHA16_ROW
+    );
+
+    const __mmask32 IGNORE_ALPHA = _cvtu32_mask32(IGNORE_ALPHA_BITS);
+
+    // Channels are already 16-bit: no spreading and packing
+    const __m512i fg_alpha = _mm512_shuffle_epi8(fg, MASK_SPREAD_ALPHA);
+    const __m512i bg_alpha = _mm512_ternarylogic_epi32(fg_alpha, fg_alpha,
+                                                       fg_alpha, 0x55);
+
+    const __m512i scaled = _mm512_mulhi_epu16(bg, bg_alpha);
+
+    return _mm512_mask_add_epi16(bg, IGNORE_ALPHA, scaled, fg);
+}
+
+void blend_row16_avx512(Pixel16* bg, const Pixel16* fg, size_t count)
+{
+    const size_t pixels_per_vector = sizeof(__m512i) / sizeof(Pixel16);
+
+    size_t x = 0;
+    for (; x + pixels_per_vector <= count; x += pixels_per_vector)
+    {
+        __m512i bg_pixels = _mm512_loadu_si512(bg + x);
+        __m512i fg_pixels = _mm512_loadu_si512(fg + x);
+        __m512i result = combine_pixels16_simd(bg_pixels, fg_pixels);
+        _mm512_storeu_si512(bg + x, result);
+    }
+
+    // Remaining pixels
+    if (x < count)
+    {
+        const __mmask8 mask = (__mmask8) ((1u << (count - x)) - 1);
+
+        __m512i bg_pixels = _mm512_maskz_loadu_epi64(mask, bg + x);
+        __m512i fg_pixels = _mm512_maskz_loadu_epi64(mask, fg + x);
+        __m512i result = combine_pixels16_simd(bg_pixels, fg_pixels);
+        _mm512_mask_storeu_epi64(bg + x, mask, result);
+    }
+}
+
+__always_inline
+static __m512i pack_pixels16_simd(__m512i pixels, __m512i thresholds)
+{
+    const __m512i DIV_MULT = _mm512_set1_epi16((short) DIV_257_MULTIPLIER);
+
+    pixels = _mm512_adds_epu16(pixels, thresholds);
+    pixels = _mm512_mulhi_epu16(pixels, DIV_MULT);
+
+    return _mm512_srli_epi16(pixels, DIV_257_SHIFT);
+}
+
+void pack_row16_avx512(Pixel* dst, const Pixel16* src, size_t count,
+                       size_t y)
+{
+    const size_t pixels_per_vector = sizeof(__m512i) / sizeof(Pixel16);
+
+    // Vector covers two periods of dither matrix row
+    const DitherRow dither_row = get_dither_row(y);
+    const __m512i thresholds = _mm512_load_si512(dither_row.thresholds);
+
+    size_t x = 0;
+    for (; x + pixels_per_vector <= count; x += pixels_per_vector)
+    {
+        const __m512i pixels = pack_pixels16_simd(_mm512_loadu_si512(src + x),
+                                                  thresholds);
+
+        // Every half-word is truncated to a byte
+        _mm256_storeu_si256((__m256i*) (dst + x),
+                            _mm512_cvtepi16_epi8(pixels));
+    }
+
+    // Remaining pixels
+    if (x < count)
+    {
+        const size_t rest = count - x;
+
+        const __m512i pixels = pack_pixels16_simd(
+                _mm512_maskz_loadu_epi64((__mmask8) ((1u << rest) - 1),
+                                         src + x),
+                thresholds);
+
+        _mm512_mask_cvtepi16_storeu_epi8(dst + x,
+                                         _cvtu32_mask32((1u << 4*rest) - 1),
+                                         pixels);
+    }
+}
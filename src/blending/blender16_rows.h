@@ -0,0 +1,111 @@
+/**
+ * @file blender16_rows.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Row kernels for 16-bit pixels, built for several instruction
+ * set levels
+ *
+ * @version 0.1
+ * @date 2023-05-07
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __BLENDER16_ROWS_H
+#define __BLENDER16_ROWS_H
+
+#include "commons/definitions.h"
+
+#define DITHER_MATRIX_SIZE 4
+
+/*
+ * floor(x / 257) == (x * 0xFF01) >> 24 for every 16-bit x
+ */
+#define DIV_257_MULTIPLIER 0xFF01
+#define DIV_257_SHIFT      8
+
+/**
+ * @brief Blend a row of premultiplied foreground pixels on top of
+ * background row
+ *
+ * @param[inout] bg	    - Background row
+ * @param[in]    fg	    - Foreground row
+ * @param[in]    count	- Number of pixels in row
+ */
+typedef void blend_row16_t(Pixel16* bg, const Pixel16* fg, size_t count);
+
+/**
+ * @brief Pack a whole image row with ordered dithering
+ *
+ * @param[out] dst	    - Destination row
+ * @param[in]  src	    - Source row
+ * @param[in]  count	- Number of pixels in row
+ * @param[in]  y	    - Row index, selects row of dither matrix
+ */
+typedef void pack_row16_t(Pixel* dst, const Pixel16* src, size_t count,
+                          size_t y);
+
+blend_row16_t blend_row16_scalar;
+blend_row16_t blend_row16_sse4;
+blend_row16_t blend_row16_avx2;
+blend_row16_t blend_row16_avx512;
+
+pack_row16_t pack_row16_scalar;
+pack_row16_t pack_row16_sse4;
+pack_row16_t pack_row16_avx2;
+pack_row16_t pack_row16_avx512;
+
+/**
+ * @brief Threshold of 4x4 Bayer matrix, scaled to [8; 248]. Its mean is
+ * half of 257, so that dithering does not shift brightness.
+ *
+ * @param[in] x	- Column index
+ * @param[in] y	- Row index
+ *
+ * @return Value, added to 16-bit channel before division by 257
+ */
+static inline uint16_t get_dither_threshold(size_t x, size_t y)
+{
+    static const uint8_t BAYER_MATRIX[DITHER_MATRIX_SIZE][DITHER_MATRIX_SIZE]
+    = {
+        { 0,  8,  2, 10},
+        {12,  4, 14,  6},
+        { 3, 11,  1,  9},
+        {15,  7, 13,  5}
+    };
+
+    return (uint16_t) (BAYER_MATRIX[y % DITHER_MATRIX_SIZE]
+                                   [x % DITHER_MATRIX_SIZE] * 16 + 8);
+}
+
+/**
+ * @brief Thresholds for every channel of 8 consecutive pixels, starting
+ * at a column, divisible by `DITHER_MATRIX_SIZE`. Vector kernels load
+ * them as a whole.
+ */
+struct DitherRow
+{
+    alignas(64) uint16_t thresholds[8 * 4];
+};
+
+static inline DitherRow get_dither_row(size_t y)
+{
+    DitherRow row = {};
+    for (size_t i = 0; i < 8 * 4; ++i)
+        row.thresholds[i] = get_dither_threshold(i / 4, y);
+
+    return row;
+}
+
+/**
+ * @brief Saturating addition of threshold and division by 257
+ */
+static inline uint8_t pack_channel16(uint16_t value, uint16_t threshold)
+{
+    const uint32_t sum = (uint32_t) value + threshold;
+    const uint32_t clamped = sum < UINT16_MAX ? sum : UINT16_MAX;
+
+    return (uint8_t) ((clamped * DIV_257_MULTIPLIER)
+                      >> (16 + DIV_257_SHIFT));
+}
+
+#endif /* blender16_rows.h */
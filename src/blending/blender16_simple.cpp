@@ -0,0 +1,44 @@
+#include "blender16.h"
+#include "blender16_rows.h"
+
+/*
+ * Foreground is premultiplied, so only background is scaled. The sum never
+ * exceeds 65535: both products are rounded down.
+ */
+__always_inline
+static uint16_t blend_channel16(uint16_t bg, uint16_t fg, uint16_t fg_alpha)
+{
+    return (uint16_t) (((uint32_t) bg * (UINT16_MAX - fg_alpha) >> 16) + fg);
+}
+
+void combine_pixels16(Pixel16* bg, const Pixel16* fg)
+{
+    const uint16_t fg_alpha = fg->alpha;
+
+    bg->red   = blend_channel16(bg->red,   fg->red,   fg_alpha);
+    bg->green = blend_channel16(bg->green, fg->green, fg_alpha);
+    bg->blue  = blend_channel16(bg->blue,  fg->blue,  fg_alpha);
+}
+
+void blend_row16_scalar(Pixel16* bg, const Pixel16* fg, size_t count)
+{
+    for (size_t x = 0; x < count; ++x)
+    {
+        combine_pixels16(bg + x, fg + x);
+    }
+}
+
+void pack_row16_scalar(Pixel* dst, const Pixel16* src, size_t count, size_t y)
+{
+    for (size_t x = 0; x < count; ++x)
+    {
+        const uint16_t threshold = get_dither_threshold(x, y);
+
+        dst[x] = {
+            .red   = pack_channel16(src[x].red,   threshold),
+            .green = pack_channel16(src[x].green, threshold),
+            .blue  = pack_channel16(src[x].blue,  threshold),
+            .alpha = pack_channel16(src[x].alpha, threshold)
+        };
+    }
+}
@@ -0,0 +1,86 @@
+#include "commons/intrinsics.h"
+
+#include "blender16.h"
+#include "blender16_rows.h"
+#include "shuffle_masks.h"
+
+__m128i combine_pixels16_simd128(__m128i bg, __m128i fg)
+{
+    const __m128i MASK_SPREAD_ALPHA = _mm_set_epi8(MASK_SPREAD_ALPHA16_ROW);
+
+    const __m128i ALL_BITS = _mm_set1_epi16(-1);
+
+    const __m128i fg_alpha = _mm_shuffle_epi8(fg, MASK_SPREAD_ALPHA);
+    const __m128i bg_alpha = _mm_xor_si128(fg_alpha, ALL_BITS);
+
+    const __m128i sum = _mm_add_epi16(_mm_mulhi_epu16(bg, bg_alpha), fg);
+
+    // Restore background alpha
+    return _mm_blend_epi16(bg, sum, IGNORE_ALPHA_BLEND);
+}
+
+void blend_row16_sse4(Pixel16* bg, const Pixel16* fg, size_t count)
+{
+    const size_t pixels_per_vector = sizeof(__m128i) / sizeof(Pixel16);
+
+    size_t x = 0;
+    for (; x + pixels_per_vector <= count; x += pixels_per_vector)
+    {
+        __m128i bg_pixels = _mm_loadu_si128((const __m128i*)(bg + x));
+        __m128i fg_pixels = _mm_loadu_si128((const __m128i*)(fg + x));
+        __m128i result = combine_pixels16_simd128(bg_pixels, fg_pixels);
+        _mm_storeu_si128((__m128i*)(bg + x), result);
+    }
+
+    // Remaining pixels
+    for (; x < count; ++x)
+        combine_pixels16(bg + x, fg + x);
+}
+
+__always_inline
+static __m128i pack_pixels16_simd128(__m128i pixels, __m128i thresholds)
+{
+    const __m128i DIV_MULT = _mm_set1_epi16((short) DIV_257_MULTIPLIER);
+
+    pixels = _mm_adds_epu16(pixels, thresholds);
+    pixels = _mm_mulhi_epu16(pixels, DIV_MULT);
+
+    return _mm_srli_epi16(pixels, DIV_257_SHIFT);
+}
+
+void pack_row16_sse4(Pixel* dst, const Pixel16* src, size_t count, size_t y)
+{
+    const size_t pixels_per_vector = sizeof(__m128i) / sizeof(Pixel16);
+
+    // Two vectors cover a single period of dither matrix row
+    const DitherRow dither_row = get_dither_row(y);
+    const __m128i* thresholds = (const __m128i*) dither_row.thresholds;
+    const __m128i thresholds_low  = _mm_load_si128(thresholds + 0);
+    const __m128i thresholds_high = _mm_load_si128(thresholds + 1);
+
+    size_t x = 0;
+    for (; x + 2*pixels_per_vector <= count; x += 2*pixels_per_vector)
+    {
+        const __m128i* pixels = (const __m128i*) (src + x);
+
+        const __m128i low  = pack_pixels16_simd128(
+                                _mm_loadu_si128(pixels + 0), thresholds_low);
+        const __m128i high = pack_pixels16_simd128(
+                                _mm_loadu_si128(pixels + 1), thresholds_high);
+
+        _mm_storeu_si128((__m128i*) (dst + x), _mm_packus_epi16(low, high));
+    }
+
+    // Remaining pixels
+    for (; x < count; ++x)
+    {
+        const uint16_t threshold = get_dither_threshold(x, y);
+
+        dst[x] = {
+            .red   = pack_channel16(src[x].red,   threshold),
+            .green = pack_channel16(src[x].green, threshold),
+            .blue  = pack_channel16(src[x].blue,  threshold),
+            .alpha = pack_channel16(src[x].alpha, threshold)
+        };
+    }
+}
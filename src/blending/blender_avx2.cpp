@@ -0,0 +1,494 @@
+#include "commons/intrinsics.h"
+
+#include "blender.h"
+#include "blender_rows.h"
+#include "shuffle_masks.h"
+
+// Without factors, foreground pixels are blended as they are
+__always_inline
+static __m256i combine_simd256_core(__m256i bg1, __m256i fg1,
+                                    const __m256i* factors)
+{
+    const __m256i MASK_SPREAD_1 = _mm256_set_epi8(
+        MASK_SPREAD_1_ROW,
+        MASK_SPREAD_1_ROW
+    );
+
+    const __m256i MASK_SPREAD_2 = _mm256_set_epi8(
+        MASK_SPREAD_2_ROW,
+        MASK_SPREAD_2_ROW
+    );
+
+    const __m256i MASK_SPREAD_ALPHA = _mm256_set_epi8(
+        MASK_SPREAD_ALPHA_ROW,
+        MASK_SPREAD_ALPHA_ROW
+    );
+
+    const __m256i MASK_PACK_1 = _mm256_set_epi8(
+        MASK_PACK_1_ROW,
+        MASK_PACK_1_ROW
+    );
+
+    const __m256i MASK_PACK_2 = _mm256_set_epi8(
+        MASK_PACK_2_ROW,
+        MASK_PACK_2_ROW
+    );
+
+    // All half-words set to 255
+    const __m256i EPI16_255 = _mm256_set1_epi16(0x00FF);
+
+    __m256i fg2 = _mm256_shuffle_epi8(fg1, MASK_SPREAD_2);
+    __m256i bg2 = _mm256_shuffle_epi8(bg1, MASK_SPREAD_2);
+            fg1 = _mm256_shuffle_epi8(fg1, MASK_SPREAD_1);
+            bg1 = _mm256_shuffle_epi8(bg1, MASK_SPREAD_1);
+
+    // Opacity and tint, see modulate_pixel
+    if (factors)
+    {
+        fg1 = _mm256_srli_epi16(_mm256_mullo_epi16(fg1, *factors), 8);
+        fg2 = _mm256_srli_epi16(_mm256_mullo_epi16(fg2, *factors), 8);
+    }
+
+    __m256i fg_alpha1 = _mm256_shuffle_epi8(fg1, MASK_SPREAD_ALPHA);
+    __m256i fg_alpha2 = _mm256_shuffle_epi8(fg2, MASK_SPREAD_ALPHA);
+
+    __m256i bg_alpha1 = _mm256_sub_epi16(EPI16_255, fg_alpha1);
+    __m256i bg_alpha2 = _mm256_sub_epi16(EPI16_255, fg_alpha2);
+
+    // No write masks before AVX-512: multiply everything, then restore
+    // background alpha and clear foreground alpha with blends
+    bg1 = _mm256_blend_epi16(bg1, _mm256_mullo_epi16(bg1, bg_alpha1),
+                             IGNORE_ALPHA_BLEND);
+    bg2 = _mm256_blend_epi16(bg2, _mm256_mullo_epi16(bg2, bg_alpha2),
+                             IGNORE_ALPHA_BLEND);
+
+    fg1 = _mm256_blend_epi16(_mm256_setzero_si256(),
+                             _mm256_mullo_epi16(fg1, fg_alpha1),
+                             IGNORE_ALPHA_BLEND);
+    fg2 = _mm256_blend_epi16(_mm256_setzero_si256(),
+                             _mm256_mullo_epi16(fg2, fg_alpha2),
+                             IGNORE_ALPHA_BLEND);
+
+    bg1 = _mm256_add_epi16(bg1, fg1);
+    bg2 = _mm256_add_epi16(bg2, fg2);
+
+    bg1 = _mm256_shuffle_epi8(bg1, MASK_PACK_1);
+    bg2 = _mm256_shuffle_epi8(bg2, MASK_PACK_2);
+
+    // Pixels do not intersect and can be simply added
+    bg1 = _mm256_add_epi8(bg1, bg2);
+
+    return bg1;
+}
+
+__m256i combine_pixels_simd256(__m256i bg, __m256i fg)
+{
+    return combine_simd256_core(bg, fg, NULL);
+}
+
+// Same as above, with correctly rounded division
+__always_inline
+static __m256i combine_simd256_core_exact(__m256i bg1, __m256i fg1,
+                                          const __m256i* factors)
+{
+    const __m256i MASK_SPREAD_1 = _mm256_set_epi8(
+        MASK_SPREAD_1_ROW,
+        MASK_SPREAD_1_ROW
+    );
+
+    const __m256i MASK_SPREAD_2 = _mm256_set_epi8(
+        MASK_SPREAD_2_ROW,
+        MASK_SPREAD_2_ROW
+    );
+
+    const __m256i MASK_SPREAD_ALPHA = _mm256_set_epi8(
+        MASK_SPREAD_ALPHA_ROW,
+        MASK_SPREAD_ALPHA_ROW
+    );
+
+    const __m256i MASK_PACK_1 = _mm256_set_epi8(
+        MASK_PACK_EXACT_1_ROW,
+        MASK_PACK_EXACT_1_ROW
+    );
+
+    const __m256i MASK_PACK_2 = _mm256_set_epi8(
+        MASK_PACK_EXACT_2_ROW,
+        MASK_PACK_EXACT_2_ROW
+    );
+
+    const __m256i EPI16_255  = _mm256_set1_epi16(0x00FF);
+    const __m256i DIV_BIAS   = _mm256_set1_epi16(EXACT_DIV_BIAS);
+    const __m256i DIV_MULT   = _mm256_set1_epi16(EXACT_DIV_MULTIPLIER);
+
+    __m256i fg2 = _mm256_shuffle_epi8(fg1, MASK_SPREAD_2);
+    __m256i bg2 = _mm256_shuffle_epi8(bg1, MASK_SPREAD_2);
+            fg1 = _mm256_shuffle_epi8(fg1, MASK_SPREAD_1);
+            bg1 = _mm256_shuffle_epi8(bg1, MASK_SPREAD_1);
+
+    // Opacity and tint, see modulate_pixel
+    if (factors)
+    {
+        fg1 = _mm256_srli_epi16(_mm256_mullo_epi16(fg1, *factors), 8);
+        fg2 = _mm256_srli_epi16(_mm256_mullo_epi16(fg2, *factors), 8);
+    }
+
+    __m256i fg_alpha1 = _mm256_shuffle_epi8(fg1, MASK_SPREAD_ALPHA);
+    __m256i fg_alpha2 = _mm256_shuffle_epi8(fg2, MASK_SPREAD_ALPHA);
+
+    __m256i bg_alpha1 = _mm256_sub_epi16(EPI16_255, fg_alpha1);
+    __m256i bg_alpha2 = _mm256_sub_epi16(EPI16_255, fg_alpha2);
+
+    // Background alpha is restored by the final blend, so unlike
+    // `combine_pixels_simd256` everything can be multiplied at once
+    __m256i sum1 = _mm256_add_epi16(_mm256_mullo_epi16(bg1, bg_alpha1),
+                                    _mm256_mullo_epi16(fg1, fg_alpha1));
+    __m256i sum2 = _mm256_add_epi16(_mm256_mullo_epi16(bg2, bg_alpha2),
+                                    _mm256_mullo_epi16(fg2, fg_alpha2));
+
+    // x / 255 rounded
+    sum1 = _mm256_mulhi_epu16(_mm256_add_epi16(sum1, DIV_BIAS), DIV_MULT);
+    sum2 = _mm256_mulhi_epu16(_mm256_add_epi16(sum2, DIV_BIAS), DIV_MULT);
+
+    bg1 = _mm256_blend_epi16(bg1, sum1, IGNORE_ALPHA_BLEND);
+    bg2 = _mm256_blend_epi16(bg2, sum2, IGNORE_ALPHA_BLEND);
+
+    bg1 = _mm256_shuffle_epi8(bg1, MASK_PACK_1);
+    bg2 = _mm256_shuffle_epi8(bg2, MASK_PACK_2);
+
+    // Pixels do not intersect and can be simply added
+    bg1 = _mm256_add_epi8(bg1, bg2);
+
+    return bg1;
+}
+
+__m256i combine_pixels_simd256_exact(__m256i bg, __m256i fg)
+{
+    return combine_simd256_core_exact(bg, fg, NULL);
+}
+
+/*
+ * Premultiplied foreground needs only background to be multiplied
+ */
+static __m256i combine_premultiplied_simd256(__m256i bg1, __m256i fg)
+{
+    const __m256i MASK_SPREAD_1 = _mm256_set_epi8(
+        MASK_SPREAD_1_ROW,
+        MASK_SPREAD_1_ROW
+    );
+    const __m256i MASK_SPREAD_2 = _mm256_set_epi8(
+        MASK_SPREAD_2_ROW,
+        MASK_SPREAD_2_ROW
+    );
+
+    const __m256i MASK_SPREAD_HIGH_1 = _mm256_set_epi8(
+        MASK_SPREAD_HIGH_1_ROW,
+        MASK_SPREAD_HIGH_1_ROW
+    );
+    const __m256i MASK_SPREAD_HIGH_2 = _mm256_set_epi8(
+        MASK_SPREAD_HIGH_2_ROW,
+        MASK_SPREAD_HIGH_2_ROW
+    );
+
+    const __m256i MASK_SPREAD_ALPHA_1 = _mm256_set_epi8(
+        MASK_SPREAD_PACKED_ALPHA_1_ROW,
+        MASK_SPREAD_PACKED_ALPHA_1_ROW
+    );
+    const __m256i MASK_SPREAD_ALPHA_2 = _mm256_set_epi8(
+        MASK_SPREAD_PACKED_ALPHA_2_ROW,
+        MASK_SPREAD_PACKED_ALPHA_2_ROW
+    );
+
+    const __m256i MASK_PACK_1 = _mm256_set_epi8(
+        MASK_PACK_1_ROW,
+        MASK_PACK_1_ROW
+    );
+    const __m256i MASK_PACK_2 = _mm256_set_epi8(
+        MASK_PACK_2_ROW,
+        MASK_PACK_2_ROW
+    );
+
+    const __m256i EPI16_255 = _mm256_set1_epi16(0x00FF);
+
+    __m256i bg2 = _mm256_shuffle_epi8(bg1, MASK_SPREAD_2);
+            bg1 = _mm256_shuffle_epi8(bg1, MASK_SPREAD_1);
+
+    __m256i fg1 = _mm256_shuffle_epi8(fg, MASK_SPREAD_HIGH_1);
+    __m256i fg2 = _mm256_shuffle_epi8(fg, MASK_SPREAD_HIGH_2);
+
+    __m256i fg_alpha1 = _mm256_shuffle_epi8(fg, MASK_SPREAD_ALPHA_1);
+    __m256i fg_alpha2 = _mm256_shuffle_epi8(fg, MASK_SPREAD_ALPHA_2);
+
+    __m256i bg_alpha1 = _mm256_sub_epi16(EPI16_255, fg_alpha1);
+    __m256i bg_alpha2 = _mm256_sub_epi16(EPI16_255, fg_alpha2);
+
+    __m256i sum1 = _mm256_add_epi16(_mm256_mullo_epi16(bg1, bg_alpha1), fg1);
+    __m256i sum2 = _mm256_add_epi16(_mm256_mullo_epi16(bg2, bg_alpha2), fg2);
+
+    // Restore background alpha
+    bg1 = _mm256_blend_epi16(bg1, sum1, IGNORE_ALPHA_BLEND);
+    bg2 = _mm256_blend_epi16(bg2, sum2, IGNORE_ALPHA_BLEND);
+
+    bg1 = _mm256_shuffle_epi8(bg1, MASK_PACK_1);
+    bg2 = _mm256_shuffle_epi8(bg2, MASK_PACK_2);
+
+    // Pixels do not intersect and can be simply added
+    bg1 = _mm256_add_epi8(bg1, bg2);
+
+    return bg1;
+}
+
+static __m256i combine_premultiplied_simd256_exact(__m256i bg1, __m256i fg)
+{
+    const __m256i MASK_SPREAD_1 = _mm256_set_epi8(
+        MASK_SPREAD_1_ROW,
+        MASK_SPREAD_1_ROW
+    );
+    const __m256i MASK_SPREAD_2 = _mm256_set_epi8(
+        MASK_SPREAD_2_ROW,
+        MASK_SPREAD_2_ROW
+    );
+
+    const __m256i MASK_SPREAD_ALPHA_1 = _mm256_set_epi8(
+        MASK_SPREAD_PACKED_ALPHA_1_ROW,
+        MASK_SPREAD_PACKED_ALPHA_1_ROW
+    );
+    const __m256i MASK_SPREAD_ALPHA_2 = _mm256_set_epi8(
+        MASK_SPREAD_PACKED_ALPHA_2_ROW,
+        MASK_SPREAD_PACKED_ALPHA_2_ROW
+    );
+
+    const __m256i MASK_PACK_1 = _mm256_set_epi8(
+        MASK_PACK_EXACT_1_ROW,
+        MASK_PACK_EXACT_1_ROW
+    );
+    const __m256i MASK_PACK_2 = _mm256_set_epi8(
+        MASK_PACK_EXACT_2_ROW,
+        MASK_PACK_EXACT_2_ROW
+    );
+
+    const __m256i EPI16_255  = _mm256_set1_epi16(0x00FF);
+    const __m256i DIV_BIAS   = _mm256_set1_epi16(EXACT_DIV_BIAS);
+    const __m256i DIV_MULT   = _mm256_set1_epi16(EXACT_DIV_MULTIPLIER);
+
+    __m256i bg2 = _mm256_shuffle_epi8(bg1, MASK_SPREAD_2);
+            bg1 = _mm256_shuffle_epi8(bg1, MASK_SPREAD_1);
+
+    // Foreground is added after division, so it stays in lower bytes
+    __m256i fg1 = _mm256_shuffle_epi8(fg, MASK_SPREAD_1);
+    __m256i fg2 = _mm256_shuffle_epi8(fg, MASK_SPREAD_2);
+
+    __m256i fg_alpha1 = _mm256_shuffle_epi8(fg, MASK_SPREAD_ALPHA_1);
+    __m256i fg_alpha2 = _mm256_shuffle_epi8(fg, MASK_SPREAD_ALPHA_2);
+
+    __m256i bg_alpha1 = _mm256_sub_epi16(EPI16_255, fg_alpha1);
+    __m256i bg_alpha2 = _mm256_sub_epi16(EPI16_255, fg_alpha2);
+
+    __m256i sum1 = _mm256_mullo_epi16(bg1, bg_alpha1);
+    __m256i sum2 = _mm256_mullo_epi16(bg2, bg_alpha2);
+
+    // x / 255 rounded
+    sum1 = _mm256_mulhi_epu16(_mm256_add_epi16(sum1, DIV_BIAS), DIV_MULT);
+    sum2 = _mm256_mulhi_epu16(_mm256_add_epi16(sum2, DIV_BIAS), DIV_MULT);
+
+    sum1 = _mm256_add_epi16(sum1, fg1);
+    sum2 = _mm256_add_epi16(sum2, fg2);
+
+    // Restore background alpha
+    bg1 = _mm256_blend_epi16(bg1, sum1, IGNORE_ALPHA_BLEND);
+    bg2 = _mm256_blend_epi16(bg2, sum2, IGNORE_ALPHA_BLEND);
+
+    bg1 = _mm256_shuffle_epi8(bg1, MASK_PACK_1);
+    bg2 = _mm256_shuffle_epi8(bg2, MASK_PACK_2);
+
+    // Pixels do not intersect and can be simply added
+    bg1 = _mm256_add_epi8(bg1, bg2);
+
+    return bg1;
+}
+
+__always_inline
+static void blend_row_with(Pixel* bg, const Pixel* fg, size_t count,
+                           __m256i (*combine_simd)(__m256i, __m256i),
+                           void    (*combine)(Pixel*, const Pixel*))
+{
+    size_t x = 0;
+    for (x = 0; x + 8 <= count; x += 8)
+    {
+        __m256i bg_pixels = _mm256_loadu_si256((const __m256i*)(bg + x));
+        __m256i fg_pixels = _mm256_loadu_si256((const __m256i*)(fg + x));
+        __m256i result = combine_simd(bg_pixels, fg_pixels);
+        _mm256_storeu_si256((__m256i*)(bg + x), result);
+    }
+    // Remaining pixels
+    for (; x < count; ++x)
+    {
+        combine(bg + x, fg + x);
+    }
+}
+
+void blend_row_avx2(Pixel* bg, const Pixel* fg, size_t count)
+{
+    blend_row_with(bg, fg, count, combine_pixels_simd256, combine_pixels);
+}
+
+void blend_row_exact_avx2(Pixel* bg, const Pixel* fg, size_t count)
+{
+    blend_row_with(bg, fg, count, combine_pixels_simd256_exact,
+                   combine_pixels_exact);
+}
+
+void blend_row_premultiplied_avx2(Pixel* bg, const Pixel* fg, size_t count)
+{
+    blend_row_with(bg, fg, count, combine_premultiplied_simd256,
+                   combine_pixels_premultiplied);
+}
+
+void blend_row_premultiplied_exact_avx2(Pixel* bg, const Pixel* fg,
+                                        size_t count)
+{
+    blend_row_with(bg, fg, count, combine_premultiplied_simd256_exact,
+                   combine_pixels_premultiplied_exact);
+}
+
+// Not inlined, so that unoptimized builds fit into stack
+static __m256i combine_modulated_simd256(__m256i bg, __m256i fg,
+                                         const __m256i* factors)
+{
+    return combine_simd256_core(bg, fg, factors);
+}
+
+static __m256i combine_modulated_simd256_exact(__m256i bg, __m256i fg,
+                                               const __m256i* factors)
+{
+    return combine_simd256_core_exact(bg, fg, factors);
+}
+
+__always_inline
+static __m256i combine_with_factors(__m256i bg, __m256i fg,
+                                    const __m256i* factors, bool is_exact)
+{
+    return is_exact ? combine_modulated_simd256_exact(bg, fg, factors)
+                    : combine_modulated_simd256(bg, fg, factors);
+}
+
+__always_inline
+static void blend_row_modulated_with(Pixel* bg, const Pixel* fg, size_t count,
+                                     Pixel16 factors, bool is_exact)
+{
+    const size_t pixels_per_vector = sizeof(__m256i) / sizeof(Pixel);
+
+    const __m256i factors_simd = _mm256_set1_epi64x(
+                                (long long) pack_modulation_factors(factors));
+
+    size_t x = 0;
+    for (; x + pixels_per_vector <= count; x += pixels_per_vector)
+    {
+        __m256i bg_pixels = _mm256_loadu_si256((const __m256i*)(bg + x));
+        __m256i fg_pixels = _mm256_loadu_si256((const __m256i*)(fg + x));
+        __m256i result = combine_with_factors(bg_pixels, fg_pixels,
+                                              &factors_simd, is_exact);
+        _mm256_storeu_si256((__m256i*)(bg + x), result);
+    }
+
+    // Remaining pixels
+    if (is_exact)
+        blend_row_modulated_exact_scalar(bg + x, fg + x, count - x, factors);
+    else
+        blend_row_modulated_scalar(bg + x, fg + x, count - x, factors);
+}
+
+void blend_row_modulated_avx2(Pixel* bg, const Pixel* fg, size_t count,
+                              Pixel16 factors)
+{
+    blend_row_modulated_with(bg, fg, count, factors, false);
+}
+
+void blend_row_modulated_exact_avx2(Pixel* bg, const Pixel* fg,
+                                    size_t count, Pixel16 factors)
+{
+    blend_row_modulated_with(bg, fg, count, factors, true);
+}
+
+/*
+ * Premultiplied channels are scaled by their factors, see
+ * `get_premultiplied_modulation_factors`. Lanes are widened and packed back
+ * in the same order, so factors match the layout of `Pixel16`.
+ */
+__always_inline
+static __m256i modulate_simd256(__m256i pixels, __m256i factors)
+{
+    const __m256i zero = _mm256_setzero_si256();
+
+    __m256i low  = _mm256_unpacklo_epi8(pixels, zero);
+    __m256i high = _mm256_unpackhi_epi8(pixels, zero);
+
+    low  = _mm256_srli_epi16(_mm256_mullo_epi16(low,  factors), 8);
+    high = _mm256_srli_epi16(_mm256_mullo_epi16(high, factors), 8);
+
+    return _mm256_packus_epi16(low, high);
+}
+
+__always_inline
+static void blend_row_premultiplied_modulated_with(Pixel* bg, const Pixel* fg,
+                                                   size_t count,
+                                                   Pixel16 factors,
+                                                   bool is_exact)
+{
+    const size_t pixels_per_vector = sizeof(__m256i) / sizeof(Pixel);
+
+    const __m256i factors_simd = _mm256_set1_epi64x(
+                                (long long) pack_modulation_factors(factors));
+
+    size_t x = 0;
+    for (; x + pixels_per_vector <= count; x += pixels_per_vector)
+    {
+        __m256i bg_pixels = _mm256_loadu_si256((const __m256i*)(bg + x));
+        __m256i fg_pixels = _mm256_loadu_si256((const __m256i*)(fg + x));
+        fg_pixels = modulate_simd256(fg_pixels, factors_simd);
+
+        __m256i result = is_exact
+                ? combine_premultiplied_simd256_exact(bg_pixels, fg_pixels)
+                : combine_premultiplied_simd256(bg_pixels, fg_pixels);
+        _mm256_storeu_si256((__m256i*)(bg + x), result);
+    }
+
+    // Remaining pixels
+    if (is_exact)
+        blend_row_premultiplied_modulated_exact_scalar(bg + x, fg + x,
+                                                       count - x, factors);
+    else
+        blend_row_premultiplied_modulated_scalar(bg + x, fg + x,
+                                                 count - x, factors);
+}
+
+void blend_row_premultiplied_modulated_avx2(Pixel* bg, const Pixel* fg,
+                                            size_t count, Pixel16 factors)
+{
+    blend_row_premultiplied_modulated_with(bg, fg, count, factors, false);
+}
+
+void blend_row_premultiplied_modulated_exact_avx2(Pixel* bg, const Pixel* fg,
+                                                  size_t count,
+                                                  Pixel16 factors)
+{
+    blend_row_premultiplied_modulated_with(bg, fg, count, factors, true);
+}
+
+void copy_opaque_row_avx2(Pixel* bg, const Pixel* fg, size_t count)
+{
+    const size_t pixels_per_vector = sizeof(__m256i) / sizeof(Pixel);
+    const __m256i ALPHA_BITS = _mm256_set1_epi32((int) 0xFF000000);
+
+    size_t x = 0;
+    for (; x + pixels_per_vector <= count; x += pixels_per_vector)
+    {
+        __m256i bg_pixels = _mm256_loadu_si256((const __m256i*)(bg + x));
+        __m256i fg_pixels = _mm256_loadu_si256((const __m256i*)(fg + x));
+        __m256i result = _mm256_blendv_epi8(fg_pixels, bg_pixels,
+                                            ALPHA_BITS);
+        _mm256_storeu_si256((__m256i*)(bg + x), result);
+    }
+
+    // Remaining pixels
+    copy_opaque_row_scalar(bg + x, fg + x, count - x);
+}
@@ -0,0 +1,752 @@
+#include "commons/intrinsics.h"
+#include <stdint.h>
+
+#include "blender.h"
+#include "blender_rows.h"
+#include "shuffle_masks.h"
+#include "srgb.h"
+
+// Without factors, foreground pixels are blended as they are
+__always_inline
+static __m512i combine_simd_core(__m512i bg1, __m512i fg1,
+                                 const __m512i* factors)
+{
+    // Local constants are folded into memory operands by compiler. Unlike
+    // global ones, they are never initialized on CPUs without AVX-512.
+    const __m512i MASK_SPREAD_1 = _mm512_set_epi8(
+        MASK_SPREAD_1_ROW,
+        MASK_SPREAD_1_ROW,
+        MASK_SPREAD_1_ROW,
+        MASK_SPREAD_1_ROW
+    );
+
+    const __m512i MASK_SPREAD_2 = _mm512_set_epi8(
+        MASK_SPREAD_2_ROW,
+        MASK_SPREAD_2_ROW,
+        MASK_SPREAD_2_ROW,
+        MASK_SPREAD_2_ROW
+    );
+
+    const __m512i MASK_SPREAD_ALPHA = _mm512_set_epi8(
+        MASK_SPREAD_ALPHA_ROW,
+        MASK_SPREAD_ALPHA_ROW,
+        MASK_SPREAD_ALPHA_ROW,
+        MASK_SPREAD_ALPHA_ROW
+    );
+
+    const __m512i MASK_PACK_1 = _mm512_set_epi8(
+        MASK_PACK_1_ROW,
+        MASK_PACK_1_ROW,
+        MASK_PACK_1_ROW,
+        MASK_PACK_1_ROW
+    );
+
+    const __m512i MASK_PACK_2 = _mm512_set_epi8(
+        MASK_PACK_2_ROW,
+        MASK_PACK_2_ROW,
+        MASK_PACK_2_ROW,
+        MASK_PACK_2_ROW
+    );
+
+    // All half-words set to 255
+    const __m512i EPI16_255 = _mm512_set1_epi16(0x00FF);
+
+    const __mmask32 IGNORE_ALPHA = _cvtu32_mask32(IGNORE_ALPHA_BITS);
+
+    __m512i fg2 = _mm512_shuffle_epi8(fg1, MASK_SPREAD_2);
+    __m512i bg2 = _mm512_shuffle_epi8(bg1, MASK_SPREAD_2);
+            fg1 = _mm512_shuffle_epi8(fg1, MASK_SPREAD_1);
+            bg1 = _mm512_shuffle_epi8(bg1, MASK_SPREAD_1);
+
+    // Opacity and tint, see modulate_pixel
+    if (factors)
+    {
+        fg1 = _mm512_srli_epi16(_mm512_mullo_epi16(fg1, *factors), 8);
+        fg2 = _mm512_srli_epi16(_mm512_mullo_epi16(fg2, *factors), 8);
+    }
+
+    __m512i fg_alpha1 = _mm512_shuffle_epi8(fg1, MASK_SPREAD_ALPHA);
+    __m512i fg_alpha2 = _mm512_shuffle_epi8(fg2, MASK_SPREAD_ALPHA);
+
+    __m512i bg_alpha1 = _mm512_sub_epi16(EPI16_255, fg_alpha1);
+    __m512i bg_alpha2 = _mm512_sub_epi16(EPI16_255, fg_alpha2);
+
+    bg1 = _mm512_mask_mullo_epi16(bg1, IGNORE_ALPHA, bg1, bg_alpha1);
+    bg2 = _mm512_mask_mullo_epi16(bg2, IGNORE_ALPHA, bg2, bg_alpha2);
+
+    fg1 = _mm512_maskz_mullo_epi16(IGNORE_ALPHA, fg1, fg_alpha1);
+    fg2 = _mm512_maskz_mullo_epi16(IGNORE_ALPHA, fg2, fg_alpha2);
+
+    bg1 = _mm512_add_epi16(bg1, fg1);
+    bg2 = _mm512_add_epi16(bg2, fg2);
+
+    bg1 = _mm512_shuffle_epi8(bg1, MASK_PACK_1);
+    bg2 = _mm512_shuffle_epi8(bg2, MASK_PACK_2);
+
+    // Pixels do not intersect and can be simply added
+    bg1 = _mm512_add_epi8(bg1, bg2);
+
+    return bg1;
+}
+
+__m512i combine_pixels_simd(__m512i bg, __m512i fg)
+{
+    return combine_simd_core(bg, fg, NULL);
+}
+
+// Same as above, with correctly rounded division
+__always_inline
+static __m512i combine_simd_core_exact(__m512i bg1, __m512i fg1,
+                                       const __m512i* factors)
+{
+    const __m512i MASK_SPREAD_1 = _mm512_set_epi8(
+        MASK_SPREAD_1_ROW,
+        MASK_SPREAD_1_ROW,
+        MASK_SPREAD_1_ROW,
+        MASK_SPREAD_1_ROW
+    );
+
+    const __m512i MASK_SPREAD_2 = _mm512_set_epi8(
+        MASK_SPREAD_2_ROW,
+        MASK_SPREAD_2_ROW,
+        MASK_SPREAD_2_ROW,
+        MASK_SPREAD_2_ROW
+    );
+
+    const __m512i MASK_SPREAD_ALPHA = _mm512_set_epi8(
+        MASK_SPREAD_ALPHA_ROW,
+        MASK_SPREAD_ALPHA_ROW,
+        MASK_SPREAD_ALPHA_ROW,
+        MASK_SPREAD_ALPHA_ROW
+    );
+
+    const __m512i MASK_PACK_1 = _mm512_set_epi8(
+        MASK_PACK_EXACT_1_ROW,
+        MASK_PACK_EXACT_1_ROW,
+        MASK_PACK_EXACT_1_ROW,
+        MASK_PACK_EXACT_1_ROW
+    );
+
+    const __m512i MASK_PACK_2 = _mm512_set_epi8(
+        MASK_PACK_EXACT_2_ROW,
+        MASK_PACK_EXACT_2_ROW,
+        MASK_PACK_EXACT_2_ROW,
+        MASK_PACK_EXACT_2_ROW
+    );
+
+    const __m512i EPI16_255  = _mm512_set1_epi16(0x00FF);
+    const __m512i DIV_BIAS   = _mm512_set1_epi16(EXACT_DIV_BIAS);
+    const __m512i DIV_MULT   = _mm512_set1_epi16(EXACT_DIV_MULTIPLIER);
+
+    const __mmask32 IGNORE_ALPHA = _cvtu32_mask32(IGNORE_ALPHA_BITS);
+
+    __m512i fg2 = _mm512_shuffle_epi8(fg1, MASK_SPREAD_2);
+    __m512i bg2 = _mm512_shuffle_epi8(bg1, MASK_SPREAD_2);
+            fg1 = _mm512_shuffle_epi8(fg1, MASK_SPREAD_1);
+            bg1 = _mm512_shuffle_epi8(bg1, MASK_SPREAD_1);
+
+    // Opacity and tint, see modulate_pixel
+    if (factors)
+    {
+        fg1 = _mm512_srli_epi16(_mm512_mullo_epi16(fg1, *factors), 8);
+        fg2 = _mm512_srli_epi16(_mm512_mullo_epi16(fg2, *factors), 8);
+    }
+
+    __m512i fg_alpha1 = _mm512_shuffle_epi8(fg1, MASK_SPREAD_ALPHA);
+    __m512i fg_alpha2 = _mm512_shuffle_epi8(fg2, MASK_SPREAD_ALPHA);
+
+    __m512i bg_alpha1 = _mm512_sub_epi16(EPI16_255, fg_alpha1);
+    __m512i bg_alpha2 = _mm512_sub_epi16(EPI16_255, fg_alpha2);
+
+    bg1 = _mm512_mask_mullo_epi16(bg1, IGNORE_ALPHA, bg1, bg_alpha1);
+    bg2 = _mm512_mask_mullo_epi16(bg2, IGNORE_ALPHA, bg2, bg_alpha2);
+
+    fg1 = _mm512_maskz_mullo_epi16(IGNORE_ALPHA, fg1, fg_alpha1);
+    fg2 = _mm512_maskz_mullo_epi16(IGNORE_ALPHA, fg2, fg_alpha2);
+
+    bg1 = _mm512_add_epi16(bg1, fg1);
+    bg2 = _mm512_add_epi16(bg2, fg2);
+
+    // The only two extra instructions per vector: x / 255 rounded
+    bg1 = _mm512_mask_add_epi16(bg1, IGNORE_ALPHA, bg1, DIV_BIAS);
+    bg2 = _mm512_mask_add_epi16(bg2, IGNORE_ALPHA, bg2, DIV_BIAS);
+
+    bg1 = _mm512_mask_mulhi_epu16(bg1, IGNORE_ALPHA, bg1, DIV_MULT);
+    bg2 = _mm512_mask_mulhi_epu16(bg2, IGNORE_ALPHA, bg2, DIV_MULT);
+
+    bg1 = _mm512_shuffle_epi8(bg1, MASK_PACK_1);
+    bg2 = _mm512_shuffle_epi8(bg2, MASK_PACK_2);
+
+    // Pixels do not intersect and can be simply added
+    bg1 = _mm512_add_epi8(bg1, bg2);
+
+    return bg1;
+}
+
+__m512i combine_pixels_simd_exact(__m512i bg, __m512i fg)
+{
+    return combine_simd_core_exact(bg, fg, NULL);
+}
+
+/*
+ * Premultiplied foreground needs only background to be multiplied
+ */
+static __m512i combine_premultiplied_simd(__m512i bg1, __m512i fg)
+{
+    const __m512i MASK_SPREAD_1 = _mm512_set_epi8(
+        MASK_SPREAD_1_ROW,
+        MASK_SPREAD_1_ROW,
+        MASK_SPREAD_1_ROW,
+        MASK_SPREAD_1_ROW
+    );
+
+    const __m512i MASK_SPREAD_2 = _mm512_set_epi8(
+        MASK_SPREAD_2_ROW,
+        MASK_SPREAD_2_ROW,
+        MASK_SPREAD_2_ROW,
+        MASK_SPREAD_2_ROW
+    );
+
+    const __m512i MASK_SPREAD_HIGH_1 = _mm512_set_epi8(
+        MASK_SPREAD_HIGH_1_ROW,
+        MASK_SPREAD_HIGH_1_ROW,
+        MASK_SPREAD_HIGH_1_ROW,
+        MASK_SPREAD_HIGH_1_ROW
+    );
+
+    const __m512i MASK_SPREAD_HIGH_2 = _mm512_set_epi8(
+        MASK_SPREAD_HIGH_2_ROW,
+        MASK_SPREAD_HIGH_2_ROW,
+        MASK_SPREAD_HIGH_2_ROW,
+        MASK_SPREAD_HIGH_2_ROW
+    );
+
+    const __m512i MASK_SPREAD_ALPHA_1 = _mm512_set_epi8(
+        MASK_SPREAD_PACKED_ALPHA_1_ROW,
+        MASK_SPREAD_PACKED_ALPHA_1_ROW,
+        MASK_SPREAD_PACKED_ALPHA_1_ROW,
+        MASK_SPREAD_PACKED_ALPHA_1_ROW
+    );
+
+    const __m512i MASK_SPREAD_ALPHA_2 = _mm512_set_epi8(
+        MASK_SPREAD_PACKED_ALPHA_2_ROW,
+        MASK_SPREAD_PACKED_ALPHA_2_ROW,
+        MASK_SPREAD_PACKED_ALPHA_2_ROW,
+        MASK_SPREAD_PACKED_ALPHA_2_ROW
+    );
+
+    const __m512i MASK_PACK_1 = _mm512_set_epi8(
+        MASK_PACK_1_ROW,
+        MASK_PACK_1_ROW,
+        MASK_PACK_1_ROW,
+        MASK_PACK_1_ROW
+    );
+
+    const __m512i MASK_PACK_2 = _mm512_set_epi8(
+        MASK_PACK_2_ROW,
+        MASK_PACK_2_ROW,
+        MASK_PACK_2_ROW,
+        MASK_PACK_2_ROW
+    );
+
+    const __m512i EPI16_255 = _mm512_set1_epi16(0x00FF);
+
+    const __mmask32 IGNORE_ALPHA = _cvtu32_mask32(IGNORE_ALPHA_BITS);
+
+    __m512i bg2 = _mm512_shuffle_epi8(bg1, MASK_SPREAD_2);
+            bg1 = _mm512_shuffle_epi8(bg1, MASK_SPREAD_1);
+
+    __m512i fg1 = _mm512_shuffle_epi8(fg, MASK_SPREAD_HIGH_1);
+    __m512i fg2 = _mm512_shuffle_epi8(fg, MASK_SPREAD_HIGH_2);
+
+    __m512i fg_alpha1 = _mm512_shuffle_epi8(fg, MASK_SPREAD_ALPHA_1);
+    __m512i fg_alpha2 = _mm512_shuffle_epi8(fg, MASK_SPREAD_ALPHA_2);
+
+    __m512i bg_alpha1 = _mm512_sub_epi16(EPI16_255, fg_alpha1);
+    __m512i bg_alpha2 = _mm512_sub_epi16(EPI16_255, fg_alpha2);
+
+    bg1 = _mm512_mask_mullo_epi16(bg1, IGNORE_ALPHA, bg1, bg_alpha1);
+    bg2 = _mm512_mask_mullo_epi16(bg2, IGNORE_ALPHA, bg2, bg_alpha2);
+
+    bg1 = _mm512_mask_add_epi16(bg1, IGNORE_ALPHA, bg1, fg1);
+    bg2 = _mm512_mask_add_epi16(bg2, IGNORE_ALPHA, bg2, fg2);
+
+    bg1 = _mm512_shuffle_epi8(bg1, MASK_PACK_1);
+    bg2 = _mm512_shuffle_epi8(bg2, MASK_PACK_2);
+
+    // Pixels do not intersect and can be simply added
+    bg1 = _mm512_add_epi8(bg1, bg2);
+
+    return bg1;
+}
+
+static __m512i combine_premultiplied_simd_exact(__m512i bg1, __m512i fg)
+{
+    const __m512i MASK_SPREAD_1 = _mm512_set_epi8(
+        MASK_SPREAD_1_ROW,
+        MASK_SPREAD_1_ROW,
+        MASK_SPREAD_1_ROW,
+        MASK_SPREAD_1_ROW
+    );
+
+    const __m512i MASK_SPREAD_2 = _mm512_set_epi8(
+        MASK_SPREAD_2_ROW,
+        MASK_SPREAD_2_ROW,
+        MASK_SPREAD_2_ROW,
+        MASK_SPREAD_2_ROW
+    );
+
+    const __m512i MASK_SPREAD_ALPHA_1 = _mm512_set_epi8(
+        MASK_SPREAD_PACKED_ALPHA_1_ROW,
+        MASK_SPREAD_PACKED_ALPHA_1_ROW,
+        MASK_SPREAD_PACKED_ALPHA_1_ROW,
+        MASK_SPREAD_PACKED_ALPHA_1_ROW
+    );
+
+    const __m512i MASK_SPREAD_ALPHA_2 = _mm512_set_epi8(
+        MASK_SPREAD_PACKED_ALPHA_2_ROW,
+        MASK_SPREAD_PACKED_ALPHA_2_ROW,
+        MASK_SPREAD_PACKED_ALPHA_2_ROW,
+        MASK_SPREAD_PACKED_ALPHA_2_ROW
+    );
+
+    const __m512i MASK_PACK_1 = _mm512_set_epi8(
+        MASK_PACK_EXACT_1_ROW,
+        MASK_PACK_EXACT_1_ROW,
+        MASK_PACK_EXACT_1_ROW,
+        MASK_PACK_EXACT_1_ROW
+    );
+
+    const __m512i MASK_PACK_2 = _mm512_set_epi8(
+        MASK_PACK_EXACT_2_ROW,
+        MASK_PACK_EXACT_2_ROW,
+        MASK_PACK_EXACT_2_ROW,
+        MASK_PACK_EXACT_2_ROW
+    );
+
+    const __m512i EPI16_255  = _mm512_set1_epi16(0x00FF);
+    const __m512i DIV_BIAS   = _mm512_set1_epi16(EXACT_DIV_BIAS);
+    const __m512i DIV_MULT   = _mm512_set1_epi16(EXACT_DIV_MULTIPLIER);
+
+    const __mmask32 IGNORE_ALPHA = _cvtu32_mask32(IGNORE_ALPHA_BITS);
+
+    __m512i bg2 = _mm512_shuffle_epi8(bg1, MASK_SPREAD_2);
+            bg1 = _mm512_shuffle_epi8(bg1, MASK_SPREAD_1);
+
+    // Foreground is added after division, so it stays in lower bytes
+    __m512i fg1 = _mm512_shuffle_epi8(fg, MASK_SPREAD_1);
+    __m512i fg2 = _mm512_shuffle_epi8(fg, MASK_SPREAD_2);
+
+    __m512i fg_alpha1 = _mm512_shuffle_epi8(fg, MASK_SPREAD_ALPHA_1);
+    __m512i fg_alpha2 = _mm512_shuffle_epi8(fg, MASK_SPREAD_ALPHA_2);
+
+    __m512i bg_alpha1 = _mm512_sub_epi16(EPI16_255, fg_alpha1);
+    __m512i bg_alpha2 = _mm512_sub_epi16(EPI16_255, fg_alpha2);
+
+    bg1 = _mm512_mask_mullo_epi16(bg1, IGNORE_ALPHA, bg1, bg_alpha1);
+    bg2 = _mm512_mask_mullo_epi16(bg2, IGNORE_ALPHA, bg2, bg_alpha2);
+
+    bg1 = _mm512_mask_add_epi16(bg1, IGNORE_ALPHA, bg1, DIV_BIAS);
+    bg2 = _mm512_mask_add_epi16(bg2, IGNORE_ALPHA, bg2, DIV_BIAS);
+
+    bg1 = _mm512_mask_mulhi_epu16(bg1, IGNORE_ALPHA, bg1, DIV_MULT);
+    bg2 = _mm512_mask_mulhi_epu16(bg2, IGNORE_ALPHA, bg2, DIV_MULT);
+
+    bg1 = _mm512_mask_add_epi16(bg1, IGNORE_ALPHA, bg1, fg1);
+    bg2 = _mm512_mask_add_epi16(bg2, IGNORE_ALPHA, bg2, fg2);
+
+    bg1 = _mm512_shuffle_epi8(bg1, MASK_PACK_1);
+    bg2 = _mm512_shuffle_epi8(bg2, MASK_PACK_2);
+
+    // Pixels do not intersect and can be simply added
+    bg1 = _mm512_add_epi8(bg1, bg2);
+
+    return bg1;
+}
+
+typedef __m512i combine_simd_t(__m512i bg, __m512i fg);
+
+/*
+ * Masked loads do not touch memory outside of the mask,
+ * so less than 16 pixels can be blended without scalar code
+ */
+__always_inline
+static void blend_masked(Pixel* bg, const Pixel* fg, size_t count,
+                         combine_simd_t* combine_simd)
+{
+    const __mmask16 mask = _cvtu32_mask16((1u << count) - 1);
+
+    __m512i bg_pixels = _mm512_maskz_loadu_epi32(mask, bg);
+    __m512i fg_pixels = _mm512_maskz_loadu_epi32(mask, fg);
+    __m512i result = combine_simd(bg_pixels, fg_pixels);
+    _mm512_mask_storeu_epi32(bg, mask, result);
+}
+
+__always_inline
+static void blend_row_with(Pixel* bg, const Pixel* fg, size_t count,
+                           combine_simd_t* combine_simd)
+{
+    const size_t pixels_per_vector = sizeof(__m512i) / sizeof(Pixel);
+    const size_t misalignment = (uintptr_t) bg % sizeof(__m512i);
+
+    size_t x = 0;
+
+    if (misalignment % sizeof(Pixel) == 0)
+    {
+        // Peel pixels up to the first aligned background vector
+        size_t head = (sizeof(__m512i) - misalignment) % sizeof(__m512i)
+                    / sizeof(Pixel);
+        if (head > count)
+            head = count;
+
+        if (head > 0)
+            blend_masked(bg, fg, head, combine_simd);
+
+        for (x = head; x + pixels_per_vector <= count; x += pixels_per_vector)
+        {
+            __m512i bg_pixels = _mm512_load_si512(bg + x);
+            __m512i fg_pixels = _mm512_loadu_si512(fg + x);
+            __m512i result = combine_simd(bg_pixels, fg_pixels);
+            _mm512_store_si512(bg + x, result);
+        }
+    }
+    else    // Pixels are not even aligned by their size, no point in peeling
+    {
+        for (x = 0; x + pixels_per_vector <= count; x += pixels_per_vector)
+        {
+            __m512i bg_pixels = _mm512_loadu_si512(bg + x);
+            __m512i fg_pixels = _mm512_loadu_si512(fg + x);
+            __m512i result = combine_simd(bg_pixels, fg_pixels);
+            _mm512_storeu_si512(bg + x, result);
+        }
+    }
+
+    // Remaining pixels
+    if (x < count)
+        blend_masked(bg + x, fg + x, count - x, combine_simd);
+}
+
+void blend_row_avx512(Pixel* bg, const Pixel* fg, size_t count)
+{
+    blend_row_with(bg, fg, count, combine_pixels_simd);
+}
+
+void blend_row_exact_avx512(Pixel* bg, const Pixel* fg, size_t count)
+{
+    blend_row_with(bg, fg, count, combine_pixels_simd_exact);
+}
+
+void blend_row_premultiplied_avx512(Pixel* bg, const Pixel* fg, size_t count)
+{
+    blend_row_with(bg, fg, count, combine_premultiplied_simd);
+}
+
+void blend_row_premultiplied_exact_avx512(Pixel* bg, const Pixel* fg,
+                                          size_t count)
+{
+    blend_row_with(bg, fg, count, combine_premultiplied_simd_exact);
+}
+
+// Not inlined, so that unoptimized builds fit into stack
+static __m512i combine_modulated_simd(__m512i bg, __m512i fg,
+                                      const __m512i* factors)
+{
+    return combine_simd_core(bg, fg, factors);
+}
+
+static __m512i combine_modulated_simd_exact(__m512i bg, __m512i fg,
+                                            const __m512i* factors)
+{
+    return combine_simd_core_exact(bg, fg, factors);
+}
+
+__always_inline
+static __m512i combine_with_factors(__m512i bg, __m512i fg,
+                                    const __m512i* factors, bool is_exact)
+{
+    return is_exact ? combine_modulated_simd_exact(bg, fg, factors)
+                    : combine_modulated_simd(bg, fg, factors);
+}
+
+__always_inline
+static void blend_row_modulated_with(Pixel* bg, const Pixel* fg, size_t count,
+                                     Pixel16 factors, bool is_exact)
+{
+    const size_t pixels_per_vector = sizeof(__m512i) / sizeof(Pixel);
+
+    const __m512i factors_simd = _mm512_set1_epi64(
+                                (long long) pack_modulation_factors(factors));
+
+    size_t x = 0;
+    for (; x + pixels_per_vector <= count; x += pixels_per_vector)
+    {
+        __m512i bg_pixels = _mm512_loadu_si512(bg + x);
+        __m512i fg_pixels = _mm512_loadu_si512(fg + x);
+        __m512i result = combine_with_factors(bg_pixels, fg_pixels,
+                                              &factors_simd, is_exact);
+        _mm512_storeu_si512(bg + x, result);
+    }
+
+    // Remaining pixels
+    if (x < count)
+    {
+        const __mmask16 mask = _cvtu32_mask16((1u << (count - x)) - 1);
+
+        __m512i bg_pixels = _mm512_maskz_loadu_epi32(mask, bg + x);
+        __m512i fg_pixels = _mm512_maskz_loadu_epi32(mask, fg + x);
+        __m512i result = combine_with_factors(bg_pixels, fg_pixels,
+                                              &factors_simd, is_exact);
+        _mm512_mask_storeu_epi32(bg + x, mask, result);
+    }
+}
+
+void blend_row_modulated_avx512(Pixel* bg, const Pixel* fg, size_t count,
+                                Pixel16 factors)
+{
+    blend_row_modulated_with(bg, fg, count, factors, false);
+}
+
+void blend_row_modulated_exact_avx512(Pixel* bg, const Pixel* fg,
+                                      size_t count, Pixel16 factors)
+{
+    blend_row_modulated_with(bg, fg, count, factors, true);
+}
+
+/*
+ * Premultiplied channels are scaled by their factors, see
+ * `get_premultiplied_modulation_factors`. Lanes are widened and packed back
+ * in the same order, so factors match the layout of `Pixel16`.
+ */
+__always_inline
+static __m512i modulate_simd(__m512i pixels, __m512i factors)
+{
+    const __m512i zero = _mm512_setzero_si512();
+
+    __m512i low  = _mm512_unpacklo_epi8(pixels, zero);
+    __m512i high = _mm512_unpackhi_epi8(pixels, zero);
+
+    low  = _mm512_srli_epi16(_mm512_mullo_epi16(low,  factors), 8);
+    high = _mm512_srli_epi16(_mm512_mullo_epi16(high, factors), 8);
+
+    return _mm512_packus_epi16(low, high);
+}
+
+__always_inline
+static __m512i combine_premultiplied_with_factors(__m512i bg, __m512i fg,
+                                                  __m512i factors,
+                                                  bool is_exact)
+{
+    fg = modulate_simd(fg, factors);
+
+    return is_exact ? combine_premultiplied_simd_exact(bg, fg)
+                    : combine_premultiplied_simd(bg, fg);
+}
+
+__always_inline
+static void blend_row_premultiplied_modulated_with(Pixel* bg, const Pixel* fg,
+                                                   size_t count,
+                                                   Pixel16 factors,
+                                                   bool is_exact)
+{
+    const size_t pixels_per_vector = sizeof(__m512i) / sizeof(Pixel);
+
+    const __m512i factors_simd = _mm512_set1_epi64(
+                                (long long) pack_modulation_factors(factors));
+
+    size_t x = 0;
+    for (; x + pixels_per_vector <= count; x += pixels_per_vector)
+    {
+        __m512i bg_pixels = _mm512_loadu_si512(bg + x);
+        __m512i fg_pixels = _mm512_loadu_si512(fg + x);
+        __m512i result = combine_premultiplied_with_factors(
+                                bg_pixels, fg_pixels, factors_simd, is_exact);
+        _mm512_storeu_si512(bg + x, result);
+    }
+
+    // Remaining pixels
+    if (x < count)
+    {
+        const __mmask16 mask = _cvtu32_mask16((1u << (count - x)) - 1);
+
+        __m512i bg_pixels = _mm512_maskz_loadu_epi32(mask, bg + x);
+        __m512i fg_pixels = _mm512_maskz_loadu_epi32(mask, fg + x);
+        __m512i result = combine_premultiplied_with_factors(
+                                bg_pixels, fg_pixels, factors_simd, is_exact);
+        _mm512_mask_storeu_epi32(bg + x, mask, result);
+    }
+}
+
+void blend_row_premultiplied_modulated_avx512(Pixel* bg, const Pixel* fg,
+                                              size_t count, Pixel16 factors)
+{
+    blend_row_premultiplied_modulated_with(bg, fg, count, factors, false);
+}
+
+void blend_row_premultiplied_modulated_exact_avx512(Pixel* bg,
+                                                    const Pixel* fg,
+                                                    size_t count,
+                                                    Pixel16 factors)
+{
+    blend_row_premultiplied_modulated_with(bg, fg, count, factors, true);
+}
+
+/**
+ * @brief Decoding table is kept in registers, 32 entries per register
+ */
+struct LinearTables
+{
+    __m512i        decode[SRGB_DECODE_SIZE / 32];
+    const uint8_t* encode;
+};
+
+// Channels are 16-bit words in range [0; 255]
+static __m512i decode_linear(__m512i channels, const __m512i* decode)
+{
+    // vpermi2w looks up 64 entries, two more index bits select the result
+    const __m512i quarter0 = _mm512_permutex2var_epi16(decode[0], channels,
+                                                       decode[1]);
+    const __m512i quarter1 = _mm512_permutex2var_epi16(decode[2], channels,
+                                                       decode[3]);
+    const __m512i quarter2 = _mm512_permutex2var_epi16(decode[4], channels,
+                                                       decode[5]);
+    const __m512i quarter3 = _mm512_permutex2var_epi16(decode[6], channels,
+                                                       decode[7]);
+
+    const __mmask32 is_odd_quarter = _mm512_test_epi16_mask(
+                                        channels, _mm512_set1_epi16(64));
+    const __mmask32 is_upper_half  = _mm512_test_epi16_mask(
+                                        channels, _mm512_set1_epi16(128));
+
+    const __m512i lower = _mm512_mask_blend_epi16(is_odd_quarter,
+                                                  quarter0, quarter1);
+    const __m512i upper = _mm512_mask_blend_epi16(is_odd_quarter,
+                                                  quarter2, quarter3);
+
+    return _mm512_mask_blend_epi16(is_upper_half, lower, upper);
+}
+
+// Encode 4 pixels. Gather replaces only color channels of background
+__always_inline
+static __m128i encode_linear(__m256i index, __m128i bg, const uint8_t* encode)
+{
+    // Constant mask, gather is a macro without optimization
+    const __mmask16 IGNORE_ALPHA = (__mmask16) IGNORE_ALPHA_BITS;
+
+    const __m512i encoded = _mm512_mask_i32gather_epi32(
+                                _mm512_cvtepu8_epi32(bg), IGNORE_ALPHA,
+                                _mm512_cvtepu16_epi32(index), encode, 1);
+
+    // Gathered dwords contain neighbouring entries in higher bytes
+    return _mm512_cvtepi32_epi8(encoded);
+}
+
+// Blend 8 pixels, see blend_channel_linear
+__always_inline
+static __m256i combine_linear_half(__m256i bg, __m256i fg,
+                                   const LinearTables* tables)
+{
+    const __m512i MASK_SPREAD_ALPHA = _mm512_set_epi8(
+        MASK_SPREAD_ALPHA16_ROW,
+        MASK_SPREAD_ALPHA16_ROW,
+        MASK_SPREAD_ALPHA16_ROW,
+        MASK_SPREAD_ALPHA16_ROW
+    );
+
+    const __m512i bg_channels = _mm512_cvtepu8_epi16(bg);
+    const __m512i fg_channels = _mm512_cvtepu8_epi16(fg);
+
+    // Alpha is not gamma-encoded, so it is only scaled by 257
+    __m512i alpha = _mm512_shuffle_epi8(fg_channels, MASK_SPREAD_ALPHA);
+    alpha = _mm512_or_si512(alpha, _mm512_slli_epi16(alpha, 8));
+    const __m512i inv_alpha = _mm512_ternarylogic_epi32(alpha, alpha, alpha,
+                                                        0x55);
+
+    __m512i linear = _mm512_add_epi16(
+            _mm512_mulhi_epu16(decode_linear(fg_channels, tables->decode),
+                               alpha),
+            _mm512_mulhi_epu16(decode_linear(bg_channels, tables->decode),
+                               inv_alpha));
+    linear = _mm512_add_epi16(linear, _mm512_set1_epi16(1));
+
+    const __m512i index = _mm512_srli_epi16(linear, SRGB_ENCODE_SHIFT);
+
+    const __m128i low  = encode_linear(_mm512_castsi512_si256(index),
+                                       _mm256_castsi256_si128(bg),
+                                       tables->encode);
+    const __m128i high = encode_linear(_mm512_extracti64x4_epi64(index, 1),
+                                       _mm256_extracti128_si256(bg, 1),
+                                       tables->encode);
+
+    return _mm256_set_m128i(high, low);
+}
+
+/*
+ * Helpers are large, forced inlining would exceed stack usage limit
+ * in unoptimized build
+ */
+static __m512i combine_linear_simd(__m512i bg, __m512i fg,
+                                   const LinearTables* tables)
+{
+    const __m256i low  = combine_linear_half(_mm512_castsi512_si256(bg),
+                                             _mm512_castsi512_si256(fg),
+                                             tables);
+    const __m256i high = combine_linear_half(_mm512_extracti64x4_epi64(bg, 1),
+                                             _mm512_extracti64x4_epi64(fg, 1),
+                                             tables);
+
+    return _mm512_inserti64x4(_mm512_castsi256_si512(low), high, 1);
+}
+
+void blend_row_linear_avx512(Pixel* bg, const Pixel* fg, size_t count)
+{
+    const size_t pixels_per_vector = sizeof(__m512i) / sizeof(Pixel);
+
+    const SrgbTables* srgb = get_srgb_tables();
+
+    LinearTables tables = {.decode = {}, .encode = srgb->encode};
+    for (size_t i = 0; i < SRGB_DECODE_SIZE / 32; ++i)
+        tables.decode[i] = _mm512_load_si512(srgb->decode + 32 * i);
+
+    size_t x = 0;
+    for (; x + pixels_per_vector <= count; x += pixels_per_vector)
+    {
+        __m512i bg_pixels = _mm512_loadu_si512(bg + x);
+        __m512i fg_pixels = _mm512_loadu_si512(fg + x);
+        __m512i result = combine_linear_simd(bg_pixels, fg_pixels, &tables);
+        _mm512_storeu_si512(bg + x, result);
+    }
+
+    // Remaining pixels
+    if (x < count)
+    {
+        const __mmask16 mask = _cvtu32_mask16((1u << (count - x)) - 1);
+
+        __m512i bg_pixels = _mm512_maskz_loadu_epi32(mask, bg + x);
+        __m512i fg_pixels = _mm512_maskz_loadu_epi32(mask, fg + x);
+        __m512i result = combine_linear_simd(bg_pixels, fg_pixels, &tables);
+        _mm512_mask_storeu_epi32(bg + x, mask, result);
+    }
+}
+
+void copy_opaque_row_avx512(Pixel* bg, const Pixel* fg, size_t count)
+{
+    const size_t pixels_per_vector = sizeof(__m512i) / sizeof(Pixel);
+
+    // Only color bytes are stored, background alpha is not even loaded
+    const __mmask64 color_bytes = 0x7777777777777777;
+
+    size_t x = 0;
+    for (; x + pixels_per_vector <= count; x += pixels_per_vector)
+        _mm512_mask_storeu_epi8(bg + x, color_bytes,
+                                _mm512_loadu_si512(fg + x));
+
+    // Remaining pixels
+    if (x < count)
+    {
+        const __mmask64 mask = color_bytes
+                             & ((1ull << (4 * (count - x))) - 1);
+
+        _mm512_mask_storeu_epi8(bg + x, mask,
+                                _mm512_maskz_loadu_epi8(mask, fg + x));
+    }
+}
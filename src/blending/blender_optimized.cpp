@@ -1,177 +1,274 @@
-#include <immintrin.h>
-
 #include "meerkat_assert/asserts.h"
+#include "commons/cpu_features.h"
 
 #include "blender.h"
+#include "blender_rows.h"
+#include "span_index.h"
+
+// Indexed by BlendMode and SimdLevel
+static blend_row_t* const BLEND_ROW_KERNELS[BLEND_MODE_COUNT][SIMD_LEVEL_COUNT]
+= {
+    {
+        blend_row_scalar,
+        blend_row_sse4,
+        blend_row_avx2,
+        blend_row_avx512
+    },
+    {
+        blend_row_exact_scalar,
+        blend_row_exact_sse4,
+        blend_row_exact_avx2,
+        blend_row_exact_avx512
+    }
+};
+
+// Indexed by BlendMode and SimdLevel
+static blend_row_modulated_t* const
+MODULATED_ROW_KERNELS[BLEND_MODE_COUNT][SIMD_LEVEL_COUNT] = {
+    {
+        blend_row_modulated_scalar,
+        blend_row_modulated_sse4,
+        blend_row_modulated_avx2,
+        blend_row_modulated_avx512
+    },
+    {
+        blend_row_modulated_exact_scalar,
+        blend_row_modulated_exact_sse4,
+        blend_row_modulated_exact_avx2,
+        blend_row_modulated_exact_avx512
+    }
+};
+
+// Indexed by BlendMode and SimdLevel
+static blend_row_t* const
+PREMULTIPLIED_ROW_KERNELS[BLEND_MODE_COUNT][SIMD_LEVEL_COUNT] = {
+    {
+        blend_row_premultiplied_scalar,
+        blend_row_premultiplied_sse4,
+        blend_row_premultiplied_avx2,
+        blend_row_premultiplied_avx512
+    },
+    {
+        blend_row_premultiplied_exact_scalar,
+        blend_row_premultiplied_exact_sse4,
+        blend_row_premultiplied_exact_avx2,
+        blend_row_premultiplied_exact_avx512
+    }
+};
+
+// Indexed by BlendMode and SimdLevel
+static blend_row_modulated_t* const
+PREMULTIPLIED_MODULATED_ROW_KERNELS[BLEND_MODE_COUNT][SIMD_LEVEL_COUNT] = {
+    {
+        blend_row_premultiplied_modulated_scalar,
+        blend_row_premultiplied_modulated_sse4,
+        blend_row_premultiplied_modulated_avx2,
+        blend_row_premultiplied_modulated_avx512
+    },
+    {
+        blend_row_premultiplied_modulated_exact_scalar,
+        blend_row_premultiplied_modulated_exact_sse4,
+        blend_row_premultiplied_modulated_exact_avx2,
+        blend_row_premultiplied_modulated_exact_avx512
+    }
+};
+
+// Indexed by BlendMode and SimdLevel. Division is not used
+static blend_row_t* const
+LINEAR_ROW_KERNELS[BLEND_MODE_COUNT][SIMD_LEVEL_COUNT] = {
+    {
+        blend_row_linear_scalar,
+        blend_row_linear_scalar,
+        blend_row_linear_scalar,
+        blend_row_linear_avx512
+    },
+    {
+        blend_row_linear_scalar,
+        blend_row_linear_scalar,
+        blend_row_linear_scalar,
+        blend_row_linear_avx512
+    }
+};
+
+// Indexed by SimdLevel
+static copy_opaque_row_t* const COPY_OPAQUE_ROW_KERNELS[SIMD_LEVEL_COUNT] = {
+    copy_opaque_row_scalar,
+    copy_opaque_row_sse4,
+    copy_opaque_row_avx2,
+    copy_opaque_row_avx512
+};
+
+static int blend_with_kernel(PixelImage* background,
+                             const MovedImage* foreground,
+                             ThreadPool* pool,
+                             blend_row_t* const
+                             kernels[BLEND_MODE_COUNT][SIMD_LEVEL_COUNT],
+                             blend_row_modulated_t* const
+                             modulated[BLEND_MODE_COUNT][SIMD_LEVEL_COUNT],
+                             Pixel16 (*get_factors)(const Modulation*));
+
+blend_row_t* get_blend_row_kernel(BlendMode mode)
+{
+    return BLEND_ROW_KERNELS[mode][get_simd_level()];
+}
+
+blend_row_t* get_blend_premultiplied_row_kernel(BlendMode mode)
+{
+    return PREMULTIPLIED_ROW_KERNELS[mode][get_simd_level()];
+}
+
+blend_row_modulated_t* get_blend_premultiplied_modulated_row_kernel(
+                                                        BlendMode mode)
+{
+    return PREMULTIPLIED_MODULATED_ROW_KERNELS[mode][get_simd_level()];
+}
 
-const char MASK_ZERO = (char) 0x80;
-
-/*
- * [ r0 g0 b0 a0 | r1 g1 b1 a1 | r2 g2 b2 a2 | r3 g3 b3 a3 ]
- *                             V
- *                             V
- * [ r0 00 g0 00   b0 00 a0 00 | r1 00 g1 00   b1 00 a1 00 ]
- */
-#define MASK_SPREAD_1_ROW \
-    MASK_ZERO, 0x07,\
-    MASK_ZERO, 0x06,\
-    MASK_ZERO, 0x05,\
-    MASK_ZERO, 0x04,\
-    MASK_ZERO, 0x03,\
-    MASK_ZERO, 0x02,\
-    MASK_ZERO, 0x01,\
-    MASK_ZERO, 0x00
-
-/*
- * [ r0 g0 b0 a0 | r1 g1 b1 a1 | r2 g2 b2 a2 | r3 g3 b3 a3 ]
- *                             V
- *                             V
- * [ r2 00 g2 00   b2 00 a2 00 | r3 00 g3 00   b3 00 a3 00 ]
- */
-#define MASK_SPREAD_2_ROW \
-    MASK_ZERO, 0x0F,\
-    MASK_ZERO, 0x0E,\
-    MASK_ZERO, 0x0D,\
-    MASK_ZERO, 0x0C,\
-    MASK_ZERO, 0x0B,\
-    MASK_ZERO, 0x0A,\
-    MASK_ZERO, 0x09,\
-    MASK_ZERO, 0x08
-
-/*
- * [ r0 00 g0 00 b0 00 a0 00 | r1 00 g1 00 b1 00 a1 00 ]
- *                           V
- *                           V
- * [ a0 00 a0 00 a0 00 a0 00 | a1 00 a1 00 a1 00 a1 00 ]
- */
-#define MASK_SPREAD_ALPHA_ROW \
-    MASK_ZERO, 0x0E,\
-    MASK_ZERO, 0x0E,\
-    MASK_ZERO, 0x0E,\
-    MASK_ZERO, 0x0E,\
-    MASK_ZERO, 0x06,\
-    MASK_ZERO, 0x06,\
-    MASK_ZERO, 0x06,\
-    MASK_ZERO, 0x06
-
-/*
- * Because alpha channel is not updated, it resides in lower byte
- * of half-word, unlike other channels
- *
- * [ xx r0 xx g0   xx b0 a0 00 | xx r1 xx g1   xx b1 a1 00 ]
- *                             V
- *                             V
- * [ r0 g0 b0 a0 | r1 g1 b1 a1 | 00 00 00 00 | 00 00 00 00 ]
- */
-#define MASK_PACK_1_ROW \
-    MASK_ZERO, MASK_ZERO,\
-    MASK_ZERO, MASK_ZERO,\
-    MASK_ZERO, MASK_ZERO,\
-    MASK_ZERO, MASK_ZERO,\
-    0x0E,      0x0D,     \
-    0x0B,      0x09,     \
-    0x06,      0x05,     \
-    0x03,      0x01
-
-/*
- * Because alpha channel is not updated, it resides in lower byte
- * of half-word, unlike other channels
- *
- * [ xx r2 xx g2   xx b2 a2 00 | xx r2 xx g2   xx b2 a2 00 ]
- *                             V
- *                             V
- * [ 00 00 00 00 | 00 00 00 00 | r2 g2 b2 a2 | r3 g3 b3 a3 ]
- */
-#define MASK_PACK_2_ROW \
-    0x0E,      0x0D,     \
-    0x0B,      0x09,     \
-    0x06,      0x05,     \
-    0x03,      0x01,     \
-    MASK_ZERO, MASK_ZERO,\
-    MASK_ZERO, MASK_ZERO,\
-    MASK_ZERO, MASK_ZERO,\
-    MASK_ZERO, MASK_ZERO
-
-const __m512i MASK_SPREAD_1 = _mm512_set_epi8(
-    MASK_SPREAD_1_ROW,
-    MASK_SPREAD_1_ROW,
-    MASK_SPREAD_1_ROW,
-    MASK_SPREAD_1_ROW
-);
-
-const __m512i MASK_SPREAD_2 = _mm512_set_epi8(
-    MASK_SPREAD_2_ROW,
-    MASK_SPREAD_2_ROW,
-    MASK_SPREAD_2_ROW,
-    MASK_SPREAD_2_ROW
-);
-
-const __m512i MASK_SPREAD_ALPHA = _mm512_set_epi8(
-    MASK_SPREAD_ALPHA_ROW,
-    MASK_SPREAD_ALPHA_ROW,
-    MASK_SPREAD_ALPHA_ROW,
-    MASK_SPREAD_ALPHA_ROW
-);
-
-const __m512i MASK_PACK_1 = _mm512_set_epi8(
-    MASK_PACK_1_ROW,
-    MASK_PACK_1_ROW,
-    MASK_PACK_1_ROW,
-    MASK_PACK_1_ROW
-);
-
-const __m512i MASK_PACK_2 = _mm512_set_epi8(
-    MASK_PACK_2_ROW,
-    MASK_PACK_2_ROW,
-    MASK_PACK_2_ROW,
-    MASK_PACK_2_ROW
-);
-
-// All half-words set to 255
-const __m512i EPI16_255 = _mm512_set1_epi16(0x00FF);
-
-// During calculations, alpha channel of background should not be affected
-const __mmask32 IGNORE_ALPHA = _cvtu32_mask32(0x77777777);
-
-#undef MASK_SPREAD_1_ROW
-#undef MASK_SPREAD_2_ROW
-#undef MASK_SPREAD_ALPHA_ROW
-#undef MASK_PACK_1_ROW
-#undef MASK_PACK_2_ROW
-
-__m512i combine_pixels_simd(__m512i bg1, __m512i fg1)
+struct BlendRowsTask
 {
-    __m512i fg2 = _mm512_shuffle_epi8(fg1, MASK_SPREAD_2);
-    __m512i bg2 = _mm512_shuffle_epi8(bg1, MASK_SPREAD_2);
-            fg1 = _mm512_shuffle_epi8(fg1, MASK_SPREAD_1);
-            bg1 = _mm512_shuffle_epi8(bg1, MASK_SPREAD_1);
+    Pixel*       bg_pixels;
+    size_t       bg_size_x;
 
-    __m512i fg_alpha1 = _mm512_shuffle_epi8(fg1, MASK_SPREAD_ALPHA);
-    __m512i fg_alpha2 = _mm512_shuffle_epi8(fg2, MASK_SPREAD_ALPHA);
+    const Pixel* fg_pixels;
+    size_t       fg_size_x;
 
-    __m512i bg_alpha1 = _mm512_sub_epi16(EPI16_255, fg_alpha1);
-    __m512i bg_alpha2 = _mm512_sub_epi16(EPI16_255, fg_alpha2);
+    const SpanIndex* spans;
 
-    bg1 = _mm512_mask_mullo_epi16(bg1, IGNORE_ALPHA, bg1, bg_alpha1);
-    bg2 = _mm512_mask_mullo_epi16(bg2, IGNORE_ALPHA, bg2, bg_alpha2);
+    blend_row_t* blend_row;     // Exactly one of kernels is set
 
-    fg1 = _mm512_maskz_mullo_epi16(IGNORE_ALPHA, fg1, fg_alpha1);
-    fg2 = _mm512_maskz_mullo_epi16(IGNORE_ALPHA, fg2, fg_alpha2);
+    blend_row_modulated_t* blend_row_modulated;
+    Pixel16                factors;
+};
 
-    bg1 = _mm512_add_epi16(bg1, fg1);
-    bg2 = _mm512_add_epi16(bg2, fg2);
+void blend_row_spans(Pixel* bg_row, const Pixel* fg_row,
+                     const SpanIndex* spans, size_t y,
+                     size_t x_begin, size_t x_end,
+                     blend_row_t* blend_row)
+{
+    copy_opaque_row_t* const copy_opaque_row =
+                            COPY_OPAQUE_ROW_KERNELS[get_simd_level()];
+
+    for (size_t i = spans->row_starts[y]; i < spans->row_starts[y + 1]; ++i)
+    {
+        const AlphaSpan* span = spans->spans + i;
 
-    bg1 = _mm512_shuffle_epi8(bg1, MASK_PACK_1);
-    bg2 = _mm512_shuffle_epi8(bg2, MASK_PACK_2);
+        // Spans are sorted, so the rest of them are clipped as well
+        if (span->begin >= x_end)
+            break;
 
-    // Pixels do not intersect and can be simply added
-    bg1 = _mm512_add_epi8(bg1, bg2);
+        const size_t begin = span->begin > x_begin ? span->begin : x_begin;
+        const size_t end   = span->begin + span->length < x_end
+                           ? span->begin + span->length : x_end;
+        if (begin >= end)
+            continue;
 
-    return bg1;
+        switch (span->type)
+        {
+            case SPAN_OPAQUE:
+                copy_opaque_row(bg_row + begin, fg_row + begin, end - begin);
+                break;
+            case SPAN_PARTIAL:
+                blend_row(bg_row + begin, fg_row + begin, end - begin);
+                break;
+            case SPAN_TRANSPARENT:
+            default:
+                break;
+        }
+    }
+}
+
+void blend_row_spans_modulated(Pixel* bg_row, const Pixel* fg_row,
+                               const SpanIndex* spans, size_t y,
+                               size_t x_begin, size_t x_end,
+                               blend_row_modulated_t* blend_row,
+                               Pixel16 factors)
+{
+    for (size_t i = spans->row_starts[y]; i < spans->row_starts[y + 1]; ++i)
+    {
+        const AlphaSpan* span = spans->spans + i;
+
+        // Spans are sorted, so the rest of them are clipped as well
+        if (span->begin >= x_end)
+            break;
+
+        const size_t begin = span->begin > x_begin ? span->begin : x_begin;
+        const size_t end   = span->begin + span->length < x_end
+                           ? span->begin + span->length : x_end;
+        if (begin >= end || span->type == SPAN_TRANSPARENT)
+            continue;
+
+        blend_row(bg_row + begin, fg_row + begin, end - begin, factors);
+    }
+}
+
+static void blend_rows(void* task_ptr, size_t begin, size_t end)
+{
+    const BlendRowsTask* task = (const BlendRowsTask*) task_ptr;
+
+    Pixel* bg_row = task->bg_pixels + begin * task->bg_size_x;
+    const Pixel* fg_row = task->fg_pixels + begin * task->fg_size_x;
+
+    for (size_t y = begin; y < end; ++y)
+    {
+        if (task->blend_row_modulated && task->spans)
+            blend_row_spans_modulated(bg_row, fg_row, task->spans, y,
+                                      0, task->fg_size_x,
+                                      task->blend_row_modulated,
+                                      task->factors);
+        else if (task->blend_row_modulated)
+            task->blend_row_modulated(bg_row, fg_row, task->fg_size_x,
+                                      task->factors);
+        else if (task->spans)
+            blend_row_spans(bg_row, fg_row, task->spans, y,
+                            0, task->fg_size_x, task->blend_row);
+        else
+            task->blend_row(bg_row, fg_row, task->fg_size_x);
+
+        fg_row += task->fg_size_x;
+        bg_row += task->bg_size_x;
+    }
 }
 
 int blend_pixels_optimized(PixelImage* background,
                             const MovedImage* foreground)
+{
+    return blend_pixels_parallel(background, foreground, NULL);
+}
+
+int blend_pixels_parallel(PixelImage* background,
+                           const MovedImage* foreground,
+                           ThreadPool* pool)
+{
+    return blend_with_kernel(background, foreground, pool,
+                             BLEND_ROW_KERNELS, MODULATED_ROW_KERNELS,
+                             get_modulation_factors);
+}
+
+int blend_premultiplied(PixelImage* background,
+                        const MovedImage* foreground,
+                        ThreadPool* pool)
+{
+    return blend_with_kernel(background, foreground, pool,
+                             PREMULTIPLIED_ROW_KERNELS,
+                             PREMULTIPLIED_MODULATED_ROW_KERNELS,
+                             get_premultiplied_modulation_factors);
+}
+
+int blend_pixels_linear(PixelImage* background,
+                        const MovedImage* foreground,
+                        ThreadPool* pool)
+{
+    return blend_with_kernel(background, foreground, pool,
+                             LINEAR_ROW_KERNELS, NULL, NULL);
+}
+
+static int blend_with_kernel(PixelImage* background,
+                             const MovedImage* foreground,
+                             ThreadPool* pool,
+                             blend_row_t* const
+                             kernels[BLEND_MODE_COUNT][SIMD_LEVEL_COUNT],
+                             blend_row_modulated_t* const
+                             modulated[BLEND_MODE_COUNT][SIMD_LEVEL_COUNT],
+                             Pixel16 (*get_factors)(const Modulation*))
 {
     const size_t bg_size_x = background->size.x;
     const size_t bg_size_y = background->size.y;
@@ -188,35 +285,48 @@ int blend_pixels_optimized(PixelImage* background,
                 fg_pos_x + fg_size_x, bg_size_x);
         ASSERT_LESS_EQUAL(
                 fg_pos_y + fg_size_y, bg_size_y);
+        ASSERT_LESS(
+                foreground->blend_mode, BLEND_MODE_COUNT);
+
+        if (foreground->spans)
+            ASSERT_EQUAL(
+                    foreground->spans->row_count, fg_size_y);
+
+        // Not every kind of blending supports modulation
+        if (foreground->modulation)
+            ASSERT_TRUE(modulated != NULL);
     }
     SAFE_BLOCK_HANDLE_ERRORS
     {
-        return -1;     
+        return -1;
     }
     SAFE_BLOCK_END
 
-    Pixel* bg_row = background->pixel_array + bg_size_x*fg_pos_y + fg_pos_x;
-    const Pixel* fg_row = foreground->pixel_array;
-
-    for (size_t y = 0; y < fg_size_y; ++y)
+    BlendRowsTask task = {
+        .bg_pixels           = background->pixel_array
+                             + bg_size_x*fg_pos_y + fg_pos_x,
+        .bg_size_x           = bg_size_x,
+        .fg_pixels           = foreground->pixel_array,
+        .fg_size_x           = fg_size_x,
+        .spans               = foreground->spans,
+        .blend_row           = kernels[foreground->blend_mode]
+                                      [get_simd_level()],
+        .blend_row_modulated = NULL,
+        .factors             = {}
+    };
+
+    if (foreground->modulation)
     {
-        size_t x = 0;
-        for (x = 0; x + 16 <= fg_size_x; x += 16)
-        {
-            __m512i bg = _mm512_loadu_si512(bg_row + x);
-            __m512i fg = _mm512_loadu_si512(fg_row + x);
-            __m512i result = combine_pixels_simd(bg, fg);
-            _mm512_storeu_si512(bg_row + x, result);
-        }
-        // Remaining pixels
-        for (; x < fg_size_x; ++x)
-        {
-            combine_pixels(bg_row + x, fg_row + x);
-        }
-
-        fg_row += fg_size_x;
-        bg_row += bg_size_x;
+        task.blend_row = NULL;
+        task.blend_row_modulated =
+                    modulated[foreground->blend_mode][get_simd_level()];
+        task.factors = get_factors(foreground->modulation);
     }
 
+    if (pool)
+        thread_pool_run(pool, blend_rows, &task, fg_size_y);
+    else
+        blend_rows(&task, 0, fg_size_y);
+
     return 0;
 }
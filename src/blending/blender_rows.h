@@ -0,0 +1,227 @@
+/**
+ * @file blender_rows.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Row blending kernels, built for several instruction set levels
+ *
+ * @version 0.1
+ * @date 2023-04-24
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __BLENDER_ROWS_H
+#define __BLENDER_ROWS_H
+
+#include "commons/definitions.h"
+#include "span_index.h"
+
+/**
+ * @brief Blend a row of foreground pixels on top of background row
+ *
+ * @param[inout] bg	    - Background row
+ * @param[in]    fg	    - Foreground row
+ * @param[in]    count	- Number of pixels in row
+ */
+typedef void blend_row_t(Pixel* bg, const Pixel* fg, size_t count);
+
+/**
+ * @brief Blend a row of foreground pixels, modulated by per-channel
+ * factors, on top of background row
+ *
+ * @param[inout] bg	        - Background row
+ * @param[in]    fg	        - Foreground row
+ * @param[in]    count	    - Number of pixels in row
+ * @param[in]    factors	- Channel multipliers, see `get_modulation_factors`
+ */
+typedef void blend_row_modulated_t(Pixel* bg, const Pixel* fg, size_t count,
+                                   Pixel16 factors);
+
+blend_row_t blend_row_scalar;
+blend_row_t blend_row_sse4;
+blend_row_t blend_row_avx2;
+blend_row_t blend_row_avx512;
+
+blend_row_t blend_row_exact_scalar;
+blend_row_t blend_row_exact_sse4;
+blend_row_t blend_row_exact_avx2;
+blend_row_t blend_row_exact_avx512;
+
+// Foreground rows are expected to be premultiplied by alpha
+blend_row_t blend_row_premultiplied_scalar;
+blend_row_t blend_row_premultiplied_sse4;
+blend_row_t blend_row_premultiplied_avx2;
+blend_row_t blend_row_premultiplied_avx512;
+
+blend_row_t blend_row_premultiplied_exact_scalar;
+blend_row_t blend_row_premultiplied_exact_sse4;
+blend_row_t blend_row_premultiplied_exact_avx2;
+blend_row_t blend_row_premultiplied_exact_avx512;
+
+/**
+ * @brief Copy color of opaque foreground pixels, keeping background alpha,
+ * as blending them would
+ *
+ * @param[inout] bg	    - Background row
+ * @param[in]    fg	    - Foreground row of opaque pixels
+ * @param[in]    count	- Number of pixels in row
+ */
+typedef void copy_opaque_row_t(Pixel* bg, const Pixel* fg, size_t count);
+
+copy_opaque_row_t copy_opaque_row_scalar;
+copy_opaque_row_t copy_opaque_row_sse4;
+copy_opaque_row_t copy_opaque_row_avx2;
+copy_opaque_row_t copy_opaque_row_avx512;
+
+blend_row_modulated_t blend_row_modulated_scalar;
+blend_row_modulated_t blend_row_modulated_sse4;
+blend_row_modulated_t blend_row_modulated_avx2;
+blend_row_modulated_t blend_row_modulated_avx512;
+
+blend_row_modulated_t blend_row_modulated_exact_scalar;
+blend_row_modulated_t blend_row_modulated_exact_sse4;
+blend_row_modulated_t blend_row_modulated_exact_avx2;
+blend_row_modulated_t blend_row_modulated_exact_avx512;
+
+// Foreground rows are expected to be premultiplied by alpha, factors are
+// returned by `get_premultiplied_modulation_factors`
+blend_row_modulated_t blend_row_premultiplied_modulated_scalar;
+blend_row_modulated_t blend_row_premultiplied_modulated_sse4;
+blend_row_modulated_t blend_row_premultiplied_modulated_avx2;
+blend_row_modulated_t blend_row_premultiplied_modulated_avx512;
+
+blend_row_modulated_t blend_row_premultiplied_modulated_exact_scalar;
+blend_row_modulated_t blend_row_premultiplied_modulated_exact_sse4;
+blend_row_modulated_t blend_row_premultiplied_modulated_exact_avx2;
+blend_row_modulated_t blend_row_premultiplied_modulated_exact_avx512;
+
+// Blending in linear light, see `combine_pixels_linear`. Lookups dominate,
+// and narrower instruction sets have nothing faster than scalar loads.
+blend_row_t blend_row_linear_scalar;
+blend_row_t blend_row_linear_avx512;
+
+/**
+ * @brief Get multipliers of foreground channels in 8.8 fixed point.
+ * Modulation value `m` becomes `m + 1`, so that 255 keeps channel exactly.
+ */
+__always_inline
+static Pixel16 get_modulation_factors(const Modulation* modulation)
+{
+    return {
+        .red   = (uint16_t) (modulation->tint.red   + 1),
+        .green = (uint16_t) (modulation->tint.green + 1),
+        .blue  = (uint16_t) (modulation->tint.blue  + 1),
+        .alpha = (uint16_t) (modulation->opacity    + 1)
+    };
+}
+
+/**
+ * @brief Get multipliers of premultiplied foreground channels. Color
+ * channels already carry alpha, so they are scaled by opacity as well as
+ * by tint and never exceed modulated alpha.
+ */
+__always_inline
+static Pixel16 get_premultiplied_modulation_factors(const Modulation*
+                                                    modulation)
+{
+    const Pixel16 factors = get_modulation_factors(modulation);
+
+    return {
+        .red   = (uint16_t) (factors.red   * factors.alpha >> 8),
+        .green = (uint16_t) (factors.green * factors.alpha >> 8),
+        .blue  = (uint16_t) (factors.blue  * factors.alpha >> 8),
+        .alpha = factors.alpha
+    };
+}
+
+/**
+ * @brief Pack factors into 64 bits, the same way `Pixel16` is stored
+ */
+__always_inline
+static uint64_t pack_modulation_factors(Pixel16 factors)
+{
+    return (uint64_t) factors.alpha << 48 | (uint64_t) factors.blue << 32
+         | (uint64_t) factors.green << 16 | (uint64_t) factors.red;
+}
+
+/**
+ * @brief Multiply every channel of pixel by its factor
+ */
+__always_inline
+static Pixel modulate_pixel(Pixel pixel, Pixel16 factors)
+{
+    return {
+        .red   = (uint8_t) (pixel.red   * factors.red   >> 8),
+        .green = (uint8_t) (pixel.green * factors.green >> 8),
+        .blue  = (uint8_t) (pixel.blue  * factors.blue  >> 8),
+        .alpha = (uint8_t) (pixel.alpha * factors.alpha >> 8)
+    };
+}
+
+/**
+ * @brief Get the fastest row blending kernel, supported by CPU
+ *
+ * @param[in] mode	- Division used by kernel
+ *
+ * @return Kernel from the dispatch table
+ */
+blend_row_t* get_blend_row_kernel(BlendMode mode);
+
+/**
+ * @brief Get the fastest kernel for blending premultiplied foreground rows
+ *
+ * @param[in] mode	- Division used by kernel
+ *
+ * @return Kernel from the dispatch table
+ */
+blend_row_t* get_blend_premultiplied_row_kernel(BlendMode mode);
+
+/**
+ * @brief Get the fastest kernel for blending premultiplied foreground rows
+ * with modulation
+ *
+ * @param[in] mode	- Division used by kernel
+ *
+ * @return Kernel from the dispatch table
+ */
+blend_row_modulated_t* get_blend_premultiplied_modulated_row_kernel(
+                                                        BlendMode mode);
+
+/**
+ * @brief Blend columns [x_begin; x_end) of foreground row, skipping its
+ * transparent spans and copying color of opaque ones. Only partial spans
+ * are passed to the kernel. Background alpha is left unchanged.
+ *
+ * @param[inout] bg_row	    - Background row, under the first foreground pixel
+ * @param[in]    fg_row	    - Foreground row
+ * @param[in]    spans	    - Span index of foreground
+ * @param[in]    y	        - Row index inside foreground
+ * @param[in]    x_begin	- First column inside foreground
+ * @param[in]    x_end	    - Column after the last one
+ * @param[in]    blend_row	- Kernel for partial spans
+ */
+void blend_row_spans(Pixel* bg_row, const Pixel* fg_row,
+                     const SpanIndex* spans, size_t y,
+                     size_t x_begin, size_t x_end,
+                     blend_row_t* blend_row);
+
+/**
+ * @brief Blend columns [x_begin; x_end) of modulated foreground row.
+ * Modulated opaque spans are no longer opaque, so only transparent ones
+ * are skipped.
+ *
+ * @param[inout] bg_row	    - Background row, under the first foreground pixel
+ * @param[in]    fg_row	    - Foreground row
+ * @param[in]    spans	    - Span index of foreground
+ * @param[in]    y	        - Row index inside foreground
+ * @param[in]    x_begin	- First column inside foreground
+ * @param[in]    x_end	    - Column after the last one
+ * @param[in]    blend_row	- Modulated kernel
+ * @param[in]    factors	- Channel multipliers, passed to kernel
+ */
+void blend_row_spans_modulated(Pixel* bg_row, const Pixel* fg_row,
+                               const SpanIndex* spans, size_t y,
+                               size_t x_begin, size_t x_end,
+                               blend_row_modulated_t* blend_row,
+                               Pixel16 factors);
+
+#endif /* blender_rows.h */
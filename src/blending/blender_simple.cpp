@@ -1,6 +1,9 @@
 #include "meerkat_assert/asserts.h"
 
 #include "blender.h"
+#include "blender_rows.h"
+#include "shuffle_masks.h"
+#include "srgb.h"
 
 void combine_pixels(Pixel* bg, const Pixel* fg)
 {
@@ -21,6 +24,174 @@ void combine_pixels(Pixel* bg, const Pixel* fg)
     bg->blue  = (uint8_t) (blue  >> 8);
 }
 
+__always_inline
+static uint8_t divide_exact(uint16_t value)
+{
+    const uint32_t biased = (uint32_t) value + EXACT_DIV_BIAS;
+
+    return (uint8_t) ((biased * EXACT_DIV_MULTIPLIER) >> 16);
+}
+
+void combine_pixels_exact(Pixel* bg, const Pixel* fg)
+{
+    const uint16_t fg_alpha = fg->alpha;
+
+    const uint16_t red   = (uint16_t) (bg->red   * (255 - fg_alpha)
+                                     + fg->red   * fg_alpha);
+
+    const uint16_t green = (uint16_t) (bg->green * (255 - fg_alpha)
+                                     + fg->green * fg_alpha);
+
+    const uint16_t blue  = (uint16_t) (bg->blue  * (255 - fg_alpha)
+                                     + fg->blue  * fg_alpha);
+
+    bg->red   = divide_exact(red);
+    bg->green = divide_exact(green);
+    bg->blue  = divide_exact(blue);
+}
+
+void combine_pixels_premultiplied(Pixel* bg, const Pixel* fg)
+{
+    const uint16_t bg_alpha = (uint16_t) (255 - fg->alpha);
+
+    // Foreground is added in higher byte, so that single shift suffices
+    const uint16_t red   = (uint16_t) (bg->red   * bg_alpha + (fg->red   << 8));
+    const uint16_t green = (uint16_t) (bg->green * bg_alpha + (fg->green << 8));
+    const uint16_t blue  = (uint16_t) (bg->blue  * bg_alpha + (fg->blue  << 8));
+
+    bg->red   = (uint8_t) (red   >> 8);
+    bg->green = (uint8_t) (green >> 8);
+    bg->blue  = (uint8_t) (blue  >> 8);
+}
+
+void combine_pixels_premultiplied_exact(Pixel* bg, const Pixel* fg)
+{
+    const uint16_t bg_alpha = (uint16_t) (255 - fg->alpha);
+
+    bg->red   = (uint8_t) (divide_exact((uint16_t) (bg->red   * bg_alpha))
+                         + fg->red);
+    bg->green = (uint8_t) (divide_exact((uint16_t) (bg->green * bg_alpha))
+                         + fg->green);
+    bg->blue  = (uint8_t) (divide_exact((uint16_t) (bg->blue  * bg_alpha))
+                         + fg->blue);
+}
+
+__always_inline
+static void combine_linear(Pixel* bg, const Pixel* fg,
+                           const SrgbTables* tables)
+{
+    const uint32_t fg_alpha = fg->alpha * 257u;
+
+    bg->red   = blend_channel_linear(bg->red,   fg->red,   fg_alpha, tables);
+    bg->green = blend_channel_linear(bg->green, fg->green, fg_alpha, tables);
+    bg->blue  = blend_channel_linear(bg->blue,  fg->blue,  fg_alpha, tables);
+}
+
+void combine_pixels_linear(Pixel* bg, const Pixel* fg)
+{
+    combine_linear(bg, fg, get_srgb_tables());
+}
+
+void premultiply_alpha(PixelImage* image)
+{
+    const size_t pixel_count = image->size.x * image->size.y;
+
+    for (size_t i = 0; i < pixel_count; ++i)
+    {
+        Pixel* pixel = image->pixel_array + i;
+        const uint16_t alpha = pixel->alpha;
+
+        pixel->red   = divide_exact((uint16_t) (pixel->red   * alpha));
+        pixel->green = divide_exact((uint16_t) (pixel->green * alpha));
+        pixel->blue  = divide_exact((uint16_t) (pixel->blue  * alpha));
+    }
+}
+
+void blend_row_scalar(Pixel* bg, const Pixel* fg, size_t count)
+{
+    for (size_t x = 0; x < count; ++x)
+    {
+        combine_pixels(bg + x, fg + x);
+    }
+}
+
+void blend_row_exact_scalar(Pixel* bg, const Pixel* fg, size_t count)
+{
+    for (size_t x = 0; x < count; ++x)
+    {
+        combine_pixels_exact(bg + x, fg + x);
+    }
+}
+
+void blend_row_modulated_scalar(Pixel* bg, const Pixel* fg, size_t count,
+                                Pixel16 factors)
+{
+    for (size_t x = 0; x < count; ++x)
+    {
+        const Pixel pixel = modulate_pixel(fg[x], factors);
+        combine_pixels(bg + x, &pixel);
+    }
+}
+
+void blend_row_modulated_exact_scalar(Pixel* bg, const Pixel* fg,
+                                      size_t count, Pixel16 factors)
+{
+    for (size_t x = 0; x < count; ++x)
+    {
+        const Pixel pixel = modulate_pixel(fg[x], factors);
+        combine_pixels_exact(bg + x, &pixel);
+    }
+}
+
+void blend_row_premultiplied_scalar(Pixel* bg, const Pixel* fg, size_t count)
+{
+    for (size_t x = 0; x < count; ++x)
+    {
+        combine_pixels_premultiplied(bg + x, fg + x);
+    }
+}
+
+void blend_row_premultiplied_exact_scalar(Pixel* bg, const Pixel* fg,
+                                          size_t count)
+{
+    for (size_t x = 0; x < count; ++x)
+    {
+        combine_pixels_premultiplied_exact(bg + x, fg + x);
+    }
+}
+
+void blend_row_premultiplied_modulated_scalar(Pixel* bg, const Pixel* fg,
+                                              size_t count, Pixel16 factors)
+{
+    for (size_t x = 0; x < count; ++x)
+    {
+        const Pixel pixel = modulate_pixel(fg[x], factors);
+        combine_pixels_premultiplied(bg + x, &pixel);
+    }
+}
+
+void blend_row_premultiplied_modulated_exact_scalar(Pixel* bg,
+                                                    const Pixel* fg,
+                                                    size_t count,
+                                                    Pixel16 factors)
+{
+    for (size_t x = 0; x < count; ++x)
+    {
+        const Pixel pixel = modulate_pixel(fg[x], factors);
+        combine_pixels_premultiplied_exact(bg + x, &pixel);
+    }
+}
+
+void blend_row_linear_scalar(Pixel* bg, const Pixel* fg, size_t count)
+{
+    const SrgbTables* tables = get_srgb_tables();
+
+    for (size_t x = 0; x < count; ++x)
+    {
+        combine_linear(bg + x, fg + x, tables);
+    }
+}
+
 int blend_pixels_simple(PixelImage* background,
                          const MovedImage* foreground)
 {
@@ -49,11 +220,18 @@ int blend_pixels_simple(PixelImage* background,
     Pixel* bg_row = background->pixel_array + bg_size_x*fg_pos_y + fg_pos_x;
     const Pixel* fg_row = foreground->pixel_array;
 
+    const Modulation* modulation = foreground->modulation;
+
     for (size_t y = 0; y < fg_size_y; ++y)
     {
         for (size_t x = 0; x < fg_size_x; ++x)
         {
-            combine_pixels(bg_row + x, fg_row + x);
+            Pixel pixel = fg_row[x];
+            if (modulation)
+                pixel = modulate_pixel(pixel,
+                                       get_modulation_factors(modulation));
+
+            combine_pixels(bg_row + x, &pixel);
         }
         bg_row += bg_size_x;
         fg_row += fg_size_x;
@@ -61,3 +239,13 @@ int blend_pixels_simple(PixelImage* background,
 
     return 0;
 }
+
+void copy_opaque_row_scalar(Pixel* bg, const Pixel* fg, size_t count)
+{
+    for (size_t x = 0; x < count; ++x)
+    {
+        bg[x].red   = fg[x].red;
+        bg[x].green = fg[x].green;
+        bg[x].blue  = fg[x].blue;
+    }
+}
@@ -0,0 +1,412 @@
+#include "commons/intrinsics.h"
+
+#include "blender.h"
+#include "blender_rows.h"
+#include "shuffle_masks.h"
+
+// Without factors, foreground pixels are blended as they are
+__always_inline
+static __m128i combine_simd128_core(__m128i bg1, __m128i fg1,
+                                    const __m128i* factors)
+{
+    const __m128i MASK_SPREAD_1     = _mm_set_epi8(MASK_SPREAD_1_ROW);
+    const __m128i MASK_SPREAD_2     = _mm_set_epi8(MASK_SPREAD_2_ROW);
+    const __m128i MASK_SPREAD_ALPHA = _mm_set_epi8(MASK_SPREAD_ALPHA_ROW);
+    const __m128i MASK_PACK_1       = _mm_set_epi8(MASK_PACK_1_ROW);
+    const __m128i MASK_PACK_2       = _mm_set_epi8(MASK_PACK_2_ROW);
+
+    // All half-words set to 255
+    const __m128i EPI16_255 = _mm_set1_epi16(0x00FF);
+
+    __m128i fg2 = _mm_shuffle_epi8(fg1, MASK_SPREAD_2);
+    __m128i bg2 = _mm_shuffle_epi8(bg1, MASK_SPREAD_2);
+            fg1 = _mm_shuffle_epi8(fg1, MASK_SPREAD_1);
+            bg1 = _mm_shuffle_epi8(bg1, MASK_SPREAD_1);
+
+    // Opacity and tint, see modulate_pixel
+    if (factors)
+    {
+        fg1 = _mm_srli_epi16(_mm_mullo_epi16(fg1, *factors), 8);
+        fg2 = _mm_srli_epi16(_mm_mullo_epi16(fg2, *factors), 8);
+    }
+
+    __m128i fg_alpha1 = _mm_shuffle_epi8(fg1, MASK_SPREAD_ALPHA);
+    __m128i fg_alpha2 = _mm_shuffle_epi8(fg2, MASK_SPREAD_ALPHA);
+
+    __m128i bg_alpha1 = _mm_sub_epi16(EPI16_255, fg_alpha1);
+    __m128i bg_alpha2 = _mm_sub_epi16(EPI16_255, fg_alpha2);
+
+    // No write masks before AVX-512: multiply everything, then restore
+    // background alpha and clear foreground alpha with blends
+    bg1 = _mm_blend_epi16(bg1, _mm_mullo_epi16(bg1, bg_alpha1),
+                          IGNORE_ALPHA_BLEND);
+    bg2 = _mm_blend_epi16(bg2, _mm_mullo_epi16(bg2, bg_alpha2),
+                          IGNORE_ALPHA_BLEND);
+
+    fg1 = _mm_blend_epi16(_mm_setzero_si128(),
+                          _mm_mullo_epi16(fg1, fg_alpha1),
+                          IGNORE_ALPHA_BLEND);
+    fg2 = _mm_blend_epi16(_mm_setzero_si128(),
+                          _mm_mullo_epi16(fg2, fg_alpha2),
+                          IGNORE_ALPHA_BLEND);
+
+    bg1 = _mm_add_epi16(bg1, fg1);
+    bg2 = _mm_add_epi16(bg2, fg2);
+
+    bg1 = _mm_shuffle_epi8(bg1, MASK_PACK_1);
+    bg2 = _mm_shuffle_epi8(bg2, MASK_PACK_2);
+
+    // Pixels do not intersect and can be simply added
+    bg1 = _mm_add_epi8(bg1, bg2);
+
+    return bg1;
+}
+
+__m128i combine_pixels_simd128(__m128i bg, __m128i fg)
+{
+    return combine_simd128_core(bg, fg, NULL);
+}
+
+// Same as above, with correctly rounded division
+__always_inline
+static __m128i combine_simd128_core_exact(__m128i bg1, __m128i fg1,
+                                          const __m128i* factors)
+{
+    const __m128i MASK_SPREAD_1     = _mm_set_epi8(MASK_SPREAD_1_ROW);
+    const __m128i MASK_SPREAD_2     = _mm_set_epi8(MASK_SPREAD_2_ROW);
+    const __m128i MASK_SPREAD_ALPHA = _mm_set_epi8(MASK_SPREAD_ALPHA_ROW);
+    const __m128i MASK_PACK_1       = _mm_set_epi8(MASK_PACK_EXACT_1_ROW);
+    const __m128i MASK_PACK_2       = _mm_set_epi8(MASK_PACK_EXACT_2_ROW);
+
+    const __m128i EPI16_255  = _mm_set1_epi16(0x00FF);
+    const __m128i DIV_BIAS   = _mm_set1_epi16(EXACT_DIV_BIAS);
+    const __m128i DIV_MULT   = _mm_set1_epi16(EXACT_DIV_MULTIPLIER);
+
+    __m128i fg2 = _mm_shuffle_epi8(fg1, MASK_SPREAD_2);
+    __m128i bg2 = _mm_shuffle_epi8(bg1, MASK_SPREAD_2);
+            fg1 = _mm_shuffle_epi8(fg1, MASK_SPREAD_1);
+            bg1 = _mm_shuffle_epi8(bg1, MASK_SPREAD_1);
+
+    // Opacity and tint, see modulate_pixel
+    if (factors)
+    {
+        fg1 = _mm_srli_epi16(_mm_mullo_epi16(fg1, *factors), 8);
+        fg2 = _mm_srli_epi16(_mm_mullo_epi16(fg2, *factors), 8);
+    }
+
+    __m128i fg_alpha1 = _mm_shuffle_epi8(fg1, MASK_SPREAD_ALPHA);
+    __m128i fg_alpha2 = _mm_shuffle_epi8(fg2, MASK_SPREAD_ALPHA);
+
+    __m128i bg_alpha1 = _mm_sub_epi16(EPI16_255, fg_alpha1);
+    __m128i bg_alpha2 = _mm_sub_epi16(EPI16_255, fg_alpha2);
+
+    // Background alpha is restored by the final blend, so unlike
+    // `combine_pixels_simd128` everything can be multiplied at once
+    __m128i sum1 = _mm_add_epi16(_mm_mullo_epi16(bg1, bg_alpha1),
+                                 _mm_mullo_epi16(fg1, fg_alpha1));
+    __m128i sum2 = _mm_add_epi16(_mm_mullo_epi16(bg2, bg_alpha2),
+                                 _mm_mullo_epi16(fg2, fg_alpha2));
+
+    // x / 255 rounded
+    sum1 = _mm_mulhi_epu16(_mm_add_epi16(sum1, DIV_BIAS), DIV_MULT);
+    sum2 = _mm_mulhi_epu16(_mm_add_epi16(sum2, DIV_BIAS), DIV_MULT);
+
+    bg1 = _mm_blend_epi16(bg1, sum1, IGNORE_ALPHA_BLEND);
+    bg2 = _mm_blend_epi16(bg2, sum2, IGNORE_ALPHA_BLEND);
+
+    bg1 = _mm_shuffle_epi8(bg1, MASK_PACK_1);
+    bg2 = _mm_shuffle_epi8(bg2, MASK_PACK_2);
+
+    // Pixels do not intersect and can be simply added
+    bg1 = _mm_add_epi8(bg1, bg2);
+
+    return bg1;
+}
+
+__m128i combine_pixels_simd128_exact(__m128i bg, __m128i fg)
+{
+    return combine_simd128_core_exact(bg, fg, NULL);
+}
+
+/*
+ * Premultiplied foreground needs only background to be multiplied
+ */
+static __m128i combine_premultiplied_simd128(__m128i bg1, __m128i fg)
+{
+    const __m128i MASK_SPREAD_1 = _mm_set_epi8(MASK_SPREAD_1_ROW);
+    const __m128i MASK_SPREAD_2 = _mm_set_epi8(MASK_SPREAD_2_ROW);
+
+    const __m128i MASK_SPREAD_HIGH_1 = _mm_set_epi8(MASK_SPREAD_HIGH_1_ROW);
+    const __m128i MASK_SPREAD_HIGH_2 = _mm_set_epi8(MASK_SPREAD_HIGH_2_ROW);
+
+    const __m128i MASK_SPREAD_ALPHA_1 = _mm_set_epi8(MASK_SPREAD_PACKED_ALPHA_1_ROW);
+    const __m128i MASK_SPREAD_ALPHA_2 = _mm_set_epi8(MASK_SPREAD_PACKED_ALPHA_2_ROW);
+
+    const __m128i MASK_PACK_1 = _mm_set_epi8(MASK_PACK_1_ROW);
+    const __m128i MASK_PACK_2 = _mm_set_epi8(MASK_PACK_2_ROW);
+
+    const __m128i EPI16_255 = _mm_set1_epi16(0x00FF);
+
+    __m128i bg2 = _mm_shuffle_epi8(bg1, MASK_SPREAD_2);
+            bg1 = _mm_shuffle_epi8(bg1, MASK_SPREAD_1);
+
+    __m128i fg1 = _mm_shuffle_epi8(fg, MASK_SPREAD_HIGH_1);
+    __m128i fg2 = _mm_shuffle_epi8(fg, MASK_SPREAD_HIGH_2);
+
+    __m128i fg_alpha1 = _mm_shuffle_epi8(fg, MASK_SPREAD_ALPHA_1);
+    __m128i fg_alpha2 = _mm_shuffle_epi8(fg, MASK_SPREAD_ALPHA_2);
+
+    __m128i bg_alpha1 = _mm_sub_epi16(EPI16_255, fg_alpha1);
+    __m128i bg_alpha2 = _mm_sub_epi16(EPI16_255, fg_alpha2);
+
+    __m128i sum1 = _mm_add_epi16(_mm_mullo_epi16(bg1, bg_alpha1), fg1);
+    __m128i sum2 = _mm_add_epi16(_mm_mullo_epi16(bg2, bg_alpha2), fg2);
+
+    // Restore background alpha
+    bg1 = _mm_blend_epi16(bg1, sum1, IGNORE_ALPHA_BLEND);
+    bg2 = _mm_blend_epi16(bg2, sum2, IGNORE_ALPHA_BLEND);
+
+    bg1 = _mm_shuffle_epi8(bg1, MASK_PACK_1);
+    bg2 = _mm_shuffle_epi8(bg2, MASK_PACK_2);
+
+    // Pixels do not intersect and can be simply added
+    bg1 = _mm_add_epi8(bg1, bg2);
+
+    return bg1;
+}
+
+static __m128i combine_premultiplied_simd128_exact(__m128i bg1, __m128i fg)
+{
+    const __m128i MASK_SPREAD_1 = _mm_set_epi8(MASK_SPREAD_1_ROW);
+    const __m128i MASK_SPREAD_2 = _mm_set_epi8(MASK_SPREAD_2_ROW);
+
+    const __m128i MASK_SPREAD_ALPHA_1 = _mm_set_epi8(MASK_SPREAD_PACKED_ALPHA_1_ROW);
+    const __m128i MASK_SPREAD_ALPHA_2 = _mm_set_epi8(MASK_SPREAD_PACKED_ALPHA_2_ROW);
+
+    const __m128i MASK_PACK_1 = _mm_set_epi8(MASK_PACK_EXACT_1_ROW);
+    const __m128i MASK_PACK_2 = _mm_set_epi8(MASK_PACK_EXACT_2_ROW);
+
+    const __m128i EPI16_255  = _mm_set1_epi16(0x00FF);
+    const __m128i DIV_BIAS   = _mm_set1_epi16(EXACT_DIV_BIAS);
+    const __m128i DIV_MULT   = _mm_set1_epi16(EXACT_DIV_MULTIPLIER);
+
+    __m128i bg2 = _mm_shuffle_epi8(bg1, MASK_SPREAD_2);
+            bg1 = _mm_shuffle_epi8(bg1, MASK_SPREAD_1);
+
+    // Foreground is added after division, so it stays in lower bytes
+    __m128i fg1 = _mm_shuffle_epi8(fg, MASK_SPREAD_1);
+    __m128i fg2 = _mm_shuffle_epi8(fg, MASK_SPREAD_2);
+
+    __m128i fg_alpha1 = _mm_shuffle_epi8(fg, MASK_SPREAD_ALPHA_1);
+    __m128i fg_alpha2 = _mm_shuffle_epi8(fg, MASK_SPREAD_ALPHA_2);
+
+    __m128i bg_alpha1 = _mm_sub_epi16(EPI16_255, fg_alpha1);
+    __m128i bg_alpha2 = _mm_sub_epi16(EPI16_255, fg_alpha2);
+
+    __m128i sum1 = _mm_mullo_epi16(bg1, bg_alpha1);
+    __m128i sum2 = _mm_mullo_epi16(bg2, bg_alpha2);
+
+    // x / 255 rounded
+    sum1 = _mm_mulhi_epu16(_mm_add_epi16(sum1, DIV_BIAS), DIV_MULT);
+    sum2 = _mm_mulhi_epu16(_mm_add_epi16(sum2, DIV_BIAS), DIV_MULT);
+
+    sum1 = _mm_add_epi16(sum1, fg1);
+    sum2 = _mm_add_epi16(sum2, fg2);
+
+    // Restore background alpha
+    bg1 = _mm_blend_epi16(bg1, sum1, IGNORE_ALPHA_BLEND);
+    bg2 = _mm_blend_epi16(bg2, sum2, IGNORE_ALPHA_BLEND);
+
+    bg1 = _mm_shuffle_epi8(bg1, MASK_PACK_1);
+    bg2 = _mm_shuffle_epi8(bg2, MASK_PACK_2);
+
+    // Pixels do not intersect and can be simply added
+    bg1 = _mm_add_epi8(bg1, bg2);
+
+    return bg1;
+}
+
+__always_inline
+static void blend_row_with(Pixel* bg, const Pixel* fg, size_t count,
+                           __m128i (*combine_simd)(__m128i, __m128i),
+                           void    (*combine)(Pixel*, const Pixel*))
+{
+    size_t x = 0;
+    for (x = 0; x + 4 <= count; x += 4)
+    {
+        __m128i bg_pixels = _mm_loadu_si128((const __m128i*)(bg + x));
+        __m128i fg_pixels = _mm_loadu_si128((const __m128i*)(fg + x));
+        __m128i result = combine_simd(bg_pixels, fg_pixels);
+        _mm_storeu_si128((__m128i*)(bg + x), result);
+    }
+    // Remaining pixels
+    for (; x < count; ++x)
+    {
+        combine(bg + x, fg + x);
+    }
+}
+
+void blend_row_sse4(Pixel* bg, const Pixel* fg, size_t count)
+{
+    blend_row_with(bg, fg, count, combine_pixels_simd128, combine_pixels);
+}
+
+void blend_row_exact_sse4(Pixel* bg, const Pixel* fg, size_t count)
+{
+    blend_row_with(bg, fg, count, combine_pixels_simd128_exact,
+                   combine_pixels_exact);
+}
+
+void blend_row_premultiplied_sse4(Pixel* bg, const Pixel* fg, size_t count)
+{
+    blend_row_with(bg, fg, count, combine_premultiplied_simd128,
+                   combine_pixels_premultiplied);
+}
+
+void blend_row_premultiplied_exact_sse4(Pixel* bg, const Pixel* fg,
+                                        size_t count)
+{
+    blend_row_with(bg, fg, count, combine_premultiplied_simd128_exact,
+                   combine_pixels_premultiplied_exact);
+}
+
+// Not inlined, so that unoptimized builds fit into stack
+static __m128i combine_modulated_simd128(__m128i bg, __m128i fg,
+                                         const __m128i* factors)
+{
+    return combine_simd128_core(bg, fg, factors);
+}
+
+static __m128i combine_modulated_simd128_exact(__m128i bg, __m128i fg,
+                                               const __m128i* factors)
+{
+    return combine_simd128_core_exact(bg, fg, factors);
+}
+
+__always_inline
+static __m128i combine_with_factors(__m128i bg, __m128i fg,
+                                    const __m128i* factors, bool is_exact)
+{
+    return is_exact ? combine_modulated_simd128_exact(bg, fg, factors)
+                    : combine_modulated_simd128(bg, fg, factors);
+}
+
+__always_inline
+static void blend_row_modulated_with(Pixel* bg, const Pixel* fg, size_t count,
+                                     Pixel16 factors, bool is_exact)
+{
+    const size_t pixels_per_vector = sizeof(__m128i) / sizeof(Pixel);
+
+    const __m128i factors_simd = _mm_set1_epi64x(
+                                (long long) pack_modulation_factors(factors));
+
+    size_t x = 0;
+    for (; x + pixels_per_vector <= count; x += pixels_per_vector)
+    {
+        __m128i bg_pixels = _mm_loadu_si128((const __m128i*)(bg + x));
+        __m128i fg_pixels = _mm_loadu_si128((const __m128i*)(fg + x));
+        __m128i result = combine_with_factors(bg_pixels, fg_pixels,
+                                              &factors_simd, is_exact);
+        _mm_storeu_si128((__m128i*)(bg + x), result);
+    }
+
+    // Remaining pixels
+    if (is_exact)
+        blend_row_modulated_exact_scalar(bg + x, fg + x, count - x, factors);
+    else
+        blend_row_modulated_scalar(bg + x, fg + x, count - x, factors);
+}
+
+void blend_row_modulated_sse4(Pixel* bg, const Pixel* fg, size_t count,
+                              Pixel16 factors)
+{
+    blend_row_modulated_with(bg, fg, count, factors, false);
+}
+
+void blend_row_modulated_exact_sse4(Pixel* bg, const Pixel* fg,
+                                    size_t count, Pixel16 factors)
+{
+    blend_row_modulated_with(bg, fg, count, factors, true);
+}
+
+/*
+ * Premultiplied channels are scaled by their factors, see
+ * `get_premultiplied_modulation_factors`. Lanes are widened and packed back
+ * in the same order, so factors match the layout of `Pixel16`.
+ */
+__always_inline
+static __m128i modulate_simd128(__m128i pixels, __m128i factors)
+{
+    const __m128i zero = _mm_setzero_si128();
+
+    __m128i low  = _mm_unpacklo_epi8(pixels, zero);
+    __m128i high = _mm_unpackhi_epi8(pixels, zero);
+
+    low  = _mm_srli_epi16(_mm_mullo_epi16(low,  factors), 8);
+    high = _mm_srli_epi16(_mm_mullo_epi16(high, factors), 8);
+
+    return _mm_packus_epi16(low, high);
+}
+
+__always_inline
+static void blend_row_premultiplied_modulated_with(Pixel* bg, const Pixel* fg,
+                                                   size_t count,
+                                                   Pixel16 factors,
+                                                   bool is_exact)
+{
+    const size_t pixels_per_vector = sizeof(__m128i) / sizeof(Pixel);
+
+    const __m128i factors_simd = _mm_set1_epi64x(
+                                (long long) pack_modulation_factors(factors));
+
+    size_t x = 0;
+    for (; x + pixels_per_vector <= count; x += pixels_per_vector)
+    {
+        __m128i bg_pixels = _mm_loadu_si128((const __m128i*)(bg + x));
+        __m128i fg_pixels = _mm_loadu_si128((const __m128i*)(fg + x));
+        fg_pixels = modulate_simd128(fg_pixels, factors_simd);
+
+        __m128i result = is_exact
+                ? combine_premultiplied_simd128_exact(bg_pixels, fg_pixels)
+                : combine_premultiplied_simd128(bg_pixels, fg_pixels);
+        _mm_storeu_si128((__m128i*)(bg + x), result);
+    }
+
+    // Remaining pixels
+    if (is_exact)
+        blend_row_premultiplied_modulated_exact_scalar(bg + x, fg + x,
+                                                       count - x, factors);
+    else
+        blend_row_premultiplied_modulated_scalar(bg + x, fg + x,
+                                                 count - x, factors);
+}
+
+void blend_row_premultiplied_modulated_sse4(Pixel* bg, const Pixel* fg,
+                                            size_t count, Pixel16 factors)
+{
+    blend_row_premultiplied_modulated_with(bg, fg, count, factors, false);
+}
+
+void blend_row_premultiplied_modulated_exact_sse4(Pixel* bg, const Pixel* fg,
+                                                  size_t count,
+                                                  Pixel16 factors)
+{
+    blend_row_premultiplied_modulated_with(bg, fg, count, factors, true);
+}
+
+void copy_opaque_row_sse4(Pixel* bg, const Pixel* fg, size_t count)
+{
+    const __m128i ALPHA_BITS = _mm_set1_epi32((int) 0xFF000000);
+
+    size_t x = 0;
+    for (; x + 4 <= count; x += 4)
+    {
+        __m128i bg_pixels = _mm_loadu_si128((const __m128i*)(bg + x));
+        __m128i fg_pixels = _mm_loadu_si128((const __m128i*)(fg + x));
+        __m128i result = _mm_blendv_epi8(fg_pixels, bg_pixels, ALPHA_BITS);
+        _mm_storeu_si128((__m128i*)(bg + x), result);
+    }
+
+    // Remaining pixels
+    copy_opaque_row_scalar(bg + x, fg + x, count - x);
+}
@@ -0,0 +1,313 @@
+#include <stdlib.h>
+
+#include "meerkat_assert/asserts.h"
+#include "commons/cpu_features.h"
+
+#include "downscale.h"
+#include "downscale_rows.h"
+
+/**
+ * Pyramid is built in passes. Every pass reads one level and produces this
+ * many smaller ones, so the second pass reads only 1/256 of source.
+ */
+#define PYRAMID_PASS_LEVELS 4
+
+// Indexed by SimdLevel
+static downscale_row_t* const DOWNSCALE_ROW_KERNELS[SIMD_LEVEL_COUNT] = {
+    downscale_row_scalar,
+    downscale_row_sse4,
+    downscale_row_avx2,
+    downscale_row_avx512
+};
+
+SizeVector2 get_downscaled_size(SizeVector2 size)
+{
+    return {
+        .x = (size.x + 1) / 2,
+        .y = (size.y + 1) / 2
+    };
+}
+
+/*
+ * Compute row `y` of `dst`. Odd last column and row of `src` are averaged
+ * with themselves.
+ */
+static void downscale_image_row(const PixelImage* dst, const PixelImage* src,
+                                size_t y, downscale_row_t* downscale_row)
+{
+    const Pixel* top    = src->pixel_array + 2 * y * src->size.x;
+    const Pixel* bottom = 2 * y + 1 < src->size.y ? top + src->size.x : top;
+
+    Pixel* dst_row = dst->pixel_array + y * dst->size.x;
+
+    const size_t pair_count = src->size.x / 2;
+    downscale_row(dst_row, top, bottom, pair_count);
+
+    if (pair_count < dst->size.x)
+    {
+        const Pixel* last_top    = top    + 2 * pair_count;
+        const Pixel* last_bottom = bottom + 2 * pair_count;
+
+        const Pixel column_top[2]    = {*last_top,    *last_top};
+        const Pixel column_bottom[2] = {*last_bottom, *last_bottom};
+
+        dst_row[pair_count] = get_downscaled_pixel(column_top,
+                                                   column_bottom);
+    }
+}
+
+struct DownscaleTask
+{
+    const PixelImage* dst;
+    const PixelImage* src;
+    downscale_row_t*  downscale_row;
+};
+
+// Items are destination rows
+static void downscale_rows(void* task_ptr, size_t begin, size_t end)
+{
+    const DownscaleTask* task = (const DownscaleTask*) task_ptr;
+
+    for (size_t y = begin; y < end; ++y)
+        downscale_image_row(task->dst, task->src, y, task->downscale_row);
+}
+
+int downscale_half(PixelImage* dst, const PixelImage* src, ThreadPool* pool)
+{
+    SAFE_BLOCK_START
+    {
+        ASSERT_TRUE(dst != NULL);
+        ASSERT_TRUE(dst->pixel_array != NULL);
+
+        ASSERT_TRUE(src != NULL);
+        ASSERT_TRUE(src->pixel_array != NULL);
+
+        const SizeVector2 dst_size = get_downscaled_size(src->size);
+        ASSERT_EQUAL(dst->size.x, dst_size.x);
+        ASSERT_EQUAL(dst->size.y, dst_size.y);
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    DownscaleTask task = {
+        .dst           = dst,
+        .src           = src,
+        .downscale_row = DOWNSCALE_ROW_KERNELS[get_simd_level()]
+    };
+
+    if (pool)
+        thread_pool_run(pool, downscale_rows, &task, dst->size.y);
+    else
+        downscale_rows(&task, 0, dst->size.y);
+
+    return 0;
+}
+
+__always_inline
+static size_t align_size(size_t size)
+{
+    return (size + PIXEL_ALIGNMENT - 1) / PIXEL_ALIGNMENT * PIXEL_ALIGNMENT;
+}
+
+int image_pyramid_init(ImagePyramid* pyramid, SizeVector2 size,
+                       size_t level_count)
+{
+    SAFE_BLOCK_START    // Validate parameters
+    {
+        ASSERT_TRUE_MESSAGE(pyramid != NULL, "pyramid");
+        ASSERT_POSITIVE_MESSAGE(size.x, "size.x");
+        ASSERT_POSITIVE_MESSAGE(size.y, "size.y");
+        ASSERT_TRUE_MESSAGE(level_count <= PYRAMID_MAX_LEVELS,
+                            "level_count");
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    const size_t pixel_count = size.x * size.y;
+
+    SAFE_BLOCK_START
+    {
+        ASSERT_TRUE_MESSAGE_CALLBACK(
+                pixel_count / size.x == size.y &&
+                pixel_count * sizeof(Pixel) / sizeof(Pixel) == pixel_count,
+                "Integer multiplication overflow",
+                errno = EOVERFLOW);
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    if (level_count == 0)
+    {
+        for (SizeVector2 level_size = size;
+             (level_size.x > 1 || level_size.y > 1) &&
+             level_count < PYRAMID_MAX_LEVELS;
+             level_size = get_downscaled_size(level_size))
+            ++level_count;
+
+        // Single pixel is its own pyramid
+        if (level_count == 0)
+            level_count = 1;
+    }
+
+    *pyramid = {};
+    pyramid->level_count = level_count;
+
+    // Levels are placed one after another, each one is aligned
+    size_t total_size = 0;
+    SizeVector2 level_size = size;
+    for (size_t i = 0; i < level_count; ++i)
+    {
+        level_size = get_downscaled_size(level_size);
+
+        pyramid->levels[i].size = level_size;
+        total_size += align_size(level_size.x * level_size.y
+                                 * sizeof(Pixel));
+    }
+
+    uint8_t* memory = NULL;
+    if (posix_memalign((void**) &memory, PIXEL_ALIGNMENT, total_size) != 0)
+    {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    for (size_t i = 0; i < level_count; ++i)
+    {
+        PixelImage* level = &pyramid->levels[i];
+
+        level->pixel_array = (Pixel*) (void*) memory;
+        memory += align_size(level->size.x * level->size.y * sizeof(Pixel));
+    }
+
+    return 0;
+}
+
+void image_pyramid_dispose(ImagePyramid* pyramid)
+{
+    free(pyramid->levels[0].pixel_array);
+    *pyramid = {};
+}
+
+/**
+ * Pass reads one level and produces several smaller ones. Rows of its first
+ * level are processed in bands, which are aligned, so that every band
+ * produces whole rows of all levels.
+ */
+struct PyramidTask
+{
+    const PixelImage* source;
+    const PixelImage* levels;
+    size_t            level_count;
+
+    size_t            band_height;  // Rows of the first level
+    downscale_row_t*  downscale_row;
+};
+
+// Items are bands of rows of the first level
+static void build_pyramid_bands(void* task_ptr, size_t begin, size_t end)
+{
+    const PyramidTask* task = (const PyramidTask*) task_ptr;
+    const PixelImage* levels = task->levels;
+
+    for (size_t band = begin; band < end; ++band)
+    {
+        const size_t row_begin = band * task->band_height;
+        const size_t row_end   = row_begin + task->band_height
+                                    < levels[0].size.y
+                               ? row_begin + task->band_height
+                               : levels[0].size.y;
+
+        for (size_t y = row_begin; y < row_end; ++y)
+        {
+            downscale_image_row(&levels[0], task->source, y,
+                                task->downscale_row);
+
+            // Row of the next level is computed, as soon as both rows it
+            // averages are ready and still in cache
+            size_t level = 0;
+            size_t row   = y;
+            while (level + 1 < task->level_count &&
+                   (row % 2 == 1 || row + 1 == levels[level].size.y))
+            {
+                row /= 2;
+                ++level;
+
+                downscale_image_row(&levels[level], &levels[level - 1], row,
+                                    task->downscale_row);
+            }
+        }
+    }
+}
+
+int build_image_pyramid(ImagePyramid* pyramid, const PixelImage* source,
+                        ThreadPool* pool)
+{
+    SAFE_BLOCK_START
+    {
+        ASSERT_TRUE(pyramid != NULL);
+        ASSERT_TRUE(pyramid->level_count > 0);
+        ASSERT_TRUE(pyramid->level_count <= PYRAMID_MAX_LEVELS);
+        ASSERT_TRUE(pyramid->levels[0].pixel_array != NULL);
+
+        ASSERT_TRUE(source != NULL);
+        ASSERT_TRUE(source->pixel_array != NULL);
+
+        const SizeVector2 level_size = get_downscaled_size(source->size);
+        ASSERT_EQUAL(pyramid->levels[0].size.x, level_size.x);
+        ASSERT_EQUAL(pyramid->levels[0].size.y, level_size.y);
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    downscale_row_t* const downscale_row =
+                            DOWNSCALE_ROW_KERNELS[get_simd_level()];
+
+    const PixelImage* pass_source = source;
+    for (size_t first = 0; first < pyramid->level_count;
+         first += PYRAMID_PASS_LEVELS)
+    {
+        const size_t remaining   = pyramid->level_count - first;
+        const size_t level_count = remaining < PYRAMID_PASS_LEVELS
+                                 ? remaining : PYRAMID_PASS_LEVELS;
+
+        PyramidTask task = {
+            .source        = pass_source,
+            .levels        = pyramid->levels + first,
+            .level_count   = level_count,
+            .band_height   = (size_t) 1 << (level_count - 1),
+            .downscale_row = downscale_row
+        };
+
+        const size_t band_count = (task.levels[0].size.y
+                                   + task.band_height - 1)
+                                / task.band_height;
+
+        if (pool)
+            thread_pool_run(pool, build_pyramid_bands, &task, band_count);
+        else
+            build_pyramid_bands(&task, 0, band_count);
+
+        pass_source = &pyramid->levels[first + level_count - 1];
+    }
+
+    return 0;
+}
@@ -0,0 +1,96 @@
+/**
+ * @file downscale.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Downscaling by two with 2x2 box filter and image pyramids for
+ * thumbnails and previews
+ *
+ * @version 0.1
+ * @date 2023-05-13
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __DOWNSCALE_H
+#define __DOWNSCALE_H
+
+#include "commons/definitions.h"
+#include "commons/thread_pool.h"
+
+/**
+ * @brief Pyramid of 32768x32768 image is reduced to a single pixel
+ */
+#define PYRAMID_MAX_LEVELS 15
+
+/**
+ * @brief Successively halved copies of source image. Source itself is not
+ * stored.
+ */
+struct ImagePyramid
+{
+    size_t     level_count;
+    PixelImage levels[PYRAMID_MAX_LEVELS];  // Level `i` is `2^(i+1)` times
+                                            // smaller than source
+};
+
+/**
+ * @brief Size of image, downscaled by two. Odd sizes are rounded up, last
+ * column or row being averaged with itself.
+ *
+ * @param[in] size	- Source image size
+ *
+ * @return Downscaled image size
+ */
+SizeVector2 get_downscaled_size(SizeVector2 size);
+
+/**
+ * @brief Downscale image by two: every destination pixel is average of
+ * 2x2 source pixels, correctly rounded. Channels are averaged
+ * independently, which is exact for opaque and premultiplied images.
+ *
+ * @param[out]   dst	- Destination image, `get_downscaled_size` of source
+ * @param[in]    src	- Source image
+ * @param[inout] pool	- Worker threads. If NULL, only the calling
+ *                        thread is used
+ *
+ * @return 0 upon success, -1 upon invalid arguments
+ */
+int downscale_half(PixelImage* dst, const PixelImage* src, ThreadPool* pool);
+
+/**
+ * @brief Allocate pyramid levels for source of given size in one buffer.
+ * Pixel values are unspecified.
+ *
+ * @param[out] pyramid	    - Pyramid to be initialized
+ * @param[in]  size	        - Source image size
+ * @param[in]  level_count	- Number of levels, zero means all levels down
+ *                            to a single pixel
+ *
+ * @return 0 upon success, -1 upon error
+ */
+int image_pyramid_init(ImagePyramid* pyramid, SizeVector2 size,
+                       size_t level_count);
+
+/**
+ * @brief Free pixels, allocated in `image_pyramid_init`
+ *
+ * @param[inout] pyramid	- Previously initialized pyramid
+ */
+void image_pyramid_dispose(ImagePyramid* pyramid);
+
+/**
+ * @brief Compute all pyramid levels in one pass over source. Source is
+ * processed in bands of rows, and rows of smaller levels are computed as
+ * soon as rows they depend on are ready, while those are still in cache.
+ * Results match repeated `downscale_half` exactly.
+ *
+ * @param[inout] pyramid	- Pyramid, initialized for source size
+ * @param[in]    source	    - Source image
+ * @param[inout] pool	    - Worker threads. If NULL, only the calling
+ *                            thread is used
+ *
+ * @return 0 upon success, -1 upon invalid arguments
+ */
+int build_image_pyramid(ImagePyramid* pyramid, const PixelImage* source,
+                        ThreadPool* pool);
+
+#endif /* downscale.h */
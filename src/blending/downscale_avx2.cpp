@@ -0,0 +1,62 @@
+#include "commons/intrinsics.h"
+
+#include "downscale_rows.h"
+
+/*
+ * Red and blue, green and alpha are summed in 16-bit fields, which hold
+ * sums of four bytes. Sums of pixel pairs end up in even elements.
+ */
+__always_inline
+static __m256i downscale_pairs_simd256(__m256i top, __m256i bottom)
+{
+    const __m256i LOW_BYTES = _mm256_set1_epi32(0x00FF00FF);
+    const __m256i BIAS      = _mm256_set1_epi32(0x00020002);
+
+    __m256i even = _mm256_add_epi32(_mm256_and_si256(top,    LOW_BYTES),
+                                    _mm256_and_si256(bottom, LOW_BYTES));
+    __m256i odd  = _mm256_add_epi32(
+                    _mm256_and_si256(_mm256_srli_epi32(top,    8), LOW_BYTES),
+                    _mm256_and_si256(_mm256_srli_epi32(bottom, 8), LOW_BYTES));
+
+    even = _mm256_add_epi32(even, _mm256_srli_epi64(even, 32));
+    odd  = _mm256_add_epi32(odd,  _mm256_srli_epi64(odd,  32));
+
+    even = _mm256_srli_epi16(_mm256_add_epi16(even, BIAS), 2);
+    odd  = _mm256_srli_epi16(_mm256_add_epi16(odd,  BIAS), 2);
+
+    const __m256i pixels = _mm256_or_si256(even, _mm256_slli_epi32(odd, 8));
+
+    // Even elements are moved to the lower half of every lane
+    return _mm256_shuffle_epi32(pixels, _MM_SHUFFLE(3, 1, 2, 0));
+}
+
+void downscale_row_avx2(Pixel* dst, const Pixel* top, const Pixel* bottom,
+                        size_t count)
+{
+    const size_t pixels_per_vector = sizeof(__m256i) / sizeof(Pixel);
+
+    size_t x = 0;
+    for (; x + pixels_per_vector <= count; x += pixels_per_vector)
+    {
+        const __m256i* top_pixels    = (const __m256i*) (top    + 2*x);
+        const __m256i* bottom_pixels = (const __m256i*) (bottom + 2*x);
+
+        const __m256i low  = downscale_pairs_simd256(
+                                _mm256_loadu_si256(top_pixels    + 0),
+                                _mm256_loadu_si256(bottom_pixels + 0));
+        const __m256i high = downscale_pairs_simd256(
+                                _mm256_loadu_si256(top_pixels    + 1),
+                                _mm256_loadu_si256(bottom_pixels + 1));
+
+        // Quadwords are low0, high0, low1, high1, restore pixel order
+        const __m256i pixels = _mm256_permute4x64_epi64(
+                                    _mm256_unpacklo_epi64(low, high),
+                                    _MM_SHUFFLE(3, 1, 2, 0));
+
+        _mm256_storeu_si256((__m256i*) (dst + x), pixels);
+    }
+
+    // Remaining pixels
+    for (; x < count; ++x)
+        dst[x] = get_downscaled_pixel(top + 2*x, bottom + 2*x);
+}
@@ -0,0 +1,59 @@
+#include "commons/intrinsics.h"
+
+#include "downscale_rows.h"
+
+/*
+ * Red and blue, green and alpha are summed in 16-bit fields, which hold
+ * sums of four bytes. Sums of pixel pairs end up in even elements, which
+ * are then narrowed from quadwords.
+ */
+__always_inline
+static __m512i downscale_pairs_simd(__m512i top, __m512i bottom)
+{
+    const __m512i LOW_BYTES = _mm512_set1_epi32(0x00FF00FF);
+    const __m512i BIAS      = _mm512_set1_epi32(0x00020002);
+
+    __m512i even = _mm512_add_epi32(_mm512_and_si512(top,    LOW_BYTES),
+                                    _mm512_and_si512(bottom, LOW_BYTES));
+    __m512i odd  = _mm512_add_epi32(
+                    _mm512_and_si512(_mm512_srli_epi32(top,    8), LOW_BYTES),
+                    _mm512_and_si512(_mm512_srli_epi32(bottom, 8), LOW_BYTES));
+
+    even = _mm512_add_epi32(even, _mm512_srli_epi64(even, 32));
+    odd  = _mm512_add_epi32(odd,  _mm512_srli_epi64(odd,  32));
+
+    even = _mm512_srli_epi16(_mm512_add_epi16(even, BIAS), 2);
+    odd  = _mm512_srli_epi16(_mm512_add_epi16(odd,  BIAS), 2);
+
+    return _mm512_or_si512(even, _mm512_slli_epi32(odd, 8));
+}
+
+void downscale_row_avx512(Pixel* dst, const Pixel* top, const Pixel* bottom,
+                          size_t count)
+{
+    const size_t pixels_per_vector = sizeof(__m512i) / sizeof(Pixel) / 2;
+
+    size_t x = 0;
+    for (; x + pixels_per_vector <= count; x += pixels_per_vector)
+    {
+        const __m512i pairs = downscale_pairs_simd(
+                                _mm512_loadu_si512(top    + 2*x),
+                                _mm512_loadu_si512(bottom + 2*x));
+
+        _mm256_storeu_si256((__m256i*) (dst + x),
+                            _mm512_cvtepi64_epi32(pairs));
+    }
+
+    // Remaining pixels, source pixels past the end of row are not loaded
+    if (x < count)
+    {
+        const __mmask8  dst_mask = (__mmask8) ((1u << (count - x)) - 1);
+        const __mmask16 src_mask = (__mmask16) ((1u << 2*(count - x)) - 1);
+
+        const __m512i pairs = downscale_pairs_simd(
+                            _mm512_maskz_loadu_epi32(src_mask, top    + 2*x),
+                            _mm512_maskz_loadu_epi32(src_mask, bottom + 2*x));
+
+        _mm512_mask_cvtepi64_storeu_epi32(dst + x, dst_mask, pairs);
+    }
+}
@@ -0,0 +1,59 @@
+/**
+ * @file downscale_rows.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Row kernels of 2x2 box filter, built for several instruction
+ * set levels
+ *
+ * @version 0.1
+ * @date 2023-05-13
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __DOWNSCALE_ROWS_H
+#define __DOWNSCALE_ROWS_H
+
+#include <stdint.h>
+
+#include "commons/definitions.h"
+
+/**
+ * @brief Average pairs of adjacent pixels of two source rows
+ *
+ * @param[out] dst	    - Destination row
+ * @param[in]  top	    - Upper source row, `2*count` pixels
+ * @param[in]  bottom	- Lower source row, `2*count` pixels
+ * @param[in]  count	- Number of pixels in destination row
+ */
+typedef void downscale_row_t(Pixel* dst, const Pixel* top,
+                             const Pixel* bottom, size_t count);
+
+downscale_row_t downscale_row_scalar;
+downscale_row_t downscale_row_sse4;
+downscale_row_t downscale_row_avx2;
+downscale_row_t downscale_row_avx512;
+
+/**
+ * @brief Compute pixel exactly as vector kernels do
+ *
+ * @param[in] top	- Two upper source pixels
+ * @param[in] bottom	- Two lower source pixels
+ *
+ * @return Rounded average of four pixels
+ */
+static inline Pixel get_downscaled_pixel(const Pixel* top,
+                                         const Pixel* bottom)
+{
+    return {
+        .red   = (uint8_t) ((top[0].red   + top[1].red
+                           + bottom[0].red   + bottom[1].red   + 2) >> 2),
+        .green = (uint8_t) ((top[0].green + top[1].green
+                           + bottom[0].green + bottom[1].green + 2) >> 2),
+        .blue  = (uint8_t) ((top[0].blue  + top[1].blue
+                           + bottom[0].blue  + bottom[1].blue  + 2) >> 2),
+        .alpha = (uint8_t) ((top[0].alpha + top[1].alpha
+                           + bottom[0].alpha + bottom[1].alpha + 2) >> 2)
+    };
+}
+
+#endif /* downscale_rows.h */
@@ -0,0 +1,8 @@
+#include "downscale_rows.h"
+
+void downscale_row_scalar(Pixel* dst, const Pixel* top, const Pixel* bottom,
+                          size_t count)
+{
+    for (size_t x = 0; x < count; ++x)
+        dst[x] = get_downscaled_pixel(top + 2*x, bottom + 2*x);
+}
@@ -0,0 +1,58 @@
+#include "commons/intrinsics.h"
+
+#include "downscale_rows.h"
+
+/*
+ * Red and blue, green and alpha are summed in 16-bit fields, which hold
+ * sums of four bytes. Sums of pixel pairs end up in even elements.
+ */
+__always_inline
+static __m128i downscale_pairs_simd128(__m128i top, __m128i bottom)
+{
+    const __m128i LOW_BYTES = _mm_set1_epi32(0x00FF00FF);
+    const __m128i BIAS      = _mm_set1_epi32(0x00020002);
+
+    __m128i even = _mm_add_epi32(_mm_and_si128(top,    LOW_BYTES),
+                                 _mm_and_si128(bottom, LOW_BYTES));
+    __m128i odd  = _mm_add_epi32(
+                        _mm_and_si128(_mm_srli_epi32(top,    8), LOW_BYTES),
+                        _mm_and_si128(_mm_srli_epi32(bottom, 8), LOW_BYTES));
+
+    even = _mm_add_epi32(even, _mm_srli_epi64(even, 32));
+    odd  = _mm_add_epi32(odd,  _mm_srli_epi64(odd,  32));
+
+    even = _mm_srli_epi16(_mm_add_epi16(even, BIAS), 2);
+    odd  = _mm_srli_epi16(_mm_add_epi16(odd,  BIAS), 2);
+
+    const __m128i pixels = _mm_or_si128(even, _mm_slli_epi32(odd, 8));
+
+    // Even elements are moved to the lower half
+    return _mm_shuffle_epi32(pixels, _MM_SHUFFLE(3, 1, 2, 0));
+}
+
+void downscale_row_sse4(Pixel* dst, const Pixel* top, const Pixel* bottom,
+                        size_t count)
+{
+    const size_t pixels_per_vector = sizeof(__m128i) / sizeof(Pixel);
+
+    size_t x = 0;
+    for (; x + pixels_per_vector <= count; x += pixels_per_vector)
+    {
+        const __m128i* top_pixels    = (const __m128i*) (top    + 2*x);
+        const __m128i* bottom_pixels = (const __m128i*) (bottom + 2*x);
+
+        const __m128i low  = downscale_pairs_simd128(
+                                _mm_loadu_si128(top_pixels    + 0),
+                                _mm_loadu_si128(bottom_pixels + 0));
+        const __m128i high = downscale_pairs_simd128(
+                                _mm_loadu_si128(top_pixels    + 1),
+                                _mm_loadu_si128(bottom_pixels + 1));
+
+        _mm_storeu_si128((__m128i*) (dst + x),
+                         _mm_unpacklo_epi64(low, high));
+    }
+
+    // Remaining pixels
+    for (; x < count; ++x)
+        dst[x] = get_downscaled_pixel(top + 2*x, bottom + 2*x);
+}
@@ -0,0 +1,241 @@
+#include <stdlib.h>
+
+#include "meerkat_assert/asserts.h"
+#include "commons/cpu_features.h"
+
+#include "planar.h"
+#include "planar_rows.h"
+
+// Indexed by SimdLevel
+static split_row_t* const SPLIT_ROW_KERNELS[SIMD_LEVEL_COUNT] = {
+    split_row_scalar,
+    split_row_sse4,
+    split_row_avx2,
+    split_row_avx512
+};
+
+// Indexed by SimdLevel
+static merge_row_t* const MERGE_ROW_KERNELS[SIMD_LEVEL_COUNT] = {
+    merge_row_scalar,
+    merge_row_sse4,
+    merge_row_avx2,
+    merge_row_avx512
+};
+
+// Indexed by BlendMode and SimdLevel
+static blend_planar_row_t* const
+BLEND_PLANAR_ROW_KERNELS[BLEND_MODE_COUNT][SIMD_LEVEL_COUNT] = {
+    {
+        blend_planar_row_scalar,
+        blend_planar_row_sse4,
+        blend_planar_row_avx2,
+        blend_planar_row_avx512
+    },
+    {
+        blend_planar_row_exact_scalar,
+        blend_planar_row_exact_sse4,
+        blend_planar_row_exact_avx2,
+        blend_planar_row_exact_avx512
+    }
+};
+
+int planar_image_init(PlanarImage* image, SizeVector2 size)
+{
+    SAFE_BLOCK_START    // Validate parameters
+    {
+        ASSERT_TRUE_MESSAGE(image != NULL, "image");
+        ASSERT_POSITIVE_MESSAGE(size.x, "size.x");
+        ASSERT_POSITIVE_MESSAGE(size.y, "size.y");
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    // Every plane row starts at aligned address, so that full vectors
+    // of different planes can be processed together
+    const size_t stride = (size.x + PIXEL_ALIGNMENT - 1)
+                        / PIXEL_ALIGNMENT * PIXEL_ALIGNMENT;
+    const size_t plane_size = stride * size.y;
+
+    SAFE_BLOCK_START
+    {
+        ASSERT_TRUE_MESSAGE_CALLBACK(
+                plane_size / stride == size.y &&
+                plane_size * PLANE_COUNT / PLANE_COUNT == plane_size,
+                "Integer multiplication overflow",
+                errno = EOVERFLOW);
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    uint8_t* planes = NULL;
+    if (posix_memalign((void**) &planes, PIXEL_ALIGNMENT,
+                       plane_size * PLANE_COUNT) != 0)
+    {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    image->size   = size;
+    image->stride = stride;
+    for (size_t i = 0; i < PLANE_COUNT; ++i)
+        image->planes[i] = planes + i * plane_size;
+
+    return 0;
+}
+
+void planar_image_dispose(PlanarImage* image)
+{
+    // All planes share allocation of the first one
+    free(image->planes[PLANE_RED]);
+
+    for (size_t i = 0; i < PLANE_COUNT; ++i)
+        image->planes[i] = NULL;
+}
+
+__always_inline
+static PlanarRow get_planar_row(const PlanarImage* image, size_t x, size_t y)
+{
+    PlanarRow row = {};
+    for (size_t i = 0; i < PLANE_COUNT; ++i)
+        row.planes[i] = image->planes[i] + y * image->stride + x;
+
+    return row;
+}
+
+struct ConvertRowsTask
+{
+    Pixel*             pixels;
+    const PlanarImage* planar;
+
+    split_row_t*       split_row;   // Exactly one of kernels is set
+    merge_row_t*       merge_row;
+};
+
+static void convert_rows(void* task_ptr, size_t begin, size_t end)
+{
+    const ConvertRowsTask* task = (const ConvertRowsTask*) task_ptr;
+    const size_t size_x = task->planar->size.x;
+
+    for (size_t y = begin; y < end; ++y)
+    {
+        const PlanarRow planar_row = get_planar_row(task->planar, 0, y);
+        Pixel* pixel_row = task->pixels + y * size_x;
+
+        if (task->split_row)
+            task->split_row(&planar_row, pixel_row, size_x);
+        else
+            task->merge_row(pixel_row, &planar_row, size_x);
+    }
+}
+
+static int convert_image(const PixelImage* image, const PlanarImage* planar,
+                         ThreadPool* pool,
+                         split_row_t* split_row, merge_row_t* merge_row)
+{
+    SAFE_BLOCK_START
+    {
+        ASSERT_EQUAL(image->size.x, planar->size.x);
+        ASSERT_EQUAL(image->size.y, planar->size.y);
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    ConvertRowsTask task = {
+        .pixels    = image->pixel_array,
+        .planar    = planar,
+        .split_row = split_row,
+        .merge_row = merge_row
+    };
+
+    if (pool)
+        thread_pool_run(pool, convert_rows, &task, planar->size.y);
+    else
+        convert_rows(&task, 0, planar->size.y);
+
+    return 0;
+}
+
+int split_planes(PlanarImage* planar, const PixelImage* image,
+                 ThreadPool* pool)
+{
+    return convert_image(image, planar, pool,
+                         SPLIT_ROW_KERNELS[get_simd_level()], NULL);
+}
+
+int merge_planes(PixelImage* image, const PlanarImage* planar,
+                 ThreadPool* pool)
+{
+    return convert_image(image, planar, pool,
+                         NULL, MERGE_ROW_KERNELS[get_simd_level()]);
+}
+
+struct BlendPlanarTask
+{
+    const PlanarImage*  background;
+    const PlanarImage*  foreground;
+    SizeVector2         pos;
+
+    blend_planar_row_t* blend_row;
+};
+
+static void blend_planar_rows(void* task_ptr, size_t begin, size_t end)
+{
+    const BlendPlanarTask* task = (const BlendPlanarTask*) task_ptr;
+
+    for (size_t y = begin; y < end; ++y)
+    {
+        const PlanarRow bg_row = get_planar_row(task->background,
+                                                task->pos.x,
+                                                task->pos.y + y);
+        const PlanarRow fg_row = get_planar_row(task->foreground, 0, y);
+
+        task->blend_row(&bg_row, &fg_row, task->foreground->size.x);
+    }
+}
+
+int blend_planar(PlanarImage* background, const PlanarImage* foreground,
+                 SizeVector2 pos, BlendMode mode, ThreadPool* pool)
+{
+    SAFE_BLOCK_START
+    {
+        ASSERT_LESS_EQUAL(
+                pos.x + foreground->size.x, background->size.x);
+        ASSERT_LESS_EQUAL(
+                pos.y + foreground->size.y, background->size.y);
+        ASSERT_LESS(
+                mode, BLEND_MODE_COUNT);
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    BlendPlanarTask task = {
+        .background = background,
+        .foreground = foreground,
+        .pos        = pos,
+        .blend_row  = BLEND_PLANAR_ROW_KERNELS[mode][get_simd_level()]
+    };
+
+    if (pool)
+        thread_pool_run(pool, blend_planar_rows, &task, foreground->size.y);
+    else
+        blend_planar_rows(&task, 0, foreground->size.y);
+
+    return 0;
+}
@@ -0,0 +1,103 @@
+/**
+ * @file planar.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Planar image layout: every channel is stored in its own plane
+ * of bytes, so that blending needs no shuffles
+ *
+ * @version 0.1
+ * @date 2023-05-06
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __PLANAR_H
+#define __PLANAR_H
+
+#include <stdint.h>
+
+#include "commons/definitions.h"
+#include "commons/thread_pool.h"
+
+enum PlaneIndex
+{
+    PLANE_RED,
+    PLANE_GREEN,
+    PLANE_BLUE,
+    PLANE_ALPHA,
+
+    PLANE_COUNT
+};
+
+/**
+ * @brief All planes share a single allocation. Every plane row starts
+ * at `PIXEL_ALIGNMENT`-aligned address.
+ */
+struct PlanarImage
+{
+    SizeVector2 size;
+    size_t      stride;                 // Bytes between plane rows
+
+    uint8_t*    planes[PLANE_COUNT];    // Indexed by PlaneIndex
+};
+
+/**
+ * @brief Allocate planes of given size. Pixel values are unspecified.
+ *
+ * @param[out] image	- Image to be initialized
+ * @param[in]  size	    - Image size in pixels
+ *
+ * @return 0 upon success, -1 upon error
+ */
+int planar_image_init(PlanarImage* image, SizeVector2 size);
+
+/**
+ * @brief Free planes, allocated in `planar_image_init`
+ *
+ * @param[inout] image	- Previously initialized image
+ */
+void planar_image_dispose(PlanarImage* image);
+
+/**
+ * @brief Convert interleaved RGBA image into planes of the same size
+ *
+ * @param[out]   planar	- Destination planar image
+ * @param[in]    image	- Source image
+ * @param[inout] pool	- Worker threads. If NULL, only the calling
+ *                        thread is used
+ *
+ * @return 0 upon success, -1 upon invalid arguments
+ */
+int split_planes(PlanarImage* planar, const PixelImage* image,
+                 ThreadPool* pool);
+
+/**
+ * @brief Convert planes back into interleaved RGBA image of the same size
+ *
+ * @param[out]   image	- Destination image
+ * @param[in]    planar	- Source planar image
+ * @param[inout] pool	- Worker threads. If NULL, only the calling
+ *                        thread is used
+ *
+ * @return 0 upon success, -1 upon invalid arguments
+ */
+int merge_planes(PixelImage* image, const PlanarImage* planar,
+                 ThreadPool* pool);
+
+/**
+ * @brief Blend planar foreground on top of planar background and store
+ * result in background. Results match `blend_pixels_optimized` with the
+ * same division exactly. Background alpha is left unchanged.
+ *
+ * @param[inout] background	- Image background
+ * @param[in]    foreground	- Image foreground, not premultiplied
+ * @param[in]    pos	    - Foreground position inside background
+ * @param[in]    mode	    - Division used by kernel
+ * @param[inout] pool	    - Worker threads. If NULL, only the calling
+ *                            thread is used
+ *
+ * @return 0 upon success, -1 upon invalid arguments
+ */
+int blend_planar(PlanarImage* background, const PlanarImage* foreground,
+                 SizeVector2 pos, BlendMode mode, ThreadPool* pool);
+
+#endif /* planar.h */
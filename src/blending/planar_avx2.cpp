@@ -0,0 +1,217 @@
+#include "commons/intrinsics.h"
+
+#include "planar_rows.h"
+#include "shuffle_masks.h"
+
+/*
+ * Every 128-bit lane of four pixels becomes four dwords of red, green,
+ * blue and alpha bytes. Then dwords of the same channel are gathered, so
+ * that every qword holds 8 bytes of a single channel.
+ */
+__always_inline
+static __m256i group_channels(__m256i pixels)
+{
+    const __m256i MASK_TRANSPOSE = _mm256_set_epi8(
+        MASK_TRANSPOSE_CHANNELS_ROW,
+        MASK_TRANSPOSE_CHANNELS_ROW
+    );
+
+    const __m256i GATHER_DWORDS = _mm256_set_epi32(7, 3, 6, 2, 5, 1, 4, 0);
+
+    pixels = _mm256_shuffle_epi8(pixels, MASK_TRANSPOSE);
+    return _mm256_permutevar8x32_epi32(pixels, GATHER_DWORDS);
+}
+
+/*
+ * Inverse of `group_channels`
+ */
+__always_inline
+static __m256i interleave_channels(__m256i channels)
+{
+    const __m256i MASK_TRANSPOSE = _mm256_set_epi8(
+        MASK_TRANSPOSE_CHANNELS_ROW,
+        MASK_TRANSPOSE_CHANNELS_ROW
+    );
+
+    const __m256i SCATTER_DWORDS = _mm256_set_epi32(7, 5, 3, 1, 6, 4, 2, 0);
+
+    channels = _mm256_permutevar8x32_epi32(channels, SCATTER_DWORDS);
+    return _mm256_shuffle_epi8(channels, MASK_TRANSPOSE);
+}
+
+void split_row_avx2(const PlanarRow* dst, const Pixel* src, size_t count)
+{
+    const size_t bytes_per_vector = sizeof(__m256i);
+
+    size_t x = 0;
+    for (; x + bytes_per_vector <= count; x += bytes_per_vector)
+    {
+        const __m256i* pixels = (const __m256i*) (src + x);
+
+        // Qwords of every vector hold red, green, blue and alpha
+        const __m256i v0 = group_channels(_mm256_loadu_si256(pixels + 0));
+        const __m256i v1 = group_channels(_mm256_loadu_si256(pixels + 1));
+        const __m256i v2 = group_channels(_mm256_loadu_si256(pixels + 2));
+        const __m256i v3 = group_channels(_mm256_loadu_si256(pixels + 3));
+
+        // Red and blue of two vectors, then green and alpha
+        const __m256i rb01 = _mm256_unpacklo_epi64(v0, v1);
+        const __m256i ga01 = _mm256_unpackhi_epi64(v0, v1);
+        const __m256i rb23 = _mm256_unpacklo_epi64(v2, v3);
+        const __m256i ga23 = _mm256_unpackhi_epi64(v2, v3);
+
+        _mm256_storeu_si256((__m256i*) (dst->planes[PLANE_RED] + x),
+                            _mm256_permute2x128_si256(rb01, rb23, 0x20));
+        _mm256_storeu_si256((__m256i*) (dst->planes[PLANE_GREEN] + x),
+                            _mm256_permute2x128_si256(ga01, ga23, 0x20));
+        _mm256_storeu_si256((__m256i*) (dst->planes[PLANE_BLUE] + x),
+                            _mm256_permute2x128_si256(rb01, rb23, 0x31));
+        _mm256_storeu_si256((__m256i*) (dst->planes[PLANE_ALPHA] + x),
+                            _mm256_permute2x128_si256(ga01, ga23, 0x31));
+    }
+
+    // Remaining pixels
+    const PlanarRow rest = offset_planar_row(dst, x);
+    split_row_scalar(&rest, src + x, count - x);
+}
+
+void merge_row_avx2(Pixel* dst, const PlanarRow* src, size_t count)
+{
+    const size_t bytes_per_vector = sizeof(__m256i);
+
+    size_t x = 0;
+    for (; x + bytes_per_vector <= count; x += bytes_per_vector)
+    {
+        const __m256i red   = _mm256_loadu_si256(
+                        (const __m256i*) (src->planes[PLANE_RED]   + x));
+        const __m256i green = _mm256_loadu_si256(
+                        (const __m256i*) (src->planes[PLANE_GREEN] + x));
+        const __m256i blue  = _mm256_loadu_si256(
+                        (const __m256i*) (src->planes[PLANE_BLUE]  + x));
+        const __m256i alpha = _mm256_loadu_si256(
+                        (const __m256i*) (src->planes[PLANE_ALPHA] + x));
+
+        const __m256i rb01 = _mm256_permute2x128_si256(red,   blue,  0x20);
+        const __m256i rb23 = _mm256_permute2x128_si256(red,   blue,  0x31);
+        const __m256i ga01 = _mm256_permute2x128_si256(green, alpha, 0x20);
+        const __m256i ga23 = _mm256_permute2x128_si256(green, alpha, 0x31);
+
+        __m256i* pixels = (__m256i*) (dst + x);
+
+        _mm256_storeu_si256(pixels + 0, interleave_channels(
+                                    _mm256_unpacklo_epi64(rb01, ga01)));
+        _mm256_storeu_si256(pixels + 1, interleave_channels(
+                                    _mm256_unpackhi_epi64(rb01, ga01)));
+        _mm256_storeu_si256(pixels + 2, interleave_channels(
+                                    _mm256_unpacklo_epi64(rb23, ga23)));
+        _mm256_storeu_si256(pixels + 3, interleave_channels(
+                                    _mm256_unpackhi_epi64(rb23, ga23)));
+    }
+
+    // Remaining pixels
+    const PlanarRow rest = offset_planar_row(src, x);
+    merge_row_scalar(dst + x, &rest, count - x);
+}
+
+/*
+ * Both divisions get `bg*(255 - a) + fg*a`, shifted down by 255*128
+ */
+typedef __m256i divide_simd_t(__m256i biased_sum);
+
+static __m256i divide_fast(__m256i biased_sum)
+{
+    const __m256i SUM_BIAS = _mm256_set1_epi16(255*128);
+
+    return _mm256_srli_epi16(_mm256_add_epi16(biased_sum, SUM_BIAS), 8);
+}
+
+static __m256i divide_exact(__m256i biased_sum)
+{
+    // Sum bias and bias of exact division are added at once. The sum
+    // is 0x8000, which only wraps in signed type
+    const __m256i SUM_BIAS = _mm256_set1_epi16((short) (255*128 + EXACT_DIV_BIAS));
+    const __m256i DIV_MULT = _mm256_set1_epi16(EXACT_DIV_MULTIPLIER);
+
+    return _mm256_mulhi_epu16(_mm256_add_epi16(biased_sum, SUM_BIAS),
+                              DIV_MULT);
+}
+
+/*
+ * Same as AVX-512 version: unsigned weights, channels shifted to signed
+ * range and `vpmaddubsw`
+ */
+__always_inline
+static __m256i blend_plane(__m256i bg, __m256i fg,
+                           __m256i weights_low, __m256i weights_high,
+                           divide_simd_t* divide)
+{
+    const __m256i SIGN_BIT = _mm256_set1_epi8((char) 0x80);
+
+    bg = _mm256_xor_si256(bg, SIGN_BIT);
+    fg = _mm256_xor_si256(fg, SIGN_BIT);
+
+    __m256i low  = _mm256_maddubs_epi16(weights_low,
+                                        _mm256_unpacklo_epi8(bg, fg));
+    __m256i high = _mm256_maddubs_epi16(weights_high,
+                                        _mm256_unpackhi_epi8(bg, fg));
+
+    low  = divide(low);
+    high = divide(high);
+
+    return _mm256_packus_epi16(low, high);
+}
+
+__always_inline
+static void blend_planar_with(const PlanarRow* bg, const PlanarRow* fg,
+                              size_t count, divide_simd_t* divide,
+                              blend_planar_row_t* blend_row)
+{
+    const size_t bytes_per_vector = sizeof(__m256i);
+
+    const __m256i ALL_BITS = _mm256_set1_epi8((char) 0xFF);
+
+    size_t x = 0;
+    for (; x + bytes_per_vector <= count; x += bytes_per_vector)
+    {
+        const __m256i alpha = _mm256_loadu_si256(
+                        (const __m256i*) (fg->planes[PLANE_ALPHA] + x));
+        const __m256i inverse_alpha = _mm256_xor_si256(alpha, ALL_BITS);
+
+        const __m256i weights_low  = _mm256_unpacklo_epi8(inverse_alpha,
+                                                          alpha);
+        const __m256i weights_high = _mm256_unpackhi_epi8(inverse_alpha,
+                                                          alpha);
+
+        for (size_t plane = PLANE_RED; plane < PLANE_ALPHA; ++plane)
+        {
+            __m256i* bg_channel = (__m256i*) (bg->planes[plane] + x);
+            const __m256i* fg_channel = (const __m256i*)
+                                        (fg->planes[plane] + x);
+
+            const __m256i result = blend_plane(
+                                        _mm256_loadu_si256(bg_channel),
+                                        _mm256_loadu_si256(fg_channel),
+                                        weights_low, weights_high, divide);
+
+            _mm256_storeu_si256(bg_channel, result);
+        }
+    }
+
+    // Remaining pixels
+    const PlanarRow bg_rest = offset_planar_row(bg, x);
+    const PlanarRow fg_rest = offset_planar_row(fg, x);
+    blend_row(&bg_rest, &fg_rest, count - x);
+}
+
+void blend_planar_row_avx2(const PlanarRow* bg, const PlanarRow* fg,
+                           size_t count)
+{
+    blend_planar_with(bg, fg, count, divide_fast, blend_planar_row_scalar);
+}
+
+void blend_planar_row_exact_avx2(const PlanarRow* bg, const PlanarRow* fg,
+                                 size_t count)
+{
+    blend_planar_with(bg, fg, count, divide_exact,
+                      blend_planar_row_exact_scalar);
+}
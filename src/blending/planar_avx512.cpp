@@ -0,0 +1,312 @@
+#include "commons/intrinsics.h"
+
+#include "planar_rows.h"
+#include "shuffle_masks.h"
+
+/*
+ * Every 128-bit lane of four pixels becomes four dwords of red, green,
+ * blue and alpha bytes. Then dwords of the same channel are gathered, so
+ * that every lane holds 16 bytes of a single channel.
+ */
+__always_inline
+static __m512i group_channels(__m512i pixels)
+{
+    const __m512i MASK_TRANSPOSE = _mm512_set_epi8(
+        MASK_TRANSPOSE_CHANNELS_ROW,
+        MASK_TRANSPOSE_CHANNELS_ROW,
+        MASK_TRANSPOSE_CHANNELS_ROW,
+        MASK_TRANSPOSE_CHANNELS_ROW
+    );
+
+    // 4x4 transpose of dwords, its own inverse
+    const __m512i TRANSPOSE_DWORDS = _mm512_set_epi32(
+        15, 11,  7,  3, 14, 10,  6,  2, 13,  9,  5,  1, 12,  8,  4,  0
+    );
+
+    pixels = _mm512_shuffle_epi8(pixels, MASK_TRANSPOSE);
+    return _mm512_permutexvar_epi32(TRANSPOSE_DWORDS, pixels);
+}
+
+/*
+ * Inverse of `group_channels`
+ */
+__always_inline
+static __m512i interleave_channels(__m512i channels)
+{
+    const __m512i MASK_TRANSPOSE = _mm512_set_epi8(
+        MASK_TRANSPOSE_CHANNELS_ROW,
+        MASK_TRANSPOSE_CHANNELS_ROW,
+        MASK_TRANSPOSE_CHANNELS_ROW,
+        MASK_TRANSPOSE_CHANNELS_ROW
+    );
+
+    const __m512i TRANSPOSE_DWORDS = _mm512_set_epi32(
+        15, 11,  7,  3, 14, 10,  6,  2, 13,  9,  5,  1, 12,  8,  4,  0
+    );
+
+    channels = _mm512_permutexvar_epi32(TRANSPOSE_DWORDS, channels);
+    return _mm512_shuffle_epi8(channels, MASK_TRANSPOSE);
+}
+
+/*
+ * Vectors of 16 pixels with grouped channels are transposed by 128-bit
+ * lanes: lane `i` of every vector goes to plane `i`
+ */
+__always_inline
+static void transpose_lanes(__m512i* v0, __m512i* v1, __m512i* v2, __m512i* v3)
+{
+    const __m512i t0 = _mm512_shuffle_i64x2(*v0, *v1, 0x44);
+    const __m512i t1 = _mm512_shuffle_i64x2(*v0, *v1, 0xEE);
+    const __m512i t2 = _mm512_shuffle_i64x2(*v2, *v3, 0x44);
+    const __m512i t3 = _mm512_shuffle_i64x2(*v2, *v3, 0xEE);
+
+    *v0 = _mm512_shuffle_i64x2(t0, t2, 0x88);
+    *v1 = _mm512_shuffle_i64x2(t0, t2, 0xDD);
+    *v2 = _mm512_shuffle_i64x2(t1, t3, 0x88);
+    *v3 = _mm512_shuffle_i64x2(t1, t3, 0xDD);
+}
+
+__always_inline
+static __mmask16 get_pixel_mask(size_t count, size_t vector)
+{
+    const size_t pixels_per_vector = sizeof(__m512i) / sizeof(Pixel);
+
+    if (count <= vector * pixels_per_vector)
+        return 0;
+
+    const size_t rest = count - vector * pixels_per_vector;
+    return rest >= pixels_per_vector
+         ? (__mmask16) 0xFFFF
+         : _cvtu32_mask16((1u << rest) - 1);
+}
+
+/*
+ * Masked loads and stores do not touch memory outside of the mask,
+ * so the last pixels are converted without scalar code
+ */
+static void split_masked(const PlanarRow* dst, const Pixel* src, size_t x,
+                         size_t count)
+{
+    const size_t pixels_per_vector = sizeof(__m512i) / sizeof(Pixel);
+
+    __m512i v0 = _mm512_maskz_loadu_epi32(get_pixel_mask(count, 0),
+                                          src + x);
+    __m512i v1 = _mm512_maskz_loadu_epi32(get_pixel_mask(count, 1),
+                                          src + x + pixels_per_vector);
+    __m512i v2 = _mm512_maskz_loadu_epi32(get_pixel_mask(count, 2),
+                                          src + x + 2*pixels_per_vector);
+    __m512i v3 = _mm512_maskz_loadu_epi32(get_pixel_mask(count, 3),
+                                          src + x + 3*pixels_per_vector);
+
+    v0 = group_channels(v0);
+    v1 = group_channels(v1);
+    v2 = group_channels(v2);
+    v3 = group_channels(v3);
+
+    transpose_lanes(&v0, &v1, &v2, &v3);
+
+    const __mmask64 mask = _cvtu64_mask64((1ull << count) - 1);
+
+    _mm512_mask_storeu_epi8(dst->planes[PLANE_RED]   + x, mask, v0);
+    _mm512_mask_storeu_epi8(dst->planes[PLANE_GREEN] + x, mask, v1);
+    _mm512_mask_storeu_epi8(dst->planes[PLANE_BLUE]  + x, mask, v2);
+    _mm512_mask_storeu_epi8(dst->planes[PLANE_ALPHA] + x, mask, v3);
+}
+
+void split_row_avx512(const PlanarRow* dst, const Pixel* src, size_t count)
+{
+    const size_t pixels_per_vector = sizeof(__m512i) / sizeof(Pixel);
+    const size_t bytes_per_vector  = sizeof(__m512i);
+
+    size_t x = 0;
+    for (; x + bytes_per_vector <= count; x += bytes_per_vector)
+    {
+        __m512i v0 = _mm512_loadu_si512(src + x);
+        __m512i v1 = _mm512_loadu_si512(src + x + pixels_per_vector);
+        __m512i v2 = _mm512_loadu_si512(src + x + 2*pixels_per_vector);
+        __m512i v3 = _mm512_loadu_si512(src + x + 3*pixels_per_vector);
+
+        v0 = group_channels(v0);
+        v1 = group_channels(v1);
+        v2 = group_channels(v2);
+        v3 = group_channels(v3);
+
+        transpose_lanes(&v0, &v1, &v2, &v3);
+
+        _mm512_storeu_si512(dst->planes[PLANE_RED]   + x, v0);
+        _mm512_storeu_si512(dst->planes[PLANE_GREEN] + x, v1);
+        _mm512_storeu_si512(dst->planes[PLANE_BLUE]  + x, v2);
+        _mm512_storeu_si512(dst->planes[PLANE_ALPHA] + x, v3);
+    }
+
+    // Remaining pixels
+    if (x < count)
+        split_masked(dst, src, x, count - x);
+}
+
+static void merge_masked(Pixel* dst, const PlanarRow* src, size_t x,
+                         size_t count)
+{
+    const size_t pixels_per_vector = sizeof(__m512i) / sizeof(Pixel);
+
+    const __mmask64 mask = _cvtu64_mask64((1ull << count) - 1);
+
+    __m512i v0 = _mm512_maskz_loadu_epi8(mask, src->planes[PLANE_RED]   + x);
+    __m512i v1 = _mm512_maskz_loadu_epi8(mask, src->planes[PLANE_GREEN] + x);
+    __m512i v2 = _mm512_maskz_loadu_epi8(mask, src->planes[PLANE_BLUE]  + x);
+    __m512i v3 = _mm512_maskz_loadu_epi8(mask, src->planes[PLANE_ALPHA] + x);
+
+    transpose_lanes(&v0, &v1, &v2, &v3);
+
+    _mm512_mask_storeu_epi32(dst + x, get_pixel_mask(count, 0),
+                             interleave_channels(v0));
+    _mm512_mask_storeu_epi32(dst + x + pixels_per_vector,
+                             get_pixel_mask(count, 1),
+                             interleave_channels(v1));
+    _mm512_mask_storeu_epi32(dst + x + 2*pixels_per_vector,
+                             get_pixel_mask(count, 2),
+                             interleave_channels(v2));
+    _mm512_mask_storeu_epi32(dst + x + 3*pixels_per_vector,
+                             get_pixel_mask(count, 3),
+                             interleave_channels(v3));
+}
+
+void merge_row_avx512(Pixel* dst, const PlanarRow* src, size_t count)
+{
+    const size_t pixels_per_vector = sizeof(__m512i) / sizeof(Pixel);
+    const size_t bytes_per_vector  = sizeof(__m512i);
+
+    size_t x = 0;
+    for (; x + bytes_per_vector <= count; x += bytes_per_vector)
+    {
+        __m512i v0 = _mm512_loadu_si512(src->planes[PLANE_RED]   + x);
+        __m512i v1 = _mm512_loadu_si512(src->planes[PLANE_GREEN] + x);
+        __m512i v2 = _mm512_loadu_si512(src->planes[PLANE_BLUE]  + x);
+        __m512i v3 = _mm512_loadu_si512(src->planes[PLANE_ALPHA] + x);
+
+        // Transposing lanes is its own inverse
+        transpose_lanes(&v0, &v1, &v2, &v3);
+
+        _mm512_storeu_si512(dst + x,
+                            interleave_channels(v0));
+        _mm512_storeu_si512(dst + x + pixels_per_vector,
+                            interleave_channels(v1));
+        _mm512_storeu_si512(dst + x + 2*pixels_per_vector,
+                            interleave_channels(v2));
+        _mm512_storeu_si512(dst + x + 3*pixels_per_vector,
+                            interleave_channels(v3));
+    }
+
+    // Remaining pixels
+    if (x < count)
+        merge_masked(dst, src, x, count - x);
+}
+
+/*
+ * Both divisions get `bg*(255 - a) + fg*a`, shifted down by 255*128
+ */
+typedef __m512i divide_simd_t(__m512i biased_sum);
+
+static __m512i divide_fast(__m512i biased_sum)
+{
+    const __m512i SUM_BIAS = _mm512_set1_epi16(255*128);
+
+    return _mm512_srli_epi16(_mm512_add_epi16(biased_sum, SUM_BIAS), 8);
+}
+
+static __m512i divide_exact(__m512i biased_sum)
+{
+    // Sum bias and bias of exact division are added at once. The sum
+    // is 0x8000, which only wraps in signed type
+    const __m512i SUM_BIAS = _mm512_set1_epi16((short) (255*128 + EXACT_DIV_BIAS));
+    const __m512i DIV_MULT = _mm512_set1_epi16(EXACT_DIV_MULTIPLIER);
+
+    return _mm512_mulhi_epu16(_mm512_add_epi16(biased_sum, SUM_BIAS),
+                              DIV_MULT);
+}
+
+/*
+ * `vpmaddubsw` multiplies unsigned bytes by signed ones and adds adjacent
+ * products. Weights `255 - a` and `a` are unsigned, and channels are
+ * shifted to signed range by flipping their highest bit. Weights sum up
+ * to 255, so sums never saturate.
+ */
+__always_inline
+static __m512i blend_plane(__m512i bg, __m512i fg,
+                           __m512i weights_low, __m512i weights_high,
+                           divide_simd_t* divide)
+{
+    const __m512i SIGN_BIT = _mm512_set1_epi8((char) 0x80);
+
+    bg = _mm512_xor_si512(bg, SIGN_BIT);
+    fg = _mm512_xor_si512(fg, SIGN_BIT);
+
+    __m512i low  = _mm512_maddubs_epi16(weights_low,
+                                        _mm512_unpacklo_epi8(bg, fg));
+    __m512i high = _mm512_maddubs_epi16(weights_high,
+                                        _mm512_unpackhi_epi8(bg, fg));
+
+    low  = divide(low);
+    high = divide(high);
+
+    // Unpacking and packing both work within lanes, so order is restored
+    return _mm512_packus_epi16(low, high);
+}
+
+__always_inline
+static void blend_planar_vector(const PlanarRow* bg, const PlanarRow* fg,
+                                size_t x, __mmask64 mask,
+                                divide_simd_t* divide)
+{
+    const __m512i alpha = _mm512_maskz_loadu_epi8(
+                                mask, fg->planes[PLANE_ALPHA] + x);
+    const __m512i inverse_alpha = _mm512_ternarylogic_epi32(alpha, alpha,
+                                                            alpha, 0x55);
+
+    const __m512i weights_low  = _mm512_unpacklo_epi8(inverse_alpha, alpha);
+    const __m512i weights_high = _mm512_unpackhi_epi8(inverse_alpha, alpha);
+
+    for (size_t plane = PLANE_RED; plane < PLANE_ALPHA; ++plane)
+    {
+        const __m512i bg_channel = _mm512_maskz_loadu_epi8(
+                                        mask, bg->planes[plane] + x);
+        const __m512i fg_channel = _mm512_maskz_loadu_epi8(
+                                        mask, fg->planes[plane] + x);
+
+        const __m512i result = blend_plane(bg_channel, fg_channel,
+                                           weights_low, weights_high,
+                                           divide);
+
+        _mm512_mask_storeu_epi8(bg->planes[plane] + x, mask, result);
+    }
+}
+
+__always_inline
+static void blend_planar_with(const PlanarRow* bg, const PlanarRow* fg,
+                              size_t count, divide_simd_t* divide)
+{
+    const size_t bytes_per_vector = sizeof(__m512i);
+    const __mmask64 FULL_MASK = _cvtu64_mask64(~0ull);
+
+    size_t x = 0;
+    for (; x + bytes_per_vector <= count; x += bytes_per_vector)
+        blend_planar_vector(bg, fg, x, FULL_MASK, divide);
+
+    // Remaining pixels
+    if (x < count)
+        blend_planar_vector(bg, fg, x,
+                            _cvtu64_mask64((1ull << (count - x)) - 1),
+                            divide);
+}
+
+void blend_planar_row_avx512(const PlanarRow* bg, const PlanarRow* fg,
+                             size_t count)
+{
+    blend_planar_with(bg, fg, count, divide_fast);
+}
+
+void blend_planar_row_exact_avx512(const PlanarRow* bg, const PlanarRow* fg,
+                                   size_t count)
+{
+    blend_planar_with(bg, fg, count, divide_exact);
+}
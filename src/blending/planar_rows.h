@@ -0,0 +1,99 @@
+/**
+ * @file planar_rows.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Planar conversion and blending kernels, built for several
+ * instruction set levels
+ *
+ * @version 0.1
+ * @date 2023-05-06
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __PLANAR_ROWS_H
+#define __PLANAR_ROWS_H
+
+#include "commons/definitions.h"
+#include "planar.h"
+
+/**
+ * @brief Transposes 4x4 bytes of every 128-bit lane: four RGBA pixels
+ * become four runs of red, green, blue and alpha bytes, and vice versa.
+ * Arguments of `_mm_set_epi8`, highest byte first.
+ */
+#define MASK_TRANSPOSE_CHANNELS_ROW \
+    15, 11,  7,  3, 14, 10,  6,  2, 13,  9,  5,  1, 12,  8,  4,  0
+
+/**
+ * @brief Row of planar image. Every element points to the same column
+ * in its plane.
+ */
+struct PlanarRow
+{
+    uint8_t* planes[PLANE_COUNT];
+};
+
+/**
+ * @brief Get the same row, starting `x` columns further
+ */
+__always_inline
+static PlanarRow offset_planar_row(const PlanarRow* row, size_t x)
+{
+    PlanarRow result = {};
+    for (size_t i = 0; i < PLANE_COUNT; ++i)
+        result.planes[i] = row->planes[i] + x;
+
+    return result;
+}
+
+/**
+ * @brief Split interleaved row into planes
+ *
+ * @param[out] dst	    - Destination planar row
+ * @param[in]  src	    - Source row
+ * @param[in]  count	- Number of pixels in row
+ */
+typedef void split_row_t(const PlanarRow* dst, const Pixel* src,
+                         size_t count);
+
+/**
+ * @brief Interleave planar row
+ *
+ * @param[out] dst	    - Destination row
+ * @param[in]  src	    - Source planar row
+ * @param[in]  count	- Number of pixels in row
+ */
+typedef void merge_row_t(Pixel* dst, const PlanarRow* src, size_t count);
+
+/**
+ * @brief Blend planar foreground row on top of planar background row.
+ * Only color planes of background are written.
+ *
+ * @param[inout] bg	    - Background row
+ * @param[in]    fg	    - Foreground row
+ * @param[in]    count	- Number of pixels in row
+ */
+typedef void blend_planar_row_t(const PlanarRow* bg, const PlanarRow* fg,
+                                size_t count);
+
+split_row_t split_row_scalar;
+split_row_t split_row_sse4;
+split_row_t split_row_avx2;
+split_row_t split_row_avx512;
+
+merge_row_t merge_row_scalar;
+merge_row_t merge_row_sse4;
+merge_row_t merge_row_avx2;
+merge_row_t merge_row_avx512;
+
+blend_planar_row_t blend_planar_row_scalar;
+blend_planar_row_t blend_planar_row_sse4;
+blend_planar_row_t blend_planar_row_avx2;
+blend_planar_row_t blend_planar_row_avx512;
+
+blend_planar_row_t blend_planar_row_exact_scalar;
+blend_planar_row_t blend_planar_row_exact_sse4;
+blend_planar_row_t blend_planar_row_exact_avx2;
+blend_planar_row_t blend_planar_row_exact_avx512;
+
+#endif /* planar_rows.h */
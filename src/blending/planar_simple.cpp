@@ -0,0 +1,75 @@
+#include "planar_rows.h"
+#include "shuffle_masks.h"
+
+void split_row_scalar(const PlanarRow* dst, const Pixel* src, size_t count)
+{
+    for (size_t x = 0; x < count; ++x)
+    {
+        dst->planes[PLANE_RED]  [x] = src[x].red;
+        dst->planes[PLANE_GREEN][x] = src[x].green;
+        dst->planes[PLANE_BLUE] [x] = src[x].blue;
+        dst->planes[PLANE_ALPHA][x] = src[x].alpha;
+    }
+}
+
+void merge_row_scalar(Pixel* dst, const PlanarRow* src, size_t count)
+{
+    for (size_t x = 0; x < count; ++x)
+    {
+        dst[x] = {
+            .red   = src->planes[PLANE_RED]  [x],
+            .green = src->planes[PLANE_GREEN][x],
+            .blue  = src->planes[PLANE_BLUE] [x],
+            .alpha = src->planes[PLANE_ALPHA][x]
+        };
+    }
+}
+
+/*
+ * Same arithmetic as `combine_pixels` and `combine_pixels_exact`
+ */
+__always_inline
+static uint16_t mix_channel(uint8_t bg, uint8_t fg, uint8_t fg_alpha)
+{
+    return (uint16_t) (bg * (255 - fg_alpha) + fg * fg_alpha);
+}
+
+__always_inline
+static uint8_t divide_exact(uint16_t value)
+{
+    const uint32_t biased = (uint32_t) value + EXACT_DIV_BIAS;
+
+    return (uint8_t) ((biased * EXACT_DIV_MULTIPLIER) >> 16);
+}
+
+void blend_planar_row_scalar(const PlanarRow* bg, const PlanarRow* fg,
+                             size_t count)
+{
+    const uint8_t* fg_alpha = fg->planes[PLANE_ALPHA];
+
+    for (size_t plane = PLANE_RED; plane < PLANE_ALPHA; ++plane)
+    {
+        uint8_t*       bg_plane = bg->planes[plane];
+        const uint8_t* fg_plane = fg->planes[plane];
+
+        for (size_t x = 0; x < count; ++x)
+            bg_plane[x] = (uint8_t) (mix_channel(bg_plane[x], fg_plane[x],
+                                                 fg_alpha[x]) >> 8);
+    }
+}
+
+void blend_planar_row_exact_scalar(const PlanarRow* bg, const PlanarRow* fg,
+                                   size_t count)
+{
+    const uint8_t* fg_alpha = fg->planes[PLANE_ALPHA];
+
+    for (size_t plane = PLANE_RED; plane < PLANE_ALPHA; ++plane)
+    {
+        uint8_t*       bg_plane = bg->planes[plane];
+        const uint8_t* fg_plane = fg->planes[plane];
+
+        for (size_t x = 0; x < count; ++x)
+            bg_plane[x] = divide_exact(mix_channel(bg_plane[x], fg_plane[x],
+                                                   fg_alpha[x]));
+    }
+}
@@ -0,0 +1,213 @@
+#include "commons/intrinsics.h"
+
+#include "planar_rows.h"
+#include "shuffle_masks.h"
+
+/*
+ * 4x4 transpose of dwords, its own inverse
+ */
+__always_inline
+static void transpose_dwords(__m128i* v0, __m128i* v1,
+                             __m128i* v2, __m128i* v3)
+{
+    const __m128i low01  = _mm_unpacklo_epi32(*v0, *v1);
+    const __m128i high01 = _mm_unpackhi_epi32(*v0, *v1);
+    const __m128i low23  = _mm_unpacklo_epi32(*v2, *v3);
+    const __m128i high23 = _mm_unpackhi_epi32(*v2, *v3);
+
+    *v0 = _mm_unpacklo_epi64(low01,  low23);
+    *v1 = _mm_unpackhi_epi64(low01,  low23);
+    *v2 = _mm_unpacklo_epi64(high01, high23);
+    *v3 = _mm_unpackhi_epi64(high01, high23);
+}
+
+/*
+ * Four vectors of four pixels become four vectors of 16 channel bytes:
+ * every vector is transposed as 4x4 bytes, then all of them as 4x4 dwords
+ */
+__always_inline
+static void group_channels(__m128i* v0, __m128i* v1,
+                           __m128i* v2, __m128i* v3)
+{
+    const __m128i MASK_TRANSPOSE = _mm_set_epi8(MASK_TRANSPOSE_CHANNELS_ROW);
+
+    *v0 = _mm_shuffle_epi8(*v0, MASK_TRANSPOSE);
+    *v1 = _mm_shuffle_epi8(*v1, MASK_TRANSPOSE);
+    *v2 = _mm_shuffle_epi8(*v2, MASK_TRANSPOSE);
+    *v3 = _mm_shuffle_epi8(*v3, MASK_TRANSPOSE);
+
+    transpose_dwords(v0, v1, v2, v3);
+}
+
+/*
+ * Inverse of `group_channels`: dwords first, then bytes
+ */
+__always_inline
+static void interleave_channels(__m128i* v0, __m128i* v1,
+                                __m128i* v2, __m128i* v3)
+{
+    const __m128i MASK_TRANSPOSE = _mm_set_epi8(MASK_TRANSPOSE_CHANNELS_ROW);
+
+    transpose_dwords(v0, v1, v2, v3);
+
+    *v0 = _mm_shuffle_epi8(*v0, MASK_TRANSPOSE);
+    *v1 = _mm_shuffle_epi8(*v1, MASK_TRANSPOSE);
+    *v2 = _mm_shuffle_epi8(*v2, MASK_TRANSPOSE);
+    *v3 = _mm_shuffle_epi8(*v3, MASK_TRANSPOSE);
+}
+
+void split_row_sse4(const PlanarRow* dst, const Pixel* src, size_t count)
+{
+    const size_t bytes_per_vector = sizeof(__m128i);
+
+    size_t x = 0;
+    for (; x + bytes_per_vector <= count; x += bytes_per_vector)
+    {
+        const __m128i* pixels = (const __m128i*) (src + x);
+
+        __m128i v0 = _mm_loadu_si128(pixels + 0);
+        __m128i v1 = _mm_loadu_si128(pixels + 1);
+        __m128i v2 = _mm_loadu_si128(pixels + 2);
+        __m128i v3 = _mm_loadu_si128(pixels + 3);
+
+        group_channels(&v0, &v1, &v2, &v3);
+
+        _mm_storeu_si128((__m128i*) (dst->planes[PLANE_RED]   + x), v0);
+        _mm_storeu_si128((__m128i*) (dst->planes[PLANE_GREEN] + x), v1);
+        _mm_storeu_si128((__m128i*) (dst->planes[PLANE_BLUE]  + x), v2);
+        _mm_storeu_si128((__m128i*) (dst->planes[PLANE_ALPHA] + x), v3);
+    }
+
+    // Remaining pixels
+    const PlanarRow rest = offset_planar_row(dst, x);
+    split_row_scalar(&rest, src + x, count - x);
+}
+
+void merge_row_sse4(Pixel* dst, const PlanarRow* src, size_t count)
+{
+    const size_t bytes_per_vector = sizeof(__m128i);
+
+    size_t x = 0;
+    for (; x + bytes_per_vector <= count; x += bytes_per_vector)
+    {
+        __m128i v0 = _mm_loadu_si128(
+                        (const __m128i*) (src->planes[PLANE_RED]   + x));
+        __m128i v1 = _mm_loadu_si128(
+                        (const __m128i*) (src->planes[PLANE_GREEN] + x));
+        __m128i v2 = _mm_loadu_si128(
+                        (const __m128i*) (src->planes[PLANE_BLUE]  + x));
+        __m128i v3 = _mm_loadu_si128(
+                        (const __m128i*) (src->planes[PLANE_ALPHA] + x));
+
+        interleave_channels(&v0, &v1, &v2, &v3);
+
+        __m128i* pixels = (__m128i*) (dst + x);
+
+        _mm_storeu_si128(pixels + 0, v0);
+        _mm_storeu_si128(pixels + 1, v1);
+        _mm_storeu_si128(pixels + 2, v2);
+        _mm_storeu_si128(pixels + 3, v3);
+    }
+
+    // Remaining pixels
+    const PlanarRow rest = offset_planar_row(src, x);
+    merge_row_scalar(dst + x, &rest, count - x);
+}
+
+/*
+ * Both divisions get `bg*(255 - a) + fg*a`, shifted down by 255*128
+ */
+typedef __m128i divide_simd_t(__m128i biased_sum);
+
+static __m128i divide_fast(__m128i biased_sum)
+{
+    const __m128i SUM_BIAS = _mm_set1_epi16(255*128);
+
+    return _mm_srli_epi16(_mm_add_epi16(biased_sum, SUM_BIAS), 8);
+}
+
+static __m128i divide_exact(__m128i biased_sum)
+{
+    // Sum bias and bias of exact division are added at once. The sum
+    // is 0x8000, which only wraps in signed type
+    const __m128i SUM_BIAS = _mm_set1_epi16((short) (255*128 + EXACT_DIV_BIAS));
+    const __m128i DIV_MULT = _mm_set1_epi16(EXACT_DIV_MULTIPLIER);
+
+    return _mm_mulhi_epu16(_mm_add_epi16(biased_sum, SUM_BIAS), DIV_MULT);
+}
+
+/*
+ * Same as AVX-512 version: unsigned weights, channels shifted to signed
+ * range and `pmaddubsw`
+ */
+__always_inline
+static __m128i blend_plane(__m128i bg, __m128i fg,
+                           __m128i weights_low, __m128i weights_high,
+                           divide_simd_t* divide)
+{
+    const __m128i SIGN_BIT = _mm_set1_epi8((char) 0x80);
+
+    bg = _mm_xor_si128(bg, SIGN_BIT);
+    fg = _mm_xor_si128(fg, SIGN_BIT);
+
+    __m128i low  = _mm_maddubs_epi16(weights_low,  _mm_unpacklo_epi8(bg, fg));
+    __m128i high = _mm_maddubs_epi16(weights_high, _mm_unpackhi_epi8(bg, fg));
+
+    low  = divide(low);
+    high = divide(high);
+
+    return _mm_packus_epi16(low, high);
+}
+
+__always_inline
+static void blend_planar_with(const PlanarRow* bg, const PlanarRow* fg,
+                              size_t count, divide_simd_t* divide,
+                              blend_planar_row_t* blend_row)
+{
+    const size_t bytes_per_vector = sizeof(__m128i);
+
+    const __m128i ALL_BITS = _mm_set1_epi8((char) 0xFF);
+
+    size_t x = 0;
+    for (; x + bytes_per_vector <= count; x += bytes_per_vector)
+    {
+        const __m128i alpha = _mm_loadu_si128(
+                        (const __m128i*) (fg->planes[PLANE_ALPHA] + x));
+        const __m128i inverse_alpha = _mm_xor_si128(alpha, ALL_BITS);
+
+        const __m128i weights_low  = _mm_unpacklo_epi8(inverse_alpha, alpha);
+        const __m128i weights_high = _mm_unpackhi_epi8(inverse_alpha, alpha);
+
+        for (size_t plane = PLANE_RED; plane < PLANE_ALPHA; ++plane)
+        {
+            __m128i* bg_channel = (__m128i*) (bg->planes[plane] + x);
+            const __m128i* fg_channel = (const __m128i*)
+                                        (fg->planes[plane] + x);
+
+            const __m128i result = blend_plane(_mm_loadu_si128(bg_channel),
+                                               _mm_loadu_si128(fg_channel),
+                                               weights_low, weights_high,
+                                               divide);
+
+            _mm_storeu_si128(bg_channel, result);
+        }
+    }
+
+    // Remaining pixels
+    const PlanarRow bg_rest = offset_planar_row(bg, x);
+    const PlanarRow fg_rest = offset_planar_row(fg, x);
+    blend_row(&bg_rest, &fg_rest, count - x);
+}
+
+void blend_planar_row_sse4(const PlanarRow* bg, const PlanarRow* fg,
+                           size_t count)
+{
+    blend_planar_with(bg, fg, count, divide_fast, blend_planar_row_scalar);
+}
+
+void blend_planar_row_exact_sse4(const PlanarRow* bg, const PlanarRow* fg,
+                                 size_t count)
+{
+    blend_planar_with(bg, fg, count, divide_exact,
+                      blend_planar_row_exact_scalar);
+}
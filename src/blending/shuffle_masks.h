@@ -0,0 +1,244 @@
+/**
+ * @file shuffle_masks.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Byte shuffle masks, shared by blending kernels of all vector widths.
+ * Shuffles never cross 128-bit lanes, so each mask is defined for a single
+ * lane and repeated as many times, as the vector width requires.
+ *
+ * @version 0.1
+ * @date 2023-04-24
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __SHUFFLE_MASKS_H
+#define __SHUFFLE_MASKS_H
+
+#define MASK_ZERO ((char) 0x80)
+
+/*
+ * [ r0 g0 b0 a0 | r1 g1 b1 a1 | r2 g2 b2 a2 | r3 g3 b3 a3 ]
+ *                             V
+ *                             V
+ * [ r0 00 g0 00   b0 00 a0 00 | r1 00 g1 00   b1 00 a1 00 ]
+ */
+#define MASK_SPREAD_1_ROW \
+    MASK_ZERO, 0x07,\
+    MASK_ZERO, 0x06,\
+    MASK_ZERO, 0x05,\
+    MASK_ZERO, 0x04,\
+    MASK_ZERO, 0x03,\
+    MASK_ZERO, 0x02,\
+    MASK_ZERO, 0x01,\
+    MASK_ZERO, 0x00
+
+/*
+ * [ r0 g0 b0 a0 | r1 g1 b1 a1 | r2 g2 b2 a2 | r3 g3 b3 a3 ]
+ *                             V
+ *                             V
+ * [ r2 00 g2 00   b2 00 a2 00 | r3 00 g3 00   b3 00 a3 00 ]
+ */
+#define MASK_SPREAD_2_ROW \
+    MASK_ZERO, 0x0F,\
+    MASK_ZERO, 0x0E,\
+    MASK_ZERO, 0x0D,\
+    MASK_ZERO, 0x0C,\
+    MASK_ZERO, 0x0B,\
+    MASK_ZERO, 0x0A,\
+    MASK_ZERO, 0x09,\
+    MASK_ZERO, 0x08
+
+/*
+ * [ r0 00 g0 00 b0 00 a0 00 | r1 00 g1 00 b1 00 a1 00 ]
+ *                           V
+ *                           V
+ * [ a0 00 a0 00 a0 00 a0 00 | a1 00 a1 00 a1 00 a1 00 ]
+ */
+#define MASK_SPREAD_ALPHA_ROW \
+    MASK_ZERO, 0x0E,\
+    MASK_ZERO, 0x0E,\
+    MASK_ZERO, 0x0E,\
+    MASK_ZERO, 0x0E,\
+    MASK_ZERO, 0x06,\
+    MASK_ZERO, 0x06,\
+    MASK_ZERO, 0x06,\
+    MASK_ZERO, 0x06
+
+/*
+ * Alpha of 16-bit pixels occupies both bytes of a half-word
+ *
+ * [ r0    g0    b0    a0    | r1    g1    b1    a1    ]
+ *                           V
+ *                           V
+ * [ a0    a0    a0    a0    | a1    a1    a1    a1    ]
+ */
+#define MASK_SPREAD_ALPHA16_ROW \
+    0x0F, 0x0E,\
+    0x0F, 0x0E,\
+    0x0F, 0x0E,\
+    0x0F, 0x0E,\
+    0x07, 0x06,\
+    0x07, 0x06,\
+    0x07, 0x06,\
+    0x07, 0x06
+
+/*
+ * Premultiplied foreground is added after multiplication, so in fast mode
+ * it has to be spread into higher bytes of half-words
+ *
+ * [ r0 g0 b0 a0 | r1 g1 b1 a1 | r2 g2 b2 a2 | r3 g3 b3 a3 ]
+ *                             V
+ *                             V
+ * [ 00 r0 00 g0   00 b0 00 a0 | 00 r1 00 g1   00 b1 00 a1 ]
+ */
+#define MASK_SPREAD_HIGH_1_ROW \
+    0x07, MASK_ZERO,\
+    0x06, MASK_ZERO,\
+    0x05, MASK_ZERO,\
+    0x04, MASK_ZERO,\
+    0x03, MASK_ZERO,\
+    0x02, MASK_ZERO,\
+    0x01, MASK_ZERO,\
+    0x00, MASK_ZERO
+
+/*
+ * [ r0 g0 b0 a0 | r1 g1 b1 a1 | r2 g2 b2 a2 | r3 g3 b3 a3 ]
+ *                             V
+ *                             V
+ * [ 00 r2 00 g2   00 b2 00 a2 | 00 r3 00 g3   00 b3 00 a3 ]
+ */
+#define MASK_SPREAD_HIGH_2_ROW \
+    0x0F, MASK_ZERO,\
+    0x0E, MASK_ZERO,\
+    0x0D, MASK_ZERO,\
+    0x0C, MASK_ZERO,\
+    0x0B, MASK_ZERO,\
+    0x0A, MASK_ZERO,\
+    0x09, MASK_ZERO,\
+    0x08, MASK_ZERO
+
+/*
+ * Spreads alpha directly from packed pixels, when there is no need
+ * to spread other foreground channels into lower bytes
+ *
+ * [ r0 g0 b0 a0 | r1 g1 b1 a1 | r2 g2 b2 a2 | r3 g3 b3 a3 ]
+ *                             V
+ *                             V
+ * [ a0 00 a0 00   a0 00 a0 00 | a1 00 a1 00   a1 00 a1 00 ]
+ */
+#define MASK_SPREAD_PACKED_ALPHA_1_ROW \
+    MASK_ZERO, 0x07,\
+    MASK_ZERO, 0x07,\
+    MASK_ZERO, 0x07,\
+    MASK_ZERO, 0x07,\
+    MASK_ZERO, 0x03,\
+    MASK_ZERO, 0x03,\
+    MASK_ZERO, 0x03,\
+    MASK_ZERO, 0x03
+
+/*
+ * [ r0 g0 b0 a0 | r1 g1 b1 a1 | r2 g2 b2 a2 | r3 g3 b3 a3 ]
+ *                             V
+ *                             V
+ * [ a2 00 a2 00   a2 00 a2 00 | a3 00 a3 00   a3 00 a3 00 ]
+ */
+#define MASK_SPREAD_PACKED_ALPHA_2_ROW \
+    MASK_ZERO, 0x0F,\
+    MASK_ZERO, 0x0F,\
+    MASK_ZERO, 0x0F,\
+    MASK_ZERO, 0x0F,\
+    MASK_ZERO, 0x0B,\
+    MASK_ZERO, 0x0B,\
+    MASK_ZERO, 0x0B,\
+    MASK_ZERO, 0x0B
+
+/*
+ * Because alpha channel is not updated, it resides in lower byte
+ * of half-word, unlike other channels
+ *
+ * [ xx r0 xx g0   xx b0 a0 00 | xx r1 xx g1   xx b1 a1 00 ]
+ *                             V
+ *                             V
+ * [ r0 g0 b0 a0 | r1 g1 b1 a1 | 00 00 00 00 | 00 00 00 00 ]
+ */
+#define MASK_PACK_1_ROW \
+    MASK_ZERO, MASK_ZERO,\
+    MASK_ZERO, MASK_ZERO,\
+    MASK_ZERO, MASK_ZERO,\
+    MASK_ZERO, MASK_ZERO,\
+    0x0E,      0x0D,     \
+    0x0B,      0x09,     \
+    0x06,      0x05,     \
+    0x03,      0x01
+
+/*
+ * Because alpha channel is not updated, it resides in lower byte
+ * of half-word, unlike other channels
+ *
+ * [ xx r2 xx g2   xx b2 a2 00 | xx r2 xx g2   xx b2 a2 00 ]
+ *                             V
+ *                             V
+ * [ 00 00 00 00 | 00 00 00 00 | r2 g2 b2 a2 | r3 g3 b3 a3 ]
+ */
+#define MASK_PACK_2_ROW \
+    0x0E,      0x0D,     \
+    0x0B,      0x09,     \
+    0x06,      0x05,     \
+    0x03,      0x01,     \
+    MASK_ZERO, MASK_ZERO,\
+    MASK_ZERO, MASK_ZERO,\
+    MASK_ZERO, MASK_ZERO,\
+    MASK_ZERO, MASK_ZERO
+
+/*
+ * Exact division leaves results in lower byte of half-word
+ *
+ * [ r0 00 g0 00   b0 00 a0 00 | r1 00 g1 00   b1 00 a1 00 ]
+ *                             V
+ *                             V
+ * [ r0 g0 b0 a0 | r1 g1 b1 a1 | 00 00 00 00 | 00 00 00 00 ]
+ */
+#define MASK_PACK_EXACT_1_ROW \
+    MASK_ZERO, MASK_ZERO,\
+    MASK_ZERO, MASK_ZERO,\
+    MASK_ZERO, MASK_ZERO,\
+    MASK_ZERO, MASK_ZERO,\
+    0x0E,      0x0C,     \
+    0x0A,      0x08,     \
+    0x06,      0x04,     \
+    0x02,      0x00
+
+/*
+ * Exact division leaves results in lower byte of half-word
+ *
+ * [ r2 00 g2 00   b2 00 a2 00 | r3 00 g3 00   b3 00 a3 00 ]
+ *                             V
+ *                             V
+ * [ 00 00 00 00 | 00 00 00 00 | r2 g2 b2 a2 | r3 g3 b3 a3 ]
+ */
+#define MASK_PACK_EXACT_2_ROW \
+    0x0E,      0x0C,     \
+    0x0A,      0x08,     \
+    0x06,      0x04,     \
+    0x02,      0x00,     \
+    MASK_ZERO, MASK_ZERO,\
+    MASK_ZERO, MASK_ZERO,\
+    MASK_ZERO, MASK_ZERO,\
+    MASK_ZERO, MASK_ZERO
+
+/*
+ * Correctly rounded division by 255 of 16-bit x: with t = x + 128,
+ * round(x / 255) == (t + (t >> 8)) >> 8 == (t * 257) >> 16
+ */
+#define EXACT_DIV_BIAS       128
+#define EXACT_DIV_MULTIPLIER 257
+
+/*
+ * During calculations, alpha channel of background should not be affected.
+ * One bit per half-word, i.e. per channel of a spread pixel: as a write mask
+ * for the whole 512-bit vector and as a blend immediate for a 128-bit lane.
+ */
+#define IGNORE_ALPHA_BITS  0x77777777u
+#define IGNORE_ALPHA_BLEND 0x77
+
+#endif /* shuffle_masks.h */
@@ -0,0 +1,169 @@
+#include <stdlib.h>
+
+#include "meerkat_assert/asserts.h"
+
+#include "span_index.h"
+
+static const size_t NO_SPAN = (size_t) -1;
+
+static SpanType get_span_type(const Pixel* pixel);
+static int      push_span(SpanIndex* index, size_t* capacity,
+                          size_t begin, size_t end, SpanType type);
+static int      index_row(SpanIndex* index, size_t* capacity,
+                          const Pixel* row, size_t row_length);
+
+int span_index_init(SpanIndex* index, const PixelImage* image)
+{
+    SAFE_BLOCK_START    // Validate parameters
+    {
+        ASSERT_TRUE_MESSAGE(index != NULL, "index");
+        ASSERT_TRUE_MESSAGE(image != NULL, "image");
+        ASSERT_TRUE_MESSAGE(image->pixel_array != NULL, "image->pixel_array");
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    const size_t size_x = image->size.x;
+    const size_t size_y = image->size.y;
+
+    index->row_count  = size_y;
+    index->span_count = 0;
+    index->spans      = NULL;
+
+    size_t capacity = 0;
+
+    SAFE_BLOCK_START    // Build index
+    {
+        index->row_starts = (size_t*) calloc(size_y + 1,
+                                             sizeof(*index->row_starts));
+        ASSERT_TRUE_MESSAGE(index->row_starts != NULL,
+                            "Failed to allocate memory");
+
+        for (size_t y = 0; y < size_y; ++y)
+        {
+            index->row_starts[y] = index->span_count;
+
+            ASSERT_ZERO(
+                    index_row(index, &capacity,
+                              image->pixel_array + y*size_x, size_x));
+        }
+        index->row_starts[size_y] = index->span_count;
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        span_index_dispose(index);
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    return 0;
+}
+
+void span_index_dispose(SpanIndex* index)
+{
+    SAFE_BLOCK_START
+    {
+        ASSERT_TRUE_MESSAGE(index != NULL, "index");
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        return;
+    }
+    SAFE_BLOCK_END
+
+    free(index->row_starts);
+    free(index->spans);
+
+    index->row_starts = NULL;
+    index->spans      = NULL;
+    index->row_count  = 0;
+    index->span_count = 0;
+}
+
+static SpanType get_span_type(const Pixel* pixel)
+{
+    switch (pixel->alpha)
+    {
+        case 0:   return SPAN_TRANSPARENT;
+        case 255: return SPAN_OPAQUE;
+        default:  return SPAN_PARTIAL;
+    }
+}
+
+static int index_row(SpanIndex* index, size_t* capacity,
+                     const Pixel* row, size_t row_length)
+{
+    // Partial span, which absorbs too short runs, until a long one is met
+    size_t partial_begin = NO_SPAN;
+
+    size_t x = 0;
+    while (x < row_length)
+    {
+        const SpanType type = get_span_type(row + x);
+
+        size_t run_end = x + 1;
+        while (run_end < row_length && get_span_type(row + run_end) == type)
+            ++run_end;
+
+        if (type == SPAN_PARTIAL || run_end - x < MIN_SPAN_LENGTH)
+        {
+            if (partial_begin == NO_SPAN)
+                partial_begin = x;
+
+            x = run_end;
+            continue;
+        }
+
+        if (partial_begin != NO_SPAN)
+        {
+            if (push_span(index, capacity, partial_begin, x, SPAN_PARTIAL))
+                return -1;
+            partial_begin = NO_SPAN;
+        }
+
+        if (type == SPAN_OPAQUE &&
+            push_span(index, capacity, x, run_end, SPAN_OPAQUE))
+            return -1;
+
+        x = run_end;
+    }
+
+    if (partial_begin != NO_SPAN &&
+        push_span(index, capacity, partial_begin, row_length, SPAN_PARTIAL))
+        return -1;
+
+    return 0;
+}
+
+static int push_span(SpanIndex* index, size_t* capacity,
+                     size_t begin, size_t end, SpanType type)
+{
+    if (index->span_count == *capacity)
+    {
+        const size_t new_capacity = *capacity ? 2 * *capacity : 64;
+
+        AlphaSpan* new_spans = (AlphaSpan*) realloc(
+                                    index->spans,
+                                    new_capacity * sizeof(*new_spans));
+        if (!new_spans)
+            return -1;
+
+        index->spans = new_spans;
+        *capacity    = new_capacity;
+    }
+
+    index->spans[index->span_count++] = {
+        .begin  = begin,
+        .length = end - begin,
+        .type   = type
+    };
+
+    return 0;
+}
@@ -0,0 +1,68 @@
+/**
+ * @file span_index.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Per-row index of fully transparent, fully opaque and partially
+ * transparent runs of foreground pixels
+ *
+ * @version 0.1
+ * @date 2023-04-26
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __SPAN_INDEX_H
+#define __SPAN_INDEX_H
+
+#include "commons/definitions.h"
+
+/**
+ * @brief Shorter transparent or opaque runs are blended as partial ones:
+ * splitting vector iterations costs more than blending them.
+ */
+#define MIN_SPAN_LENGTH 16
+
+enum SpanType
+{
+    SPAN_TRANSPARENT,   // alpha == 0, skipped
+    SPAN_OPAQUE,        // alpha == 255, copied
+    SPAN_PARTIAL        // blended
+};
+
+struct AlphaSpan
+{
+    size_t   begin;
+    size_t   length;
+    SpanType type;
+};
+
+/**
+ * @brief Transparent spans are not stored. Spans of row `y` are
+ * `spans[row_starts[y]]` up to (not including) `spans[row_starts[y + 1]]`
+ */
+struct SpanIndex
+{
+    size_t     row_count;
+    size_t*    row_starts;
+
+    size_t     span_count;
+    AlphaSpan* spans;
+};
+
+/**
+ * @brief Classify pixel runs of every image row
+ *
+ * @param[out] index	- Built index
+ * @param[in]  image	- Foreground image
+ *
+ * @return 0 upon success, -1 upon error
+ */
+int span_index_init(SpanIndex* index, const PixelImage* image);
+
+/**
+ * @brief Free memory, allocated in `span_index_init`
+ *
+ * @param[inout] index	- Previously built index
+ */
+void span_index_dispose(SpanIndex* index);
+
+#endif /* span_index.h */
@@ -0,0 +1,55 @@
+#include <math.h>
+
+#include "srgb.h"
+
+static SrgbTables build_srgb_tables(void);
+
+const SrgbTables* get_srgb_tables(void)
+{
+    static const SrgbTables tables = build_srgb_tables();
+
+    return &tables;
+}
+
+static double decode_srgb(double value)
+{
+    if (value <= 0.04045)
+        return value / 12.92;
+
+    return pow((value + 0.055) / 1.055, 2.4);
+}
+
+static double encode_srgb(double value)
+{
+    if (value <= 0.0031308)
+        return value * 12.92;
+
+    return 1.055 * pow(value, 1 / 2.4) - 0.055;
+}
+
+static SrgbTables build_srgb_tables(void)
+{
+    SrgbTables tables = {};
+
+    for (unsigned i = 0; i < SRGB_DECODE_SIZE; ++i)
+        tables.decode[i] = (uint16_t) lround(
+                                decode_srgb(i / 255.0) * UINT16_MAX);
+
+    // Every entry covers a range of linear values, encode its middle
+    const unsigned half_range = 1u << (SRGB_ENCODE_SHIFT - 1);
+    for (unsigned i = 0; i < SRGB_ENCODE_SIZE; ++i)
+    {
+        const unsigned linear = (i << SRGB_ENCODE_SHIFT) + half_range;
+
+        tables.encode[i] = (uint8_t) lround(
+                                encode_srgb(linear / (double) UINT16_MAX)
+                                * 255);
+    }
+
+    // Decoded values themselves lie anywhere inside entry ranges, so their
+    // entries are fixed up to make round trip exact
+    for (unsigned i = 0; i < SRGB_DECODE_SIZE; ++i)
+        tables.encode[tables.decode[i] >> SRGB_ENCODE_SHIFT] = (uint8_t) i;
+
+    return tables;
+}
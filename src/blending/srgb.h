@@ -0,0 +1,68 @@
+/**
+ * @file srgb.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Lookup tables for conversion between sRGB-encoded channels and
+ * linear light
+ *
+ * @version 0.1
+ * @date 2023-05-08
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __SRGB_H
+#define __SRGB_H
+
+#include <stdint.h>
+
+#define SRGB_DECODE_SIZE  256
+
+/**
+ * @brief Linear values are encoded by their highest 12 bits. Neighbouring
+ * 8-bit sRGB values are at least 19 apart in linear light, so every one
+ * of them gets its own table entry.
+ */
+#define SRGB_ENCODE_SHIFT 4
+#define SRGB_ENCODE_SIZE  (1u << (16 - SRGB_ENCODE_SHIFT))
+
+struct SrgbTables
+{
+    alignas(64) uint16_t decode[SRGB_DECODE_SIZE];      // 16-bit linear
+
+    // Gathers load 4 bytes per element, so table is padded
+    alignas(64) uint8_t  encode[SRGB_ENCODE_SIZE + 4];  // 8-bit sRGB
+};
+
+/**
+ * @brief Get conversion tables. They are built on the first call.
+ * Decoding and encoding back any 8-bit value gives the same value.
+ *
+ * @return Shared tables
+ */
+const SrgbTables* get_srgb_tables(void);
+
+/**
+ * @brief Blend a single channel in linear light:
+ * `fg*a + bg*(65535 - a)` with 16-bit operands and 16-bit result.
+ * Multiplication by 65535 loses one, which is added back, so that opaque
+ * and transparent foreground pixels are reproduced exactly.
+ *
+ * @param[in] bg	    - sRGB-encoded background channel
+ * @param[in] fg	    - sRGB-encoded foreground channel
+ * @param[in] alpha	    - 16-bit foreground alpha
+ * @param[in] tables	- Result of `get_srgb_tables`
+ *
+ * @return sRGB-encoded result
+ */
+static inline uint8_t blend_channel_linear(uint8_t bg, uint8_t fg,
+                                           uint32_t alpha,
+                                           const SrgbTables* tables)
+{
+    const uint32_t linear = (tables->decode[fg] * alpha >> 16)
+                          + (tables->decode[bg] * (UINT16_MAX - alpha) >> 16)
+                          + 1;
+
+    return tables->encode[linear >> SRGB_ENCODE_SHIFT];
+}
+
+#endif /* srgb.h */
@@ -0,0 +1,404 @@
+#include <math.h>
+
+#include "meerkat_assert/asserts.h"
+#include "commons/cpu_features.h"
+
+#include "transform.h"
+#include "transform_rows.h"
+
+// Indexed by SimdLevel
+static transform_row_t* const TRANSFORM_ROW_KERNELS[SIMD_LEVEL_COUNT] = {
+    transform_row_scalar,
+    transform_row_scalar,
+    transform_row_avx2,
+    transform_row_avx512
+};
+
+// Indexed by SimdLevel
+static subpixel_row_t* const SUBPIXEL_ROW_KERNELS[SIMD_LEVEL_COUNT] = {
+    subpixel_row_scalar,
+    subpixel_row_sse4,
+    subpixel_row_avx2,
+    subpixel_row_avx512
+};
+
+/**
+ * @brief Background to foreground mapping, same layout as `AffineTransform`
+ */
+struct InverseTransform
+{
+    double matrix[2][3];
+};
+
+static bool invert_transform(const AffineTransform* transform,
+                             InverseTransform* inverse)
+{
+    const double (*m)[3] = transform->matrix;
+
+    const double det = m[0][0] * m[1][1] - m[0][1] * m[1][0];
+    if (!isfinite(det) || fabs(det) < 1e-9)
+        return false;
+
+    double (*inv)[3] = inverse->matrix;
+
+    inv[0][0] =  m[1][1] / det;
+    inv[0][1] = -m[0][1] / det;
+    inv[1][0] = -m[1][0] / det;
+    inv[1][1] =  m[0][0] / det;
+
+    inv[0][2] = -(inv[0][0] * m[0][2] + inv[0][1] * m[1][2]);
+    inv[1][2] = -(inv[1][0] * m[0][2] + inv[1][1] * m[1][2]);
+
+    // Steps between pixels have to fit 16.16 fixed point
+    const double max_step = TRANSFORM_MAX_SOURCE_SIZE;
+    for (size_t i = 0; i < 2; ++i)
+        for (size_t j = 0; j < 3; ++j)
+            if (!isfinite(inv[i][j]) || (j < 2 && fabs(inv[i][j]) >= max_step))
+                return false;
+
+    return true;
+}
+
+/**
+ * @brief Half-open range of background pixels, which may be covered
+ */
+struct PixelSpan
+{
+    size_t begin;
+    size_t end;
+};
+
+/**
+ * @brief Get bounding box of transformed foreground. Foreground is
+ * extended by half a pixel, where its anti-aliased edge is sampled.
+ */
+static void get_bounding_box(const AffineTransform* transform,
+                             SizeVector2 fg_size, SizeVector2 bg_size,
+                             PixelSpan* columns, PixelSpan* rows)
+{
+    const double corners_x[] = { -0.5, (double) fg_size.x + 0.5 };
+    const double corners_y[] = { -0.5, (double) fg_size.y + 0.5 };
+
+    double min[2] = {  INFINITY,  INFINITY };
+    double max[2] = { -INFINITY, -INFINITY };
+
+    for (size_t i = 0; i < 2; ++i)
+        for (size_t j = 0; j < 2; ++j)
+            for (size_t k = 0; k < 2; ++k)
+            {
+                const double* row = transform->matrix[k];
+                const double mapped = row[0] * corners_x[i]
+                                    + row[1] * corners_y[j]
+                                    + row[2];
+
+                min[k] = fmin(min[k], mapped);
+                max[k] = fmax(max[k], mapped);
+            }
+
+    const size_t bg_dims[] = { bg_size.x, bg_size.y };
+    PixelSpan* spans[] = { columns, rows };
+
+    for (size_t k = 0; k < 2; ++k)
+    {
+        const double begin = fmax(floor(min[k]), 0);
+        const double end   = fmin(ceil(max[k]), (double) bg_dims[k]);
+
+        if (begin >= end)
+            *spans[k] = {};
+        else
+            *spans[k] = { .begin = (size_t) begin, .end = (size_t) end };
+    }
+}
+
+/**
+ * @brief Shrink span of columns to the ones, which sample foreground
+ * coordinate `base + step*x` inside the range of `(-1, size)`.
+ * Span is kept one column wider on both sides, as samples near its
+ * ends are empty anyway.
+ *
+ * @return false if no columns are left, true otherwise
+ */
+static bool clip_span(PixelSpan* span, double base, double step, size_t size)
+{
+    const double lower = -1;
+    const double upper = (double) size;
+
+    // Coordinate does not change along the row
+    if (fabs(step) < 1e-12)
+        return lower < base && base < upper && span->begin < span->end;
+
+    double first = (lower - base) / step;
+    double last  = (upper - base) / step;
+    if (first > last)
+    {
+        const double tmp = first;
+        first = last;
+        last  = tmp;
+    }
+
+    const double begin = floor(first);
+    const double end   = ceil(last) + 1;
+
+    if (end <= (double) span->begin || begin >= (double) span->end)
+        return false;
+
+    if (begin > (double) span->begin)
+        span->begin = (size_t) begin;
+    if (end < (double) span->end)
+        span->end = (size_t) end;
+
+    return span->begin < span->end;
+}
+
+__always_inline
+static int32_t to_fixed(double value)
+{
+    return (int32_t) lround(value * (1 << SAMPLE_COORD_SHIFT));
+}
+
+struct TransformTask
+{
+    PixelImage*       background;
+    const PixelImage* foreground;
+    InverseTransform  inverse;
+
+    PixelSpan         columns;      // Bounding box
+    PixelSpan         rows;
+
+    transform_row_t*  transform_row;
+};
+
+static void transform_rows(void* task_ptr, size_t begin, size_t end)
+{
+    const TransformTask* task = (const TransformTask*) task_ptr;
+
+    const double (*inv)[3] = task->inverse.matrix;
+    const SizeVector2 fg_size = task->foreground->size;
+    const size_t bg_width = task->background->size.x;
+
+    for (size_t y = task->rows.begin + begin;
+                y < task->rows.begin + end; ++y)
+    {
+        const double dst_y = (double) y + 0.5;
+
+        // Sampled position of column x is `base + step*x`, shifted by
+        // half a pixel to get the upper left sampled pixel
+        const double base_u = inv[0][0] * 0.5 + inv[0][1] * dst_y
+                            + inv[0][2] - 0.5;
+        const double base_v = inv[1][0] * 0.5 + inv[1][1] * dst_y
+                            + inv[1][2] - 0.5;
+
+        PixelSpan span = task->columns;
+        if (!clip_span(&span, base_u, inv[0][0], fg_size.x) ||
+            !clip_span(&span, base_v, inv[1][0], fg_size.y))
+            continue;
+
+        const double x = (double) span.begin;
+        const SourceWalk walk = {
+            .u  = to_fixed(base_u + inv[0][0] * x),
+            .v  = to_fixed(base_v + inv[1][0] * x),
+            .du = to_fixed(inv[0][0]),
+            .dv = to_fixed(inv[1][0])
+        };
+
+        task->transform_row(task->background->pixel_array
+                                + y * bg_width + span.begin,
+                            span.end - span.begin, &walk, task->foreground);
+    }
+}
+
+int blend_transformed(PixelImage* background, const PixelImage* foreground,
+                      const AffineTransform* transform, ThreadPool* pool)
+{
+    SAFE_BLOCK_START
+    {
+        ASSERT_TRUE(background != NULL);
+        ASSERT_TRUE(foreground != NULL);
+        ASSERT_TRUE(transform  != NULL);
+        ASSERT_POSITIVE(foreground->size.x);
+        ASSERT_POSITIVE(foreground->size.y);
+        ASSERT_LESS(foreground->size.x, TRANSFORM_MAX_SOURCE_SIZE);
+        ASSERT_LESS(foreground->size.y, TRANSFORM_MAX_SOURCE_SIZE);
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    TransformTask task = {
+        .background    = background,
+        .foreground    = foreground,
+        .inverse       = {},
+        .columns       = {},
+        .rows          = {},
+        .transform_row = TRANSFORM_ROW_KERNELS[get_simd_level()]
+    };
+
+    if (!invert_transform(transform, &task.inverse))
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+
+    get_bounding_box(transform, foreground->size, background->size,
+                     &task.columns, &task.rows);
+
+    const size_t row_count = task.rows.end - task.rows.begin;
+    if (row_count == 0 || task.columns.begin == task.columns.end)
+        return 0;
+
+    if (pool)
+        thread_pool_run(pool, transform_rows, &task, row_count);
+    else
+        transform_rows(&task, 0, row_count);
+
+    return 0;
+}
+
+/**
+ * @brief Sampling of fractionally positioned foreground along one axis
+ */
+struct SubpixelAxis
+{
+    PixelSpan span;         // Covered background pixels
+    int64_t   offset;       // Background pixel `i` samples `i - offset`
+    uint16_t  weight;       // 16-bit weight of pixel `i - offset + 1`
+};
+
+static SubpixelAxis get_subpixel_axis(uint32_t pos, size_t fg_size,
+                                      size_t bg_size)
+{
+    const uint32_t fraction_mask = (1u << SUBPIXEL_BITS) - 1;
+
+    const uint32_t integer  = pos >> SUBPIXEL_BITS;
+    const uint32_t fraction = pos & fraction_mask;
+
+    // Pixel center `i + 0.5` samples foreground at `i - pos`, which is
+    // `i - integer - 1 + (1 - fraction)` for non-zero fraction
+    const size_t has_fraction = fraction != 0;
+    const uint32_t weight = (fraction_mask + 1 - fraction) & fraction_mask;
+
+    const size_t end = integer + fg_size + has_fraction;
+
+    return {
+        .span   = {
+            .begin = integer < bg_size ? integer : bg_size,
+            .end   = end     < bg_size ? end     : bg_size
+        },
+        .offset = (int64_t) (integer + has_fraction),
+        .weight = (uint16_t) (weight * 257)     // Scaled to 16 bits
+    };
+}
+
+struct SubpixelTask
+{
+    PixelImage*       background;
+    const PixelImage* foreground;
+
+    SubpixelAxis      axis_x;
+    SubpixelAxis      axis_y;
+
+    subpixel_row_t*   blend_row;
+};
+
+static void blend_subpixel_rows(void* task_ptr, size_t begin, size_t end)
+{
+    const SubpixelTask* task = (const SubpixelTask*) task_ptr;
+
+    const PixelImage* fg = task->foreground;
+    const SubpixelAxis* axis_x = &task->axis_x;
+    const SubpixelAxis* axis_y = &task->axis_y;
+
+    const int64_t fg_width  = (int64_t) fg->size.x;
+    const int64_t fg_height = (int64_t) fg->size.y;
+
+    // Columns, which sample only pixels inside foreground
+    PixelSpan inner = axis_x->span;
+    if ((int64_t) inner.begin < axis_x->offset)
+        inner.begin = (size_t) axis_x->offset;
+    if ((int64_t) inner.end > axis_x->offset + fg_width - 1)
+        inner.end = (size_t) (axis_x->offset + fg_width - 1);
+    if (inner.end < inner.begin)
+        inner.end = inner.begin;
+
+    for (size_t y = axis_y->span.begin + begin;
+                y < axis_y->span.begin + end; ++y)
+    {
+        Pixel* row = task->background->pixel_array
+                   + y * task->background->size.x;
+        const int64_t fg_y = (int64_t) y - axis_y->offset;
+
+        const bool is_inner_row = 0 <= fg_y && fg_y + 1 < fg_height;
+        const size_t inner_begin = is_inner_row ? inner.begin
+                                                : axis_x->span.end;
+
+        // Pixels on foreground edges sample outside of it
+        for (size_t x = axis_x->span.begin; x < inner_begin; ++x)
+            blend_sampled_at(row + x, fg,
+                             (int32_t) ((int64_t) x - axis_x->offset),
+                             (int32_t) fg_y,
+                             axis_x->weight, axis_y->weight);
+
+        if (!is_inner_row)
+            continue;
+
+        const Pixel* top = fg->pixel_array + (size_t) fg_y * fg->size.x
+                         + (size_t) ((int64_t) inner.begin - axis_x->offset);
+
+        task->blend_row(row + inner.begin, top, top + fg->size.x,
+                        inner.end - inner.begin,
+                        axis_x->weight, axis_y->weight);
+
+        for (size_t x = inner.end; x < axis_x->span.end; ++x)
+            blend_sampled_at(row + x, fg,
+                             (int32_t) ((int64_t) x - axis_x->offset),
+                             (int32_t) fg_y,
+                             axis_x->weight, axis_y->weight);
+    }
+}
+
+int blend_subpixel(PixelImage* background, const PixelImage* foreground,
+                   SubpixelVector2 pos, ThreadPool* pool)
+{
+    SAFE_BLOCK_START
+    {
+        ASSERT_TRUE(background != NULL);
+        ASSERT_TRUE(foreground != NULL);
+        ASSERT_POSITIVE(foreground->size.x);
+        ASSERT_POSITIVE(foreground->size.y);
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    SubpixelTask task = {
+        .background = background,
+        .foreground = foreground,
+        .axis_x     = get_subpixel_axis(pos.x, foreground->size.x,
+                                        background->size.x),
+        .axis_y     = get_subpixel_axis(pos.y, foreground->size.y,
+                                        background->size.y),
+        .blend_row  = SUBPIXEL_ROW_KERNELS[get_simd_level()]
+    };
+
+    const size_t row_count = task.axis_y.span.end
+                           - task.axis_y.span.begin;
+    if (row_count == 0 ||
+        task.axis_x.span.begin == task.axis_x.span.end)
+        return 0;
+
+    if (pool)
+        thread_pool_run(pool, blend_subpixel_rows, &task, row_count);
+    else
+        blend_subpixel_rows(&task, 0, row_count);
+
+    return 0;
+}
@@ -0,0 +1,73 @@
+/**
+ * @file transform.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Blending of rotated, scaled or fractionally positioned foreground
+ * with bilinear sampling, without intermediate resampled image
+ *
+ * @version 0.1
+ * @date 2023-05-09
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __TRANSFORM_H
+#define __TRANSFORM_H
+
+#include "commons/definitions.h"
+#include "commons/thread_pool.h"
+
+/**
+ * @brief Foreground is sampled with 16.16 fixed-point coordinates, so its
+ * sides have to be shorter than this
+ */
+#define TRANSFORM_MAX_SOURCE_SIZE (1u << 14)
+
+/**
+ * @brief Maps foreground coordinates to background ones:
+ * `dst_x = m[0][0]*x + m[0][1]*y + m[0][2]`,
+ * `dst_y = m[1][0]*x + m[1][1]*y + m[1][2]`.
+ * Pixel centers are at half-integer coordinates, so the identity matrix
+ * maps every pixel onto itself.
+ */
+struct AffineTransform
+{
+    double matrix[2][3];
+};
+
+/**
+ * @brief Transform foreground, bilinearly sampling it, and blend it on top
+ * of background. Only background pixels inside the bounding box of the
+ * transformed foreground are visited, and every row is further clipped
+ * to the pixels, which may be covered. Foreground edges are anti-aliased.
+ * Background alpha is left unchanged.
+ *
+ * @param[inout] background	- Image background
+ * @param[in]    foreground	- Image foreground, not premultiplied
+ * @param[in]    transform	- Foreground to background mapping
+ * @param[inout] pool	    - Worker threads. If NULL, only the calling
+ *                            thread is used
+ *
+ * @return 0 upon success, -1 upon invalid arguments or degenerate
+ * transform
+ */
+int blend_transformed(PixelImage* background, const PixelImage* foreground,
+                      const AffineTransform* transform, ThreadPool* pool);
+
+/**
+ * @brief Blend foreground, placed at fractional position, on top of
+ * background. Same as `blend_transformed` with translation by `pos`,
+ * but neighbouring pixels are sampled with unit stride. Foreground may
+ * extend beyond background and is clipped.
+ *
+ * @param[inout] background	- Image background
+ * @param[in]    foreground	- Image foreground, not premultiplied
+ * @param[in]    pos	    - Foreground position inside background
+ * @param[inout] pool	    - Worker threads. If NULL, only the calling
+ *                            thread is used
+ *
+ * @return 0 upon success, -1 upon invalid arguments
+ */
+int blend_subpixel(PixelImage* background, const PixelImage* foreground,
+                   SubpixelVector2 pos, ThreadPool* pool);
+
+#endif /* transform.h */
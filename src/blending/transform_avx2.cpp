@@ -0,0 +1,303 @@
+#include "commons/intrinsics.h"
+
+#include "transform_rows.h"
+#include "shuffle_masks.h"
+
+/**
+ * @brief Sampled foreground pixels, each vector has 8 of them
+ */
+struct Texels
+{
+    __m256i top_left;
+    __m256i top_right;
+    __m256i bottom_left;
+    __m256i bottom_right;
+
+    __m256i weight_x;       // 16-bit weights in dwords
+    __m256i weight_y;
+};
+
+// Lanes with invalid coordinates load the first pixel and are then zeroed
+__always_inline
+static __m256i gather_texels(__m256i index, __m256i is_valid,
+                             const PixelImage* fg)
+{
+    const __m256i pixels = _mm256_i32gather_epi32(
+                                (const int*) (const void*) fg->pixel_array,
+                                _mm256_and_si256(index, is_valid),
+                                sizeof(Pixel));
+
+    return _mm256_and_si256(pixels, is_valid);
+}
+
+// Unsigned comparison rejects negative coordinates as well
+__always_inline
+static __m256i is_coord_inside(__m256i coord, __m256i max_coord)
+{
+    return _mm256_cmpeq_epi32(_mm256_min_epu32(coord, max_coord), coord);
+}
+
+static Texels gather_quads(__m256i u, __m256i v, const PixelImage* fg)
+{
+    const __m256i ONE    = _mm256_set1_epi32(1);
+    const __m256i size_x = _mm256_set1_epi32((int) fg->size.x);
+    const __m256i max_x  = _mm256_set1_epi32((int) fg->size.x - 1);
+    const __m256i max_y  = _mm256_set1_epi32((int) fg->size.y - 1);
+
+    const __m256i x = _mm256_srai_epi32(u, SAMPLE_COORD_SHIFT);
+    const __m256i y = _mm256_srai_epi32(v, SAMPLE_COORD_SHIFT);
+
+    const __m256i is_valid_top    = is_coord_inside(y, max_y);
+    const __m256i is_valid_bottom = is_coord_inside(_mm256_add_epi32(y, ONE),
+                                                    max_y);
+    const __m256i is_valid_left   = is_coord_inside(x, max_x);
+    const __m256i is_valid_right  = is_coord_inside(_mm256_add_epi32(x, ONE),
+                                                    max_x);
+
+    const __m256i top_index    = _mm256_add_epi32(
+                                    _mm256_mullo_epi32(y, size_x), x);
+    const __m256i bottom_index = _mm256_add_epi32(top_index, size_x);
+
+    // 8-bit fractions, scaled to 16 bits
+    const __m256i FRACTION = _mm256_set1_epi32(0xFF);
+    const __m256i fraction_x = _mm256_and_si256(
+                                    _mm256_srli_epi32(u, SAMPLE_WEIGHT_SHIFT),
+                                    FRACTION);
+    const __m256i fraction_y = _mm256_and_si256(
+                                    _mm256_srli_epi32(v, SAMPLE_WEIGHT_SHIFT),
+                                    FRACTION);
+
+    return {
+        .top_left     = gather_texels(
+                            top_index,
+                            _mm256_and_si256(is_valid_top, is_valid_left),
+                            fg),
+        .top_right    = gather_texels(
+                            _mm256_add_epi32(top_index, ONE),
+                            _mm256_and_si256(is_valid_top, is_valid_right),
+                            fg),
+        .bottom_left  = gather_texels(
+                            bottom_index,
+                            _mm256_and_si256(is_valid_bottom, is_valid_left),
+                            fg),
+        .bottom_right = gather_texels(
+                            _mm256_add_epi32(bottom_index, ONE),
+                            _mm256_and_si256(is_valid_bottom, is_valid_right),
+                            fg),
+
+        .weight_x = _mm256_or_si256(fraction_x,
+                                    _mm256_slli_epi32(fraction_x, 8)),
+        .weight_y = _mm256_or_si256(fraction_y,
+                                    _mm256_slli_epi32(fraction_y, 8))
+    };
+}
+
+// Widen 4 pixels, see get_texel
+__always_inline
+static __m256i premultiply_texels(__m128i pixels)
+{
+    const __m256i MASK_SPREAD_ALPHA = _mm256_set_epi8(
+        MASK_SPREAD_ALPHA16_ROW,
+        MASK_SPREAD_ALPHA16_ROW
+    );
+
+    const __m256i channels = _mm256_cvtepu8_epi16(pixels);
+    const __m256i alpha = _mm256_shuffle_epi8(channels, MASK_SPREAD_ALPHA);
+
+    // Color channels are multiplied by alpha, alpha is scaled by 257
+    return _mm256_blend_epi16(
+                _mm256_or_si256(alpha, _mm256_slli_epi16(alpha, 8)),
+                _mm256_mullo_epi16(channels, alpha),
+                IGNORE_ALPHA_BLEND);
+}
+
+// Move 4 weights from dwords to every channel of widened pixels
+__always_inline
+static __m256i spread_weights(__m128i weights)
+{
+    const __m256i MASK_SPREAD_ALPHA = _mm256_set_epi8(
+        MASK_SPREAD_ALPHA16_ROW,
+        MASK_SPREAD_ALPHA16_ROW
+    );
+
+    const __m256i highest_word = _mm256_slli_epi64(
+                                    _mm256_cvtepu32_epi64(weights), 48);
+
+    return _mm256_shuffle_epi8(highest_word, MASK_SPREAD_ALPHA);
+}
+
+// See lerp_texels
+__always_inline
+static __m256i lerp_texels_simd(__m256i a, __m256i b, __m256i weight)
+{
+    const __m256i inv_weight = _mm256_xor_si256(weight,
+                                                _mm256_set1_epi16(-1));
+
+    return _mm256_add_epi16(_mm256_mulhi_epu16(a, inv_weight),
+                            _mm256_mulhi_epu16(b, weight));
+}
+
+// Interpolate and blend 4 pixels, see blend_bilinear. Weights are spread
+// to every channel.
+static __m256i blend_bilinear_half(__m128i bg,
+                                   __m128i top_left,    __m128i top_right,
+                                   __m128i bottom_left, __m128i bottom_right,
+                                   __m256i weight_x,    __m256i weight_y)
+{
+    const __m256i MASK_SPREAD_ALPHA = _mm256_set_epi8(
+        MASK_SPREAD_ALPHA16_ROW,
+        MASK_SPREAD_ALPHA16_ROW
+    );
+
+    const __m256i top    = lerp_texels_simd(premultiply_texels(top_left),
+                                            premultiply_texels(top_right),
+                                            weight_x);
+    const __m256i bottom = lerp_texels_simd(premultiply_texels(bottom_left),
+                                            premultiply_texels(bottom_right),
+                                            weight_x);
+    const __m256i sample = lerp_texels_simd(top, bottom, weight_y);
+
+    // See blend_sampled_channel
+    const __m256i alpha = _mm256_shuffle_epi8(sample, MASK_SPREAD_ALPHA);
+    const __m256i inv_alpha = _mm256_xor_si256(alpha, _mm256_set1_epi16(-1));
+
+    const __m256i bg_channels = _mm256_cvtepu8_epi16(bg);
+
+    __m256i blended = _mm256_add_epi16(
+                        _mm256_mulhi_epu16(_mm256_slli_epi16(bg_channels, 8),
+                                           inv_alpha),
+                        _mm256_add_epi16(
+                            sample,
+                            _mm256_mulhi_epu16(sample,
+                                               _mm256_set1_epi16(257))));
+
+    blended = _mm256_srli_epi16(
+                _mm256_adds_epu16(blended, _mm256_set1_epi16(128)), 8);
+
+    // Background alpha is kept
+    return _mm256_blend_epi16(bg_channels, blended, IGNORE_ALPHA_BLEND);
+}
+
+// Packing works within 128-bit lanes, so pixel pairs are interleaved
+__always_inline
+static __m256i pack_halves(__m256i low, __m256i high)
+{
+    return _mm256_permute4x64_epi64(_mm256_packus_epi16(low, high), 0xD8);
+}
+
+static __m256i blend_sampled_simd(__m256i bg, __m256i u, __m256i v,
+                                  const PixelImage* fg)
+{
+    const Texels texels = gather_quads(u, v, fg);
+
+    const __m256i low  = blend_bilinear_half(
+                    _mm256_castsi256_si128(bg),
+                    _mm256_castsi256_si128(texels.top_left),
+                    _mm256_castsi256_si128(texels.top_right),
+                    _mm256_castsi256_si128(texels.bottom_left),
+                    _mm256_castsi256_si128(texels.bottom_right),
+                    spread_weights(_mm256_castsi256_si128(texels.weight_x)),
+                    spread_weights(_mm256_castsi256_si128(texels.weight_y)));
+    const __m256i high = blend_bilinear_half(
+                    _mm256_extracti128_si256(bg, 1),
+                    _mm256_extracti128_si256(texels.top_left, 1),
+                    _mm256_extracti128_si256(texels.top_right, 1),
+                    _mm256_extracti128_si256(texels.bottom_left, 1),
+                    _mm256_extracti128_si256(texels.bottom_right, 1),
+                    spread_weights(_mm256_extracti128_si256(texels.weight_x,
+                                                            1)),
+                    spread_weights(_mm256_extracti128_si256(texels.weight_y,
+                                                            1)));
+
+    return pack_halves(low, high);
+}
+
+void transform_row_avx2(Pixel* bg, size_t count, const SourceWalk* walk,
+                        const PixelImage* fg)
+{
+    const size_t pixels_per_vector = sizeof(__m256i) / sizeof(Pixel);
+
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+    // Positions beyond the row may not fit 32 bits, so they wrap
+    __m256i u = _mm256_add_epi32(
+                    _mm256_set1_epi32(walk->u),
+                    _mm256_mullo_epi32(lanes, _mm256_set1_epi32(walk->du)));
+    __m256i v = _mm256_add_epi32(
+                    _mm256_set1_epi32(walk->v),
+                    _mm256_mullo_epi32(lanes, _mm256_set1_epi32(walk->dv)));
+
+    const __m256i step_u = _mm256_slli_epi32(_mm256_set1_epi32(walk->du), 3);
+    const __m256i step_v = _mm256_slli_epi32(_mm256_set1_epi32(walk->dv), 3);
+
+    size_t x = 0;
+    for (; x + pixels_per_vector <= count; x += pixels_per_vector)
+    {
+        __m256i bg_pixels = _mm256_loadu_si256((const __m256i*)(bg + x));
+        __m256i result = blend_sampled_simd(bg_pixels, u, v, fg);
+        _mm256_storeu_si256((__m256i*)(bg + x), result);
+
+        u = _mm256_add_epi32(u, step_u);
+        v = _mm256_add_epi32(v, step_v);
+    }
+
+    // Remaining pixels
+    const SourceWalk tail = {
+        .u  = _mm256_cvtsi256_si32(u),
+        .v  = _mm256_cvtsi256_si32(v),
+        .du = walk->du,
+        .dv = walk->dv
+    };
+    transform_row_scalar(bg + x, count - x, &tail, fg);
+}
+
+// Neighbouring foreground pixels are loaded with overlapping loads
+static __m256i blend_subpixel_simd(__m256i bg, const Pixel* top,
+                                   const Pixel* bottom,
+                                   __m256i weight_x, __m256i weight_y)
+{
+    const __m256i top_left     = _mm256_loadu_si256((const __m256i*) top);
+    const __m256i top_right    = _mm256_loadu_si256((const __m256i*)(top + 1));
+    const __m256i bottom_left  = _mm256_loadu_si256((const __m256i*) bottom);
+    const __m256i bottom_right = _mm256_loadu_si256(
+                                            (const __m256i*)(bottom + 1));
+
+    const __m256i low  = blend_bilinear_half(
+                            _mm256_castsi256_si128(bg),
+                            _mm256_castsi256_si128(top_left),
+                            _mm256_castsi256_si128(top_right),
+                            _mm256_castsi256_si128(bottom_left),
+                            _mm256_castsi256_si128(bottom_right),
+                            weight_x, weight_y);
+    const __m256i high = blend_bilinear_half(
+                            _mm256_extracti128_si256(bg, 1),
+                            _mm256_extracti128_si256(top_left, 1),
+                            _mm256_extracti128_si256(top_right, 1),
+                            _mm256_extracti128_si256(bottom_left, 1),
+                            _mm256_extracti128_si256(bottom_right, 1),
+                            weight_x, weight_y);
+
+    return pack_halves(low, high);
+}
+
+void subpixel_row_avx2(Pixel* bg, const Pixel* top, const Pixel* bottom,
+                       size_t count, uint16_t weight_x, uint16_t weight_y)
+{
+    const size_t pixels_per_vector = sizeof(__m256i) / sizeof(Pixel);
+
+    const __m256i spread_x = _mm256_set1_epi16((short) weight_x);
+    const __m256i spread_y = _mm256_set1_epi16((short) weight_y);
+
+    size_t x = 0;
+    for (; x + pixels_per_vector <= count; x += pixels_per_vector)
+    {
+        __m256i bg_pixels = _mm256_loadu_si256((const __m256i*)(bg + x));
+        __m256i result = blend_subpixel_simd(bg_pixels, top + x, bottom + x,
+                                             spread_x, spread_y);
+        _mm256_storeu_si256((__m256i*)(bg + x), result);
+    }
+
+    // Remaining pixels
+    subpixel_row_scalar(bg + x, top + x, bottom + x, count - x,
+                        weight_x, weight_y);
+}
@@ -0,0 +1,314 @@
+#include "commons/intrinsics.h"
+
+#include "transform_rows.h"
+#include "shuffle_masks.h"
+
+/**
+ * @brief Sampled foreground pixels, each vector has 16 of them
+ */
+struct Texels
+{
+    __m512i top_left;
+    __m512i top_right;
+    __m512i bottom_left;
+    __m512i bottom_right;
+
+    __m512i weight_x;       // 16-bit weights in dwords
+    __m512i weight_y;
+};
+
+// Lanes with invalid coordinates load the first pixel and are then zeroed.
+// Unmasked 512-bit gather takes all-ones mask, which does not fit the
+// signed mask of its builtin without optimizations, so halves are gathered
+// separately.
+__always_inline
+static __m512i gather_texels(__m512i index, __mmask16 is_valid,
+                             const PixelImage* fg)
+{
+    const int* pixels = (const int*) (const void*) fg->pixel_array;
+    const __m512i valid_index = _mm512_maskz_mov_epi32(is_valid, index);
+
+    const __m256i low  = _mm256_i32gather_epi32(
+                            pixels, _mm512_castsi512_si256(valid_index),
+                            sizeof(Pixel));
+    const __m256i high = _mm256_i32gather_epi32(
+                            pixels, _mm512_extracti64x4_epi64(valid_index, 1),
+                            sizeof(Pixel));
+
+    return _mm512_maskz_mov_epi32(
+                is_valid,
+                _mm512_inserti64x4(_mm512_castsi256_si512(low), high, 1));
+}
+
+static Texels gather_quads(__m512i u, __m512i v, const PixelImage* fg)
+{
+    const __m512i ONE    = _mm512_set1_epi32(1);
+    const __m512i size_x = _mm512_set1_epi32((int) fg->size.x);
+    const __m512i size_y = _mm512_set1_epi32((int) fg->size.y);
+
+    const __m512i x = _mm512_srai_epi32(u, SAMPLE_COORD_SHIFT);
+    const __m512i y = _mm512_srai_epi32(v, SAMPLE_COORD_SHIFT);
+
+    // Unsigned comparison rejects negative coordinates as well
+    const __mmask16 is_valid_top    = _mm512_cmplt_epu32_mask(y, size_y);
+    const __mmask16 is_valid_bottom = _mm512_cmplt_epu32_mask(
+                                        _mm512_add_epi32(y, ONE), size_y);
+
+    const __mmask16 is_valid_left   = _mm512_cmplt_epu32_mask(x, size_x);
+    const __mmask16 is_valid_right  = _mm512_cmplt_epu32_mask(
+                                        _mm512_add_epi32(x, ONE), size_x);
+
+    const __m512i top_index    = _mm512_add_epi32(
+                                    _mm512_mullo_epi32(y, size_x), x);
+    const __m512i bottom_index = _mm512_add_epi32(top_index, size_x);
+
+    // 8-bit fractions, scaled to 16 bits
+    const __m512i FRACTION = _mm512_set1_epi32(0xFF);
+    const __m512i fraction_x = _mm512_and_si512(
+                                    _mm512_srli_epi32(u, SAMPLE_WEIGHT_SHIFT),
+                                    FRACTION);
+    const __m512i fraction_y = _mm512_and_si512(
+                                    _mm512_srli_epi32(v, SAMPLE_WEIGHT_SHIFT),
+                                    FRACTION);
+
+    return {
+        .top_left     = gather_texels(top_index,
+                                      is_valid_top & is_valid_left, fg),
+        .top_right    = gather_texels(_mm512_add_epi32(top_index, ONE),
+                                      is_valid_top & is_valid_right, fg),
+        .bottom_left  = gather_texels(bottom_index,
+                                      is_valid_bottom & is_valid_left, fg),
+        .bottom_right = gather_texels(_mm512_add_epi32(bottom_index, ONE),
+                                      is_valid_bottom & is_valid_right, fg),
+
+        .weight_x = _mm512_or_si512(fraction_x,
+                                    _mm512_slli_epi32(fraction_x, 8)),
+        .weight_y = _mm512_or_si512(fraction_y,
+                                    _mm512_slli_epi32(fraction_y, 8))
+    };
+}
+
+// Widen 8 pixels, see get_texel
+__always_inline
+static __m512i premultiply_texels(__m256i pixels)
+{
+    const __m512i MASK_SPREAD_ALPHA = _mm512_set_epi8(
+        MASK_SPREAD_ALPHA16_ROW,
+        MASK_SPREAD_ALPHA16_ROW,
+        MASK_SPREAD_ALPHA16_ROW,
+        MASK_SPREAD_ALPHA16_ROW
+    );
+
+    const __mmask32 IGNORE_ALPHA = _cvtu32_mask32(IGNORE_ALPHA_BITS);
+
+    const __m512i channels = _mm512_cvtepu8_epi16(pixels);
+    const __m512i alpha = _mm512_shuffle_epi8(channels, MASK_SPREAD_ALPHA);
+
+    // Color channels are multiplied by alpha, alpha is scaled by 257
+    return _mm512_mask_blend_epi16(
+                IGNORE_ALPHA,
+                _mm512_or_si512(alpha, _mm512_slli_epi16(alpha, 8)),
+                _mm512_mullo_epi16(channels, alpha));
+}
+
+// Move 8 weights from dwords to every channel of widened pixels
+__always_inline
+static __m512i spread_weights(__m256i weights)
+{
+    const __m512i MASK_SPREAD_ALPHA = _mm512_set_epi8(
+        MASK_SPREAD_ALPHA16_ROW,
+        MASK_SPREAD_ALPHA16_ROW,
+        MASK_SPREAD_ALPHA16_ROW,
+        MASK_SPREAD_ALPHA16_ROW
+    );
+
+    const __m512i highest_word = _mm512_slli_epi64(
+                                    _mm512_cvtepu32_epi64(weights), 48);
+
+    return _mm512_shuffle_epi8(highest_word, MASK_SPREAD_ALPHA);
+}
+
+// See lerp_texels
+__always_inline
+static __m512i lerp_texels_simd(__m512i a, __m512i b, __m512i weight)
+{
+    const __m512i inv_weight = _mm512_ternarylogic_epi32(weight, weight,
+                                                         weight, 0x55);
+
+    return _mm512_add_epi16(_mm512_mulhi_epu16(a, inv_weight),
+                            _mm512_mulhi_epu16(b, weight));
+}
+
+// Interpolate and blend 8 pixels, see blend_bilinear. Weights are spread
+// to every channel.
+static __m256i blend_bilinear_half(__m256i bg,
+                                   __m256i top_left,    __m256i top_right,
+                                   __m256i bottom_left, __m256i bottom_right,
+                                   __m512i weight_x,    __m512i weight_y)
+{
+    const __m512i MASK_SPREAD_ALPHA = _mm512_set_epi8(
+        MASK_SPREAD_ALPHA16_ROW,
+        MASK_SPREAD_ALPHA16_ROW,
+        MASK_SPREAD_ALPHA16_ROW,
+        MASK_SPREAD_ALPHA16_ROW
+    );
+
+    const __mmask32 IGNORE_ALPHA = _cvtu32_mask32(IGNORE_ALPHA_BITS);
+
+    const __m512i top    = lerp_texels_simd(premultiply_texels(top_left),
+                                            premultiply_texels(top_right),
+                                            weight_x);
+    const __m512i bottom = lerp_texels_simd(premultiply_texels(bottom_left),
+                                            premultiply_texels(bottom_right),
+                                            weight_x);
+    const __m512i sample = lerp_texels_simd(top, bottom, weight_y);
+
+    // See blend_sampled_channel
+    const __m512i alpha = _mm512_shuffle_epi8(sample, MASK_SPREAD_ALPHA);
+    const __m512i inv_alpha = _mm512_ternarylogic_epi32(alpha, alpha, alpha,
+                                                        0x55);
+
+    const __m512i bg_channels = _mm512_cvtepu8_epi16(bg);
+
+    __m512i blended = _mm512_add_epi16(
+                        _mm512_mulhi_epu16(_mm512_slli_epi16(bg_channels, 8),
+                                           inv_alpha),
+                        _mm512_add_epi16(
+                            sample,
+                            _mm512_mulhi_epu16(sample,
+                                               _mm512_set1_epi16(257))));
+
+    blended = _mm512_srli_epi16(
+                _mm512_adds_epu16(blended, _mm512_set1_epi16(128)), 8);
+
+    // Background alpha is kept
+    blended = _mm512_mask_blend_epi16(IGNORE_ALPHA, bg_channels, blended);
+
+    return _mm512_cvtepi16_epi8(blended);
+}
+
+static __m512i blend_sampled_simd(__m512i bg, __m512i u, __m512i v,
+                                  const PixelImage* fg)
+{
+    const Texels texels = gather_quads(u, v, fg);
+
+    const __m256i low  = blend_bilinear_half(
+                    _mm512_castsi512_si256(bg),
+                    _mm512_castsi512_si256(texels.top_left),
+                    _mm512_castsi512_si256(texels.top_right),
+                    _mm512_castsi512_si256(texels.bottom_left),
+                    _mm512_castsi512_si256(texels.bottom_right),
+                    spread_weights(_mm512_castsi512_si256(texels.weight_x)),
+                    spread_weights(_mm512_castsi512_si256(texels.weight_y)));
+    const __m256i high = blend_bilinear_half(
+                    _mm512_extracti64x4_epi64(bg, 1),
+                    _mm512_extracti64x4_epi64(texels.top_left, 1),
+                    _mm512_extracti64x4_epi64(texels.top_right, 1),
+                    _mm512_extracti64x4_epi64(texels.bottom_left, 1),
+                    _mm512_extracti64x4_epi64(texels.bottom_right, 1),
+                    spread_weights(_mm512_extracti64x4_epi64(texels.weight_x,
+                                                             1)),
+                    spread_weights(_mm512_extracti64x4_epi64(texels.weight_y,
+                                                             1)));
+
+    return _mm512_inserti64x4(_mm512_castsi256_si512(low), high, 1);
+}
+
+void transform_row_avx512(Pixel* bg, size_t count, const SourceWalk* walk,
+                          const PixelImage* fg)
+{
+    const size_t pixels_per_vector = sizeof(__m512i) / sizeof(Pixel);
+
+    const __m512i lanes = _mm512_setr_epi32(0, 1, 2,  3,  4,  5,  6,  7,
+                                            8, 9, 10, 11, 12, 13, 14, 15);
+
+    // Positions beyond the row may not fit 32 bits, so they wrap
+    __m512i u = _mm512_add_epi32(
+                    _mm512_set1_epi32(walk->u),
+                    _mm512_mullo_epi32(lanes, _mm512_set1_epi32(walk->du)));
+    __m512i v = _mm512_add_epi32(
+                    _mm512_set1_epi32(walk->v),
+                    _mm512_mullo_epi32(lanes, _mm512_set1_epi32(walk->dv)));
+
+    const __m512i step_u = _mm512_slli_epi32(_mm512_set1_epi32(walk->du), 4);
+    const __m512i step_v = _mm512_slli_epi32(_mm512_set1_epi32(walk->dv), 4);
+
+    size_t x = 0;
+    for (; x + pixels_per_vector <= count; x += pixels_per_vector)
+    {
+        __m512i bg_pixels = _mm512_loadu_si512(bg + x);
+        __m512i result = blend_sampled_simd(bg_pixels, u, v, fg);
+        _mm512_storeu_si512(bg + x, result);
+
+        u = _mm512_add_epi32(u, step_u);
+        v = _mm512_add_epi32(v, step_v);
+    }
+
+    // Remaining pixels
+    if (x < count)
+    {
+        const __mmask16 mask = _cvtu32_mask16((1u << (count - x)) - 1);
+
+        __m512i bg_pixels = _mm512_maskz_loadu_epi32(mask, bg + x);
+        __m512i result = blend_sampled_simd(bg_pixels, u, v, fg);
+        _mm512_mask_storeu_epi32(bg + x, mask, result);
+    }
+}
+
+// Neighbouring foreground pixels are loaded with overlapping loads
+static __m512i blend_subpixel_simd(__m512i bg, const Pixel* top,
+                                   const Pixel* bottom, __mmask16 mask,
+                                   __m512i weight_x, __m512i weight_y)
+{
+    const __m512i top_left     = _mm512_maskz_loadu_epi32(mask, top);
+    const __m512i top_right    = _mm512_maskz_loadu_epi32(mask, top + 1);
+    const __m512i bottom_left  = _mm512_maskz_loadu_epi32(mask, bottom);
+    const __m512i bottom_right = _mm512_maskz_loadu_epi32(mask, bottom + 1);
+
+    const __m256i low  = blend_bilinear_half(
+                            _mm512_castsi512_si256(bg),
+                            _mm512_castsi512_si256(top_left),
+                            _mm512_castsi512_si256(top_right),
+                            _mm512_castsi512_si256(bottom_left),
+                            _mm512_castsi512_si256(bottom_right),
+                            weight_x, weight_y);
+    const __m256i high = blend_bilinear_half(
+                            _mm512_extracti64x4_epi64(bg, 1),
+                            _mm512_extracti64x4_epi64(top_left, 1),
+                            _mm512_extracti64x4_epi64(top_right, 1),
+                            _mm512_extracti64x4_epi64(bottom_left, 1),
+                            _mm512_extracti64x4_epi64(bottom_right, 1),
+                            weight_x, weight_y);
+
+    return _mm512_inserti64x4(_mm512_castsi256_si512(low), high, 1);
+}
+
+void subpixel_row_avx512(Pixel* bg, const Pixel* top, const Pixel* bottom,
+                         size_t count, uint16_t weight_x, uint16_t weight_y)
+{
+    const size_t pixels_per_vector = sizeof(__m512i) / sizeof(Pixel);
+    const __mmask16 ALL_PIXELS = _cvtu32_mask16(0xFFFF);
+
+    const __m512i spread_x = _mm512_set1_epi16((short) weight_x);
+    const __m512i spread_y = _mm512_set1_epi16((short) weight_y);
+
+    size_t x = 0;
+    for (; x + pixels_per_vector <= count; x += pixels_per_vector)
+    {
+        __m512i bg_pixels = _mm512_loadu_si512(bg + x);
+        __m512i result = blend_subpixel_simd(bg_pixels, top + x, bottom + x,
+                                             ALL_PIXELS, spread_x, spread_y);
+        _mm512_storeu_si512(bg + x, result);
+    }
+
+    // Remaining pixels
+    if (x < count)
+    {
+        const __mmask16 mask = _cvtu32_mask16((1u << (count - x)) - 1);
+
+        __m512i bg_pixels = _mm512_maskz_loadu_epi32(mask, bg + x);
+        __m512i result = blend_subpixel_simd(bg_pixels, top + x, bottom + x,
+                                             mask, spread_x, spread_y);
+        _mm512_mask_storeu_epi32(bg + x, mask, result);
+    }
+}
@@ -0,0 +1,199 @@
+/**
+ * @file transform_rows.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Transformed blending kernels, built for several instruction
+ * set levels
+ *
+ * @version 0.1
+ * @date 2023-05-09
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __TRANSFORM_ROWS_H
+#define __TRANSFORM_ROWS_H
+
+#include <stdint.h>
+
+#include "commons/definitions.h"
+
+#define SAMPLE_COORD_SHIFT  16
+#define SAMPLE_WEIGHT_SHIFT (SAMPLE_COORD_SHIFT - 8)
+
+/**
+ * @brief Source position of the first pixel in row and its increment
+ * between neighbouring pixels. Coordinates are 16.16 fixed-point, shifted
+ * by half a pixel, so that integer part is the upper left sampled pixel.
+ */
+struct SourceWalk
+{
+    int32_t u;
+    int32_t v;
+
+    int32_t du;
+    int32_t dv;
+};
+
+/**
+ * @brief Blend transformed foreground over a background row
+ *
+ * @param[inout] bg	    - Background row
+ * @param[in]    count	- Number of pixels in row
+ * @param[in]    walk	- Sampled positions
+ * @param[in]    fg	    - Foreground image
+ */
+typedef void transform_row_t(Pixel* bg, size_t count, const SourceWalk* walk,
+                             const PixelImage* fg);
+
+/**
+ * @brief Blend foreground rows, shifted by a fraction of pixel, over
+ * a background row. Background pixel `i` is interpolated between pixels
+ * `i` and `i + 1` of both foreground rows, all of which have to exist.
+ *
+ * @param[inout] bg	        - Background row
+ * @param[in]    top	    - Upper foreground row
+ * @param[in]    bottom	    - Lower foreground row
+ * @param[in]    count	    - Number of pixels in background row
+ * @param[in]    weight_x	- 16-bit weight of right pixels
+ * @param[in]    weight_y	- 16-bit weight of lower row
+ */
+typedef void subpixel_row_t(Pixel* bg, const Pixel* top, const Pixel* bottom,
+                            size_t count,
+                            uint16_t weight_x, uint16_t weight_y);
+
+// Sampling needs gathers, SSE4.1 level uses scalar kernel
+transform_row_t transform_row_scalar;
+transform_row_t transform_row_avx2;
+transform_row_t transform_row_avx512;
+
+subpixel_row_t subpixel_row_scalar;
+subpixel_row_t subpixel_row_sse4;
+subpixel_row_t subpixel_row_avx2;
+subpixel_row_t subpixel_row_avx512;
+
+__always_inline
+static uint16_t mulhi16(uint16_t a, uint16_t b)
+{
+    return (uint16_t) ((uint32_t) a * b >> 16);
+}
+
+/**
+ * @brief Get pixel with color channels premultiplied by alpha and 16-bit
+ * alpha
+ */
+__always_inline
+static Pixel16 premultiply_texel(Pixel pixel)
+{
+    return {
+        .red   = (uint16_t) (pixel.red   * pixel.alpha),
+        .green = (uint16_t) (pixel.green * pixel.alpha),
+        .blue  = (uint16_t) (pixel.blue  * pixel.alpha),
+        .alpha = (uint16_t) (pixel.alpha * 257)
+    };
+}
+
+/**
+ * @brief Get premultiplied foreground pixel. Pixels outside of foreground
+ * are transparent.
+ */
+__always_inline
+static Pixel16 get_texel(const PixelImage* fg, int32_t x, int32_t y)
+{
+    if ((uint32_t) x >= fg->size.x || (uint32_t) y >= fg->size.y)
+        return {};
+
+    return premultiply_texel(fg->pixel_array[(size_t) y * fg->size.x
+                                             + (size_t) x]);
+}
+
+/**
+ * @brief `a*(65535 - weight) + b*weight`, scaled down by 65536
+ */
+__always_inline
+static Pixel16 lerp_texels(Pixel16 a, Pixel16 b, uint16_t weight)
+{
+    const uint16_t inv_weight = (uint16_t) ~weight;
+
+    return {
+        .red   = (uint16_t) (mulhi16(a.red,   inv_weight)
+                           + mulhi16(b.red,   weight)),
+        .green = (uint16_t) (mulhi16(a.green, inv_weight)
+                           + mulhi16(b.green, weight)),
+        .blue  = (uint16_t) (mulhi16(a.blue,  inv_weight)
+                           + mulhi16(b.blue,  weight)),
+        .alpha = (uint16_t) (mulhi16(a.alpha, inv_weight)
+                           + mulhi16(b.alpha, weight))
+    };
+}
+
+/**
+ * @brief Blend a channel in 8.8 fixed point: `bg*(1 - alpha) + sample/255`,
+ * where sample is premultiplied by 8-bit alpha, and round the result.
+ */
+__always_inline
+static uint8_t blend_sampled_channel(uint8_t bg, uint16_t sample,
+                                     uint16_t alpha)
+{
+    const uint32_t blended = (uint32_t) mulhi16((uint16_t) (bg << 8),
+                                                (uint16_t) ~alpha)
+                           + sample + mulhi16(sample, 257)
+                           + 128;
+
+    return (uint8_t) ((blended < UINT16_MAX ? blended : UINT16_MAX) >> 8);
+}
+
+/**
+ * @brief Interpolate four premultiplied pixels and blend the result over
+ * background pixel
+ */
+__always_inline
+static void blend_bilinear(Pixel* bg,
+                           Pixel16 top_left,    Pixel16 top_right,
+                           Pixel16 bottom_left, Pixel16 bottom_right,
+                           uint16_t weight_x,   uint16_t weight_y)
+{
+    const Pixel16 top    = lerp_texels(top_left,    top_right,    weight_x);
+    const Pixel16 bottom = lerp_texels(bottom_left, bottom_right, weight_x);
+    const Pixel16 sample = lerp_texels(top, bottom, weight_y);
+
+    bg->red   = blend_sampled_channel(bg->red,   sample.red,   sample.alpha);
+    bg->green = blend_sampled_channel(bg->green, sample.green, sample.alpha);
+    bg->blue  = blend_sampled_channel(bg->blue,  sample.blue,  sample.alpha);
+}
+
+/**
+ * @brief Sample foreground between pixel (x, y) and its lower right
+ * neighbour with 16-bit weights and blend it over background pixel
+ */
+__always_inline
+static void blend_sampled_at(Pixel* bg, const PixelImage* fg,
+                             int32_t x, int32_t y,
+                             uint16_t weight_x, uint16_t weight_y)
+{
+    blend_bilinear(bg,
+                   get_texel(fg, x,     y),
+                   get_texel(fg, x + 1, y),
+                   get_texel(fg, x,     y + 1),
+                   get_texel(fg, x + 1, y + 1),
+                   weight_x, weight_y);
+}
+
+/**
+ * @brief Sample foreground at 16.16 position and blend it over background
+ * pixel. Vector kernels produce the same results.
+ */
+__always_inline
+static void blend_sampled(Pixel* bg, const PixelImage* fg,
+                          int32_t u, int32_t v)
+{
+    // 8-bit fractions, scaled to 16 bits
+    const uint16_t weight_x = (uint16_t) (((u >> SAMPLE_WEIGHT_SHIFT) & 0xFF)
+                                          * 257);
+    const uint16_t weight_y = (uint16_t) (((v >> SAMPLE_WEIGHT_SHIFT) & 0xFF)
+                                          * 257);
+
+    blend_sampled_at(bg, fg, u >> SAMPLE_COORD_SHIFT, v >> SAMPLE_COORD_SHIFT,
+                     weight_x, weight_y);
+}
+
+#endif /* transform_rows.h */
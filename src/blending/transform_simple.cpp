@@ -0,0 +1,29 @@
+#include "transform_rows.h"
+
+void transform_row_scalar(Pixel* bg, size_t count, const SourceWalk* walk,
+                          const PixelImage* fg)
+{
+    // Positions beyond the row may not fit 32 bits, so they wrap
+    uint32_t u = (uint32_t) walk->u;
+    uint32_t v = (uint32_t) walk->v;
+
+    for (size_t x = 0; x < count; ++x)
+    {
+        blend_sampled(bg + x, fg, (int32_t) u, (int32_t) v);
+
+        u += (uint32_t) walk->du;
+        v += (uint32_t) walk->dv;
+    }
+}
+
+void subpixel_row_scalar(Pixel* bg, const Pixel* top, const Pixel* bottom,
+                         size_t count, uint16_t weight_x, uint16_t weight_y)
+{
+    for (size_t x = 0; x < count; ++x)
+        blend_bilinear(bg + x,
+                       premultiply_texel(top[x]),
+                       premultiply_texel(top[x + 1]),
+                       premultiply_texel(bottom[x]),
+                       premultiply_texel(bottom[x + 1]),
+                       weight_x, weight_y);
+}
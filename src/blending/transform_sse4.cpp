@@ -0,0 +1,112 @@
+#include "commons/intrinsics.h"
+
+#include "transform_rows.h"
+#include "shuffle_masks.h"
+
+// Widen 2 pixels, see premultiply_texel
+__always_inline
+static __m128i premultiply_texels(__m128i pixels)
+{
+    const __m128i MASK_SPREAD_ALPHA = _mm_set_epi8(MASK_SPREAD_ALPHA16_ROW);
+
+    const __m128i channels = _mm_cvtepu8_epi16(pixels);
+    const __m128i alpha = _mm_shuffle_epi8(channels, MASK_SPREAD_ALPHA);
+
+    // Color channels are multiplied by alpha, alpha is scaled by 257
+    return _mm_blend_epi16(_mm_or_si128(alpha, _mm_slli_epi16(alpha, 8)),
+                           _mm_mullo_epi16(channels, alpha),
+                           IGNORE_ALPHA_BLEND);
+}
+
+// See lerp_texels
+__always_inline
+static __m128i lerp_texels_simd(__m128i a, __m128i b, __m128i weight)
+{
+    const __m128i inv_weight = _mm_xor_si128(weight, _mm_set1_epi16(-1));
+
+    return _mm_add_epi16(_mm_mulhi_epu16(a, inv_weight),
+                         _mm_mulhi_epu16(b, weight));
+}
+
+// Interpolate and blend 2 pixels in lower halves of vectors,
+// see blend_bilinear
+__always_inline
+static __m128i blend_bilinear_half(__m128i bg,
+                                   __m128i top_left,    __m128i top_right,
+                                   __m128i bottom_left, __m128i bottom_right,
+                                   __m128i weight_x,    __m128i weight_y)
+{
+    const __m128i MASK_SPREAD_ALPHA = _mm_set_epi8(MASK_SPREAD_ALPHA16_ROW);
+
+    const __m128i top    = lerp_texels_simd(premultiply_texels(top_left),
+                                            premultiply_texels(top_right),
+                                            weight_x);
+    const __m128i bottom = lerp_texels_simd(premultiply_texels(bottom_left),
+                                            premultiply_texels(bottom_right),
+                                            weight_x);
+    const __m128i sample = lerp_texels_simd(top, bottom, weight_y);
+
+    // See blend_sampled_channel
+    const __m128i alpha = _mm_shuffle_epi8(sample, MASK_SPREAD_ALPHA);
+    const __m128i inv_alpha = _mm_xor_si128(alpha, _mm_set1_epi16(-1));
+
+    const __m128i bg_channels = _mm_cvtepu8_epi16(bg);
+
+    __m128i blended = _mm_add_epi16(
+                        _mm_mulhi_epu16(_mm_slli_epi16(bg_channels, 8),
+                                        inv_alpha),
+                        _mm_add_epi16(
+                            sample,
+                            _mm_mulhi_epu16(sample, _mm_set1_epi16(257))));
+
+    blended = _mm_srli_epi16(_mm_adds_epu16(blended, _mm_set1_epi16(128)), 8);
+
+    // Background alpha is kept
+    return _mm_blend_epi16(bg_channels, blended, IGNORE_ALPHA_BLEND);
+}
+
+// Neighbouring foreground pixels are loaded with overlapping loads
+static __m128i blend_subpixel_simd(__m128i bg, const Pixel* top,
+                                   const Pixel* bottom,
+                                   __m128i weight_x, __m128i weight_y)
+{
+    const __m128i top_left     = _mm_loadu_si128((const __m128i*) top);
+    const __m128i top_right    = _mm_loadu_si128((const __m128i*)(top + 1));
+    const __m128i bottom_left  = _mm_loadu_si128((const __m128i*) bottom);
+    const __m128i bottom_right = _mm_loadu_si128((const __m128i*)(bottom + 1));
+
+    const __m128i low  = blend_bilinear_half(bg,
+                                             top_left,    top_right,
+                                             bottom_left, bottom_right,
+                                             weight_x,    weight_y);
+    const __m128i high = blend_bilinear_half(_mm_srli_si128(bg, 8),
+                                             _mm_srli_si128(top_left,     8),
+                                             _mm_srli_si128(top_right,    8),
+                                             _mm_srli_si128(bottom_left,  8),
+                                             _mm_srli_si128(bottom_right, 8),
+                                             weight_x, weight_y);
+
+    return _mm_packus_epi16(low, high);
+}
+
+void subpixel_row_sse4(Pixel* bg, const Pixel* top, const Pixel* bottom,
+                       size_t count, uint16_t weight_x, uint16_t weight_y)
+{
+    const size_t pixels_per_vector = sizeof(__m128i) / sizeof(Pixel);
+
+    const __m128i spread_x = _mm_set1_epi16((short) weight_x);
+    const __m128i spread_y = _mm_set1_epi16((short) weight_y);
+
+    size_t x = 0;
+    for (; x + pixels_per_vector <= count; x += pixels_per_vector)
+    {
+        __m128i bg_pixels = _mm_loadu_si128((const __m128i*)(bg + x));
+        __m128i result = blend_subpixel_simd(bg_pixels, top + x, bottom + x,
+                                             spread_x, spread_y);
+        _mm_storeu_si128((__m128i*)(bg + x), result);
+    }
+
+    // Remaining pixels
+    subpixel_row_scalar(bg + x, top + x, bottom + x, count - x,
+                        weight_x, weight_y);
+}
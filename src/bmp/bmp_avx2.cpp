@@ -0,0 +1,64 @@
+#include "commons/intrinsics.h"
+
+#include "blending/shuffle_masks.h"
+
+#include "bmp_rows.h"
+
+uint32_t convert_bmp_row_avx2(Pixel* dst, const uint8_t* src, size_t count,
+                              const BmpSwizzle* swizzle)
+{
+    const __m256i shuffle = _mm256_broadcastsi128_si256(
+                                _mm_loadu_si128(
+                                    (const __m128i*) swizzle->shuffle));
+    const __m256i fill    = _mm256_set1_epi32((int) swizzle->fill);
+
+    __m256i combined = _mm256_setzero_si256();
+
+    size_t x = 0;
+    for (; x + 8 <= count; x += 8)
+    {
+        __m256i pixels = _mm256_loadu_si256((const __m256i*) (src + 4*x));
+        pixels = _mm256_or_si256(_mm256_shuffle_epi8(pixels, shuffle), fill);
+        _mm256_storeu_si256((__m256i*) (dst + x), pixels);
+
+        combined = _mm256_or_si256(combined, pixels);
+    }
+
+    __m128i reduced = _mm_or_si128(_mm256_castsi256_si128(combined),
+                                   _mm256_extracti128_si256(combined, 1));
+    reduced = _mm_or_si128(reduced, _mm_srli_si128(reduced, 8));
+    reduced = _mm_or_si128(reduced, _mm_srli_si128(reduced, 4));
+
+    return (uint32_t) _mm_cvtsi128_si32(reduced)
+         | convert_bmp_row_scalar(dst + x, src + 4*x, count - x, swizzle);
+}
+
+void convert_bmp_rgb_row_avx2(Pixel* dst, const uint8_t* src, size_t count)
+{
+    // Bytes are shuffled only inside 128-bit lanes, so the second
+    // 12 bytes are moved to the upper lane first
+    const __m256i spread  = _mm256_setr_epi32(0, 1, 2, 0, 3, 4, 5, 0);
+    const __m256i shuffle = _mm256_setr_epi8(
+                                 2,  1,  0, MASK_ZERO,
+                                 5,  4,  3, MASK_ZERO,
+                                 8,  7,  6, MASK_ZERO,
+                                11, 10,  9, MASK_ZERO,
+                                 2,  1,  0, MASK_ZERO,
+                                 5,  4,  3, MASK_ZERO,
+                                 8,  7,  6, MASK_ZERO,
+                                11, 10,  9, MASK_ZERO);
+    const __m256i opaque  = _mm256_set1_epi32((int) 0xFF000000);
+
+    // 8 pixels take 24 bytes, but 32 are loaded
+    size_t x = 0;
+    for (; x + 11 <= count; x += 8)
+    {
+        __m256i pixels = _mm256_loadu_si256((const __m256i*) (src + 3*x));
+        pixels = _mm256_permutevar8x32_epi32(pixels, spread);
+        pixels = _mm256_or_si256(_mm256_shuffle_epi8(pixels, shuffle),
+                                 opaque);
+        _mm256_storeu_si256((__m256i*) (dst + x), pixels);
+    }
+
+    convert_bmp_rgb_row_scalar(dst + x, src + 3*x, count - x);
+}
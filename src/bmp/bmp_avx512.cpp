@@ -0,0 +1,82 @@
+#include "commons/intrinsics.h"
+
+#include "blending/shuffle_masks.h"
+
+#include "bmp_rows.h"
+
+uint32_t convert_bmp_row_avx512(Pixel* dst, const uint8_t* src, size_t count,
+                                const BmpSwizzle* swizzle)
+{
+    const __m512i shuffle = _mm512_broadcast_i32x4(
+                                _mm_loadu_si128(
+                                    (const __m128i*) swizzle->shuffle));
+    const __m512i fill    = _mm512_set1_epi32((int) swizzle->fill);
+
+    __m512i combined = _mm512_setzero_si512();
+
+    size_t x = 0;
+    for (; x + 16 <= count; x += 16)
+    {
+        __m512i pixels = _mm512_loadu_si512(src + 4*x);
+        pixels = _mm512_or_si512(_mm512_shuffle_epi8(pixels, shuffle), fill);
+        _mm512_storeu_si512(dst + x, pixels);
+
+        combined = _mm512_or_si512(combined, pixels);
+    }
+
+    if (x < count)
+    {
+        const __mmask16 mask = _cvtu32_mask16((1u << (count - x)) - 1);
+
+        __m512i pixels = _mm512_maskz_loadu_epi32(mask, src + 4*x);
+        pixels = _mm512_or_si512(_mm512_shuffle_epi8(pixels, shuffle), fill);
+        _mm512_mask_storeu_epi32(dst + x, mask, pixels);
+
+        combined = _mm512_mask_or_epi32(combined, mask, combined, pixels);
+    }
+
+    return (uint32_t) _mm512_reduce_or_epi32(combined);
+}
+
+void convert_bmp_rgb_row_avx512(Pixel* dst, const uint8_t* src, size_t count)
+{
+    // Bytes are shuffled only inside 128-bit lanes, so every 12 bytes
+    // are moved to their own lane first
+    const __m512i spread  = _mm512_setr_epi32(0, 1,  2, 0,  3,  4,  5, 0,
+                                              6, 7,  8, 0,  9, 10, 11, 0);
+    const __m512i shuffle = _mm512_broadcast_i32x4(
+                                _mm_setr_epi8( 2,  1,  0, MASK_ZERO,
+                                               5,  4,  3, MASK_ZERO,
+                                               8,  7,  6, MASK_ZERO,
+                                              11, 10,  9, MASK_ZERO));
+    const __m512i opaque  = _mm512_set1_epi32((int) 0xFF000000);
+
+    // Exactly 48 bytes of 16 pixels are loaded
+    const __mmask16 load_mask = _cvtu32_mask16(0x0FFF);
+
+    size_t x = 0;
+    for (; x + 16 <= count; x += 16)
+    {
+        __m512i pixels = _mm512_maskz_loadu_epi32(load_mask, src + 3*x);
+        pixels = _mm512_permutexvar_epi32(spread, pixels);
+        pixels = _mm512_or_si512(_mm512_shuffle_epi8(pixels, shuffle),
+                                 opaque);
+        _mm512_storeu_si512(dst + x, pixels);
+    }
+
+    if (x < count)
+    {
+        const size_t tail = count - x;
+
+        // Byte mask, so that nothing past the last pixel is touched
+        const __mmask64 byte_mask  = _cvtu64_mask64(
+                                        (1ull << (3 * tail)) - 1);
+        const __mmask16 pixel_mask = _cvtu32_mask16((1u << tail) - 1);
+
+        __m512i pixels = _mm512_maskz_loadu_epi8(byte_mask, src + 3*x);
+        pixels = _mm512_permutexvar_epi32(spread, pixels);
+        pixels = _mm512_or_si512(_mm512_shuffle_epi8(pixels, shuffle),
+                                 opaque);
+        _mm512_mask_storeu_epi32(dst + x, pixel_mask, pixels);
+    }
+}
@@ -0,0 +1,428 @@
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "meerkat_assert/asserts.h"
+#include "commons/cpu_features.h"
+
+#include "bmp_loader.h"
+#include "bmp_rows.h"
+
+#define BMP_FILE_HEADER_SIZE 14
+#define BMP_INFO_HEADER_SIZE 40
+#define BMP_MASKS_OFFSET     54     // Inside or right after info header
+
+/**
+ * @brief Converted rows of mapped file are released in chunks of about
+ * this size, so that file and image are not held in memory together
+ */
+#define BMP_RELEASE_SIZE     (1 << 20)
+
+enum BmpCompression
+{
+    BMP_COMPRESSION_RGB            = 0,
+    BMP_COMPRESSION_BITFIELDS      = 3,
+    BMP_COMPRESSION_ALPHABITFIELDS = 6
+};
+
+struct BmpHeader
+{
+    size_t   pixel_offset;
+    size_t   row_stride;
+    SizeVector2 size;
+
+    bool     is_top_down;
+    unsigned bits_per_pixel;
+    uint32_t masks[4];      // Red, green, blue and alpha. Zero if missing
+};
+
+// Indexed by SimdLevel
+static bmp_row_t* const BMP_ROW_KERNELS[SIMD_LEVEL_COUNT] = {
+    convert_bmp_row_scalar,
+    convert_bmp_row_sse4,
+    convert_bmp_row_avx2,
+    convert_bmp_row_avx512
+};
+
+// Indexed by SimdLevel
+static bmp_rgb_row_t* const BMP_RGB_ROW_KERNELS[SIMD_LEVEL_COUNT] = {
+    convert_bmp_rgb_row_scalar,
+    convert_bmp_rgb_row_sse4,
+    convert_bmp_rgb_row_avx2,
+    convert_bmp_rgb_row_avx512
+};
+
+static int  parse_header  (BmpHeader* header, const uint8_t* data,
+                           size_t data_size);
+static int  get_swizzle   (BmpSwizzle* swizzle, const uint32_t masks[4]);
+static bool is_rgba_layout(const BmpHeader* header);
+static int  convert_pixels(PixelImage* image, uint8_t* data,
+                           const BmpHeader* header, PixelPool* pool);
+static void release_pages (uint8_t* begin, size_t size);
+
+__always_inline
+static uint32_t read_u32(const uint8_t* bytes)
+{
+    uint32_t value = 0;
+    memcpy(&value, bytes, sizeof(value));
+    return value;
+}
+
+__always_inline
+static uint16_t read_u16(const uint8_t* bytes)
+{
+    uint16_t value = 0;
+    memcpy(&value, bytes, sizeof(value));
+    return value;
+}
+
+int load_bmp_file(ImageFile* file, const char* filename, PixelPool* pool)
+{
+    SAFE_BLOCK_START    // Validate parameters
+    {
+        ASSERT_TRUE_MESSAGE(file     != NULL, "file");
+        ASSERT_TRUE_MESSAGE(filename != NULL, "filename");
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    file->image        = {};
+    file->mapping      = NULL;
+    file->mapping_size = 0;
+    file->pool         = pool;
+
+    const int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+        return -1;
+
+    void*  mapping      = MAP_FAILED;
+    size_t mapping_size = 0;
+
+    SAFE_BLOCK_START    // Map file
+    {
+        struct stat file_stat = {};
+        ASSERT_ZERO(
+                fstat(fd, &file_stat));
+
+        mapping_size = (size_t) file_stat.st_size;
+        ASSERT_TRUE_CALLBACK(
+                mapping_size >= BMP_FILE_HEADER_SIZE + BMP_INFO_HEADER_SIZE,
+                errno = ENOTSUP);
+
+        // Private mapping: view pixels can be modified in memory only
+        mapping = mmap(NULL, mapping_size, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE, fd, 0);
+        ASSERT_TRUE(mapping != MAP_FAILED);
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        close(fd);
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    close(fd);
+
+    uint8_t*  data   = (uint8_t*) mapping;
+    BmpHeader header = {};
+
+    SAFE_BLOCK_START    // Read pixels
+    {
+        ASSERT_ZERO_CALLBACK(
+                parse_header(&header, data, mapping_size),
+                errno = ENOTSUP);
+
+        if (is_rgba_layout(&header))
+        {
+            file->image.size        = header.size;
+            file->image.pixel_array = (Pixel*) ((uint8_t*) mapping
+                                                + header.pixel_offset);
+            file->mapping           = mapping;
+            file->mapping_size      = mapping_size;
+
+            return 0;
+        }
+
+        // Pixels are read once, in order
+        madvise(mapping, mapping_size, MADV_SEQUENTIAL);
+
+        ASSERT_ZERO(
+                convert_pixels(&file->image, data, &header, pool));
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        const int saved_errno = errno;
+        munmap(mapping, mapping_size);
+        errno = saved_errno;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    munmap(mapping, mapping_size);
+
+    return 0;
+}
+
+void unload_image_file(ImageFile* file)
+{
+    SAFE_BLOCK_START
+    {
+        ASSERT_TRUE_MESSAGE(file != NULL, "file");
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        return;
+    }
+    SAFE_BLOCK_END
+
+    if (file->mapping)
+        munmap(file->mapping, file->mapping_size);
+    else
+        pixel_pool_release(file->pool, &file->image);
+
+    file->image        = {};
+    file->mapping      = NULL;
+    file->mapping_size = 0;
+    file->pool         = NULL;
+}
+
+static int parse_header(BmpHeader* header, const uint8_t* data,
+                        size_t data_size)
+{
+    const uint32_t info_size   = read_u32(data + 14);
+    const int32_t  width       = (int32_t) read_u32(data + 18);
+    const int32_t  height      = (int32_t) read_u32(data + 22);
+    const uint16_t planes      = read_u16(data + 26);
+    const uint16_t bit_count   = read_u16(data + 28);
+    const uint32_t compression = read_u32(data + 30);
+
+    header->pixel_offset   = read_u32(data + 10);
+    header->bits_per_pixel = bit_count;
+    header->is_top_down    = height < 0;
+
+    SAFE_BLOCK_START
+    {
+        ASSERT_TRUE(data[0] == 'B' && data[1] == 'M');
+        ASSERT_GREATER_EQUAL(info_size, BMP_INFO_HEADER_SIZE);
+        ASSERT_EQUAL(planes, 1);
+
+        ASSERT_POSITIVE(width);
+        ASSERT_TRUE(height != 0 && height != INT32_MIN);
+
+        ASSERT_TRUE(bit_count == 24 || bit_count == 32);
+        ASSERT_TRUE(bit_count == 32 || compression == BMP_COMPRESSION_RGB);
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    header->size.x = (size_t) width;
+    header->size.y = (size_t) (height < 0 ? -height : height);
+
+    // Rows are padded to 4 bytes
+    header->row_stride = (header->size.x * bit_count / 8 + 3) & ~(size_t) 3;
+
+    const bool has_alpha_mask =
+                info_size >= BMP_INFO_HEADER_SIZE + 16 ||
+                compression == BMP_COMPRESSION_ALPHABITFIELDS;
+
+    switch (compression)
+    {
+        case BMP_COMPRESSION_RGB:
+            // Stored as BGRA. Alpha is not required to be valid, but in
+            // practice it is, see `convert_pixels`
+            header->masks[0] = 0x00FF0000;
+            header->masks[1] = 0x0000FF00;
+            header->masks[2] = 0x000000FF;
+            header->masks[3] = bit_count == 32 ? 0xFF000000 : 0;
+            break;
+
+        case BMP_COMPRESSION_BITFIELDS:
+        case BMP_COMPRESSION_ALPHABITFIELDS:
+            if (BMP_MASKS_OFFSET + 16 > data_size)
+                return -1;
+
+            for (size_t i = 0; i < 3; ++i)
+                header->masks[i] = read_u32(data + BMP_MASKS_OFFSET + 4*i);
+
+            header->masks[3] = has_alpha_mask
+                             ? read_u32(data + BMP_MASKS_OFFSET + 12)
+                             : 0;
+            break;
+
+        default:
+            return -1;
+    }
+
+    SAFE_BLOCK_START    // Check that all rows are present
+    {
+        ASSERT_LESS_EQUAL(header->pixel_offset, data_size);
+        ASSERT_LESS_EQUAL(
+                header->size.y,
+                (data_size - header->pixel_offset) / header->row_stride);
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    return 0;
+}
+
+static int get_swizzle(BmpSwizzle* swizzle, const uint32_t masks[4])
+{
+    for (size_t c = 0; c < 4; ++c)
+    {
+        // Only byte-sized channels are supported
+        uint8_t channel_byte = BMP_ZERO_BYTE;
+        for (uint8_t byte = 0; byte < 4; ++byte)
+        {
+            if (masks[c] == 0xFFu << 8*byte)
+                channel_byte = byte;
+        }
+
+        if (masks[c] != 0 && channel_byte == BMP_ZERO_BYTE)
+            return -1;
+
+        for (uint8_t pixel = 0; pixel < 4; ++pixel)
+        {
+            swizzle->shuffle[4*pixel + c] =
+                channel_byte == BMP_ZERO_BYTE
+                    ? BMP_ZERO_BYTE
+                    : (uint8_t) (4*pixel + channel_byte);
+        }
+    }
+
+    swizzle->fill = masks[3] ? 0 : 0xFF000000;
+
+    return 0;
+}
+
+/*
+ * `PixelImage` rows are not padded and go from top to bottom, so
+ * pixels can be used in place only if file stores them the same way.
+ * Kernels expect pixels to be at least 4-byte aligned.
+ */
+static bool is_rgba_layout(const BmpHeader* header)
+{
+    return header->bits_per_pixel == 32
+        && header->is_top_down
+        && header->pixel_offset % 4 == 0
+        && header->masks[0] == 0x000000FF
+        && header->masks[1] == 0x0000FF00
+        && header->masks[2] == 0x00FF0000
+        && header->masks[3] == 0xFF000000;
+}
+
+static int convert_pixels(PixelImage* image, uint8_t* data,
+                          const BmpHeader* header, PixelPool* pool)
+{
+    const size_t size_x = header->size.x;
+    const size_t size_y = header->size.y;
+
+    BmpSwizzle swizzle = {};
+
+    SAFE_BLOCK_START
+    {
+        ASSERT_ZERO_CALLBACK(
+                header->bits_per_pixel == 32
+                    ? get_swizzle(&swizzle, header->masks)
+                    : 0,
+                errno = ENOTSUP);
+
+        ASSERT_ZERO_MESSAGE(
+                pixel_pool_acquire(pool, image, header->size),
+                "Failed to allocate memory");
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        image->pixel_array = NULL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    const SimdLevel level = get_simd_level();
+    uint8_t*        pixels = data + header->pixel_offset;
+
+    const size_t stride     = header->row_stride;
+    const size_t chunk_rows = stride < BMP_RELEASE_SIZE
+                            ? BMP_RELEASE_SIZE / stride
+                            : 1;
+
+    uint32_t combined = 0;
+
+    for (size_t begin_y = 0; begin_y < size_y; begin_y += chunk_rows)
+    {
+        const size_t end_y = begin_y + chunk_rows < size_y
+                           ? begin_y + chunk_rows
+                           : size_y;
+
+        // Rows are flipped during the same pass
+        for (size_t y = begin_y; y < end_y; ++y)
+        {
+            const size_t src_y = header->is_top_down ? y : size_y - 1 - y;
+            const uint8_t* src_row = pixels + src_y * stride;
+            Pixel*         dst_row = image->pixel_array + y * size_x;
+
+            if (header->bits_per_pixel == 32)
+                combined |= BMP_ROW_KERNELS[level](dst_row, src_row, size_x,
+                                                   &swizzle);
+            else
+                BMP_RGB_ROW_KERNELS[level](dst_row, src_row, size_x);
+        }
+
+        // Converted rows will not be read again
+        const size_t src_begin_y = header->is_top_down ? begin_y
+                                                       : size_y - end_y;
+        release_pages(pixels + src_begin_y * stride,
+                      (end_y - begin_y) * stride);
+    }
+
+    // Some encoders leave alpha byte zeroed. Such images are opaque,
+    // as when loaded through SFML
+    if (header->bits_per_pixel == 32 && (combined >> 24) == 0)
+    {
+        for (size_t i = 0; i < size_x * size_y; ++i)
+            image->pixel_array[i].alpha = 255;
+    }
+
+    return 0;
+}
+
+/*
+ * Pages of private mapping, which were never written, are simply dropped
+ * and would be read from file again if accessed.
+ */
+static void release_pages(uint8_t* begin, size_t size)
+{
+    const long page_size_value = sysconf(_SC_PAGESIZE);
+    if (page_size_value <= 0)
+        return;
+
+    const uintptr_t page_size = (uintptr_t) page_size_value;
+
+    // Only pages lying entirely inside range are released
+    const uintptr_t first = ((uintptr_t) begin + page_size - 1)
+                          & ~(page_size - 1);
+    const uintptr_t last  = ((uintptr_t) begin + size) & ~(page_size - 1);
+
+    if (first < last)
+        madvise((void*) first, last - first, MADV_DONTNEED);
+}
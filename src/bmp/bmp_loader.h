@@ -0,0 +1,59 @@
+/**
+ * @file bmp_loader.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Native BMP loader, reading memory-mapped files
+ *
+ * @version 0.1
+ * @date 2023-05-01
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __BMP_LOADER_H
+#define __BMP_LOADER_H
+
+#include "commons/definitions.h"
+#include "commons/pixel_pool.h"
+
+/**
+ * @brief Image, loaded from file. Pixels either point directly into
+ * mapped file, or are acquired from pool.
+ */
+struct ImageFile
+{
+    PixelImage image;
+
+    void*      mapping;         // Mapped file, if image is a view into it.
+                                // Otherwise NULL
+    size_t     mapping_size;
+
+    PixelPool* pool;            // Owner of pixels, if they are not mapped.
+                                // May be NULL
+};
+
+/**
+ * @brief Load 32-bit or 24-bit uncompressed BMP file. If file stores
+ * top-down RGBA pixels at a 4-byte aligned offset, they are used in place:
+ * mapping is private, so they can still be modified without changing the
+ * file. Standard headers leave pixels at offset 2 modulo 4, so only files
+ * with a padded offset qualify. Otherwise, pixels are converted into
+ * a new buffer in a single pass.
+ *
+ * @param[out]   file	    - Loaded image
+ * @param[in]    filename	- Name of BMP file
+ * @param[inout] pool	    - Pool of pixel buffers for converted images.
+ *                            May be NULL
+ *
+ * @return 0 upon success, -1 otherwise. If file is not a BMP or uses
+ * unsupported format, `errno` is set to `ENOTSUP`
+ */
+int load_bmp_file(ImageFile* file, const char* filename, PixelPool* pool);
+
+/**
+ * @brief Return pixels to their pool or unmap file
+ *
+ * @param[inout] file	    - Previously loaded image
+ */
+void unload_image_file(ImageFile* file);
+
+#endif /* bmp_loader.h */
@@ -0,0 +1,68 @@
+/**
+ * @file bmp_rows.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief BMP pixel conversion kernels, built for several instruction
+ * set levels
+ *
+ * @version 0.1
+ * @date 2023-05-01
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __BMP_ROWS_H
+#define __BMP_ROWS_H
+
+#include <stdint.h>
+
+#include "commons/definitions.h"
+
+/**
+ * @brief Shuffle control value, producing zero byte
+ */
+#define BMP_ZERO_BYTE 0x80
+
+/**
+ * @brief Placement of channels in 32-bit pixels of BMP file
+ */
+struct BmpSwizzle
+{
+    uint8_t  shuffle[16];   // `pshufb` control for 4 pixels: source byte of
+                            // every output byte or `BMP_ZERO_BYTE`
+    uint32_t fill;          // OR-ed into every pixel, so that images
+                            // without alpha channel are opaque
+};
+
+/**
+ * @brief Convert row of 32-bit BMP pixels to RGBA
+ *
+ * @param[out] dst	    - Converted pixels
+ * @param[in]  src	    - Pixels, stored in file
+ * @param[in]  count	- Number of pixels in row
+ * @param[in]  swizzle	- Placement of channels in file
+ *
+ * @return Bitwise OR of all converted pixels
+ */
+typedef uint32_t bmp_row_t(Pixel* dst, const uint8_t* src, size_t count,
+                           const BmpSwizzle* swizzle);
+
+/**
+ * @brief Convert row of 24-bit BGR pixels to opaque RGBA
+ *
+ * @param[out] dst	    - Converted pixels
+ * @param[in]  src	    - Pixels, stored in file
+ * @param[in]  count	- Number of pixels in row
+ */
+typedef void bmp_rgb_row_t(Pixel* dst, const uint8_t* src, size_t count);
+
+bmp_row_t convert_bmp_row_scalar;
+bmp_row_t convert_bmp_row_sse4;
+bmp_row_t convert_bmp_row_avx2;
+bmp_row_t convert_bmp_row_avx512;
+
+bmp_rgb_row_t convert_bmp_rgb_row_scalar;
+bmp_rgb_row_t convert_bmp_rgb_row_sse4;
+bmp_rgb_row_t convert_bmp_rgb_row_avx2;
+bmp_rgb_row_t convert_bmp_rgb_row_avx512;
+
+#endif /* bmp_rows.h */
@@ -0,0 +1,40 @@
+#include <string.h>
+
+#include "bmp_rows.h"
+
+uint32_t convert_bmp_row_scalar(Pixel* dst, const uint8_t* src, size_t count,
+                                const BmpSwizzle* swizzle)
+{
+    const uint8_t* shuffle = swizzle->shuffle;
+
+    uint32_t combined = 0;
+
+    for (size_t x = 0; x < count; ++x, src += 4)
+    {
+        uint32_t pixel = swizzle->fill;
+        for (size_t c = 0; c < 4; ++c)
+        {
+            if (shuffle[c] != BMP_ZERO_BYTE)
+                pixel |= (uint32_t) src[shuffle[c]] << 8*c;
+        }
+
+        memcpy(&dst[x], &pixel, sizeof(pixel));
+
+        combined |= pixel;
+    }
+
+    return combined;
+}
+
+void convert_bmp_rgb_row_scalar(Pixel* dst, const uint8_t* src, size_t count)
+{
+    for (size_t x = 0; x < count; ++x, src += 3)
+    {
+        dst[x] = {
+            .red   = src[2],
+            .green = src[1],
+            .blue  = src[0],
+            .alpha = 255
+        };
+    }
+}
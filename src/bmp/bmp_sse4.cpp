@@ -0,0 +1,53 @@
+#include "commons/intrinsics.h"
+
+#include "blending/shuffle_masks.h"
+
+#include "bmp_rows.h"
+
+uint32_t convert_bmp_row_sse4(Pixel* dst, const uint8_t* src, size_t count,
+                              const BmpSwizzle* swizzle)
+{
+    const __m128i shuffle = _mm_loadu_si128(
+                                (const __m128i*) swizzle->shuffle);
+    const __m128i fill    = _mm_set1_epi32((int) swizzle->fill);
+
+    __m128i combined = _mm_setzero_si128();
+
+    size_t x = 0;
+    for (; x + 4 <= count; x += 4)
+    {
+        __m128i pixels = _mm_loadu_si128((const __m128i*) (src + 4*x));
+        pixels = _mm_or_si128(_mm_shuffle_epi8(pixels, shuffle), fill);
+        _mm_storeu_si128((__m128i*) (dst + x), pixels);
+
+        combined = _mm_or_si128(combined, pixels);
+    }
+
+    combined = _mm_or_si128(combined, _mm_srli_si128(combined, 8));
+    combined = _mm_or_si128(combined, _mm_srli_si128(combined, 4));
+
+    return (uint32_t) _mm_cvtsi128_si32(combined)
+         | convert_bmp_row_scalar(dst + x, src + 4*x, count - x, swizzle);
+}
+
+void convert_bmp_rgb_row_sse4(Pixel* dst, const uint8_t* src, size_t count)
+{
+    // Every 3 source bytes become 4 output ones
+    const __m128i shuffle = _mm_setr_epi8( 2,  1,  0, MASK_ZERO,
+                                           5,  4,  3, MASK_ZERO,
+                                           8,  7,  6, MASK_ZERO,
+                                          11, 10,  9, MASK_ZERO);
+    const __m128i opaque  = _mm_set1_epi32((int) 0xFF000000);
+
+    // 4 pixels take 12 bytes, but 16 are loaded, so the last
+    // pixels are left to scalar loop to avoid reading past row end
+    size_t x = 0;
+    for (; x + 6 <= count; x += 4)
+    {
+        __m128i pixels = _mm_loadu_si128((const __m128i*) (src + 3*x));
+        pixels = _mm_or_si128(_mm_shuffle_epi8(pixels, shuffle), opaque);
+        _mm_storeu_si128((__m128i*) (dst + x), pixels);
+    }
+
+    convert_bmp_rgb_row_scalar(dst + x, src + 3*x, count - x);
+}
@@ -0,0 +1,125 @@
+#include <stdlib.h>
+
+#include "meerkat_assert/asserts.h"
+
+#include "bounded_queue.h"
+
+int bounded_queue_init(BoundedQueue* queue, size_t capacity)
+{
+    SAFE_BLOCK_START    // Validate parameters
+    {
+        ASSERT_TRUE_MESSAGE(queue != NULL, "queue");
+        ASSERT_POSITIVE_MESSAGE(capacity, "capacity");
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    SAFE_BLOCK_START    // Allocate ring buffer
+    {
+        queue->items = (void**) calloc(capacity, sizeof(*queue->items));
+        ASSERT_TRUE_MESSAGE(queue->items != NULL, "Failed to allocate memory");
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    queue->capacity  = capacity;
+    queue->head      = 0;
+    queue->count     = 0;
+    queue->is_closed = false;
+
+    pthread_mutex_init(&queue->lock, NULL);
+    pthread_cond_init(&queue->not_empty, NULL);
+    pthread_cond_init(&queue->not_full, NULL);
+
+    return 0;
+}
+
+void bounded_queue_dispose(BoundedQueue* queue)
+{
+    SAFE_BLOCK_START
+    {
+        ASSERT_TRUE_MESSAGE(queue != NULL, "queue");
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        return;
+    }
+    SAFE_BLOCK_END
+
+    pthread_cond_destroy(&queue->not_full);
+    pthread_cond_destroy(&queue->not_empty);
+    pthread_mutex_destroy(&queue->lock);
+
+    free(queue->items);
+    queue->items    = NULL;
+    queue->capacity = 0;
+    queue->count    = 0;
+}
+
+int bounded_queue_push(BoundedQueue* queue, void* item)
+{
+    pthread_mutex_lock(&queue->lock);
+
+    while (queue->count == queue->capacity && !queue->is_closed)
+        pthread_cond_wait(&queue->not_full, &queue->lock);
+
+    if (queue->is_closed)
+    {
+        pthread_mutex_unlock(&queue->lock);
+        return -1;
+    }
+
+    const size_t tail = (queue->head + queue->count) % queue->capacity;
+    queue->items[tail] = item;
+    queue->count++;
+
+    pthread_cond_signal(&queue->not_empty);
+    pthread_mutex_unlock(&queue->lock);
+
+    return 0;
+}
+
+int bounded_queue_pop(BoundedQueue* queue, void** item)
+{
+    pthread_mutex_lock(&queue->lock);
+
+    while (queue->count == 0 && !queue->is_closed)
+        pthread_cond_wait(&queue->not_empty, &queue->lock);
+
+    // Closed queue is drained before reporting its end
+    if (queue->count == 0)
+    {
+        pthread_mutex_unlock(&queue->lock);
+        return -1;
+    }
+
+    *item = queue->items[queue->head];
+    queue->head = (queue->head + 1) % queue->capacity;
+    queue->count--;
+
+    pthread_cond_signal(&queue->not_full);
+    pthread_mutex_unlock(&queue->lock);
+
+    return 0;
+}
+
+void bounded_queue_close(BoundedQueue* queue)
+{
+    pthread_mutex_lock(&queue->lock);
+
+    queue->is_closed = true;
+
+    pthread_cond_broadcast(&queue->not_empty);
+    pthread_cond_broadcast(&queue->not_full);
+    pthread_mutex_unlock(&queue->lock);
+}
@@ -0,0 +1,76 @@
+/**
+ * @file bounded_queue.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Blocking FIFO queue of fixed capacity, connecting pipeline stages
+ *
+ * @version 0.1
+ * @date 2023-04-30
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __BOUNDED_QUEUE_H
+#define __BOUNDED_QUEUE_H
+
+#include <stddef.h>
+#include <pthread.h>
+
+struct BoundedQueue
+{
+    void**          items;      // Ring buffer of `capacity` items
+    size_t          capacity;
+    size_t          head;       // Index of the oldest item
+    size_t          count;
+    bool            is_closed;
+
+    pthread_mutex_t lock;
+    pthread_cond_t  not_empty;
+    pthread_cond_t  not_full;
+};
+
+/**
+ * @brief Allocate empty queue
+ *
+ * @param[out] queue	- Queue to be initialized
+ * @param[in]  capacity	- Maximum number of queued items, must be positive
+ *
+ * @return 0 upon success, -1 upon error
+ */
+int bounded_queue_init(BoundedQueue* queue, size_t capacity);
+
+/**
+ * @brief Free queue memory. Items, left in queue, are not freed.
+ *
+ * @param[inout] queue	- Previously initialized queue
+ */
+void bounded_queue_dispose(BoundedQueue* queue);
+
+/**
+ * @brief Append item to queue, waiting while queue is full
+ *
+ * @param[inout] queue	- Active queue
+ * @param[in]    item	- Appended item
+ *
+ * @return 0 upon success, -1 if queue was closed
+ */
+int bounded_queue_push(BoundedQueue* queue, void* item);
+
+/**
+ * @brief Remove the oldest item from queue, waiting while queue is empty
+ *
+ * @param[inout] queue	- Active queue
+ * @param[out]   item	- Removed item
+ *
+ * @return 0 upon success, -1 if queue is closed and has no more items
+ */
+int bounded_queue_pop(BoundedQueue* queue, void** item);
+
+/**
+ * @brief Forbid further pushes and wake up all waiting threads.
+ * Items, which are already queued, can still be popped.
+ *
+ * @param[inout] queue	- Active queue
+ */
+void bounded_queue_close(BoundedQueue* queue);
+
+#endif /* bounded_queue.h */
@@ -0,0 +1,73 @@
+#include <unistd.h>
+
+#include "cpu_features.h"
+
+static SimdLevel detect_simd_level(void);
+static size_t    detect_last_level_cache_size(void);
+
+static SimdLevel MaxSimdLevel = SIMD_LEVEL_AVX512;
+
+SimdLevel get_simd_level(void)
+{
+    static const SimdLevel detected = detect_simd_level();
+
+    return detected < MaxSimdLevel ? detected : MaxSimdLevel;
+}
+
+void limit_simd_level(SimdLevel max_level)
+{
+    MaxSimdLevel = max_level;
+}
+
+const char* get_simd_level_name(SimdLevel level)
+{
+    switch (level)
+    {
+        case SIMD_LEVEL_SCALAR: return "scalar";
+        case SIMD_LEVEL_SSE4_1: return "SSE4.1";
+        case SIMD_LEVEL_AVX2:   return "AVX2";
+        case SIMD_LEVEL_AVX512: return "AVX-512";
+
+        case SIMD_LEVEL_COUNT:
+        default:
+            return "unknown";
+    }
+}
+
+size_t get_last_level_cache_size(void)
+{
+    static const size_t detected = detect_last_level_cache_size();
+
+    return detected;
+}
+
+static SimdLevel detect_simd_level(void)
+{
+    // Checks both `cpuid` bits and OS support for extended register state
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+        return SIMD_LEVEL_AVX512;
+
+    if (__builtin_cpu_supports("avx2"))
+        return SIMD_LEVEL_AVX2;
+
+    if (__builtin_cpu_supports("sse4.1"))
+        return SIMD_LEVEL_SSE4_1;
+
+    return SIMD_LEVEL_SCALAR;
+}
+
+static size_t detect_last_level_cache_size(void)
+{
+    // Zero or -1 mean that level is absent or unknown
+    const long l3_size = sysconf(_SC_LEVEL3_CACHE_SIZE);
+    if (l3_size > 0)
+        return (size_t) l3_size;
+
+    const long l2_size = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    if (l2_size > 0)
+        return (size_t) l2_size;
+
+    return DEFAULT_LAST_LEVEL_CACHE_SIZE;
+}
@@ -0,0 +1,69 @@
+/**
+ * @file cpu_features.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Runtime detection of available SIMD instruction sets
+ *
+ * @version 0.1
+ * @date 2023-04-24
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __CPU_FEATURES_H
+#define __CPU_FEATURES_H
+
+#include <stddef.h>
+
+/**
+ * @brief Assumed cache size, if it cannot be queried
+ */
+#define DEFAULT_LAST_LEVEL_CACHE_SIZE (8 << 20)
+
+/**
+ * @brief Instruction set levels, for which kernels are built.
+ * Every level implies support of all previous ones.
+ */
+enum SimdLevel
+{
+    SIMD_LEVEL_SCALAR,
+    SIMD_LEVEL_SSE4_1,
+    SIMD_LEVEL_AVX2,
+    SIMD_LEVEL_AVX512,
+
+    SIMD_LEVEL_COUNT
+};
+
+/**
+ * @brief Get the best instruction set level, supported by both CPU and OS.
+ * Detection is performed through `cpuid` on the first call only.
+ *
+ * @return Detected level, capped by `limit_simd_level`
+ */
+SimdLevel get_simd_level(void);
+
+/**
+ * @brief Forbid usage of instruction sets above given level.
+ * Intended for testing and benchmarking of the fallback kernels.
+ *
+ * @param[in] max_level	- Highest allowed level
+ */
+void limit_simd_level(SimdLevel max_level);
+
+/**
+ * @brief Get human-readable name of instruction set level
+ *
+ * @param[in] level	    - Instruction set level
+ *
+ * @return Static string with level name
+ */
+const char* get_simd_level_name(SimdLevel level);
+
+/**
+ * @brief Get size of the last level of data cache. Queried on the first
+ * call only.
+ *
+ * @return Cache size in bytes
+ */
+size_t get_last_level_cache_size(void);
+
+#endif /* cpu_features.h */
@@ -28,12 +28,72 @@ struct Pixel
 
 typedef Pixel Color;
 
+/**
+ * @brief Pixel with 16 bits per channel. Value `v` of 8-bit channel
+ * corresponds to `v*257`, so that 255 becomes 65535.
+ */
+struct Pixel16
+{
+    uint16_t red;
+    uint16_t green;
+    uint16_t blue;
+    uint16_t alpha;
+};
+
+enum BlendMode
+{
+    BLEND_MODE_FAST,    // Division by 255 is approximated with shift by 8
+    BLEND_MODE_EXACT,   // Division by 255 is correctly rounded
+
+    BLEND_MODE_COUNT
+};
+
+/**
+ * @brief Porter-Duff operators for premultiplied source (s) and
+ * destination (d) pixels
+ */
+enum PorterDuffOperator
+{
+    PORTER_DUFF_OVER,   // s + d*(1 - s.alpha)
+    PORTER_DUFF_IN,     // s*d.alpha
+    PORTER_DUFF_OUT,    // s*(1 - d.alpha)
+    PORTER_DUFF_ATOP,   // s*d.alpha + d*(1 - s.alpha)
+    PORTER_DUFF_XOR,    // s*(1 - d.alpha) + d*(1 - s.alpha)
+
+    PORTER_DUFF_COUNT
+};
+
+/**
+ * @brief Whether composed frames are written with non-temporal stores,
+ * bypassing cache
+ */
+enum StreamingMode
+{
+    STREAMING_AUTO,     // Only if frame does not fit into last-level cache
+    STREAMING_NEVER,
+    STREAMING_ALWAYS,
+
+    STREAMING_MODE_COUNT
+};
+
 struct SizeVector2
 {
     size_t x;
     size_t y;
 };
 
+/**
+ * @brief Position in 24.8 fixed point: lowest `SUBPIXEL_BITS` bits are
+ * the fraction of pixel
+ */
+struct SubpixelVector2
+{
+    uint32_t x;
+    uint32_t y;
+};
+
+#define SUBPIXEL_BITS 8
+
 struct Halo
 {
     size_t radius_px;
@@ -48,12 +108,48 @@ struct PixelImage
     Pixel* pixel_array;
 };
 
+struct PixelImage16
+{
+    SizeVector2 size;
+
+    Pixel16* pixel_array;
+};
+
+/**
+ * @brief Global opacity and color multiplier of foreground. Every color
+ * channel is multiplied by the same channel of `tint` and alpha by
+ * `opacity`, so that 255 keeps channel unchanged and 0 clears it.
+ */
+struct Modulation
+{
+    Color   tint;       // Alpha is ignored
+    uint8_t opacity;
+};
+
+struct SpanIndex;
+
 struct MovedImage
 {
     SizeVector2 size;
     SizeVector2 pos;
 
     Pixel* pixel_array;
+
+    BlendMode blend_mode;
+
+    // Optional, see `blending/span_index.h`
+    const SpanIndex* spans;
+
+    // Optional, applied while blending, pixel array is left unchanged
+    const Modulation* modulation;
+};
+
+struct MovedImage16
+{
+    SizeVector2 size;
+    SizeVector2 pos;
+
+    Pixel16* pixel_array;
 };
 
 struct RenderConfig
@@ -63,6 +159,12 @@ struct RenderConfig
     const char* fg_image_name;
     const char* bg_image_name;
     const char* font_name;
+
+    size_t thread_count;    // Zero means one thread per CPU, which the
+                            // process is allowed to run on
+    bool   pin_threads;
+
+    StreamingMode streaming;
 };
 
 #endif /* definitions.h */
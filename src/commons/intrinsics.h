@@ -0,0 +1,27 @@
+/**
+ * @file intrinsics.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief x86 intrinsics; sources include this instead of `<immintrin.h>`
+ *
+ * @version 0.1
+ * @date 2023-05-12
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __INTRINSICS_H
+#define __INTRINSICS_H
+
+/*
+ * GCC 12 fills unused lanes of AVX-512 intrinsics, which have no mask,
+ * with a self-initialized `__Y` and reports it as (maybe) uninitialized
+ * wherever such intrinsic is inlined. Kernel code cannot initialize it, so
+ * the warnings are disabled for the header only, as newer GCC headers do.
+ */
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#include <immintrin.h>
+#pragma GCC diagnostic pop
+
+#endif /* intrinsics.h */
@@ -0,0 +1,228 @@
+#include <stdlib.h>
+#include <sys/mman.h>
+
+#include "meerkat_assert/asserts.h"
+
+#include "pixel_pool.h"
+
+/**
+ * @brief Free buffers are linked through their first bytes
+ */
+struct PooledBuffer
+{
+    PooledBuffer* next;
+};
+
+static size_t get_class_size(size_t size_class);
+static size_t get_size_class(size_t byte_count);
+static void*  map_buffer    (size_t byte_count, bool prefault);
+
+int pixel_pool_init(PixelPool* pool, size_t max_cached_bytes, bool prefault)
+{
+    SAFE_BLOCK_START    // Validate parameters
+    {
+        ASSERT_TRUE_MESSAGE(pool != NULL, "pool");
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    for (size_t i = 0; i < PIXEL_POOL_CLASS_COUNT; ++i)
+        pool->free_buffers[i] = NULL;
+
+    pool->cached_bytes     = 0;
+    pool->max_cached_bytes = max_cached_bytes;
+    pool->prefault         = prefault;
+
+    pthread_mutex_init(&pool->lock, NULL);
+
+    return 0;
+}
+
+void pixel_pool_dispose(PixelPool* pool)
+{
+    SAFE_BLOCK_START
+    {
+        ASSERT_TRUE_MESSAGE(pool != NULL, "pool");
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        return;
+    }
+    SAFE_BLOCK_END
+
+    for (size_t i = 0; i < PIXEL_POOL_CLASS_COUNT; ++i)
+    {
+        PooledBuffer* buffer = pool->free_buffers[i];
+        while (buffer)
+        {
+            PooledBuffer* next = buffer->next;
+            munmap(buffer, get_class_size(i));
+            buffer = next;
+        }
+
+        pool->free_buffers[i] = NULL;
+    }
+
+    pool->cached_bytes = 0;
+
+    pthread_mutex_destroy(&pool->lock);
+}
+
+int pixel_pool_acquire(PixelPool* pool, PixelImage* image, SizeVector2 size)
+{
+    const size_t pixel_count = size.x * size.y;
+
+    SAFE_BLOCK_START    // Validate parameters
+    {
+        ASSERT_TRUE_MESSAGE(image != NULL, "image");
+        ASSERT_POSITIVE_MESSAGE(size.x, "size.x");
+        ASSERT_POSITIVE_MESSAGE(size.y, "size.y");
+
+        ASSERT_TRUE_MESSAGE_CALLBACK(
+                pixel_count / size.x == size.y &&
+                pixel_count < SIZE_MAX / sizeof(Pixel),
+                "Integer multiplication overflow",
+                errno = EOVERFLOW);
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        if (errno != EOVERFLOW)
+            errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    const size_t byte_count = pixel_count * sizeof(Pixel);
+    const size_t size_class = get_size_class(byte_count);
+
+    image->size        = size;
+    image->pixel_array = NULL;
+
+    // Not pooled
+    if (!pool || size_class == PIXEL_POOL_CLASS_COUNT)
+    {
+        if (posix_memalign((void**) &image->pixel_array,
+                           PIXEL_ALIGNMENT, byte_count) != 0)
+        {
+            image->pixel_array = NULL;
+            return -1;
+        }
+
+        return 0;
+    }
+
+    const size_t class_size = get_class_size(size_class);
+
+    pthread_mutex_lock(&pool->lock);
+
+    PooledBuffer* buffer = pool->free_buffers[size_class];
+    if (buffer)
+    {
+        pool->free_buffers[size_class] = buffer->next;
+        pool->cached_bytes -= class_size;
+    }
+
+    pthread_mutex_unlock(&pool->lock);
+
+    image->pixel_array = buffer
+                       ? (Pixel*) buffer
+                       : (Pixel*) map_buffer(class_size, pool->prefault);
+
+    return image->pixel_array ? 0 : -1;
+}
+
+void pixel_pool_release(PixelPool* pool, PixelImage* image)
+{
+    SAFE_BLOCK_START
+    {
+        ASSERT_TRUE_MESSAGE(image != NULL, "image");
+        ASSERT_TRUE_MESSAGE(image->pixel_array != NULL, "image->pixel_array");
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        return;
+    }
+    SAFE_BLOCK_END
+
+    const size_t byte_count = image->size.x * image->size.y * sizeof(Pixel);
+    const size_t size_class = get_size_class(byte_count);
+
+    void* pixels = image->pixel_array;
+
+    image->pixel_array = NULL;
+    image->size.x = 0;
+    image->size.y = 0;
+
+    if (!pool || size_class == PIXEL_POOL_CLASS_COUNT)
+    {
+        free(pixels);
+        return;
+    }
+
+    const size_t class_size = get_class_size(size_class);
+
+    pthread_mutex_lock(&pool->lock);
+
+    const bool is_kept = pool->max_cached_bytes == 0 ||
+                         pool->cached_bytes + class_size
+                            <= pool->max_cached_bytes;
+    if (is_kept)
+    {
+        PooledBuffer* buffer = (PooledBuffer*) pixels;
+        buffer->next = pool->free_buffers[size_class];
+
+        pool->free_buffers[size_class] = buffer;
+        pool->cached_bytes += class_size;
+    }
+
+    pthread_mutex_unlock(&pool->lock);
+
+    if (!is_kept)
+        munmap(pixels, class_size);
+}
+
+static size_t get_class_size(size_t size_class)
+{
+    const size_t power_of_two = (size_t) 1 << (PIXEL_POOL_MIN_SHIFT
+                                               + size_class
+                                                 / PIXEL_POOL_CLASS_STEPS);
+
+    return power_of_two
+         + power_of_two / PIXEL_POOL_CLASS_STEPS
+                        * (size_class % PIXEL_POOL_CLASS_STEPS);
+}
+
+static size_t get_size_class(size_t byte_count)
+{
+    for (size_t size_class = 0; size_class < PIXEL_POOL_CLASS_COUNT;
+         ++size_class)
+    {
+        if (get_class_size(size_class) >= byte_count)
+            return size_class;
+    }
+
+    return PIXEL_POOL_CLASS_COUNT;
+}
+
+/*
+ * Buffers are mapped directly, so that they are page-aligned and are
+ * never returned to system by `free` behind our back.
+ */
+static void* map_buffer(size_t byte_count, bool prefault)
+{
+    const int flags = MAP_PRIVATE | MAP_ANONYMOUS
+                    | (prefault ? MAP_POPULATE : 0);
+
+    void* buffer = mmap(NULL, byte_count, PROT_READ | PROT_WRITE,
+                        flags, -1, 0);
+
+    return buffer == MAP_FAILED ? NULL : buffer;
+}
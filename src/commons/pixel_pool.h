@@ -0,0 +1,89 @@
+/**
+ * @file pixel_pool.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Size-classed pool of pixel buffers, recycled between images
+ *
+ * @version 0.1
+ * @date 2023-05-02
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __PIXEL_POOL_H
+#define __PIXEL_POOL_H
+
+#include <stddef.h>
+#include <pthread.h>
+
+#include "definitions.h"
+
+/**
+ * @brief Buffer sizes are rounded up to size classes. There are
+ * `PIXEL_POOL_CLASS_STEPS` classes between consecutive powers of two,
+ * starting from `1 << PIXEL_POOL_MIN_SHIFT` bytes, so at most 25% of
+ * every buffer is wasted. Larger buffers are not pooled.
+ */
+#define PIXEL_POOL_MIN_SHIFT    16
+#define PIXEL_POOL_CLASS_STEPS  4
+#define PIXEL_POOL_CLASS_COUNT  (16 * PIXEL_POOL_CLASS_STEPS)
+
+struct PooledBuffer;
+
+struct PixelPool
+{
+    pthread_mutex_t lock;
+
+    PooledBuffer*   free_buffers[PIXEL_POOL_CLASS_COUNT];
+
+    size_t          cached_bytes;       // Total size of free buffers
+    size_t          max_cached_bytes;   // Zero means unlimited
+    bool            prefault;
+};
+
+/**
+ * @brief Create empty pool
+ *
+ * @param[out] pool	            - Pool to be initialized
+ * @param[in]  max_cached_bytes	- Released buffers are unmapped instead of
+ *                                being kept for reuse, when total size
+ *                                of kept buffers would exceed this limit.
+ *                                Zero means no limit
+ * @param[in]  prefault	        - Whether new buffers should be faulted in
+ *                                right away, instead of on the first access
+ *
+ * @return 0 upon success, -1 upon error
+ */
+int pixel_pool_init(PixelPool* pool, size_t max_cached_bytes, bool prefault);
+
+/**
+ * @brief Unmap all free buffers. Buffers, which are still acquired,
+ * must be released beforehand.
+ *
+ * @param[inout] pool	- Previously initialized pool
+ */
+void pixel_pool_dispose(PixelPool* pool);
+
+/**
+ * @brief Get buffer for image of given size. Recently released buffer of
+ * the same size class is reused, if there is one. Pixels are aligned to
+ * at least `PIXEL_ALIGNMENT` bytes and are not initialized.
+ *
+ * @param[inout] pool	- Active pool. If NULL, buffer is allocated
+ *                        with `posix_memalign`
+ * @param[out]   image	- Image, receiving buffer
+ * @param[in]    size	- Image size
+ *
+ * @return 0 upon success, -1 upon error
+ */
+int pixel_pool_acquire(PixelPool* pool, PixelImage* image, SizeVector2 size);
+
+/**
+ * @brief Return image buffer to pool. Image size must not be changed
+ * since `pixel_pool_acquire`.
+ *
+ * @param[inout] pool	- Pool, which buffer was acquired from, or NULL
+ * @param[inout] image	- Image, which buffer is released
+ */
+void pixel_pool_release(PixelPool* pool, PixelImage* image);
+
+#endif /* pixel_pool.h */
@@ -0,0 +1,230 @@
+#include <stdlib.h>
+#include <sched.h>
+#include <unistd.h>
+
+#include "meerkat_assert/asserts.h"
+
+#include "thread_pool.h"
+
+static void* worker_main(void* worker_ptr);
+static void  run_band(ThreadPool* pool, size_t index);
+static void  stop_workers(ThreadPool* pool, size_t started_count);
+static void  pin_to_cpu(pthread_t thread, size_t cpu_index);
+
+int thread_pool_init(ThreadPool* pool, size_t thread_count, bool pin_threads)
+{
+    SAFE_BLOCK_START    // Validate parameters
+    {
+        ASSERT_TRUE_MESSAGE(pool != NULL, "pool");
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    if (thread_count == 0)
+        thread_count = get_allowed_cpu_count();
+
+    pool->thread_count   = thread_count;
+    pool->workers        = NULL;
+    pool->generation     = 0;
+    pool->active_workers = 0;
+    pool->is_stopping    = false;
+    pool->task           = NULL;
+    pool->context        = NULL;
+    pool->item_count     = 0;
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->task_started, NULL);
+    pthread_cond_init(&pool->task_finished, NULL);
+
+    if (thread_count == 1)
+        return 0;
+
+    size_t started_count = 0;
+
+    SAFE_BLOCK_START    // Start workers
+    {
+        pool->workers = (PoolWorker*) calloc(thread_count - 1,
+                                             sizeof(*pool->workers));
+        ASSERT_TRUE_MESSAGE(pool->workers != NULL, "Failed to allocate memory");
+
+        while (started_count < thread_count - 1)
+        {
+            PoolWorker* worker = &pool->workers[started_count];
+            worker->pool  = pool;
+            worker->index = started_count + 1;
+
+            ASSERT_ZERO_MESSAGE(
+                    pthread_create(&worker->thread, NULL, worker_main, worker),
+                    "Failed to start worker thread");
+
+            // Running worker has to be joined, whatever happens next
+            ++started_count;
+
+            if (pin_threads)
+                pin_to_cpu(worker->thread, worker->index);
+        }
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        stop_workers(pool, started_count);
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    return 0;
+}
+
+void thread_pool_dispose(ThreadPool* pool)
+{
+    SAFE_BLOCK_START
+    {
+        ASSERT_TRUE_MESSAGE(pool != NULL, "pool");
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        return;
+    }
+    SAFE_BLOCK_END
+
+    const size_t worker_count = pool->workers ? pool->thread_count - 1 : 0;
+
+    stop_workers(pool, worker_count);
+
+    pool->thread_count = 0;
+}
+
+void thread_pool_run(ThreadPool* pool, parallel_task_t* task, void* context,
+                     size_t item_count)
+{
+    // Not worth waking anyone up
+    if (pool->thread_count <= 1 || item_count < pool->thread_count)
+    {
+        task(context, 0, item_count);
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+
+    pool->task           = task;
+    pool->context        = context;
+    pool->item_count     = item_count;
+    pool->active_workers = pool->thread_count - 1;
+    pool->generation++;
+
+    pthread_cond_broadcast(&pool->task_started);
+    pthread_mutex_unlock(&pool->lock);
+
+    run_band(pool, 0);
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->active_workers > 0)
+        pthread_cond_wait(&pool->task_finished, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+static void* worker_main(void* worker_ptr)
+{
+    PoolWorker* worker = (PoolWorker*) worker_ptr;
+    ThreadPool* pool   = worker->pool;
+
+    size_t seen_generation = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    while (true)
+    {
+        while (pool->generation == seen_generation && !pool->is_stopping)
+            pthread_cond_wait(&pool->task_started, &pool->lock);
+
+        if (pool->is_stopping)
+            break;
+
+        seen_generation = pool->generation;
+        pthread_mutex_unlock(&pool->lock);
+
+        run_band(pool, worker->index);
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->active_workers == 0)
+            pthread_cond_signal(&pool->task_finished);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    return NULL;
+}
+
+static void run_band(ThreadPool* pool, size_t index)
+{
+    const size_t item_count   = pool->item_count;
+    const size_t thread_count = pool->thread_count;
+
+    const size_t begin = item_count *  index      / thread_count;
+    const size_t end   = item_count * (index + 1) / thread_count;
+
+    if (begin < end)
+        pool->task(pool->context, begin, end);
+}
+
+static void stop_workers(ThreadPool* pool, size_t started_count)
+{
+    pthread_mutex_lock(&pool->lock);
+    pool->is_stopping = true;
+    pthread_cond_broadcast(&pool->task_started);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (size_t i = 0; i < started_count; ++i)
+        pthread_join(pool->workers[i].thread, NULL);
+
+    free(pool->workers);
+    pool->workers = NULL;
+
+    pthread_cond_destroy(&pool->task_finished);
+    pthread_cond_destroy(&pool->task_started);
+    pthread_mutex_destroy(&pool->lock);
+}
+
+size_t get_allowed_cpu_count(void)
+{
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0 &&
+        CPU_COUNT(&allowed) > 0)
+        return (size_t) CPU_COUNT(&allowed);
+
+    const long online_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return online_cpus > 0 ? (size_t) online_cpus : 1;
+}
+
+/*
+ * Bind thread to allowed CPU with given index, wrapping around. Pinning is
+ * only a hint: if affinity cannot be set, thread is left unpinned.
+ */
+static void pin_to_cpu(pthread_t thread, size_t cpu_index)
+{
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0 ||
+        CPU_COUNT(&allowed) == 0)
+        return;
+
+    size_t skipped = cpu_index % (size_t) CPU_COUNT(&allowed);
+    for (size_t cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+    {
+        if (!CPU_ISSET(cpu, &allowed))
+            continue;
+
+        if (skipped-- > 0)
+            continue;
+
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        CPU_SET(cpu, &cpu_set);
+
+        pthread_setaffinity_np(thread, sizeof(cpu_set), &cpu_set);
+        return;
+    }
+}
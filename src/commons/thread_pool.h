@@ -0,0 +1,99 @@
+/**
+ * @file thread_pool.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Persistent pool of worker threads, splitting row ranges between them
+ *
+ * @version 0.1
+ * @date 2023-04-25
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __THREAD_POOL_H
+#define __THREAD_POOL_H
+
+#include <stddef.h>
+#include <pthread.h>
+
+/**
+ * @brief Process items (usually image rows) in range [begin; end)
+ *
+ * @param[inout] context    - Task-specific data
+ * @param[in]    begin	    - First item of range
+ * @param[in]    end	    - Item after the last one in range
+ */
+typedef void parallel_task_t(void* context, size_t begin, size_t end);
+
+struct ThreadPool;
+
+struct PoolWorker
+{
+    ThreadPool* pool;
+    size_t      index;
+    pthread_t   thread;
+};
+
+struct ThreadPool
+{
+    size_t          thread_count;   // Including the calling thread
+    PoolWorker*     workers;        // `thread_count - 1` background workers
+
+    pthread_mutex_t lock;
+    pthread_cond_t  task_started;
+    pthread_cond_t  task_finished;
+
+    size_t          generation;     // Incremented on every new task
+    size_t          active_workers;
+    bool            is_stopping;
+
+    parallel_task_t* task;
+    void*            context;
+    size_t           item_count;
+};
+
+/**
+ * @brief Start worker threads
+ *
+ * @param[out] pool	        - Pool to be initialized
+ * @param[in]  thread_count	- Total number of threads, including the calling
+ *                            one. Zero means one thread per CPU, which
+ *                            the process is allowed to run on
+ * @param[in]  pin_threads	- Whether worker `i` should be bound to the
+ *                            `i`-th allowed CPU. Pinning is best effort,
+ *                            failures are ignored. The calling thread is
+ *                            never pinned
+ *
+ * @return 0 upon success, -1 upon error
+ */
+int thread_pool_init(ThreadPool* pool, size_t thread_count, bool pin_threads);
+
+/**
+ * @brief Stop and join all worker threads
+ *
+ * @param[inout] pool	- Previously initialized pool
+ */
+void thread_pool_dispose(ThreadPool* pool);
+
+/**
+ * @brief Count CPUs, which the process is allowed to run on. They may be
+ * restricted by `taskset` or cgroup cpuset, so online CPUs are counted only
+ * if the set is unknown.
+ *
+ * @return Number of allowed CPUs, at least one
+ */
+size_t get_allowed_cpu_count(void);
+
+/**
+ * @brief Split items into contiguous bands, one per thread, and process them
+ * in parallel. The calling thread processes the first band and returns only
+ * after all bands are finished.
+ *
+ * @param[inout] pool	    - Active thread pool
+ * @param[in]    task	    - Function processing a band of items
+ * @param[inout] context	- Task-specific data
+ * @param[in]    item_count	- Total number of items
+ */
+void thread_pool_run(ThreadPool* pool, parallel_task_t* task, void* context,
+                     size_t item_count);
+
+#endif /* thread_pool.h */
@@ -0,0 +1,84 @@
+#include "meerkat_assert/asserts.h"
+
+#include "triple_buffer.h"
+
+int triple_buffer_init(TripleBuffer* buffer)
+{
+    SAFE_BLOCK_START    // Validate parameters
+    {
+        ASSERT_TRUE_MESSAGE(buffer != NULL, "buffer");
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    // Nothing is published yet, so producer may start right away
+    if (sem_init(&buffer->is_consumed, 0, 1) != 0)
+        return -1;
+
+    buffer->back  = 0;
+    buffer->ready = 1;
+    buffer->front = 2;
+
+    return 0;
+}
+
+void triple_buffer_dispose(TripleBuffer* buffer)
+{
+    SAFE_BLOCK_START
+    {
+        ASSERT_TRUE_MESSAGE(buffer != NULL, "buffer");
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        return;
+    }
+    SAFE_BLOCK_END
+
+    sem_destroy(&buffer->is_consumed);
+}
+
+void triple_buffer_wait_consumed(TripleBuffer* buffer)
+{
+    while (sem_wait(&buffer->is_consumed) != 0)
+        continue;   // Interrupted by signal
+}
+
+void triple_buffer_wake(TripleBuffer* buffer)
+{
+    sem_post(&buffer->is_consumed);
+}
+
+void triple_buffer_publish(TripleBuffer* buffer)
+{
+    // Release: pixels of `back` are visible before its index
+    const unsigned previous = __atomic_exchange_n(
+                                    &buffer->ready,
+                                    buffer->back | TRIPLE_BUFFER_FRESH,
+                                    __ATOMIC_ACQ_REL);
+
+    // If previous buffer was never acquired, it is simply overwritten
+    buffer->back = previous & ~TRIPLE_BUFFER_FRESH;
+}
+
+bool triple_buffer_acquire(TripleBuffer* buffer)
+{
+    // Only producer may change `ready` concurrently, and it can only
+    // publish a newer buffer, which keeps the flag set
+    if (!(__atomic_load_n(&buffer->ready, __ATOMIC_ACQUIRE)
+          & TRIPLE_BUFFER_FRESH))
+        return false;
+
+    const unsigned latest = __atomic_exchange_n(&buffer->ready, buffer->front,
+                                                __ATOMIC_ACQ_REL);
+
+    buffer->front = latest & ~TRIPLE_BUFFER_FRESH;
+    sem_post(&buffer->is_consumed);
+
+    return true;
+}
@@ -0,0 +1,93 @@
+/**
+ * @file triple_buffer.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Lock-free handoff of frames between a single producer and a single
+ * consumer through three rotating buffers
+ *
+ * @version 0.1
+ * @date 2023-05-05
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __TRIPLE_BUFFER_H
+#define __TRIPLE_BUFFER_H
+
+#include <stddef.h>
+#include <semaphore.h>
+
+#define TRIPLE_BUFFER_COUNT 3
+
+/**
+ * @brief Set in `ready`, while published buffer is not yet acquired
+ */
+#define TRIPLE_BUFFER_FRESH 0x4u
+
+/**
+ * @brief Buffers themselves are owned by user and are referred to by their
+ * indices. At every moment producer writes to `back` buffer, consumer reads
+ * `front` buffer, and the last finished one is `ready`. Buffers are
+ * exchanged with a single atomic swap on either side.
+ */
+struct TripleBuffer
+{
+    unsigned back;      // Owned by producer
+    unsigned ready;     // Shared, accessed atomically. Index with FRESH flag
+    unsigned front;     // Owned by consumer
+
+    sem_t    is_consumed;   // Posted, when published buffer is acquired
+};
+
+/**
+ * @brief Initialize buffer indices. No buffer is published.
+ *
+ * @param[out] buffer	- Handoff to be initialized
+ *
+ * @return 0 upon success, -1 upon error
+ */
+int triple_buffer_init(TripleBuffer* buffer);
+
+/**
+ * @brief Free resources, allocated in `triple_buffer_init`
+ *
+ * @param[inout] buffer	- Previously initialized handoff
+ */
+void triple_buffer_dispose(TripleBuffer* buffer);
+
+/**
+ * @brief Wait until previously published buffer is acquired by consumer.
+ * Producer should call this before it starts writing the next buffer, so
+ * that it composes the next frame while the current one is presented,
+ * but never runs more than one frame ahead.
+ *
+ * @param[inout] buffer	- Active handoff
+ */
+void triple_buffer_wait_consumed(TripleBuffer* buffer);
+
+/**
+ * @brief Wake producer, waiting in `triple_buffer_wait_consumed`, without
+ * acquiring anything. Used on shutdown.
+ *
+ * @param[inout] buffer	- Active handoff
+ */
+void triple_buffer_wake(TripleBuffer* buffer);
+
+/**
+ * @brief Publish `back` buffer as the latest finished one. Producer gets
+ * a new `back` buffer, which is never the one being read by consumer.
+ *
+ * @param[inout] buffer	- Active handoff
+ */
+void triple_buffer_publish(TripleBuffer* buffer);
+
+/**
+ * @brief Make the latest published buffer `front` one, if it was not
+ * acquired already. Never waits.
+ *
+ * @param[inout] buffer	- Active handoff
+ *
+ * @return Whether `front` buffer has changed
+ */
+bool triple_buffer_acquire(TripleBuffer* buffer);
+
+#endif /* triple_buffer.h */
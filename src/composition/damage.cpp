@@ -0,0 +1,88 @@
+#include "damage.h"
+
+__always_inline
+static bool is_empty(const FrameRect* rect)
+{
+    return rect->size.x == 0 || rect->size.y == 0;
+}
+
+__always_inline
+static bool is_intersecting(const FrameRect* first, const FrameRect* second)
+{
+    return first->pos.x < second->pos.x + second->size.x
+        && second->pos.x < first->pos.x + first->size.x
+        && first->pos.y < second->pos.y + second->size.y
+        && second->pos.y < first->pos.y + first->size.y;
+}
+
+void damage_clear(DamageRegion* damage)
+{
+    damage->rect_count = 0;
+}
+
+void damage_add_rect(DamageRegion* damage, const FrameRect* rect)
+{
+    if (is_empty(rect))
+        return;
+
+    FrameRect merged = *rect;
+
+    // Merged rectangle may intersect ones, which were checked before
+    bool was_merged = true;
+    while (was_merged)
+    {
+        was_merged = false;
+
+        for (size_t i = 0; i < damage->rect_count; ++i)
+        {
+            if (!is_intersecting(&merged, damage->rects + i))
+                continue;
+
+            merged = get_bounding_rect(&merged, damage->rects + i);
+
+            damage->rects[i] = damage->rects[--damage->rect_count];
+            was_merged = true;
+            break;
+        }
+    }
+
+    if (damage->rect_count == MAX_DAMAGE_RECTS)
+    {
+        for (size_t i = 0; i < damage->rect_count; ++i)
+            merged = get_bounding_rect(&merged, damage->rects + i);
+
+        damage->rect_count = 0;
+    }
+
+    damage->rects[damage->rect_count++] = merged;
+}
+
+FrameRect get_bounding_rect(const FrameRect* first, const FrameRect* second)
+{
+    if (is_empty(first))
+        return *second;
+    if (is_empty(second))
+        return *first;
+
+    const size_t min_x = first->pos.x < second->pos.x
+                       ? first->pos.x : second->pos.x;
+    const size_t min_y = first->pos.y < second->pos.y
+                       ? first->pos.y : second->pos.y;
+
+    const size_t first_end_x  = first->pos.x  + first->size.x;
+    const size_t first_end_y  = first->pos.y  + first->size.y;
+    const size_t second_end_x = second->pos.x + second->size.x;
+    const size_t second_end_y = second->pos.y + second->size.y;
+
+    const size_t max_x = first_end_x > second_end_x
+                       ? first_end_x : second_end_x;
+    const size_t max_y = first_end_y > second_end_y
+                       ? first_end_y : second_end_y;
+
+    const FrameRect result = {
+        .pos  = { min_x, min_y },
+        .size = { max_x - min_x, max_y - min_y }
+    };
+
+    return result;
+}
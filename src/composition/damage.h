@@ -0,0 +1,60 @@
+/**
+ * @file damage.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Tracking of frame regions, which need to be recomposed
+ *
+ * @version 0.1
+ * @date 2023-04-28
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __DAMAGE_H
+#define __DAMAGE_H
+
+#include "commons/definitions.h"
+
+#include "frame.h"
+
+/**
+ * @brief When more rectangles are damaged, all of them are replaced by
+ * their bounding box
+ */
+#define MAX_DAMAGE_RECTS 8
+
+/**
+ * @brief Set of non-intersecting damaged rectangles
+ */
+struct DamageRegion
+{
+    size_t    rect_count;
+    FrameRect rects[MAX_DAMAGE_RECTS];
+};
+
+/**
+ * @brief Mark the whole region as undamaged
+ *
+ * @param[out] damage	- Damaged region
+ */
+void damage_clear(DamageRegion* damage);
+
+/**
+ * @brief Add rectangle to damaged region. Intersecting rectangles are
+ * merged into their bounding box. Empty rectangles are ignored.
+ *
+ * @param[inout] damage	- Damaged region
+ * @param[in]    rect	- Damaged rectangle
+ */
+void damage_add_rect(DamageRegion* damage, const FrameRect* rect);
+
+/**
+ * @brief Get the smallest rectangle, containing both given ones
+ *
+ * @param[in] first	    - First rectangle
+ * @param[in] second	- Second rectangle
+ *
+ * @return Bounding box. If one of rectangles is empty, the other one
+ */
+FrameRect get_bounding_rect(const FrameRect* first, const FrameRect* second);
+
+#endif /* damage.h */
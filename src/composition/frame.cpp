@@ -0,0 +1,404 @@
+#include "commons/intrinsics.h"
+#include <stdlib.h>
+#include <string.h>
+
+#include "meerkat_assert/asserts.h"
+#include "commons/cpu_features.h"
+#include "blending/blender_rows.h"
+#include "effects/halo_rows.h"
+
+#include "frame.h"
+#include "stream_rows.h"
+
+// Indexed by SimdLevel
+static stream_row_t* const STREAM_ROW_KERNELS[SIMD_LEVEL_COUNT] = {
+    stream_row_scalar,
+    stream_row_sse4,
+    stream_row_avx2,
+    stream_row_avx512
+};
+
+stream_row_t* get_stream_row_kernel(void)
+{
+    return STREAM_ROW_KERNELS[get_simd_level()];
+}
+
+bool is_streaming_enabled(StreamingMode mode, size_t byte_count)
+{
+    switch (mode)
+    {
+        case STREAMING_NEVER:  return false;
+        case STREAMING_ALWAYS: return true;
+
+        // Background is read while frame is written, both compete for cache
+        case STREAMING_AUTO:
+            return 2 * byte_count > get_last_level_cache_size();
+
+        case STREAMING_MODE_COUNT:
+        default:
+            return false;
+    }
+}
+
+struct ComposeRowsTask
+{
+    Pixel*       frame_pixels;
+    const Pixel* bg_pixels;
+    size_t       size_x;
+
+    FrameRect    region;
+
+    const Halo*  halo;
+    FrameRect    halo_rect;
+    halo_row_t*  add_halo_row;
+
+    const MovedImage* foreground;
+    blend_row_t*      blend_row;            // Exactly one of kernels is set
+
+    blend_row_modulated_t* blend_row_modulated;
+    Pixel16                factors;
+
+    stream_row_t*     stream_row;   // NULL, if frame is written through cache
+
+    Pixel*            scratch_rows; // One row per thread, NULL if rows are
+                                    // composed in place
+    size_t            scratch_stride;
+    size_t            next_scratch; // Accessed atomically
+};
+
+static int validate_layers(const PixelImage* frame, const FrameLayers* layers);
+
+/*
+ * Intersect columns of a layer with columns [region_begin; region_end).
+ * Resulting range is relative to the leftmost layer column.
+ */
+__always_inline
+static bool clip_columns(size_t layer_x, size_t layer_width,
+                         size_t region_begin, size_t region_end,
+                         size_t* begin, size_t* end)
+{
+    const size_t layer_end = layer_x + layer_width;
+
+    const size_t clipped_begin = layer_x > region_begin
+                               ? layer_x : region_begin;
+    const size_t clipped_end   = layer_end < region_end
+                               ? layer_end : region_end;
+
+    if (clipped_begin >= clipped_end)
+        return false;
+
+    *begin = clipped_begin - layer_x;
+    *end   = clipped_end   - layer_x;
+
+    return true;
+}
+
+static void compose_rows(void* task_ptr, size_t begin, size_t end)
+{
+    ComposeRowsTask* task = (ComposeRowsTask*) task_ptr;
+
+    const size_t size_x = task->size_x;
+
+    const size_t region_begin = task->region.pos.x;
+    const size_t region_end   = task->region.pos.x + task->region.size.x;
+
+    const Halo*       halo = task->halo;
+    const MovedImage* fg   = task->foreground;
+
+    begin += task->region.pos.y;
+    end   += task->region.pos.y;
+
+    Pixel*       frame_row = task->frame_pixels + begin * size_x;
+    const Pixel* bg_row    = task->bg_pixels    + begin * size_x;
+
+    const size_t region_width = task->region.size.x;
+
+    // Streamed rows are composed in a scratch row, which stays in cache,
+    // and are written to frame only when they are complete. Every thread
+    // processes at most one band, so each band claims a row of its own.
+    Pixel* scratch_row = NULL;
+    if (task->scratch_rows)
+        scratch_row = task->scratch_rows + task->scratch_stride
+                    * __atomic_fetch_add(&task->next_scratch, 1,
+                                         __ATOMIC_RELAXED);
+
+    for (size_t y = begin; y < end; ++y)
+    {
+        size_t halo_begin = 0, halo_end = 0;
+        size_t fg_begin   = 0, fg_end   = 0;
+
+        const bool has_halo =
+            halo && y - task->halo_rect.pos.y < task->halo_rect.size.y &&
+            clip_columns(task->halo_rect.pos.x, task->halo_rect.size.x,
+                         region_begin, region_end, &halo_begin, &halo_end);
+
+        const bool has_fg =
+            fg && y - fg->pos.y < fg->size.y &&
+            clip_columns(fg->pos.x, fg->size.x,
+                         region_begin, region_end, &fg_begin, &fg_end);
+
+        // Background-only rows are streamed directly
+        if (scratch_row && !has_halo && !has_fg)
+        {
+            task->stream_row(frame_row + region_begin, bg_row + region_begin,
+                             region_width);
+
+            frame_row += size_x;
+            bg_row    += size_x;
+            continue;
+        }
+
+        Pixel* target_row = scratch_row ? scratch_row : frame_row;
+
+        memcpy(target_row + region_begin, bg_row + region_begin,
+               region_width * sizeof(*target_row));
+
+        if (has_halo)
+        {
+            const size_t square_y = y - task->halo_rect.pos.y;
+            const size_t dy = square_y > halo->radius_px
+                            ? square_y - halo->radius_px
+                            : halo->radius_px - square_y;
+
+            // Rows are composed one by one, so mirrored row is not passed
+            task->add_halo_row(target_row + task->halo_rect.pos.x
+                                          + halo_begin,
+                               NULL, dy, halo_begin, halo_end, halo);
+        }
+
+        if (has_fg)
+        {
+            const size_t fg_y = y - fg->pos.y;
+            const Pixel* fg_row = fg->pixel_array + fg_y * fg->size.x;
+
+            Pixel* fg_target = target_row + fg->pos.x;
+
+            if (task->blend_row_modulated && fg->spans)
+                blend_row_spans_modulated(fg_target, fg_row, fg->spans, fg_y,
+                                          fg_begin, fg_end,
+                                          task->blend_row_modulated,
+                                          task->factors);
+            else if (task->blend_row_modulated)
+                task->blend_row_modulated(fg_target + fg_begin,
+                                          fg_row + fg_begin,
+                                          fg_end - fg_begin, task->factors);
+            else if (fg->spans)
+                blend_row_spans(fg_target, fg_row, fg->spans,
+                                fg_y, fg_begin, fg_end, task->blend_row);
+            else
+                task->blend_row(fg_target + fg_begin,
+                                fg_row + fg_begin, fg_end - fg_begin);
+        }
+
+        if (scratch_row)
+            task->stream_row(frame_row + region_begin,
+                             scratch_row + region_begin, region_width);
+
+        frame_row += size_x;
+        bg_row    += size_x;
+    }
+
+    // Non-temporal stores must be visible before the frame is displayed
+    if (scratch_row)
+        _mm_sfence();
+}
+
+int compose_frame(PixelImage* frame, const FrameLayers* layers,
+                  StreamingMode streaming, ThreadPool* pool)
+{
+    SAFE_BLOCK_START
+    {
+        ASSERT_TRUE(frame != NULL);
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    const FrameRect whole_frame = {
+        .pos  = {0, 0},
+        .size = frame->size
+    };
+
+    return compose_frame_region(frame, layers, &whole_frame, streaming,
+                                pool);
+}
+
+int compose_frame_region(PixelImage* frame, const FrameLayers* layers,
+                         const FrameRect* region, StreamingMode streaming,
+                         ThreadPool* pool)
+{
+    if (validate_layers(frame, layers))
+        return -1;
+
+    SAFE_BLOCK_START
+    {
+        ASSERT_TRUE(region != NULL);
+        ASSERT_LESS(streaming, STREAMING_MODE_COUNT);
+
+        ASSERT_LESS_EQUAL(
+                region->pos.x + region->size.x, frame->size.x);
+        ASSERT_LESS_EQUAL(
+                region->pos.y + region->size.y, frame->size.y);
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    const Halo*       halo = layers->halo;
+    const MovedImage* fg   = layers->foreground;
+
+    ComposeRowsTask task = {
+        .frame_pixels        = frame->pixel_array,
+        .bg_pixels           = layers->background->pixel_array,
+        .size_x              = frame->size.x,
+        .region              = *region,
+        .halo                = halo,
+        .halo_rect           = {},
+        .add_halo_row        = get_halo_row_kernel(),
+        .foreground          = fg,
+        .blend_row           = NULL,
+        .blend_row_modulated = NULL,
+        .factors             = {},
+        .stream_row          = NULL,
+        .scratch_rows        = NULL,
+        .scratch_stride      = 0,
+        .next_scratch        = 0
+    };
+
+    if (halo)
+        task.halo_rect = get_halo_rect(halo);
+
+    if (fg && fg->modulation)
+    {
+        task.blend_row_modulated =
+                get_blend_premultiplied_modulated_row_kernel(fg->blend_mode);
+        task.factors = get_premultiplied_modulation_factors(fg->modulation);
+    }
+    else if (fg)
+        task.blend_row = get_blend_premultiplied_row_kernel(fg->blend_mode);
+
+    const size_t region_bytes = region->size.x * region->size.y
+                              * sizeof(*frame->pixel_array);
+    if (is_streaming_enabled(streaming, region_bytes))
+    {
+        const size_t thread_count = pool ? pool->thread_count : 1;
+        const size_t row_alignment = PIXEL_ALIGNMENT / sizeof(Pixel);
+
+        task.stream_row     = get_stream_row_kernel();
+        task.scratch_stride = (frame->size.x + row_alignment - 1)
+                            / row_alignment * row_alignment;
+
+        // If scratch rows cannot be allocated, rows are composed in place
+        if (posix_memalign((void**) &task.scratch_rows, PIXEL_ALIGNMENT,
+                           thread_count * task.scratch_stride
+                                        * sizeof(Pixel)) != 0)
+            task.scratch_rows = NULL;
+    }
+
+    if (pool)
+        thread_pool_run(pool, compose_rows, &task, region->size.y);
+    else
+        compose_rows(&task, 0, region->size.y);
+
+    free(task.scratch_rows);
+
+    return 0;
+}
+
+static int validate_layers(const PixelImage* frame, const FrameLayers* layers)
+{
+    SAFE_BLOCK_START
+    {
+        ASSERT_TRUE(frame != NULL);
+        ASSERT_TRUE(layers != NULL);
+        ASSERT_TRUE(layers->background != NULL);
+
+        ASSERT_EQUAL(frame->size.x, layers->background->size.x);
+        ASSERT_EQUAL(frame->size.y, layers->background->size.y);
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    const Halo*       halo = layers->halo;
+    const MovedImage* fg   = layers->foreground;
+
+    SAFE_BLOCK_START    // Layers must lie inside the frame
+    {
+        if (halo)
+        {
+            ASSERT_LESS(
+                    halo->radius_px, HALO_MAX_RADIUS);
+            ASSERT_LESS(
+                    halo->center.x + halo->radius_px, frame->size.x);
+            ASSERT_LESS(
+                    halo->center.y + halo->radius_px, frame->size.y);
+            ASSERT_GREATER_EQUAL(
+                    halo->center.x, halo->radius_px);
+            ASSERT_GREATER_EQUAL(
+                    halo->center.y, halo->radius_px);
+        }
+
+        if (fg)
+        {
+            ASSERT_LESS_EQUAL(
+                    fg->pos.x + fg->size.x, frame->size.x);
+            ASSERT_LESS_EQUAL(
+                    fg->pos.y + fg->size.y, frame->size.y);
+            ASSERT_LESS(
+                    fg->blend_mode, BLEND_MODE_COUNT);
+
+            if (fg->spans)
+                ASSERT_EQUAL(
+                        fg->spans->row_count, fg->size.y);
+        }
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    return 0;
+}
+
+FrameRect get_halo_rect(const Halo* halo)
+{
+    // Bounding square includes both its first and last rows
+    const FrameRect result = {
+        .pos  = {
+            .x = halo->center.x - halo->radius_px,
+            .y = halo->center.y - halo->radius_px
+        },
+        .size = {
+            .x = 2 * halo->radius_px,
+            .y = 2 * halo->radius_px + 1
+        }
+    };
+
+    return result;
+}
+
+FrameRect get_image_rect(const MovedImage* image)
+{
+    const FrameRect result = {
+        .pos  = image->pos,
+        .size = image->size
+    };
+
+    return result;
+}
@@ -0,0 +1,87 @@
+/**
+ * @file frame.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Single-pass composition of a displayed frame
+ *
+ * @version 0.1
+ * @date 2023-04-27
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __FRAME_H
+#define __FRAME_H
+
+#include "commons/definitions.h"
+#include "commons/thread_pool.h"
+
+struct FrameRect
+{
+    SizeVector2 pos;
+    SizeVector2 size;
+};
+
+struct FrameLayers
+{
+    const PixelImage* background;
+    const Halo*       halo;         // Optional
+    const MovedImage* foreground;   // Optional, premultiplied by alpha
+};
+
+/**
+ * @brief Get rectangle of frame pixels, modified by halo
+ *
+ * @param[in] halo	- Halo parameters
+ *
+ * @return Bounding square of halo
+ */
+FrameRect get_halo_rect(const Halo* halo);
+
+/**
+ * @brief Get rectangle of frame pixels, covered by image
+ *
+ * @param[in] image	- Image, placed on frame
+ *
+ * @return Image rectangle
+ */
+FrameRect get_image_rect(const MovedImage* image);
+
+/**
+ * @brief Restore frame from background, apply halo and blend foreground on
+ * top of it. Unlike calling `memcpy`, `add_halo_parallel` and
+ * `blend_premultiplied` in turn, every frame row is processed by all layers
+ * at once, while it is still in cache, so frame is read and written only once.
+ *
+ * @param[out]   frame	    - Composed frame, same size as background
+ * @param[in]    layers	    - Frame layers
+ * @param[in]    streaming	- Whether frame rows are written with
+ *                            non-temporal stores, see `stream_rows.h`
+ * @param[inout] pool	    - Worker threads. If NULL, only the calling
+ *                            thread is used
+ *
+ * @return 0 upon success, -1 upon error
+ */
+int compose_frame(PixelImage* frame, const FrameLayers* layers,
+                  StreamingMode streaming, ThreadPool* pool);
+
+/**
+ * @brief Same as `compose_frame`, but only pixels inside the region are
+ * restored and recomposed. Layers, crossing region border, are clipped.
+ *
+ * @param[inout] frame	    - Previously composed frame, same size as
+ *                            background
+ * @param[in]    layers	    - Frame layers
+ * @param[in]    region	    - Region to be recomposed, must lie inside frame
+ * @param[in]    streaming	- Whether region rows are written with
+ *                            non-temporal stores. Automatic mode decides
+ *                            by region size
+ * @param[inout] pool	    - Worker threads. If NULL, only the calling
+ *                            thread is used
+ *
+ * @return 0 upon success, -1 upon error
+ */
+int compose_frame_region(PixelImage* frame, const FrameLayers* layers,
+                         const FrameRect* region, StreamingMode streaming,
+                         ThreadPool* pool);
+
+#endif /* frame.h */
@@ -0,0 +1,189 @@
+#include <string.h>
+
+#include "meerkat_assert/asserts.h"
+#include "commons/cpu_features.h"
+
+#include "layer_stack.h"
+#include "porter_duff_rows.h"
+
+// Indexed by PorterDuffOperator and SimdLevel
+static porter_duff_row_t* const
+PORTER_DUFF_ROW_KERNELS[PORTER_DUFF_COUNT][SIMD_LEVEL_COUNT] = {
+    {
+        porter_duff_row_over_scalar,
+        porter_duff_row_over_sse4,
+        porter_duff_row_over_avx2,
+        porter_duff_row_over_avx512
+    },
+    {
+        porter_duff_row_in_scalar,
+        porter_duff_row_in_sse4,
+        porter_duff_row_in_avx2,
+        porter_duff_row_in_avx512
+    },
+    {
+        porter_duff_row_out_scalar,
+        porter_duff_row_out_sse4,
+        porter_duff_row_out_avx2,
+        porter_duff_row_out_avx512
+    },
+    {
+        porter_duff_row_atop_scalar,
+        porter_duff_row_atop_sse4,
+        porter_duff_row_atop_avx2,
+        porter_duff_row_atop_avx512
+    },
+    {
+        porter_duff_row_xor_scalar,
+        porter_duff_row_xor_sse4,
+        porter_duff_row_xor_avx2,
+        porter_duff_row_xor_avx512
+    }
+};
+
+porter_duff_row_t* get_porter_duff_row_kernel(PorterDuffOperator op)
+{
+    return PORTER_DUFF_ROW_KERNELS[op][get_simd_level()];
+}
+
+struct CompositeRowsTask
+{
+    Pixel*       target_pixels;
+    SizeVector2  target_size;
+
+    const Layer* layers;
+    size_t       layer_count;
+
+    SimdLevel    simd_level;
+};
+
+__always_inline
+static bool is_clearing(PorterDuffOperator op)
+{
+    return op == PORTER_DUFF_IN || op == PORTER_DUFF_OUT;
+}
+
+/*
+ * Apply all layers to columns [tile_begin; tile_end) of target row
+ */
+static void composite_tile(const CompositeRowsTask* task, Pixel* target_row,
+                           size_t y, size_t tile_begin, size_t tile_end)
+{
+    for (size_t i = 0; i < task->layer_count; ++i)
+    {
+        const Layer* layer = task->layers + i;
+
+        const size_t layer_end = layer->pos.x + layer->size.x;
+
+        const size_t begin = layer->pos.x > tile_begin
+                           ? layer->pos.x : tile_begin;
+        const size_t end   = layer_end < tile_end ? layer_end : tile_end;
+
+        const bool is_covered = y - layer->pos.y < layer->size.y
+                             && begin < end;
+
+        if (!is_covered)
+        {
+            if (is_clearing(layer->op))
+                memset(target_row + tile_begin, 0,
+                       (tile_end - tile_begin) * sizeof(*target_row));
+            continue;
+        }
+
+        if (is_clearing(layer->op))
+        {
+            memset(target_row + tile_begin, 0,
+                   (begin - tile_begin) * sizeof(*target_row));
+            memset(target_row + end, 0,
+                   (tile_end - end) * sizeof(*target_row));
+        }
+
+        const Pixel* layer_row = layer->pixel_array
+                               + (y - layer->pos.y) * layer->size.x
+                               + (begin - layer->pos.x);
+
+        PORTER_DUFF_ROW_KERNELS[layer->op][task->simd_level](
+                target_row + begin, layer_row, end - begin, layer->opacity);
+    }
+}
+
+static bool is_tile_touched(const CompositeRowsTask* task,
+                            size_t y, size_t tile_begin, size_t tile_end)
+{
+    for (size_t i = 0; i < task->layer_count; ++i)
+    {
+        const Layer* layer = task->layers + i;
+
+        if (is_clearing(layer->op))
+            return true;
+
+        if (y - layer->pos.y < layer->size.y &&
+            layer->pos.x < tile_end &&
+            tile_begin < layer->pos.x + layer->size.x)
+            return true;
+    }
+
+    return false;
+}
+
+static void composite_rows(void* task_ptr, size_t begin, size_t end)
+{
+    const CompositeRowsTask* task = (const CompositeRowsTask*) task_ptr;
+
+    const size_t size_x = task->target_size.x;
+
+    Pixel* target_row = task->target_pixels + begin * size_x;
+
+    for (size_t y = begin; y < end; ++y)
+    {
+        for (size_t tile = 0; tile < size_x; tile += LAYER_TILE_WIDTH)
+        {
+            const size_t tile_end = tile + LAYER_TILE_WIDTH < size_x
+                                  ? tile + LAYER_TILE_WIDTH : size_x;
+
+            if (is_tile_touched(task, y, tile, tile_end))
+                composite_tile(task, target_row, y, tile, tile_end);
+        }
+
+        target_row += size_x;
+    }
+}
+
+int composite_layers(PixelImage* target, const Layer* layers,
+                     size_t layer_count, ThreadPool* pool)
+{
+    SAFE_BLOCK_START
+    {
+        ASSERT_TRUE(target != NULL);
+        ASSERT_TRUE(target->pixel_array != NULL);
+        ASSERT_TRUE(layers != NULL || layer_count == 0);
+
+        for (size_t i = 0; i < layer_count; ++i)
+        {
+            ASSERT_TRUE(layers[i].pixel_array != NULL);
+            ASSERT_LESS(layers[i].op, PORTER_DUFF_COUNT);
+        }
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    CompositeRowsTask task = {
+        .target_pixels   = target->pixel_array,
+        .target_size     = target->size,
+        .layers          = layers,
+        .layer_count     = layer_count,
+        .simd_level      = get_simd_level()
+    };
+
+    if (pool)
+        thread_pool_run(pool, composite_rows, &task, target->size.y);
+    else
+        composite_rows(&task, 0, target->size.y);
+
+    return 0;
+}
@@ -0,0 +1,55 @@
+/**
+ * @file layer_stack.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Compositing of an ordered stack of layers with Porter-Duff operators
+ *
+ * @version 0.1
+ * @date 2023-04-29
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __LAYER_STACK_H
+#define __LAYER_STACK_H
+
+#include "commons/definitions.h"
+#include "commons/thread_pool.h"
+
+/**
+ * @brief Target is processed in tiles of a single row and at most this many
+ * pixels, which stay in L1 cache while all layers are applied to them
+ */
+#define LAYER_TILE_WIDTH 512
+
+struct Layer
+{
+    const Pixel*       pixel_array;     // Premultiplied by alpha
+    SizeVector2        size;
+    SizeVector2        pos;             // Parts outside of target are clipped
+
+    uint8_t            opacity;         // 255 is fully opaque
+    PorterDuffOperator op;
+};
+
+/**
+ * @brief Composite layers on top of target, from the first layer to the last.
+ * Target contents serve as the bottom layer. Outside of its rectangle layer
+ * is fully transparent, so `PORTER_DUFF_IN` and `PORTER_DUFF_OUT` layers
+ * clear the rest of target.
+ *
+ * Unlike calling blending functions once per layer, all layers are applied
+ * to a tile before moving on to the next one, so every target pixel is
+ * written to memory only once.
+ *
+ * @param[inout] target	        - Target image, premultiplied by alpha
+ * @param[in]    layers	        - Layers, from bottom to top
+ * @param[in]    layer_count	- Number of layers
+ * @param[inout] pool	        - Worker threads. If NULL, only the calling
+ *                                thread is used
+ *
+ * @return 0 upon success, -1 upon error
+ */
+int composite_layers(PixelImage* target, const Layer* layers,
+                     size_t layer_count, ThreadPool* pool);
+
+#endif /* layer_stack.h */
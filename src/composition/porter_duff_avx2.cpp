@@ -0,0 +1,128 @@
+#include "commons/intrinsics.h"
+
+#include "porter_duff_rows.h"
+
+/*
+ * Inside of each 128-bit lane copies alpha of two pixels, unpacked to
+ * 16-bit words, into all four words of their channels
+ */
+#define PORTER_DUFF_ALPHA_ROW \
+    15, 14, 15, 14, 15, 14, 15, 14, 7, 6, 7, 6, 7, 6, 7, 6
+
+// Correctly rounded division of 16-bit words by 255, saturated
+__always_inline
+static __m256i divide_255(__m256i words)
+{
+    words = _mm256_adds_epu16(words, _mm256_set1_epi16(128));
+
+    return _mm256_mulhi_epu16(words, _mm256_set1_epi16(257));
+}
+
+static __m256i combine_words(__m256i dst, __m256i src, PorterDuffOperator op,
+                             __m256i opacity, bool is_faded)
+{
+    const __m256i ALPHA_MASK = _mm256_set_epi8(PORTER_DUFF_ALPHA_ROW,
+                                               PORTER_DUFF_ALPHA_ROW);
+    const __m256i MAX = _mm256_set1_epi16(255);
+
+    if (is_faded)
+        src = divide_255(_mm256_mullo_epi16(src, opacity));
+
+    const __m256i src_alpha = _mm256_shuffle_epi8(src, ALPHA_MASK);
+    const __m256i dst_alpha = _mm256_shuffle_epi8(dst, ALPHA_MASK);
+
+    __m256i src_factor = MAX;
+    __m256i dst_factor = _mm256_sub_epi16(MAX, src_alpha);
+
+    switch (op)
+    {
+        case PORTER_DUFF_IN:
+            src_factor = dst_alpha;
+            return divide_255(_mm256_mullo_epi16(src, src_factor));
+        case PORTER_DUFF_OUT:
+            src_factor = _mm256_sub_epi16(MAX, dst_alpha);
+            return divide_255(_mm256_mullo_epi16(src, src_factor));
+        case PORTER_DUFF_ATOP:
+            src_factor = dst_alpha;
+            break;
+        case PORTER_DUFF_XOR:
+            src_factor = _mm256_sub_epi16(MAX, dst_alpha);
+            break;
+        case PORTER_DUFF_OVER:
+        case PORTER_DUFF_COUNT:
+        default:
+            break;
+    }
+
+    return divide_255(_mm256_adds_epu16(_mm256_mullo_epi16(src, src_factor),
+                                        _mm256_mullo_epi16(dst, dst_factor)));
+}
+
+__always_inline
+static __m256i combine_porter_duff_simd(__m256i dst, __m256i src,
+                                        PorterDuffOperator op,
+                                        __m256i opacity, bool is_faded)
+{
+    const __m256i zero = _mm256_setzero_si256();
+
+    __m256i low  = combine_words(_mm256_unpacklo_epi8(dst, zero),
+                                 _mm256_unpacklo_epi8(src, zero),
+                                 op, opacity, is_faded);
+    __m256i high = combine_words(_mm256_unpackhi_epi8(dst, zero),
+                                 _mm256_unpackhi_epi8(src, zero),
+                                 op, opacity, is_faded);
+
+    return _mm256_packus_epi16(low, high);
+}
+
+__always_inline
+static void porter_duff_row_with(Pixel* dst, const Pixel* src, size_t count,
+                                 uint8_t opacity, PorterDuffOperator op)
+{
+    const __m256i opacity_words = _mm256_set1_epi16(opacity);
+    const bool    is_faded      = opacity != 255;
+
+    size_t x = 0;
+    for (; x + 8 <= count; x += 8)
+    {
+        __m256i dst_pixels = _mm256_loadu_si256((const __m256i*)(dst + x));
+        __m256i src_pixels = _mm256_loadu_si256((const __m256i*)(src + x));
+        __m256i result = combine_porter_duff_simd(dst_pixels, src_pixels, op,
+                                                  opacity_words, is_faded);
+        _mm256_storeu_si256((__m256i*)(dst + x), result);
+    }
+
+    // Remaining pixels
+    for (; x < count; ++x)
+        combine_pixels_porter_duff(dst + x, src + x, op, opacity);
+}
+
+void porter_duff_row_over_avx2(Pixel* dst, const Pixel* src, size_t count,
+                               uint8_t opacity)
+{
+    porter_duff_row_with(dst, src, count, opacity, PORTER_DUFF_OVER);
+}
+
+void porter_duff_row_in_avx2(Pixel* dst, const Pixel* src, size_t count,
+                             uint8_t opacity)
+{
+    porter_duff_row_with(dst, src, count, opacity, PORTER_DUFF_IN);
+}
+
+void porter_duff_row_out_avx2(Pixel* dst, const Pixel* src, size_t count,
+                              uint8_t opacity)
+{
+    porter_duff_row_with(dst, src, count, opacity, PORTER_DUFF_OUT);
+}
+
+void porter_duff_row_atop_avx2(Pixel* dst, const Pixel* src, size_t count,
+                               uint8_t opacity)
+{
+    porter_duff_row_with(dst, src, count, opacity, PORTER_DUFF_ATOP);
+}
+
+void porter_duff_row_xor_avx2(Pixel* dst, const Pixel* src, size_t count,
+                              uint8_t opacity)
+{
+    porter_duff_row_with(dst, src, count, opacity, PORTER_DUFF_XOR);
+}
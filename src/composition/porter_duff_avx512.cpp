@@ -0,0 +1,137 @@
+#include "commons/intrinsics.h"
+
+#include "porter_duff_rows.h"
+
+/*
+ * Inside of each 128-bit lane copies alpha of two pixels, unpacked to
+ * 16-bit words, into all four words of their channels
+ */
+#define PORTER_DUFF_ALPHA_ROW \
+    15, 14, 15, 14, 15, 14, 15, 14, 7, 6, 7, 6, 7, 6, 7, 6
+
+// Correctly rounded division of 16-bit words by 255, saturated
+__always_inline
+static __m512i divide_255(__m512i words)
+{
+    words = _mm512_adds_epu16(words, _mm512_set1_epi16(128));
+
+    return _mm512_mulhi_epu16(words, _mm512_set1_epi16(257));
+}
+
+static __m512i combine_words(__m512i dst, __m512i src, PorterDuffOperator op,
+                             __m512i opacity, bool is_faded)
+{
+    const __m512i ALPHA_MASK = _mm512_set_epi8(PORTER_DUFF_ALPHA_ROW,
+                                               PORTER_DUFF_ALPHA_ROW,
+                                               PORTER_DUFF_ALPHA_ROW,
+                                               PORTER_DUFF_ALPHA_ROW);
+    const __m512i MAX = _mm512_set1_epi16(255);
+
+    if (is_faded)
+        src = divide_255(_mm512_mullo_epi16(src, opacity));
+
+    const __m512i src_alpha = _mm512_shuffle_epi8(src, ALPHA_MASK);
+    const __m512i dst_alpha = _mm512_shuffle_epi8(dst, ALPHA_MASK);
+
+    __m512i src_factor = MAX;
+    __m512i dst_factor = _mm512_sub_epi16(MAX, src_alpha);
+
+    switch (op)
+    {
+        case PORTER_DUFF_IN:
+            src_factor = dst_alpha;
+            return divide_255(_mm512_mullo_epi16(src, src_factor));
+        case PORTER_DUFF_OUT:
+            src_factor = _mm512_sub_epi16(MAX, dst_alpha);
+            return divide_255(_mm512_mullo_epi16(src, src_factor));
+        case PORTER_DUFF_ATOP:
+            src_factor = dst_alpha;
+            break;
+        case PORTER_DUFF_XOR:
+            src_factor = _mm512_sub_epi16(MAX, dst_alpha);
+            break;
+        case PORTER_DUFF_OVER:
+        case PORTER_DUFF_COUNT:
+        default:
+            break;
+    }
+
+    return divide_255(_mm512_adds_epu16(_mm512_mullo_epi16(src, src_factor),
+                                        _mm512_mullo_epi16(dst, dst_factor)));
+}
+
+__always_inline
+static __m512i combine_porter_duff_simd(__m512i dst, __m512i src,
+                                        PorterDuffOperator op,
+                                        __m512i opacity, bool is_faded)
+{
+    const __m512i zero = _mm512_setzero_si512();
+
+    __m512i low  = combine_words(_mm512_unpacklo_epi8(dst, zero),
+                                 _mm512_unpacklo_epi8(src, zero),
+                                 op, opacity, is_faded);
+    __m512i high = combine_words(_mm512_unpackhi_epi8(dst, zero),
+                                 _mm512_unpackhi_epi8(src, zero),
+                                 op, opacity, is_faded);
+
+    return _mm512_packus_epi16(low, high);
+}
+
+__always_inline
+static void porter_duff_row_with(Pixel* dst, const Pixel* src, size_t count,
+                                 uint8_t opacity, PorterDuffOperator op)
+{
+    const __m512i opacity_words = _mm512_set1_epi16(opacity);
+    const bool    is_faded      = opacity != 255;
+
+    size_t x = 0;
+    for (; x + 16 <= count; x += 16)
+    {
+        __m512i dst_pixels = _mm512_loadu_si512(dst + x);
+        __m512i src_pixels = _mm512_loadu_si512(src + x);
+        __m512i result = combine_porter_duff_simd(dst_pixels, src_pixels, op,
+                                                  opacity_words, is_faded);
+        _mm512_storeu_si512(dst + x, result);
+    }
+
+    if (x < count)
+    {
+        const __mmask16 mask = _cvtu32_mask16((1u << (count - x)) - 1);
+
+        __m512i dst_pixels = _mm512_maskz_loadu_epi32(mask, dst + x);
+        __m512i src_pixels = _mm512_maskz_loadu_epi32(mask, src + x);
+        __m512i result = combine_porter_duff_simd(dst_pixels, src_pixels, op,
+                                                  opacity_words, is_faded);
+        _mm512_mask_storeu_epi32(dst + x, mask, result);
+    }
+}
+
+void porter_duff_row_over_avx512(Pixel* dst, const Pixel* src, size_t count,
+                                 uint8_t opacity)
+{
+    porter_duff_row_with(dst, src, count, opacity, PORTER_DUFF_OVER);
+}
+
+void porter_duff_row_in_avx512(Pixel* dst, const Pixel* src, size_t count,
+                               uint8_t opacity)
+{
+    porter_duff_row_with(dst, src, count, opacity, PORTER_DUFF_IN);
+}
+
+void porter_duff_row_out_avx512(Pixel* dst, const Pixel* src, size_t count,
+                                uint8_t opacity)
+{
+    porter_duff_row_with(dst, src, count, opacity, PORTER_DUFF_OUT);
+}
+
+void porter_duff_row_atop_avx512(Pixel* dst, const Pixel* src, size_t count,
+                                 uint8_t opacity)
+{
+    porter_duff_row_with(dst, src, count, opacity, PORTER_DUFF_ATOP);
+}
+
+void porter_duff_row_xor_avx512(Pixel* dst, const Pixel* src, size_t count,
+                                uint8_t opacity)
+{
+    porter_duff_row_with(dst, src, count, opacity, PORTER_DUFF_XOR);
+}
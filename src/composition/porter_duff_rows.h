@@ -0,0 +1,77 @@
+/**
+ * @file porter_duff_rows.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Porter-Duff row kernels, built for several instruction set levels
+ *
+ * @version 0.1
+ * @date 2023-04-29
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __PORTER_DUFF_ROWS_H
+#define __PORTER_DUFF_ROWS_H
+
+#include "commons/definitions.h"
+
+/**
+ * @brief Composite premultiplied source pixel with destination one:
+ * `dst = src*Fa + dst*Fb`, where factors Fa and Fb are determined by
+ * operator. Source is first multiplied by opacity. Division by 255 is
+ * correctly rounded, sums are saturated.
+ *
+ * @param[inout] dst	    - Destination pixel
+ * @param[in]    src	    - Source pixel
+ * @param[in]    op	        - Porter-Duff operator
+ * @param[in]    opacity	- Source opacity, 255 is fully opaque
+ */
+void combine_pixels_porter_duff(Pixel* dst, const Pixel* src,
+                                PorterDuffOperator op, uint8_t opacity);
+
+/**
+ * @brief Composite a row of premultiplied source pixels with destination
+ * row, as `combine_pixels_porter_duff` does
+ *
+ * @param[inout] dst	    - Destination row
+ * @param[in]    src	    - Source row
+ * @param[in]    count	    - Number of pixels in row
+ * @param[in]    opacity	- Source opacity, 255 is fully opaque
+ */
+typedef void porter_duff_row_t(Pixel* dst, const Pixel* src, size_t count,
+                               uint8_t opacity);
+
+porter_duff_row_t porter_duff_row_over_scalar;
+porter_duff_row_t porter_duff_row_over_sse4;
+porter_duff_row_t porter_duff_row_over_avx2;
+porter_duff_row_t porter_duff_row_over_avx512;
+
+porter_duff_row_t porter_duff_row_in_scalar;
+porter_duff_row_t porter_duff_row_in_sse4;
+porter_duff_row_t porter_duff_row_in_avx2;
+porter_duff_row_t porter_duff_row_in_avx512;
+
+porter_duff_row_t porter_duff_row_out_scalar;
+porter_duff_row_t porter_duff_row_out_sse4;
+porter_duff_row_t porter_duff_row_out_avx2;
+porter_duff_row_t porter_duff_row_out_avx512;
+
+porter_duff_row_t porter_duff_row_atop_scalar;
+porter_duff_row_t porter_duff_row_atop_sse4;
+porter_duff_row_t porter_duff_row_atop_avx2;
+porter_duff_row_t porter_duff_row_atop_avx512;
+
+porter_duff_row_t porter_duff_row_xor_scalar;
+porter_duff_row_t porter_duff_row_xor_sse4;
+porter_duff_row_t porter_duff_row_xor_avx2;
+porter_duff_row_t porter_duff_row_xor_avx512;
+
+/**
+ * @brief Get the fastest Porter-Duff row kernel, supported by CPU
+ *
+ * @param[in] op	- Operator, applied by kernel
+ *
+ * @return Kernel from the dispatch table
+ */
+porter_duff_row_t* get_porter_duff_row_kernel(PorterDuffOperator op);
+
+#endif /* porter_duff_rows.h */
@@ -0,0 +1,109 @@
+#include "porter_duff_rows.h"
+
+__always_inline
+static uint8_t divide_saturated(uint32_t value)
+{
+    // Same as saturating 16-bit arithmetic in vector kernels
+    if (value > UINT16_MAX - 128)
+        value = UINT16_MAX - 128;
+
+    const uint32_t result = ((value + 128) * 257) >> 16;
+
+    return (uint8_t) (result > 255 ? 255 : result);
+}
+
+__always_inline
+static void get_factors(PorterDuffOperator op,
+                        uint32_t src_alpha, uint32_t dst_alpha,
+                        uint32_t* src_factor, uint32_t* dst_factor)
+{
+    switch (op)
+    {
+        case PORTER_DUFF_IN:
+            *src_factor = dst_alpha;
+            *dst_factor = 0;
+            break;
+        case PORTER_DUFF_OUT:
+            *src_factor = 255 - dst_alpha;
+            *dst_factor = 0;
+            break;
+        case PORTER_DUFF_ATOP:
+            *src_factor = dst_alpha;
+            *dst_factor = 255 - src_alpha;
+            break;
+        case PORTER_DUFF_XOR:
+            *src_factor = 255 - dst_alpha;
+            *dst_factor = 255 - src_alpha;
+            break;
+        case PORTER_DUFF_OVER:
+        case PORTER_DUFF_COUNT:
+        default:
+            *src_factor = 255;
+            *dst_factor = 255 - src_alpha;
+            break;
+    }
+}
+
+void combine_pixels_porter_duff(Pixel* dst, const Pixel* src,
+                                PorterDuffOperator op, uint8_t opacity)
+{
+    Pixel faded = *src;
+
+    if (opacity != 255)
+    {
+        faded.red   = divide_saturated((uint32_t) src->red   * opacity);
+        faded.green = divide_saturated((uint32_t) src->green * opacity);
+        faded.blue  = divide_saturated((uint32_t) src->blue  * opacity);
+        faded.alpha = divide_saturated((uint32_t) src->alpha * opacity);
+    }
+
+    uint32_t src_factor = 0, dst_factor = 0;
+    get_factors(op, faded.alpha, dst->alpha, &src_factor, &dst_factor);
+
+    dst->red   = divide_saturated(faded.red   * src_factor
+                                + dst->red    * dst_factor);
+    dst->green = divide_saturated(faded.green * src_factor
+                                + dst->green  * dst_factor);
+    dst->blue  = divide_saturated(faded.blue  * src_factor
+                                + dst->blue   * dst_factor);
+    dst->alpha = divide_saturated(faded.alpha * src_factor
+                                + dst->alpha  * dst_factor);
+}
+
+__always_inline
+static void porter_duff_row_with(Pixel* dst, const Pixel* src, size_t count,
+                                 uint8_t opacity, PorterDuffOperator op)
+{
+    for (size_t x = 0; x < count; ++x)
+        combine_pixels_porter_duff(dst + x, src + x, op, opacity);
+}
+
+void porter_duff_row_over_scalar(Pixel* dst, const Pixel* src, size_t count,
+                                 uint8_t opacity)
+{
+    porter_duff_row_with(dst, src, count, opacity, PORTER_DUFF_OVER);
+}
+
+void porter_duff_row_in_scalar(Pixel* dst, const Pixel* src, size_t count,
+                               uint8_t opacity)
+{
+    porter_duff_row_with(dst, src, count, opacity, PORTER_DUFF_IN);
+}
+
+void porter_duff_row_out_scalar(Pixel* dst, const Pixel* src, size_t count,
+                                uint8_t opacity)
+{
+    porter_duff_row_with(dst, src, count, opacity, PORTER_DUFF_OUT);
+}
+
+void porter_duff_row_atop_scalar(Pixel* dst, const Pixel* src, size_t count,
+                                 uint8_t opacity)
+{
+    porter_duff_row_with(dst, src, count, opacity, PORTER_DUFF_ATOP);
+}
+
+void porter_duff_row_xor_scalar(Pixel* dst, const Pixel* src, size_t count,
+                                uint8_t opacity)
+{
+    porter_duff_row_with(dst, src, count, opacity, PORTER_DUFF_XOR);
+}
@@ -0,0 +1,127 @@
+#include "commons/intrinsics.h"
+
+#include "porter_duff_rows.h"
+
+/*
+ * Inside of each 128-bit lane copies alpha of two pixels, unpacked to
+ * 16-bit words, into all four words of their channels
+ */
+#define PORTER_DUFF_ALPHA_ROW \
+    15, 14, 15, 14, 15, 14, 15, 14, 7, 6, 7, 6, 7, 6, 7, 6
+
+// Correctly rounded division of 16-bit words by 255, saturated
+__always_inline
+static __m128i divide_255(__m128i words)
+{
+    words = _mm_adds_epu16(words, _mm_set1_epi16(128));
+
+    return _mm_mulhi_epu16(words, _mm_set1_epi16(257));
+}
+
+static __m128i combine_words(__m128i dst, __m128i src, PorterDuffOperator op,
+                             __m128i opacity, bool is_faded)
+{
+    const __m128i ALPHA_MASK = _mm_set_epi8(PORTER_DUFF_ALPHA_ROW);
+    const __m128i MAX = _mm_set1_epi16(255);
+
+    if (is_faded)
+        src = divide_255(_mm_mullo_epi16(src, opacity));
+
+    const __m128i src_alpha = _mm_shuffle_epi8(src, ALPHA_MASK);
+    const __m128i dst_alpha = _mm_shuffle_epi8(dst, ALPHA_MASK);
+
+    __m128i src_factor = MAX;
+    __m128i dst_factor = _mm_sub_epi16(MAX, src_alpha);
+
+    switch (op)
+    {
+        case PORTER_DUFF_IN:
+            src_factor = dst_alpha;
+            return divide_255(_mm_mullo_epi16(src, src_factor));
+        case PORTER_DUFF_OUT:
+            src_factor = _mm_sub_epi16(MAX, dst_alpha);
+            return divide_255(_mm_mullo_epi16(src, src_factor));
+        case PORTER_DUFF_ATOP:
+            src_factor = dst_alpha;
+            break;
+        case PORTER_DUFF_XOR:
+            src_factor = _mm_sub_epi16(MAX, dst_alpha);
+            break;
+        case PORTER_DUFF_OVER:
+        case PORTER_DUFF_COUNT:
+        default:
+            break;
+    }
+
+    return divide_255(_mm_adds_epu16(_mm_mullo_epi16(src, src_factor),
+                                     _mm_mullo_epi16(dst, dst_factor)));
+}
+
+__always_inline
+static __m128i combine_porter_duff_simd(__m128i dst, __m128i src,
+                                        PorterDuffOperator op,
+                                        __m128i opacity, bool is_faded)
+{
+    const __m128i zero = _mm_setzero_si128();
+
+    __m128i low  = combine_words(_mm_unpacklo_epi8(dst, zero),
+                                 _mm_unpacklo_epi8(src, zero),
+                                 op, opacity, is_faded);
+    __m128i high = combine_words(_mm_unpackhi_epi8(dst, zero),
+                                 _mm_unpackhi_epi8(src, zero),
+                                 op, opacity, is_faded);
+
+    return _mm_packus_epi16(low, high);
+}
+
+__always_inline
+static void porter_duff_row_with(Pixel* dst, const Pixel* src, size_t count,
+                                 uint8_t opacity, PorterDuffOperator op)
+{
+    const __m128i opacity_words = _mm_set1_epi16(opacity);
+    const bool    is_faded      = opacity != 255;
+
+    size_t x = 0;
+    for (; x + 4 <= count; x += 4)
+    {
+        __m128i dst_pixels = _mm_loadu_si128((const __m128i*)(dst + x));
+        __m128i src_pixels = _mm_loadu_si128((const __m128i*)(src + x));
+        __m128i result = combine_porter_duff_simd(dst_pixels, src_pixels, op,
+                                                  opacity_words, is_faded);
+        _mm_storeu_si128((__m128i*)(dst + x), result);
+    }
+
+    // Remaining pixels
+    for (; x < count; ++x)
+        combine_pixels_porter_duff(dst + x, src + x, op, opacity);
+}
+
+void porter_duff_row_over_sse4(Pixel* dst, const Pixel* src, size_t count,
+                               uint8_t opacity)
+{
+    porter_duff_row_with(dst, src, count, opacity, PORTER_DUFF_OVER);
+}
+
+void porter_duff_row_in_sse4(Pixel* dst, const Pixel* src, size_t count,
+                             uint8_t opacity)
+{
+    porter_duff_row_with(dst, src, count, opacity, PORTER_DUFF_IN);
+}
+
+void porter_duff_row_out_sse4(Pixel* dst, const Pixel* src, size_t count,
+                              uint8_t opacity)
+{
+    porter_duff_row_with(dst, src, count, opacity, PORTER_DUFF_OUT);
+}
+
+void porter_duff_row_atop_sse4(Pixel* dst, const Pixel* src, size_t count,
+                               uint8_t opacity)
+{
+    porter_duff_row_with(dst, src, count, opacity, PORTER_DUFF_ATOP);
+}
+
+void porter_duff_row_xor_sse4(Pixel* dst, const Pixel* src, size_t count,
+                              uint8_t opacity)
+{
+    porter_duff_row_with(dst, src, count, opacity, PORTER_DUFF_XOR);
+}
@@ -0,0 +1,41 @@
+#include "commons/intrinsics.h"
+#include <stdint.h>
+#include <string.h>
+
+#include "stream_rows.h"
+
+void stream_row_avx2(Pixel* dst, const Pixel* src, size_t count)
+{
+    const size_t pixels_per_line = CACHE_LINE_SIZE / sizeof(Pixel);
+    const size_t misalignment    = (uintptr_t) dst % CACHE_LINE_SIZE;
+
+    // Pixels, which are not aligned by their size, are never streamed
+    size_t head = misalignment % sizeof(Pixel) == 0
+                ? (CACHE_LINE_SIZE - misalignment) % CACHE_LINE_SIZE
+                                                   / sizeof(Pixel)
+                : count;
+    if (head > count)
+        head = count;
+
+    memcpy(dst, src, head * sizeof(*dst));
+
+    size_t x = head;
+    for (; x + pixels_per_line <= count; x += pixels_per_line)
+    {
+        if (x + STREAM_PREFETCH_DISTANCE / sizeof(Pixel) < count)
+            _mm_prefetch((const char*) (src + x) + STREAM_PREFETCH_DISTANCE,
+                         _MM_HINT_T0);
+
+        const __m256i* src_line = (const __m256i*) (src + x);
+        __m256i*       dst_line = (__m256i*)       (dst + x);
+
+        const __m256i pixels0 = _mm256_loadu_si256(src_line + 0);
+        const __m256i pixels1 = _mm256_loadu_si256(src_line + 1);
+
+        _mm256_stream_si256(dst_line + 0, pixels0);
+        _mm256_stream_si256(dst_line + 1, pixels1);
+    }
+
+    // Remaining pixels
+    memcpy(dst + x, src + x, (count - x) * sizeof(*dst));
+}
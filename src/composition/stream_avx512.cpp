@@ -0,0 +1,58 @@
+#include "commons/intrinsics.h"
+#include <stdint.h>
+
+#include "stream_rows.h"
+
+/*
+ * Regular masked copy of less than a cache line
+ */
+__always_inline
+static void copy_masked(Pixel* dst, const Pixel* src, size_t count)
+{
+    const __mmask16 mask = _cvtu32_mask16((1u << count) - 1);
+
+    __m512i pixels = _mm512_maskz_loadu_epi32(mask, src);
+    _mm512_mask_storeu_epi32(dst, mask, pixels);
+}
+
+void stream_row_avx512(Pixel* dst, const Pixel* src, size_t count)
+{
+    const size_t pixels_per_line = CACHE_LINE_SIZE / sizeof(Pixel);
+    const size_t misalignment    = (uintptr_t) dst % CACHE_LINE_SIZE;
+
+    size_t x = 0;
+
+    if (misalignment % sizeof(Pixel) == 0)
+    {
+        size_t head = (CACHE_LINE_SIZE - misalignment) % CACHE_LINE_SIZE
+                    / sizeof(Pixel);
+        if (head > count)
+            head = count;
+
+        if (head > 0)
+            copy_masked(dst, src, head);
+
+        for (x = head; x + pixels_per_line <= count; x += pixels_per_line)
+        {
+            if (x + STREAM_PREFETCH_DISTANCE / sizeof(Pixel) < count)
+                _mm_prefetch((const char*) (src + x)
+                                + STREAM_PREFETCH_DISTANCE,
+                             _MM_HINT_T0);
+
+            __m512i pixels = _mm512_loadu_si512(src + x);
+            _mm512_stream_si512((__m512i*) (dst + x), pixels);
+        }
+    }
+    else    // Pixels are not even aligned by their size, nothing to stream
+    {
+        for (x = 0; x + pixels_per_line <= count; x += pixels_per_line)
+        {
+            __m512i pixels = _mm512_loadu_si512(src + x);
+            _mm512_storeu_si512(dst + x, pixels);
+        }
+    }
+
+    // Remaining pixels
+    if (x < count)
+        copy_masked(dst + x, src + x, count - x);
+}
@@ -0,0 +1,61 @@
+/**
+ * @file stream_rows.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Row copy kernels with non-temporal stores, built for several
+ * instruction set levels
+ *
+ * @version 0.1
+ * @date 2023-05-04
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __STREAM_ROWS_H
+#define __STREAM_ROWS_H
+
+#include "commons/definitions.h"
+
+/**
+ * @brief Source is prefetched this many bytes ahead of the copied cache line
+ */
+#define STREAM_PREFETCH_DISTANCE 512
+
+#define CACHE_LINE_SIZE 64
+
+/**
+ * @brief Copy row without reading destination into cache. Full cache lines
+ * of destination are written with non-temporal stores, which are weakly
+ * ordered: `_mm_sfence` must be executed before pixels are handed over
+ * to another thread.
+ *
+ * @param[out] dst	    - Destination row
+ * @param[in]  src	    - Source row
+ * @param[in]  count	- Number of pixels in row
+ */
+typedef void stream_row_t(Pixel* dst, const Pixel* src, size_t count);
+
+stream_row_t stream_row_scalar;     // Plain `memcpy`
+stream_row_t stream_row_sse4;
+stream_row_t stream_row_avx2;
+stream_row_t stream_row_avx512;
+
+/**
+ * @brief Get the widest streaming row kernel, supported by CPU
+ *
+ * @return Kernel from the dispatch table
+ */
+stream_row_t* get_stream_row_kernel(void);
+
+/**
+ * @brief Decide, whether frame region should be written with non-temporal
+ * stores. Automatic mode streams regions, which do not fit into last level
+ * of cache together with their source.
+ *
+ * @param[in] mode	        - Requested mode
+ * @param[in] byte_count	- Size of written region
+ *
+ * @return Whether stores should bypass cache
+ */
+bool is_streaming_enabled(StreamingMode mode, size_t byte_count);
+
+#endif /* stream_rows.h */
@@ -0,0 +1,8 @@
+#include <string.h>
+
+#include "stream_rows.h"
+
+void stream_row_scalar(Pixel* dst, const Pixel* src, size_t count)
+{
+    memcpy(dst, src, count * sizeof(*dst));
+}
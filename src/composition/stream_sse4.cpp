@@ -0,0 +1,46 @@
+#include "commons/intrinsics.h"
+#include <stdint.h>
+#include <string.h>
+
+#include "stream_rows.h"
+
+void stream_row_sse4(Pixel* dst, const Pixel* src, size_t count)
+{
+    const size_t pixels_per_line = CACHE_LINE_SIZE / sizeof(Pixel);
+    const size_t misalignment    = (uintptr_t) dst % CACHE_LINE_SIZE;
+
+    // Pixels, which are not aligned by their size, are never streamed
+    size_t head = misalignment % sizeof(Pixel) == 0
+                ? (CACHE_LINE_SIZE - misalignment) % CACHE_LINE_SIZE
+                                                   / sizeof(Pixel)
+                : count;
+    if (head > count)
+        head = count;
+
+    memcpy(dst, src, head * sizeof(*dst));
+
+    size_t x = head;
+    for (; x + pixels_per_line <= count; x += pixels_per_line)
+    {
+        if (x + STREAM_PREFETCH_DISTANCE / sizeof(Pixel) < count)
+            _mm_prefetch((const char*) (src + x) + STREAM_PREFETCH_DISTANCE,
+                         _MM_HINT_T0);
+
+        const __m128i* src_line = (const __m128i*) (src + x);
+        __m128i*       dst_line = (__m128i*)       (dst + x);
+
+        // Whole line is written at once, so it never has to be read
+        const __m128i pixels0 = _mm_loadu_si128(src_line + 0);
+        const __m128i pixels1 = _mm_loadu_si128(src_line + 1);
+        const __m128i pixels2 = _mm_loadu_si128(src_line + 2);
+        const __m128i pixels3 = _mm_loadu_si128(src_line + 3);
+
+        _mm_stream_si128(dst_line + 0, pixels0);
+        _mm_stream_si128(dst_line + 1, pixels1);
+        _mm_stream_si128(dst_line + 2, pixels2);
+        _mm_stream_si128(dst_line + 3, pixels3);
+    }
+
+    // Remaining pixels
+    memcpy(dst + x, src + x, (count - x) * sizeof(*dst));
+}
@@ -13,6 +13,7 @@
 #define __HALO_H
 
 #include "commons/definitions.h"
+#include "commons/thread_pool.h"
 
 /**
  * @brief Applies halo effect to the given position on image
@@ -30,4 +31,45 @@ int add_halo_simple(PixelImage* background, const Halo* halo);
  */
 int add_halo_optimized(PixelImage* background, const Halo* halo);
 
+/**
+ * @brief Applies halo effect to the given position on image.
+ * Rows are split into bands, processed by pool threads.
+ *
+ * @param[inout] background	- Image background to apply halo to
+ * @param[in]    halo	    - Halo parameters
+ * @param[inout] pool	    - Worker threads. If NULL, only the calling
+ *                            thread is used
+ */
+int add_halo_parallel(PixelImage* background, const Halo* halo,
+                      ThreadPool* pool);
+
+/**
+ * @brief Applies several halos to image, in array order. Halos are binned
+ * into strips of columns, one per thread, and every strip is modified by
+ * all halos overlapping it with a single dispatch. Unlike
+ * `add_halo_parallel`, halos may cross image edges and are clipped.
+ *
+ * @param[inout] background	- Image background to apply halos to
+ * @param[in]    halos	    - Halo parameters
+ * @param[in]    halo_count	- Number of halos
+ * @param[inout] pool	    - Worker threads. If NULL, only the calling
+ *                            thread is used
+ *
+ * @return 0 upon success, -1 upon invalid arguments or allocation failure
+ */
+int add_halos(PixelImage* background, const Halo* halos, size_t halo_count,
+              ThreadPool* pool);
+
+/**
+ * @brief Applies halo effect to the given position on 16-bit image.
+ * Halo alpha keeps fractional bits, lost in 8-bit kernels.
+ * Rows are split into bands, processed by pool threads.
+ *
+ * @param[inout] background	- Image background to apply halo to
+ * @param[in]    halo	    - Halo parameters
+ * @param[inout] pool	    - Worker threads. If NULL, only the calling
+ *                            thread is used
+ */
+int add_halo16(PixelImage16* background, const Halo* halo, ThreadPool* pool);
+
 #endif /* halo.h */
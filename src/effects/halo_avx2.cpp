@@ -0,0 +1,173 @@
+#include "commons/intrinsics.h"
+
+#include "blending/blender.h"
+#include "blending/blender16.h"
+#include "blending/shuffle_masks.h"
+
+#include "halo_rows.h"
+
+__always_inline
+static void blend_halo_vector(Pixel* row, __m256i halo_pixels)
+{
+    __m256i bg = _mm256_loadu_si256((const __m256i*) row);
+    __m256i result = combine_pixels_simd256(bg, halo_pixels);
+    _mm256_storeu_si256((__m256i*) row, result);
+}
+
+void add_halo_row_avx2(Pixel* top_row, Pixel* bottom_row, size_t dy,
+                       size_t x_begin, size_t x_end, const Halo* halo)
+{
+    size_t span_begin = 0, span_end = 0;
+    if (!get_halo_span(dy, x_begin, x_end, halo, &span_begin, &span_end))
+        return;
+
+    const uint32_t factor = get_halo_alpha_factor(halo);
+    const uint32_t radius = (uint32_t) halo->radius_px;
+    const uint32_t remainder = radius*radius - (uint32_t) (dy*dy);
+
+    // Color channels with zero alpha, so that alpha can be simply OR-ed in
+    const __m256i color = _mm256_set1_epi32(
+                            halo->color.red
+                          | halo->color.green << 8
+                          | halo->color.blue  << 16);
+
+    const __m256i dx = _mm256_add_epi32(
+            _mm256_set1_epi32((int) ((uint32_t) span_begin - radius)),
+            _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+
+    // alpha_fixed = (remainder - dx^2) * factor + bias
+    __m256i alpha_fixed = _mm256_sub_epi32(_mm256_set1_epi32((int) remainder),
+                                           _mm256_mullo_epi32(dx, dx));
+    alpha_fixed = _mm256_add_epi32(
+                    _mm256_mullo_epi32(alpha_fixed,
+                                       _mm256_set1_epi32((int) factor)),
+                    _mm256_set1_epi32((int) HALO_ALPHA_BIAS));
+
+    // Forward differences: moving by 8 columns adds
+    // -factor * (16*dx + 64), which itself decreases by 128*factor
+    __m256i step = _mm256_mullo_epi32(
+                    _mm256_add_epi32(_mm256_slli_epi32(dx, 4),
+                                     _mm256_set1_epi32(64)),
+                    _mm256_set1_epi32((int) (0u - factor)));
+    const __m256i step_delta = _mm256_set1_epi32((int) (128u * factor));
+
+    size_t x = span_begin;
+    for (; x + 8 <= span_end; x += 8)
+    {
+        __m256i alpha = _mm256_srli_epi32(alpha_fixed, HALO_ALPHA_SHIFT);
+        __m256i halo_pixels = _mm256_or_si256(_mm256_slli_epi32(alpha, 24),
+                                              color);
+
+        if (top_row)
+            blend_halo_vector(top_row + (x - x_begin), halo_pixels);
+        if (bottom_row)
+            blend_halo_vector(bottom_row + (x - x_begin), halo_pixels);
+
+        alpha_fixed = _mm256_add_epi32(alpha_fixed, step);
+        step = _mm256_sub_epi32(step, step_delta);
+    }
+
+    Pixel to_blend = halo->color;
+    for (; x < span_end; x++)
+    {
+        to_blend.alpha = (uint8_t) (get_halo_alpha_fixed(x, dy, factor, halo)
+                                    >> HALO_ALPHA_SHIFT);
+
+        if (top_row)
+            combine_pixels(top_row + (x - x_begin), &to_blend);
+        if (bottom_row)
+            combine_pixels(bottom_row + (x - x_begin), &to_blend);
+    }
+}
+
+__always_inline
+static void blend_halo16_vector(Pixel16* row, __m256i halo_pixels)
+{
+    __m256i bg = _mm256_loadu_si256((const __m256i*) row);
+    __m256i result = combine_pixels16_simd256(bg, halo_pixels);
+    _mm256_storeu_si256((__m256i*) row, result);
+}
+
+// Premultiplied halo pixels, see get_halo16_pixel
+__always_inline
+static __m256i get_halo16_pixels(__m128i alpha_fixed, __m256i color)
+{
+    const __m256i MASK_SPREAD_ALPHA = _mm256_set_epi8(
+        MASK_SPREAD_ALPHA16_ROW,
+        MASK_SPREAD_ALPHA16_ROW
+    );
+
+    __m128i alpha = _mm_srli_epi32(alpha_fixed, HALO_ALPHA_SHIFT - 8);
+    alpha = _mm_add_epi32(alpha, _mm_srli_epi32(alpha, 8));
+
+    // Alpha goes to the highest word of every pixel
+    const __m256i alpha_word = _mm256_slli_epi64(
+                                    _mm256_cvtepu32_epi64(alpha), 48);
+    const __m256i alpha_spread = _mm256_shuffle_epi8(alpha_word,
+                                                     MASK_SPREAD_ALPHA);
+
+    return _mm256_or_si256(_mm256_mulhi_epu16(color, alpha_spread),
+                           alpha_word);
+}
+
+void add_halo_row16_avx2(Pixel16* top_row, Pixel16* bottom_row, size_t dy,
+                         size_t x_begin, size_t x_end, const Halo* halo)
+{
+    size_t span_begin = 0, span_end = 0;
+    if (!get_halo_span(dy, x_begin, x_end, halo, &span_begin, &span_end))
+        return;
+
+    const uint32_t factor = get_halo16_alpha_factor(halo);
+    const uint32_t radius = (uint32_t) halo->radius_px;
+    const uint32_t remainder = radius*radius - (uint32_t) (dy*dy);
+
+    // Color channels with zero alpha, so that alpha can be simply OR-ed in
+    const __m256i color = _mm256_set1_epi64x((long long) (
+                            (uint64_t) (halo->color.red   * 257u)
+                          | (uint64_t) (halo->color.green * 257u) << 16
+                          | (uint64_t) (halo->color.blue  * 257u) << 32));
+
+    // Alpha is computed for 4 pixels, which fill a single vector
+    const __m128i dx = _mm_add_epi32(
+            _mm_set1_epi32((int) ((uint32_t) span_begin - radius)),
+            _mm_setr_epi32(0, 1, 2, 3));
+
+    // alpha_fixed = (remainder - dx^2) * factor
+    __m128i alpha_fixed = _mm_mullo_epi32(
+                            _mm_sub_epi32(_mm_set1_epi32((int) remainder),
+                                          _mm_mullo_epi32(dx, dx)),
+                            _mm_set1_epi32((int) factor));
+
+    // Forward differences: moving by 4 columns adds
+    // -factor * (8*dx + 16), which itself decreases by 32*factor
+    __m128i step = _mm_mullo_epi32(
+                    _mm_add_epi32(_mm_slli_epi32(dx, 3),
+                                  _mm_set1_epi32(16)),
+                    _mm_set1_epi32((int) (0u - factor)));
+    const __m128i step_delta = _mm_set1_epi32((int) (32u * factor));
+
+    size_t x = span_begin;
+    for (; x + 4 <= span_end; x += 4)
+    {
+        __m256i halo_pixels = get_halo16_pixels(alpha_fixed, color);
+
+        if (top_row)
+            blend_halo16_vector(top_row + (x - x_begin), halo_pixels);
+        if (bottom_row)
+            blend_halo16_vector(bottom_row + (x - x_begin), halo_pixels);
+
+        alpha_fixed = _mm_add_epi32(alpha_fixed, step);
+        step = _mm_sub_epi32(step, step_delta);
+    }
+
+    for (; x < span_end; x++)
+    {
+        const Pixel16 to_blend = get_halo16_pixel(
+                    halo->color, get_halo16_pixel_alpha(x, dy, factor, halo));
+
+        if (top_row)
+            combine_pixels16(top_row + (x - x_begin), &to_blend);
+        if (bottom_row)
+            combine_pixels16(bottom_row + (x - x_begin), &to_blend);
+    }
+}
@@ -0,0 +1,199 @@
+#include "commons/intrinsics.h"
+
+#include "blending/blender.h"
+#include "blending/blender16.h"
+#include "blending/shuffle_masks.h"
+
+#include "halo_rows.h"
+
+__always_inline
+static void blend_halo_vector(Pixel* row, __m512i halo_pixels)
+{
+    __m512i bg = _mm512_loadu_si512(row);
+    __m512i result = combine_pixels_simd(bg, halo_pixels);
+    _mm512_storeu_si512(row, result);
+}
+
+__always_inline
+static void blend_halo_masked(Pixel* row, __m512i halo_pixels,
+                              __mmask16 mask)
+{
+    __m512i bg = _mm512_maskz_loadu_epi32(mask, row);
+    __m512i result = combine_pixels_simd(bg, halo_pixels);
+    _mm512_mask_storeu_epi32(row, mask, result);
+}
+
+void add_halo_row_avx512(Pixel* top_row, Pixel* bottom_row, size_t dy,
+                         size_t x_begin, size_t x_end, const Halo* halo)
+{
+    size_t span_begin = 0, span_end = 0;
+    if (!get_halo_span(dy, x_begin, x_end, halo, &span_begin, &span_end))
+        return;
+
+    const uint32_t factor = get_halo_alpha_factor(halo);
+    const uint32_t radius = (uint32_t) halo->radius_px;
+    const uint32_t remainder = radius*radius - (uint32_t) (dy*dy);
+
+    // Color channels with zero alpha, so that alpha can be simply OR-ed in
+    const __m512i color = _mm512_set1_epi32(
+                            halo->color.red
+                          | halo->color.green << 8
+                          | halo->color.blue  << 16);
+
+    const __m512i dx = _mm512_add_epi32(
+            _mm512_set1_epi32((int) ((uint32_t) span_begin - radius)),
+            _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7,
+                              8, 9, 10, 11, 12, 13, 14, 15));
+
+    // alpha_fixed = (remainder - dx^2) * factor + bias
+    __m512i alpha_fixed = _mm512_sub_epi32(_mm512_set1_epi32((int) remainder),
+                                           _mm512_mullo_epi32(dx, dx));
+    alpha_fixed = _mm512_add_epi32(
+                    _mm512_mullo_epi32(alpha_fixed,
+                                       _mm512_set1_epi32((int) factor)),
+                    _mm512_set1_epi32((int) HALO_ALPHA_BIAS));
+
+    // Forward differences: moving by 16 columns adds
+    // -factor * (32*dx + 256), which itself decreases by 512*factor
+    __m512i step = _mm512_mullo_epi32(
+                    _mm512_add_epi32(_mm512_slli_epi32(dx, 5),
+                                     _mm512_set1_epi32(256)),
+                    _mm512_set1_epi32((int) (0u - factor)));
+    const __m512i step_delta = _mm512_set1_epi32((int) (512u * factor));
+
+    size_t x = span_begin;
+    for (; x + 16 <= span_end; x += 16)
+    {
+        __m512i alpha = _mm512_srli_epi32(alpha_fixed, HALO_ALPHA_SHIFT);
+        __m512i halo_pixels = _mm512_or_si512(_mm512_slli_epi32(alpha, 24),
+                                              color);
+
+        if (top_row)
+            blend_halo_vector(top_row + (x - x_begin), halo_pixels);
+        if (bottom_row)
+            blend_halo_vector(bottom_row + (x - x_begin), halo_pixels);
+
+        alpha_fixed = _mm512_add_epi32(alpha_fixed, step);
+        step = _mm512_sub_epi32(step, step_delta);
+    }
+
+    if (x < span_end)
+    {
+        const __mmask16 mask = _cvtu32_mask16(
+                                (1u << (span_end - x)) - 1);
+
+        __m512i alpha = _mm512_srli_epi32(alpha_fixed, HALO_ALPHA_SHIFT);
+        __m512i halo_pixels = _mm512_or_si512(_mm512_slli_epi32(alpha, 24),
+                                              color);
+
+        if (top_row)
+            blend_halo_masked(top_row + (x - x_begin), halo_pixels, mask);
+        if (bottom_row)
+            blend_halo_masked(bottom_row + (x - x_begin), halo_pixels, mask);
+    }
+}
+
+__always_inline
+static void blend_halo16_vector(Pixel16* row, __m512i halo_pixels)
+{
+    __m512i bg = _mm512_loadu_si512(row);
+    __m512i result = combine_pixels16_simd(bg, halo_pixels);
+    _mm512_storeu_si512(row, result);
+}
+
+__always_inline
+static void blend_halo16_masked(Pixel16* row, __m512i halo_pixels,
+                                __mmask8 mask)
+{
+    __m512i bg = _mm512_maskz_loadu_epi64(mask, row);
+    __m512i result = combine_pixels16_simd(bg, halo_pixels);
+    _mm512_mask_storeu_epi64(row, mask, result);
+}
+
+// Premultiplied halo pixels, see get_halo16_pixel
+__always_inline
+static __m512i get_halo16_pixels(__m256i alpha_fixed, __m512i color)
+{
+    const __m512i MASK_SPREAD_ALPHA = _mm512_set_epi8(
+        MASK_SPREAD_ALPHA16_ROW,
+        MASK_SPREAD_ALPHA16_ROW,
+        MASK_SPREAD_ALPHA16_ROW,
+        MASK_SPREAD_ALPHA16_ROW
+    );
+
+    __m256i alpha = _mm256_srli_epi32(alpha_fixed, HALO_ALPHA_SHIFT - 8);
+    alpha = _mm256_add_epi32(alpha, _mm256_srli_epi32(alpha, 8));
+
+    // Alpha goes to the highest word of every pixel
+    const __m512i alpha_word = _mm512_slli_epi64(
+                                    _mm512_cvtepu32_epi64(alpha), 48);
+    const __m512i alpha_spread = _mm512_shuffle_epi8(alpha_word,
+                                                     MASK_SPREAD_ALPHA);
+
+    return _mm512_or_si512(_mm512_mulhi_epu16(color, alpha_spread),
+                           alpha_word);
+}
+
+void add_halo_row16_avx512(Pixel16* top_row, Pixel16* bottom_row, size_t dy,
+                           size_t x_begin, size_t x_end, const Halo* halo)
+{
+    size_t span_begin = 0, span_end = 0;
+    if (!get_halo_span(dy, x_begin, x_end, halo, &span_begin, &span_end))
+        return;
+
+    const uint32_t factor = get_halo16_alpha_factor(halo);
+    const uint32_t radius = (uint32_t) halo->radius_px;
+    const uint32_t remainder = radius*radius - (uint32_t) (dy*dy);
+
+    // Color channels with zero alpha, so that alpha can be simply OR-ed in
+    const __m512i color = _mm512_set1_epi64((long long) (
+                            (uint64_t) (halo->color.red   * 257u)
+                          | (uint64_t) (halo->color.green * 257u) << 16
+                          | (uint64_t) (halo->color.blue  * 257u) << 32));
+
+    // Alpha is computed for 8 pixels, which fill a single vector
+    const __m256i dx = _mm256_add_epi32(
+            _mm256_set1_epi32((int) ((uint32_t) span_begin - radius)),
+            _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+
+    // alpha_fixed = (remainder - dx^2) * factor
+    __m256i alpha_fixed = _mm256_mullo_epi32(
+                            _mm256_sub_epi32(
+                                _mm256_set1_epi32((int) remainder),
+                                _mm256_mullo_epi32(dx, dx)),
+                            _mm256_set1_epi32((int) factor));
+
+    // Forward differences: moving by 8 columns adds
+    // -factor * (16*dx + 64), which itself decreases by 128*factor
+    __m256i step = _mm256_mullo_epi32(
+                    _mm256_add_epi32(_mm256_slli_epi32(dx, 4),
+                                     _mm256_set1_epi32(64)),
+                    _mm256_set1_epi32((int) (0u - factor)));
+    const __m256i step_delta = _mm256_set1_epi32((int) (128u * factor));
+
+    size_t x = span_begin;
+    for (; x + 8 <= span_end; x += 8)
+    {
+        __m512i halo_pixels = get_halo16_pixels(alpha_fixed, color);
+
+        if (top_row)
+            blend_halo16_vector(top_row + (x - x_begin), halo_pixels);
+        if (bottom_row)
+            blend_halo16_vector(bottom_row + (x - x_begin), halo_pixels);
+
+        alpha_fixed = _mm256_add_epi32(alpha_fixed, step);
+        step = _mm256_sub_epi32(step, step_delta);
+    }
+
+    if (x < span_end)
+    {
+        const __mmask8 mask = (__mmask8) ((1u << (span_end - x)) - 1);
+
+        __m512i halo_pixels = get_halo16_pixels(alpha_fixed, color);
+
+        if (top_row)
+            blend_halo16_masked(top_row + (x - x_begin), halo_pixels, mask);
+        if (bottom_row)
+            blend_halo16_masked(bottom_row + (x - x_begin), halo_pixels, mask);
+    }
+}
@@ -0,0 +1,303 @@
+#include <stdlib.h>
+
+#include "meerkat_assert/asserts.h"
+
+#include "halo.h"
+#include "halo_rows.h"
+
+/**
+ * Halos are applied strip by strip of columns, one strip per thread. Inside
+ * a strip every halo is applied to all of its rows before the next one, so
+ * rows mirrored about its center share alpha vectors, as in
+ * `add_halo_optimized`. Every strip border splits halo rows into separate
+ * kernel calls, so strips are not made narrower than this. Their borders
+ * are aligned, so that threads never write to the same cache line.
+ */
+static const size_t HALO_MIN_STRIP_WIDTH = 256;
+
+/**
+ * Halos, overlapping strip `s`, are `halo_indices[strip_starts[s]]` up to
+ * (not including) `halo_indices[strip_starts[s + 1]]`, in the order of halo
+ * array.
+ */
+struct HaloBins
+{
+    size_t  strip_width;
+    size_t  strip_count;
+
+    size_t* strip_starts;
+    size_t* halo_indices;
+};
+
+struct HaloStripsTask
+{
+    PixelImage*     background;
+    const Halo*     halos;
+    const HaloBins* bins;
+
+    halo_row_t*     add_halo_row;
+};
+
+static int  halo_bins_init   (HaloBins* bins, SizeVector2 bg_size,
+                              size_t thread_count,
+                              const Halo* halos, size_t halo_count);
+static void halo_bins_dispose(HaloBins* bins);
+static void add_halo_strips  (void* task_ptr, size_t begin, size_t end);
+
+int add_halos(PixelImage* background, const Halo* halos, size_t halo_count,
+              ThreadPool* pool)
+{
+    size_t max_radius = 0;
+    for (size_t i = 0; halos && i < halo_count; ++i)
+        if (halos[i].radius_px > max_radius)
+            max_radius = halos[i].radius_px;
+
+    SAFE_BLOCK_START
+    {
+        ASSERT_TRUE(background != NULL);
+        ASSERT_TRUE(background->pixel_array != NULL);
+
+        ASSERT_TRUE(halos != NULL || halo_count == 0);
+
+        ASSERT_LESS(max_radius, HALO_MAX_RADIUS);
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    const size_t thread_count = pool ? pool->thread_count : 1;
+
+    HaloBins bins = {};
+    if (halo_bins_init(&bins, background->size, thread_count,
+                       halos, halo_count) != 0)
+        return -1;
+
+    HaloStripsTask task = {
+        .background   = background,
+        .halos        = halos,
+        .bins         = &bins,
+        .add_halo_row = get_halo_row_kernel()
+    };
+
+    if (pool)
+        thread_pool_run(pool, add_halo_strips, &task, bins.strip_count);
+    else
+        add_halo_strips(&task, 0, bins.strip_count);
+
+    halo_bins_dispose(&bins);
+
+    return 0;
+}
+
+__always_inline
+static size_t min_size(size_t lhs, size_t rhs)
+{
+    return lhs < rhs ? lhs : rhs;
+}
+
+__always_inline
+static size_t max_size(size_t lhs, size_t rhs)
+{
+    return lhs > rhs ? lhs : rhs;
+}
+
+__always_inline
+static size_t get_distance(size_t lhs, size_t rhs)
+{
+    return lhs > rhs ? lhs - rhs : rhs - lhs;
+}
+
+/**
+ * Image pixels, covered by halo bounding square, clipped to image:
+ * columns [begin.x; end.x) of rows [begin.y; end.y)
+ */
+struct HaloBounds
+{
+    SizeVector2 begin;
+    SizeVector2 end;
+};
+
+static bool get_halo_bounds(SizeVector2 bg_size, const Halo* halo,
+                            HaloBounds* bounds)
+{
+    const size_t radius   = halo->radius_px;
+    const size_t center_x = halo->center.x;
+    const size_t center_y = halo->center.y;
+
+    // Halo of zero radius has no pixels inside
+    if (radius == 0)
+        return false;
+
+    // Bounding square includes its last row, but not its last column,
+    // see get_halo_span
+    bounds->begin = {
+        .x = center_x > radius ? center_x - radius : 0,
+        .y = center_y > radius ? center_y - radius : 0
+    };
+    bounds->end = {
+        .x = min_size(center_x + radius,     bg_size.x),
+        .y = min_size(center_y + radius + 1, bg_size.y)
+    };
+
+    return bounds->begin.x < bounds->end.x
+        && bounds->begin.y < bounds->end.y;
+}
+
+/*
+ * While counting, number of halos in every strip is incremented. Otherwise
+ * `strip_starts` must hold strip ends, which are moved back to store index.
+ */
+static void bin_halo(HaloBins* bins, SizeVector2 bg_size,
+                     const Halo* halo, size_t index, bool is_counting)
+{
+    HaloBounds bounds = {};
+    if (!get_halo_bounds(bg_size, halo, &bounds))
+        return;
+
+    const size_t first_strip = bounds.begin.x     / bins->strip_width;
+    const size_t last_strip  = (bounds.end.x - 1) / bins->strip_width;
+
+    for (size_t strip = first_strip; strip <= last_strip; ++strip)
+    {
+        if (is_counting)
+            bins->strip_starts[strip]++;
+        else
+            bins->halo_indices[--bins->strip_starts[strip]] = index;
+    }
+}
+
+static int halo_bins_init(HaloBins* bins, SizeVector2 bg_size,
+                          size_t thread_count,
+                          const Halo* halos, size_t halo_count)
+{
+    const size_t line_width = PIXEL_ALIGNMENT / sizeof(Pixel);
+
+    size_t strip_width = (bg_size.x + thread_count - 1) / thread_count;
+    strip_width = (strip_width + line_width - 1) / line_width * line_width;
+
+    bins->strip_width  = max_size(strip_width, HALO_MIN_STRIP_WIDTH);
+    bins->strip_count  = (bg_size.x + bins->strip_width - 1)
+                       / bins->strip_width;
+    bins->halo_indices = NULL;
+
+    const size_t strip_count = bins->strip_count;
+
+    bins->strip_starts = (size_t*) calloc(strip_count + 1,
+                                          sizeof(*bins->strip_starts));
+    if (!bins->strip_starts)
+        return -1;
+
+    for (size_t i = 0; i < halo_count; ++i)
+        bin_halo(bins, bg_size, halos + i, i, true);
+
+    // Prefix sums: every strip start holds its end
+    for (size_t strip = 1; strip < strip_count; ++strip)
+        bins->strip_starts[strip] += bins->strip_starts[strip - 1];
+
+    const size_t index_count = strip_count
+                             ? bins->strip_starts[strip_count - 1]
+                             : 0;
+    bins->strip_starts[strip_count] = index_count;
+
+    bins->halo_indices = (size_t*) calloc(index_count + 1,
+                                          sizeof(*bins->halo_indices));
+    if (!bins->halo_indices)
+    {
+        halo_bins_dispose(bins);
+        return -1;
+    }
+
+    // Halos are stored from the last one, so that every strip end is moved
+    // to its start, and halos of every strip remain in array order
+    for (size_t i = halo_count; i-- > 0;)
+        bin_halo(bins, bg_size, halos + i, i, false);
+
+    return 0;
+}
+
+static void halo_bins_dispose(HaloBins* bins)
+{
+    free(bins->strip_starts);
+    free(bins->halo_indices);
+
+    bins->strip_starts = NULL;
+    bins->halo_indices = NULL;
+}
+
+/**
+ * Apply halo to columns [strip_begin; strip_end) of image. As in
+ * `add_halo_optimized`, rows are visited in pairs, mirrored about the
+ * center row, from the center outwards. Row is passed alone, if its mirror
+ * is outside the image.
+ */
+static void add_halo_strip(const HaloStripsTask* task, const Halo* halo,
+                           size_t strip_begin, size_t strip_end)
+{
+    const SizeVector2 bg_size = task->background->size;
+
+    HaloBounds bounds = {};
+    get_halo_bounds(bg_size, halo, &bounds);
+
+    const size_t x_begin = max_size(bounds.begin.x, strip_begin);
+    const size_t x_end   = min_size(bounds.end.x,   strip_end);
+
+    const size_t radius   = halo->radius_px;
+    const size_t center_y = halo->center.y;
+
+    // Strip columns relative to bounding square
+    const size_t column_begin = x_begin + radius - halo->center.x;
+    const size_t column_end   = x_end   + radius - halo->center.x;
+
+    Pixel* const column = task->background->pixel_array + x_begin;
+
+    // Distance from the center to the farthest row
+    const size_t dy_end = max_size(get_distance(bounds.begin.y,   center_y),
+                                   get_distance(bounds.end.y - 1, center_y))
+                        + 1;
+
+    for (size_t dy = 0; dy < dy_end; ++dy)
+    {
+        Pixel* top_row    = NULL;
+        Pixel* bottom_row = NULL;
+
+        if (center_y >= bounds.begin.y + dy && center_y - dy < bounds.end.y)
+            top_row    = column + (center_y - dy) * bg_size.x;
+
+        // Center row has no pair
+        if (dy > 0 && center_y + dy >= bounds.begin.y
+                   && center_y + dy <  bounds.end.y)
+            bottom_row = column + (center_y + dy) * bg_size.x;
+
+        task->add_halo_row(top_row, bottom_row, dy,
+                           column_begin, column_end, halo);
+    }
+}
+
+// Items are strips of columns
+static void add_halo_strips(void* task_ptr, size_t begin, size_t end)
+{
+    const HaloStripsTask* task = (const HaloStripsTask*) task_ptr;
+    const HaloBins*       bins = task->bins;
+
+    const size_t bg_size_x = task->background->size.x;
+
+    for (size_t strip = begin; strip < end; ++strip)
+    {
+        const size_t strip_begin = strip * bins->strip_width;
+        const size_t strip_end   = min_size(strip_begin + bins->strip_width,
+                                            bg_size_x);
+
+        const size_t* last_index = bins->halo_indices
+                                 + bins->strip_starts[strip + 1];
+
+        for (const size_t* index = bins->halo_indices
+                                 + bins->strip_starts[strip];
+             index < last_index; ++index)
+            add_halo_strip(task, task->halos + *index,
+                           strip_begin, strip_end);
+    }
+}
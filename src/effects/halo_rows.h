@@ -0,0 +1,235 @@
+/**
+ * @file halo_rows.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Halo row kernels, built for several instruction set levels
+ *
+ * @version 0.1
+ * @date 2023-04-24
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __HALO_ROWS_H
+#define __HALO_ROWS_H
+
+#include <math.h>
+#include <stdint.h>
+
+#include "commons/definitions.h"
+
+/**
+ * @brief Halo alpha is computed in fixed point, with this many fractional
+ * bits. With larger radii, intermediate values would not fit 32 bits.
+ */
+#define HALO_ALPHA_SHIFT 23
+#define HALO_ALPHA_BIAS  (1u << (HALO_ALPHA_SHIFT - 1))
+#define HALO_MAX_RADIUS  (1u << 15)
+
+/**
+ * @brief Apply halo to columns [x_begin; x_end) of two rows of its bounding
+ * square, symmetric about its center: rows `radius_px - dy` and
+ * `radius_px + dy`. Pixels of both rows have the same alpha, so it is
+ * computed only once.
+ *
+ * @param[inout] top_row	- Pixel of the upper row in column `x_begin`.
+ *                            May be NULL
+ * @param[inout] bottom_row	- Pixel of the lower row in column `x_begin`.
+ *                            May be NULL
+ * @param[in]    dy	        - Distance from rows to the halo center
+ * @param[in]    x_begin	- First column inside bounding square
+ * @param[in]    x_end	    - Column after the last one, at most `2*radius_px`
+ * @param[in]    halo	    - Halo parameters
+ */
+typedef void halo_row_t(Pixel* top_row, Pixel* bottom_row, size_t dy,
+                        size_t x_begin, size_t x_end, const Halo* halo);
+
+/**
+ * @brief Same as `halo_row_t`, but for 16-bit image
+ */
+typedef void halo_row16_t(Pixel16* top_row, Pixel16* bottom_row, size_t dy,
+                          size_t x_begin, size_t x_end, const Halo* halo);
+
+halo_row_t add_halo_row_scalar;
+halo_row_t add_halo_row_sse4;
+halo_row_t add_halo_row_avx2;
+halo_row_t add_halo_row_avx512;
+
+halo_row16_t add_halo_row16_scalar;
+halo_row16_t add_halo_row16_sse4;
+halo_row16_t add_halo_row16_avx2;
+halo_row16_t add_halo_row16_avx512;
+
+/**
+ * @brief Get the fastest halo row kernel, supported by CPU
+ *
+ * @return Kernel from the dispatch table
+ */
+halo_row_t* get_halo_row_kernel(void);
+
+/**
+ * @brief Get the fastest 16-bit halo row kernel, supported by CPU
+ *
+ * @return Kernel from the dispatch table
+ */
+halo_row16_t* get_halo_row16_kernel(void);
+
+/**
+ * @brief Pixel is inside halo, if `dx*dx + dy*dy < radius*radius`, where
+ * `dx` and `dy` are its offsets from the halo center. Such pixels of each row
+ * form a single span, symmetric about the center column, and its half-width
+ * is shared by all four quadrants.
+ *
+ * @param[in]  dy	        - Distance from row to the halo center
+ * @param[in]  x_begin	    - First column inside bounding square
+ * @param[in]  x_end	    - Column after the last one
+ * @param[in]  halo	        - Halo parameters
+ * @param[out] span_begin	- First column of span, clipped to [x_begin; x_end)
+ * @param[out] span_end	    - Column after the last one
+ *
+ * @return Whether clipped span is not empty
+ */
+static inline bool get_halo_span(size_t dy, size_t x_begin, size_t x_end,
+                                 const Halo* halo,
+                                 size_t* span_begin, size_t* span_end)
+{
+    const size_t radius = halo->radius_px;
+
+    if (dy >= radius)
+        return false;
+
+    // Largest half-width with half_width^2 < radius^2 - dy^2
+    const size_t max_sq = radius*radius - dy*dy - 1;
+
+    size_t half_width = (size_t) sqrt((double) max_sq);
+    while (half_width*half_width > max_sq)
+        --half_width;
+    while ((half_width + 1)*(half_width + 1) <= max_sq)
+        ++half_width;
+
+    const size_t begin = radius - half_width;
+    const size_t end   = radius + half_width + 1;
+
+    *span_begin = begin > x_begin ? begin : x_begin;
+    *span_end   = end   < x_end   ? end   : x_end;
+
+    return *span_begin < *span_end;
+}
+
+/**
+ * @brief Alpha is `color.alpha * k / radius^2`, where
+ * `k = radius^2 - dx^2 - dy^2`, rounded to nearest. It is computed as
+ * `(k * factor + HALO_ALPHA_BIAS) >> HALO_ALPHA_SHIFT`, which may differ
+ * from correctly rounded value by one only if the quotient is very close
+ * to a half.
+ *
+ * @param[in] halo	- Halo parameters
+ *
+ * @return Fixed-point `color.alpha / radius^2`
+ */
+static inline uint32_t get_halo_alpha_factor(const Halo* halo)
+{
+    const uint64_t radius_sq = (uint64_t) halo->radius_px * halo->radius_px;
+
+    return (uint32_t) ((((uint64_t) halo->color.alpha << HALO_ALPHA_SHIFT)
+                        + radius_sq / 2) / radius_sq);
+}
+
+/**
+ * @brief Compute fixed-point alpha of a single pixel exactly as
+ * vector kernels do. Wrapping of 32-bit arithmetic is intended: for pixels
+ * inside halo the result is below 2^32 anyway.
+ *
+ * @param[in] x	        - Column index inside bounding square
+ * @param[in] dy	    - Distance from row to the halo center
+ * @param[in] factor	- Result of `get_halo_alpha_factor`
+ * @param[in] halo	    - Halo parameters
+ *
+ * @return `k * factor + HALO_ALPHA_BIAS`
+ */
+static inline uint32_t get_halo_alpha_fixed(size_t x, size_t dy,
+                                            uint32_t factor, const Halo* halo)
+{
+    const uint32_t radius = (uint32_t) halo->radius_px;
+    const uint32_t dx     = (uint32_t) x - radius;
+
+    const uint32_t k = radius*radius - (uint32_t) (dy*dy) - dx*dx;
+
+    return k * factor + HALO_ALPHA_BIAS;
+}
+
+/**
+ * @brief 16-bit alpha keeps the fractional bits, which 8-bit kernels
+ * discard. The factor is rounded down, so that `k * factor` never exceeds
+ * `color.alpha << HALO_ALPHA_SHIFT` and no bias is added.
+ *
+ * @param[in] halo	- Halo parameters
+ *
+ * @return Fixed-point `color.alpha / radius^2`
+ */
+static inline uint32_t get_halo16_alpha_factor(const Halo* halo)
+{
+    const uint64_t radius_sq = (uint64_t) halo->radius_px * halo->radius_px;
+
+    return (uint32_t) (((uint64_t) halo->color.alpha << HALO_ALPHA_SHIFT)
+                       / radius_sq);
+}
+
+/**
+ * @brief Convert fixed-point alpha without bias to 16 bits. Value
+ * `alpha << 8` with 8 fractional bits is scaled by 257/256, so that opaque
+ * 8-bit alpha becomes exactly 65535.
+ *
+ * @param[in] alpha_fixed	- `k * factor`, see `get_halo16_alpha_factor`
+ *
+ * @return 16-bit alpha
+ */
+static inline uint16_t get_halo16_alpha(uint32_t alpha_fixed)
+{
+    const uint32_t alpha = alpha_fixed >> (HALO_ALPHA_SHIFT - 8);
+
+    return (uint16_t) (alpha + (alpha >> 8));
+}
+
+/**
+ * @brief Compute 16-bit alpha of a single pixel exactly as vector
+ * kernels do
+ *
+ * @param[in] x	        - Column index inside bounding square
+ * @param[in] dy	    - Distance from row to the halo center
+ * @param[in] factor	- Result of `get_halo16_alpha_factor`
+ * @param[in] halo	    - Halo parameters
+ *
+ * @return 16-bit alpha
+ */
+static inline uint16_t get_halo16_pixel_alpha(size_t x, size_t dy,
+                                              uint32_t factor,
+                                              const Halo* halo)
+{
+    const uint32_t radius = (uint32_t) halo->radius_px;
+    const uint32_t dx     = (uint32_t) x - radius;
+
+    const uint32_t k = radius*radius - (uint32_t) (dy*dy) - dx*dx;
+
+    return get_halo16_alpha(k * factor);
+}
+
+/**
+ * @brief Get halo color with given alpha, premultiplied as 16-bit
+ * blending expects: `color * 257 * alpha >> 16`
+ *
+ * @param[in] color	- Halo color, alpha is ignored
+ * @param[in] alpha	- 16-bit alpha
+ *
+ * @return Premultiplied pixel
+ */
+static inline Pixel16 get_halo16_pixel(Color color, uint16_t alpha)
+{
+    return {
+        .red   = (uint16_t) (color.red   * 257u * alpha >> 16),
+        .green = (uint16_t) (color.green * 257u * alpha >> 16),
+        .blue  = (uint16_t) (color.blue  * 257u * alpha >> 16),
+        .alpha = alpha
+    };
+}
+
+#endif /* halo_rows.h */
@@ -3,8 +3,70 @@
 #include "meerkat_assert/asserts.h"
 
 #include "blending/blender.h"
+#include "blending/blender16.h"
 
 #include "halo.h"
+#include "halo_rows.h"
+
+void add_halo_row_scalar(Pixel* top_row, Pixel* bottom_row, size_t dy,
+                         size_t x_begin, size_t x_end, const Halo* halo)
+{
+    size_t span_begin = 0, span_end = 0;
+    if (!get_halo_span(dy, x_begin, x_end, halo, &span_begin, &span_end))
+        return;
+
+    const uint32_t factor = get_halo_alpha_factor(halo);
+    const uint32_t dx     = (uint32_t) span_begin - (uint32_t) halo->radius_px;
+
+    // Forward differences: moving by one column adds -factor * (2*dx + 1),
+    // which itself decreases by 2*factor
+    uint32_t alpha_fixed = get_halo_alpha_fixed(span_begin, dy, factor, halo);
+    uint32_t step        = (0u - factor) * (2*dx + 1);
+
+    Pixel blended = halo->color;
+    for (size_t x = span_begin; x < span_end; x++)
+    {
+        blended.alpha = (uint8_t) (alpha_fixed >> HALO_ALPHA_SHIFT);
+
+        if (top_row)
+            combine_pixels(top_row + (x - x_begin), &blended);
+        if (bottom_row)
+            combine_pixels(bottom_row + (x - x_begin), &blended);
+
+        alpha_fixed += step;
+        step        -= 2 * factor;
+    }
+}
+
+void add_halo_row16_scalar(Pixel16* top_row, Pixel16* bottom_row, size_t dy,
+                           size_t x_begin, size_t x_end, const Halo* halo)
+{
+    size_t span_begin = 0, span_end = 0;
+    if (!get_halo_span(dy, x_begin, x_end, halo, &span_begin, &span_end))
+        return;
+
+    const uint32_t factor = get_halo16_alpha_factor(halo);
+    const uint32_t dx     = (uint32_t) span_begin - (uint32_t) halo->radius_px;
+
+    // Same forward differences as in 8-bit kernel, but without bias
+    uint32_t alpha_fixed = get_halo_alpha_fixed(span_begin, dy, factor, halo)
+                         - HALO_ALPHA_BIAS;
+    uint32_t step        = (0u - factor) * (2*dx + 1);
+
+    for (size_t x = span_begin; x < span_end; x++)
+    {
+        const Pixel16 blended = get_halo16_pixel(halo->color,
+                                                 get_halo16_alpha(alpha_fixed));
+
+        if (top_row)
+            combine_pixels16(top_row + (x - x_begin), &blended);
+        if (bottom_row)
+            combine_pixels16(bottom_row + (x - x_begin), &blended);
+
+        alpha_fixed += step;
+        step        -= 2 * factor;
+    }
+}
 
 int add_halo_simple(PixelImage* background, const Halo* halo)
 {
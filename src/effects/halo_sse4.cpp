@@ -0,0 +1,176 @@
+#include "commons/intrinsics.h"
+
+#include "blending/blender.h"
+#include "blending/blender16.h"
+#include "blending/shuffle_masks.h"
+
+#include "halo_rows.h"
+
+__always_inline
+static void blend_halo_vector(Pixel* row, __m128i halo_pixels)
+{
+    __m128i bg = _mm_loadu_si128((const __m128i*) row);
+    __m128i result = combine_pixels_simd128(bg, halo_pixels);
+    _mm_storeu_si128((__m128i*) row, result);
+}
+
+void add_halo_row_sse4(Pixel* top_row, Pixel* bottom_row, size_t dy,
+                       size_t x_begin, size_t x_end, const Halo* halo)
+{
+    size_t span_begin = 0, span_end = 0;
+    if (!get_halo_span(dy, x_begin, x_end, halo, &span_begin, &span_end))
+        return;
+
+    const uint32_t factor = get_halo_alpha_factor(halo);
+    const uint32_t radius = (uint32_t) halo->radius_px;
+    const uint32_t remainder = radius*radius - (uint32_t) (dy*dy);
+
+    // Color channels with zero alpha, so that alpha can be simply OR-ed in
+    const __m128i color = _mm_set1_epi32(
+                            halo->color.red
+                          | halo->color.green << 8
+                          | halo->color.blue  << 16);
+
+    const __m128i dx = _mm_add_epi32(
+            _mm_set1_epi32((int) ((uint32_t) span_begin - radius)),
+            _mm_setr_epi32(0, 1, 2, 3));
+
+    // alpha_fixed = (remainder - dx^2) * factor + bias
+    __m128i alpha_fixed = _mm_sub_epi32(_mm_set1_epi32((int) remainder),
+                                        _mm_mullo_epi32(dx, dx));
+    alpha_fixed = _mm_add_epi32(
+                    _mm_mullo_epi32(alpha_fixed,
+                                    _mm_set1_epi32((int) factor)),
+                    _mm_set1_epi32((int) HALO_ALPHA_BIAS));
+
+    // Forward differences: moving by 4 columns adds
+    // -factor * (8*dx + 16), which itself decreases by 32*factor
+    __m128i step = _mm_mullo_epi32(
+                    _mm_add_epi32(_mm_slli_epi32(dx, 3),
+                                  _mm_set1_epi32(16)),
+                    _mm_set1_epi32((int) (0u - factor)));
+    const __m128i step_delta = _mm_set1_epi32((int) (32u * factor));
+
+    size_t x = span_begin;
+    for (; x + 4 <= span_end; x += 4)
+    {
+        __m128i alpha = _mm_srli_epi32(alpha_fixed, HALO_ALPHA_SHIFT);
+        __m128i halo_pixels = _mm_or_si128(_mm_slli_epi32(alpha, 24),
+                                           color);
+
+        if (top_row)
+            blend_halo_vector(top_row + (x - x_begin), halo_pixels);
+        if (bottom_row)
+            blend_halo_vector(bottom_row + (x - x_begin), halo_pixels);
+
+        alpha_fixed = _mm_add_epi32(alpha_fixed, step);
+        step = _mm_sub_epi32(step, step_delta);
+    }
+
+    Pixel to_blend = halo->color;
+    for (; x < span_end; x++)
+    {
+        to_blend.alpha = (uint8_t) (get_halo_alpha_fixed(x, dy, factor, halo)
+                                    >> HALO_ALPHA_SHIFT);
+
+        if (top_row)
+            combine_pixels(top_row + (x - x_begin), &to_blend);
+        if (bottom_row)
+            combine_pixels(bottom_row + (x - x_begin), &to_blend);
+    }
+}
+
+__always_inline
+static void blend_halo16_vector(Pixel16* row, __m128i halo_pixels)
+{
+    __m128i bg = _mm_loadu_si128((const __m128i*) row);
+    __m128i result = combine_pixels16_simd128(bg, halo_pixels);
+    _mm_storeu_si128((__m128i*) row, result);
+}
+
+// Premultiplied pixels for two lowest alpha values, see get_halo16_pixel
+__always_inline
+static __m128i get_halo16_pixels(__m128i alpha, __m128i color)
+{
+    const __m128i MASK_SPREAD_ALPHA = _mm_set_epi8(MASK_SPREAD_ALPHA16_ROW);
+
+    // Alpha goes to the highest word of every pixel
+    const __m128i alpha_word = _mm_slli_epi64(_mm_cvtepu32_epi64(alpha), 48);
+    const __m128i alpha_spread = _mm_shuffle_epi8(alpha_word,
+                                                  MASK_SPREAD_ALPHA);
+
+    return _mm_or_si128(_mm_mulhi_epu16(color, alpha_spread), alpha_word);
+}
+
+void add_halo_row16_sse4(Pixel16* top_row, Pixel16* bottom_row, size_t dy,
+                         size_t x_begin, size_t x_end, const Halo* halo)
+{
+    size_t span_begin = 0, span_end = 0;
+    if (!get_halo_span(dy, x_begin, x_end, halo, &span_begin, &span_end))
+        return;
+
+    const uint32_t factor = get_halo16_alpha_factor(halo);
+    const uint32_t radius = (uint32_t) halo->radius_px;
+    const uint32_t remainder = radius*radius - (uint32_t) (dy*dy);
+
+    // Color channels with zero alpha, so that alpha can be simply OR-ed in
+    const __m128i color = _mm_set1_epi64x((long long) (
+                            (uint64_t) (halo->color.red   * 257u)
+                          | (uint64_t) (halo->color.green * 257u) << 16
+                          | (uint64_t) (halo->color.blue  * 257u) << 32));
+
+    // Alpha is computed for 4 pixels, which fill two vectors
+    const __m128i dx = _mm_add_epi32(
+            _mm_set1_epi32((int) ((uint32_t) span_begin - radius)),
+            _mm_setr_epi32(0, 1, 2, 3));
+
+    // alpha_fixed = (remainder - dx^2) * factor
+    __m128i alpha_fixed = _mm_mullo_epi32(
+                            _mm_sub_epi32(_mm_set1_epi32((int) remainder),
+                                          _mm_mullo_epi32(dx, dx)),
+                            _mm_set1_epi32((int) factor));
+
+    // Forward differences: moving by 4 columns adds
+    // -factor * (8*dx + 16), which itself decreases by 32*factor
+    __m128i step = _mm_mullo_epi32(
+                    _mm_add_epi32(_mm_slli_epi32(dx, 3),
+                                  _mm_set1_epi32(16)),
+                    _mm_set1_epi32((int) (0u - factor)));
+    const __m128i step_delta = _mm_set1_epi32((int) (32u * factor));
+
+    size_t x = span_begin;
+    for (; x + 4 <= span_end; x += 4)
+    {
+        // 16-bit alpha, see get_halo16_alpha
+        __m128i alpha = _mm_srli_epi32(alpha_fixed, HALO_ALPHA_SHIFT - 8);
+        alpha = _mm_add_epi32(alpha, _mm_srli_epi32(alpha, 8));
+
+        __m128i low  = get_halo16_pixels(alpha, color);
+        __m128i high = get_halo16_pixels(_mm_srli_si128(alpha, 8), color);
+
+        if (top_row)
+        {
+            blend_halo16_vector(top_row + (x - x_begin),     low);
+            blend_halo16_vector(top_row + (x - x_begin) + 2, high);
+        }
+        if (bottom_row)
+        {
+            blend_halo16_vector(bottom_row + (x - x_begin),     low);
+            blend_halo16_vector(bottom_row + (x - x_begin) + 2, high);
+        }
+
+        alpha_fixed = _mm_add_epi32(alpha_fixed, step);
+        step = _mm_sub_epi32(step, step_delta);
+    }
+
+    for (; x < span_end; x++)
+    {
+        const Pixel16 to_blend = get_halo16_pixel(
+                    halo->color, get_halo16_pixel_alpha(x, dy, factor, halo));
+
+        if (top_row)
+            combine_pixels16(top_row + (x - x_begin), &to_blend);
+        if (bottom_row)
+            combine_pixels16(bottom_row + (x - x_begin), &to_blend);
+    }
+}
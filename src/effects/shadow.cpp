@@ -0,0 +1,477 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "meerkat_assert/asserts.h"
+#include "commons/cpu_features.h"
+
+#include "shadow.h"
+#include "shadow_rows.h"
+
+/**
+ * Below this sigma exact Gaussian taps are used. Larger blur would need too
+ * many taps, so it is approximated with box blurs of almost equal widths.
+ */
+static const double SHADOW_BOX_MIN_SIGMA  = 3.0;
+#define SHADOW_MAX_TAP_RADIUS 9     // ceil(3 * SHADOW_BOX_MIN_SIGMA)
+#define SHADOW_BOX_COUNT      3
+
+/**
+ * Vertical halo of every band is blurred horizontally once again, so bands
+ * are at least twice as tall as blur radius
+ */
+static const size_t SHADOW_MIN_BAND_HEIGHT = 64;
+
+// Indexed by SimdLevel
+static extract_alpha_row_t* const EXTRACT_ALPHA_ROW_KERNELS[SIMD_LEVEL_COUNT]
+= {
+    extract_alpha_row_scalar,
+    extract_alpha_row_scalar,
+    extract_alpha_row_scalar,
+    extract_alpha_row_avx512
+};
+
+// Indexed by SimdLevel
+static blur_taps_row_t* const BLUR_TAPS_ROW_KERNELS[SIMD_LEVEL_COUNT] = {
+    blur_taps_row_scalar,
+    blur_taps_row_scalar,
+    blur_taps_row_scalar,
+    blur_taps_row_avx512
+};
+
+// Indexed by SimdLevel
+static box_blur_row_t* const BOX_BLUR_ROW_KERNELS[SIMD_LEVEL_COUNT] = {
+    box_blur_row_scalar,
+    box_blur_row_scalar,
+    box_blur_row_scalar,
+    box_blur_row_avx512
+};
+
+// Indexed by SimdLevel
+static box_blur_column_t* const BOX_BLUR_COLUMN_KERNELS[SIMD_LEVEL_COUNT] = {
+    box_blur_column_scalar,
+    box_blur_column_scalar,
+    box_blur_column_scalar,
+    box_blur_column_avx512
+};
+
+// Indexed by SimdLevel
+static blend_shadow_row_t* const BLEND_SHADOW_ROW_KERNELS[SIMD_LEVEL_COUNT] = {
+    blend_shadow_row_scalar,
+    blend_shadow_row_scalar,
+    blend_shadow_row_scalar,
+    blend_shadow_row_avx512
+};
+
+/**
+ * Either Gaussian taps or radii of box blurs, applied one after another.
+ * Every pass reads `2*radius` more bytes than it writes.
+ */
+struct BlurKernel
+{
+    size_t   radius;                // Sum of radii of all passes
+
+    size_t   tap_count;             // Zero, if box blurs are used
+    uint16_t weights[2 * SHADOW_MAX_TAP_RADIUS + 1];
+
+    size_t   box_radii[SHADOW_BOX_COUNT];
+};
+
+/**
+ * Shadow mask is foreground alpha, padded with blur radius on every side and
+ * blurred. Only its part, visible on background, is computed: columns
+ * [column_begin; column_end) of rows [row_begin; row_end).
+ */
+struct ShadowTask
+{
+    PixelImage*         background;
+    const MovedImage*   foreground;
+    const BlurKernel*   blur;
+    Color               color;
+
+    ptrdiff_t           origin_x;   // Mask position, may be negative
+    ptrdiff_t           origin_y;
+
+    size_t              column_begin;
+    size_t              column_end;
+    size_t              row_begin;
+    size_t              row_end;
+    size_t              band_height;
+
+    extract_alpha_row_t* extract_alpha_row;
+    blur_taps_row_t*     blur_taps_row;
+    box_blur_row_t*      box_blur_row;
+    box_blur_column_t*   box_blur_column;
+    blend_shadow_row_t*  blend_shadow_row;
+
+    bool                failed;     // Scratch could not be allocated
+};
+
+static void get_blur_kernel(double sigma, BlurKernel* kernel);
+static bool clip_shadow_axis(ptrdiff_t origin, size_t size, size_t bg_size,
+                             size_t* begin, size_t* end);
+static void add_shadow_bands(void* task_ptr, size_t begin, size_t end);
+
+int add_drop_shadow(PixelImage* background, const MovedImage* foreground,
+                    const DropShadow* shadow, ThreadPool* pool)
+{
+    SAFE_BLOCK_START
+    {
+        ASSERT_TRUE(background != NULL);
+        ASSERT_TRUE(background->pixel_array != NULL);
+
+        ASSERT_TRUE(foreground != NULL);
+        ASSERT_TRUE(foreground->pixel_array != NULL);
+
+        ASSERT_TRUE(shadow != NULL);
+
+        // Also rejects NaN
+        ASSERT_TRUE(shadow->sigma >= 0 && shadow->sigma <= SHADOW_MAX_SIGMA);
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    BlurKernel blur = {};
+    get_blur_kernel(shadow->sigma, &blur);
+
+    const size_t radius = blur.radius;
+
+    Color color = shadow->color;
+    if (foreground->modulation)
+        color.alpha = (uint8_t) (color.alpha
+                                 * (foreground->modulation->opacity + 1u)
+                                 >> 8);
+
+    const SimdLevel level = get_simd_level();
+
+    ShadowTask task = {
+        .background        = background,
+        .foreground        = foreground,
+        .blur              = &blur,
+        .color             = color,
+        .origin_x          = (ptrdiff_t) foreground->pos.x + shadow->offset_x
+                           - (ptrdiff_t) radius,
+        .origin_y          = (ptrdiff_t) foreground->pos.y + shadow->offset_y
+                           - (ptrdiff_t) radius,
+        .column_begin      = 0,
+        .column_end        = 0,
+        .row_begin         = 0,
+        .row_end           = 0,
+        .band_height       = 2 * radius > SHADOW_MIN_BAND_HEIGHT
+                           ? 2 * radius : SHADOW_MIN_BAND_HEIGHT,
+        .extract_alpha_row = EXTRACT_ALPHA_ROW_KERNELS[level],
+        .blur_taps_row     = BLUR_TAPS_ROW_KERNELS[level],
+        .box_blur_row      = BOX_BLUR_ROW_KERNELS[level],
+        .box_blur_column   = BOX_BLUR_COLUMN_KERNELS[level],
+        .blend_shadow_row  = BLEND_SHADOW_ROW_KERNELS[level],
+        .failed            = false
+    };
+
+    const bool is_visible =
+        color.alpha > 0 &&
+        clip_shadow_axis(task.origin_x, foreground->size.x + 2 * radius,
+                         background->size.x,
+                         &task.column_begin, &task.column_end) &&
+        clip_shadow_axis(task.origin_y, foreground->size.y + 2 * radius,
+                         background->size.y,
+                         &task.row_begin, &task.row_end);
+
+    if (!is_visible)
+        return 0;
+
+    const size_t band_count = (task.row_end - task.row_begin
+                               + task.band_height - 1) / task.band_height;
+
+    if (pool)
+        thread_pool_run(pool, add_shadow_bands, &task, band_count);
+    else
+        add_shadow_bands(&task, 0, band_count);
+
+    if (task.failed)
+    {
+        // TODO: Logs
+        errno = ENOMEM;
+        return -1;
+    }
+
+    return 0;
+}
+
+/*
+ * Taps are rounded to 8.8 fixed point, and rounding error is added to the
+ * central one, so that flat areas are not changed. Box widths are chosen,
+ * so that variance of the three blurs matches `sigma^2`, see
+ * W. Jarosz, "Fast Image Convolutions"; P. Kovesi, "Fast Almost-Gaussian
+ * Filtering".
+ */
+static void get_blur_kernel(double sigma, BlurKernel* kernel)
+{
+    if (sigma < SHADOW_BOX_MIN_SIGMA)
+    {
+        const size_t radius = (size_t) ceil(3 * sigma);
+
+        kernel->radius    = radius;
+        kernel->tap_count = 2 * radius + 1;
+
+        double gaussian[2 * SHADOW_MAX_TAP_RADIUS + 1] = {};
+        double total = 0;
+        for (size_t k = 0; k < kernel->tap_count; ++k)
+        {
+            // Central tap is computed separately, as sigma may be zero
+            const double offset = (double) k - (double) radius;
+            gaussian[k] = k == radius
+                        ? 1 : exp(-offset * offset / (2 * sigma * sigma));
+            total += gaussian[k];
+        }
+
+        unsigned weight_sum = 0;
+        for (size_t k = 0; k < kernel->tap_count; ++k)
+        {
+            kernel->weights[k] = (uint16_t) lround(
+                            gaussian[k] / total * (1 << SHADOW_TAP_SHIFT));
+            weight_sum += kernel->weights[k];
+        }
+
+        kernel->weights[radius] = (uint16_t) (kernel->weights[radius]
+                                              + (1u << SHADOW_TAP_SHIFT)
+                                              - weight_sum);
+        return;
+    }
+
+    const double variance = 12 * sigma * sigma;
+    const double count    = SHADOW_BOX_COUNT;
+
+    size_t lower_width = (size_t) sqrt(variance / count + 1);
+    if (lower_width % 2 == 0)
+        --lower_width;
+
+    const double lower = (double) lower_width;
+    const long lower_count = lround(
+                        (variance - count * lower * lower
+                                  - 4 * count * lower - 3 * count)
+                        / (-4 * lower - 4));
+
+    kernel->radius    = 0;
+    kernel->tap_count = 0;
+
+    for (size_t i = 0; i < SHADOW_BOX_COUNT; ++i)
+    {
+        const size_t width = (long) i < lower_count ? lower_width
+                                                    : lower_width + 2;
+
+        kernel->box_radii[i] = width / 2;
+        kernel->radius      += width / 2;
+    }
+}
+
+/*
+ * Intersect mask pixels [0; size) at given origin with background pixels
+ * [0; bg_size). Resulting range is relative to the mask origin.
+ */
+static bool clip_shadow_axis(ptrdiff_t origin, size_t size, size_t bg_size,
+                             size_t* begin, size_t* end)
+{
+    const ptrdiff_t first   = origin < 0 ? -origin : 0;
+    const ptrdiff_t bg_last = (ptrdiff_t) bg_size - origin;
+    const ptrdiff_t last    = bg_last < (ptrdiff_t) size ? bg_last
+                                                         : (ptrdiff_t) size;
+
+    if (first >= last)
+        return false;
+
+    *begin = (size_t) first;
+    *end   = (size_t) last;
+
+    return true;
+}
+
+__always_inline
+static size_t align_size(size_t size)
+{
+    return (size + PIXEL_ALIGNMENT - 1) / PIXEL_ALIGNMENT * PIXEL_ALIGNMENT;
+}
+
+/**
+ * Per-thread buffers. Rows hold source of horizontal passes, bands hold
+ * all rows, needed by vertical passes of one band.
+ */
+struct ShadowScratch
+{
+    uint8_t*  rows[2];
+    uint32_t* sums;
+
+    uint8_t*  bands[2];
+    size_t    band_stride;
+};
+
+static int shadow_scratch_init(ShadowScratch* scratch, const ShadowTask* task)
+{
+    const size_t radius      = task->blur->radius;
+    const size_t width       = task->column_end - task->column_begin;
+
+    const size_t row_size    = align_size(width + 2 * radius);
+    const size_t sums_size   = align_size((width + 2 * radius + 1)
+                                          * sizeof(*scratch->sums));
+    const size_t band_stride = align_size(width);
+    const size_t band_size   = band_stride * (task->band_height + 2 * radius);
+
+    uint8_t* memory = NULL;
+    if (posix_memalign((void**) &memory, PIXEL_ALIGNMENT,
+                       2 * row_size + sums_size + 2 * band_size) != 0)
+        return -1;
+
+    scratch->rows[0]     = memory;
+    scratch->rows[1]     = memory + row_size;
+    scratch->sums        = (uint32_t*) (void*) (memory + 2 * row_size);
+    scratch->bands[0]    = memory + 2 * row_size + sums_size;
+    scratch->bands[1]    = scratch->bands[0] + band_size;
+    scratch->band_stride = band_stride;
+
+    return 0;
+}
+
+/*
+ * Row of padded foreground alpha is blurred horizontally. Padding is twice
+ * the blur radius: half for the mask border, half for the last taps.
+ */
+static void blur_mask_row(const ShadowTask* task, ShadowScratch* scratch,
+                          size_t padded_y, uint8_t* dst)
+{
+    const MovedImage* fg     = task->foreground;
+    const BlurKernel* blur   = task->blur;
+    const size_t      radius = blur->radius;
+
+    const size_t width     = task->column_end - task->column_begin;
+    const size_t src_count = width + 2 * radius;
+
+    if (padded_y < 2 * radius || padded_y - 2 * radius >= fg->size.y)
+    {
+        memset(dst, 0, width);
+        return;
+    }
+
+    // Source byte k is foreground column `column_begin + k - 2*radius`
+    const size_t shift     = 2 * radius;
+    const size_t src_begin = shift > task->column_begin
+                           ? shift - task->column_begin : 0;
+    const size_t fg_end    = fg->size.x + shift - task->column_begin;
+    const size_t src_end   = fg_end < src_count ? fg_end : src_count;
+
+    uint8_t* src = scratch->rows[0];
+    if (src_begin >= src_end)
+        memset(src, 0, src_count);
+    else
+    {
+        const Pixel* fg_row = fg->pixel_array
+                            + (padded_y - shift) * fg->size.x
+                            + task->column_begin + src_begin - shift;
+
+        memset(src, 0, src_begin);
+        task->extract_alpha_row(src + src_begin, fg_row, src_end - src_begin);
+        memset(src + src_end, 0, src_count - src_end);
+    }
+
+    if (blur->tap_count)
+    {
+        task->blur_taps_row(dst, src, 1, width, blur->weights,
+                            blur->tap_count);
+        return;
+    }
+
+    // Passes alternate between scratch rows, the last one writes to band
+    size_t remaining = radius;
+    for (size_t i = 0; i < SHADOW_BOX_COUNT; ++i)
+    {
+        remaining -= blur->box_radii[i];
+
+        uint8_t* pass_dst = i + 1 == SHADOW_BOX_COUNT
+                          ? dst : scratch->rows[(i + 1) % 2];
+
+        task->box_blur_row(pass_dst, scratch->rows[i % 2],
+                           width + 2 * remaining, blur->box_radii[i],
+                           scratch->sums);
+    }
+}
+
+static void add_shadow_band(const ShadowTask* task, ShadowScratch* scratch,
+                            size_t row_begin, size_t row_end)
+{
+    const BlurKernel* blur   = task->blur;
+    const size_t      radius = blur->radius;
+    const size_t      stride = scratch->band_stride;
+
+    const size_t width      = task->column_end - task->column_begin;
+    const size_t row_count  = row_end - row_begin;
+
+    // Horizontal pass of all rows, needed by the band, while they stay
+    // in cache
+    for (size_t y = 0; y < row_count + 2 * radius; ++y)
+        blur_mask_row(task, scratch, row_begin + y,
+                      scratch->bands[0] + y * stride);
+
+    const uint8_t* mask = NULL;
+    if (blur->tap_count)
+    {
+        for (size_t y = 0; y < row_count; ++y)
+            task->blur_taps_row(scratch->bands[1] + y * stride,
+                                scratch->bands[0] + y * stride, stride,
+                                width, blur->weights, blur->tap_count);
+        mask = scratch->bands[1];
+    }
+    else
+    {
+        size_t remaining = radius;
+        for (size_t i = 0; i < SHADOW_BOX_COUNT; ++i)
+        {
+            remaining -= blur->box_radii[i];
+
+            task->box_blur_column(scratch->bands[(i + 1) % 2],
+                                  scratch->bands[i % 2], stride, width,
+                                  row_count + 2 * remaining,
+                                  blur->box_radii[i]);
+        }
+        mask = scratch->bands[SHADOW_BOX_COUNT % 2];
+    }
+
+    const size_t bg_size_x = task->background->size.x;
+
+    Pixel* bg_row = task->background->pixel_array
+                  + (size_t) (task->origin_y + (ptrdiff_t) row_begin)
+                    * bg_size_x
+                  + (size_t) (task->origin_x
+                              + (ptrdiff_t) task->column_begin);
+
+    for (size_t y = 0; y < row_count; ++y, bg_row += bg_size_x)
+        task->blend_shadow_row(bg_row, mask + y * stride, width,
+                               task->color);
+}
+
+// Items are bands of visible mask rows
+static void add_shadow_bands(void* task_ptr, size_t begin, size_t end)
+{
+    ShadowTask* task = (ShadowTask*) task_ptr;
+
+    ShadowScratch scratch = {};
+    if (shadow_scratch_init(&scratch, task) != 0)
+    {
+        __atomic_store_n(&task->failed, true, __ATOMIC_RELAXED);
+        return;
+    }
+
+    for (size_t band = begin; band < end; ++band)
+    {
+        const size_t row_begin = task->row_begin + band * task->band_height;
+        const size_t row_end   = row_begin + task->band_height;
+
+        add_shadow_band(task, &scratch,
+                        row_begin,
+                        row_end < task->row_end ? row_end : task->row_end);
+    }
+
+    free(scratch.rows[0]);
+}
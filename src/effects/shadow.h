@@ -0,0 +1,63 @@
+/**
+ * @file shadow.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Drop shadow: blurred and tinted silhouette of foreground, blended
+ * under it without intermediate images
+ *
+ * @version 0.1
+ * @date 2023-05-12
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __SHADOW_H
+#define __SHADOW_H
+
+#include "commons/definitions.h"
+#include "commons/thread_pool.h"
+
+/**
+ * @brief Largest supported blur. Shadow extends about `3*sigma` pixels
+ * beyond foreground on every side.
+ */
+#define SHADOW_MAX_SIGMA 32.0
+
+/**
+ * @brief Shadow is foreground alpha, blurred with Gaussian of given
+ * standard deviation and shifted by offset, which may be negative
+ */
+struct DropShadow
+{
+    ptrdiff_t offset_x;
+    ptrdiff_t offset_y;
+
+    double    sigma;    // In pixels, zero means sharp shadow
+    Color     color;    // Alpha is shadow opacity under opaque pixels
+};
+
+/**
+ * @brief Blend shadow of foreground on top of background. Foreground itself
+ * is not blended, so this is called right before blending it. Shadow is
+ * clipped to background, and foreground does not have to lie inside it.
+ * Division is correctly rounded, so that background is unchanged where
+ * shadow is transparent.
+ *
+ * Blur is separable. For small sigma exact Gaussian taps are used, larger
+ * ones are approximated with three box blurs, computed with running sums.
+ * Shadow is processed in bands of rows, which stay in cache between
+ * horizontal and vertical passes.
+ *
+ * @param[inout] background	- Image background
+ * @param[in]    foreground	- Image foreground, only its alpha is used.
+ *                            If modulated, shadow opacity is multiplied
+ *                            by foreground opacity
+ * @param[in]    shadow	    - Shadow parameters
+ * @param[inout] pool	    - Worker threads. If NULL, only the calling
+ *                            thread is used
+ *
+ * @return 0 upon success, -1 upon invalid arguments or allocation failure
+ */
+int add_drop_shadow(PixelImage* background, const MovedImage* foreground,
+                    const DropShadow* shadow, ThreadPool* pool);
+
+#endif /* shadow.h */
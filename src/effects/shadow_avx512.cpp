@@ -0,0 +1,258 @@
+#include "commons/intrinsics.h"
+
+#include "blending/blender.h"
+
+#include "shadow_rows.h"
+
+/**
+ * @brief Mask of the first `count` elements, `count` is less than 16
+ */
+__always_inline
+static __mmask16 get_tail_mask16(size_t count)
+{
+    return (__mmask16) ((1u << count) - 1);
+}
+
+// Zero-extend 16 bytes to 32-bit elements
+__always_inline
+static __m512i load_bytes16(const uint8_t* src, __mmask16 mask)
+{
+    return _mm512_cvtepu8_epi32(
+                _mm512_castsi512_si128(
+                    _mm512_maskz_loadu_epi8((__mmask64) mask, src)));
+}
+
+void extract_alpha_row_avx512(uint8_t* dst, const Pixel* src, size_t count)
+{
+    size_t x = 0;
+    for (; x + 16 <= count; x += 16)
+    {
+        const __m512i pixels = _mm512_loadu_si512(src + x);
+        _mm_storeu_si128((__m128i*) (dst + x),
+                         _mm512_cvtepi32_epi8(_mm512_srli_epi32(pixels, 24)));
+    }
+
+    if (x < count)
+    {
+        const __mmask16 mask = get_tail_mask16(count - x);
+
+        const __m512i pixels = _mm512_maskz_loadu_epi32(mask, src + x);
+        _mm512_mask_cvtepi32_storeu_epi8(dst + x, mask,
+                                         _mm512_srli_epi32(pixels, 24));
+    }
+}
+
+/*
+ * Weighted sum fits 16 bits, so 32 bytes are convolved at once. Bytes
+ * past the end of row are not loaded.
+ */
+__always_inline
+static __m256i blur_taps_vector(const uint8_t* src, size_t step,
+                                const uint16_t* weights, size_t tap_count,
+                                __mmask64 mask)
+{
+    __m512i sum = _mm512_set1_epi16(1 << (SHADOW_TAP_SHIFT - 1));
+
+    for (size_t k = 0; k < tap_count; ++k)
+    {
+        const __m512i bytes = _mm512_cvtepu8_epi16(
+                                _mm512_castsi512_si256(
+                                    _mm512_maskz_loadu_epi8(mask,
+                                                            src + k*step)));
+
+        sum = _mm512_add_epi16(sum,
+                               _mm512_mullo_epi16(
+                                    bytes,
+                                    _mm512_set1_epi16((short) weights[k])));
+    }
+
+    return _mm512_cvtepi16_epi8(_mm512_srli_epi16(sum, SHADOW_TAP_SHIFT));
+}
+
+void blur_taps_row_avx512(uint8_t* dst, const uint8_t* src, size_t step,
+                          size_t count, const uint16_t* weights,
+                          size_t tap_count)
+{
+    const __mmask64 full_mask = 0xFFFFFFFF;
+
+    size_t x = 0;
+    for (; x + 32 <= count; x += 32)
+        _mm256_storeu_si256((__m256i*) (dst + x),
+                            blur_taps_vector(src + x, step, weights,
+                                             tap_count, full_mask));
+
+    if (x < count)
+    {
+        const __mmask64 mask = (1ull << (count - x)) - 1;
+
+        const __m256i result = blur_taps_vector(src + x, step, weights,
+                                                tap_count, mask);
+        _mm512_mask_storeu_epi8(dst + x, mask,
+                                _mm512_castsi256_si512(result));
+    }
+}
+
+/*
+ * Inclusive prefix sums of 16 elements: elements are shifted by 1, 2, 4
+ * and 8 positions, filling with zeros, and added
+ */
+__always_inline
+static __m512i get_prefix_sums(__m512i values)
+{
+    const __m512i zero = _mm512_setzero_si512();
+
+    values = _mm512_add_epi32(values, _mm512_alignr_epi32(values, zero, 15));
+    values = _mm512_add_epi32(values, _mm512_alignr_epi32(values, zero, 14));
+    values = _mm512_add_epi32(values, _mm512_alignr_epi32(values, zero, 12));
+    values = _mm512_add_epi32(values, _mm512_alignr_epi32(values, zero, 8));
+
+    return values;
+}
+
+// Rounded average, see get_box_reciprocal
+__always_inline
+static __m512i get_box_average(__m512i sum, __m512i reciprocal)
+{
+    const __m512i bias = _mm512_set1_epi32((int) SHADOW_BOX_BIAS);
+
+    return _mm512_srli_epi32(
+                _mm512_add_epi32(_mm512_mullo_epi32(sum, reciprocal), bias),
+                SHADOW_BOX_SHIFT);
+}
+
+void box_blur_row_avx512(uint8_t* dst, const uint8_t* src, size_t count,
+                         size_t radius, uint32_t* sums)
+{
+    const size_t width     = 2 * radius + 1;
+    const size_t src_count = count + width - 1;
+
+    // Last prefix sum of previous vector, broadcast
+    __m512i carry = _mm512_setzero_si512();
+    const __m512i last_index = _mm512_set1_epi32(15);
+
+    sums[0] = 0;
+
+    size_t x = 0;
+    for (; x + 16 <= src_count; x += 16)
+    {
+        const __m512i bytes = _mm512_cvtepu8_epi32(
+                                _mm_loadu_si128((const __m128i*) (src + x)));
+
+        const __m512i prefix = _mm512_add_epi32(get_prefix_sums(bytes),
+                                                carry);
+        _mm512_storeu_si512(sums + x + 1, prefix);
+
+        carry = _mm512_permutexvar_epi32(last_index, prefix);
+    }
+
+    if (x < src_count)
+    {
+        const __mmask16 mask = get_tail_mask16(src_count - x);
+
+        const __m512i prefix = _mm512_add_epi32(
+                                get_prefix_sums(load_bytes16(src + x, mask)),
+                                carry);
+        _mm512_mask_storeu_epi32(sums + x + 1, mask, prefix);
+    }
+
+    const __m512i reciprocal = _mm512_set1_epi32(
+                                (int) get_box_reciprocal(radius));
+
+    for (x = 0; x + 16 <= count; x += 16)
+    {
+        const __m512i sum = _mm512_sub_epi32(
+                                _mm512_loadu_si512(sums + x + width),
+                                _mm512_loadu_si512(sums + x));
+
+        _mm_storeu_si128((__m128i*) (dst + x),
+                         _mm512_cvtepi32_epi8(
+                            get_box_average(sum, reciprocal)));
+    }
+
+    if (x < count)
+    {
+        const __mmask16 mask = get_tail_mask16(count - x);
+
+        const __m512i sum = _mm512_sub_epi32(
+                            _mm512_maskz_loadu_epi32(mask, sums + x + width),
+                            _mm512_maskz_loadu_epi32(mask, sums + x));
+
+        _mm512_mask_cvtepi32_storeu_epi8(dst + x, mask,
+                                         get_box_average(sum, reciprocal));
+    }
+}
+
+void box_blur_column_avx512(uint8_t* dst, const uint8_t* src, size_t stride,
+                            size_t count, size_t row_count, size_t radius)
+{
+    const size_t width = 2 * radius + 1;
+
+    const __m512i reciprocal = _mm512_set1_epi32(
+                                (int) get_box_reciprocal(radius));
+
+    // Running sums of 16 columns are kept in a register, while the strip
+    // is walked down. Strip rows are cached, as band fits in cache.
+    for (size_t x = 0; x < count; x += 16)
+    {
+        const __mmask16 mask = count - x >= 16 ? (__mmask16) 0xFFFF
+                                               : get_tail_mask16(count - x);
+
+        __m512i sum = _mm512_setzero_si512();
+        for (size_t y = 0; y < width; ++y)
+            sum = _mm512_add_epi32(sum,
+                                   load_bytes16(src + y*stride + x, mask));
+
+        for (size_t y = 0; y < row_count; ++y)
+        {
+            if (y > 0)
+            {
+                const __m512i added   = load_bytes16(
+                                    src + (y + width - 1)*stride + x, mask);
+                const __m512i removed = load_bytes16(
+                                    src + (y - 1)*stride + x, mask);
+
+                sum = _mm512_sub_epi32(_mm512_add_epi32(sum, added),
+                                       removed);
+            }
+
+            _mm512_mask_cvtepi32_storeu_epi8(
+                                    dst + y*stride + x, mask,
+                                    get_box_average(sum, reciprocal));
+        }
+    }
+}
+
+void blend_shadow_row_avx512(Pixel* bg, const uint8_t* mask, size_t count,
+                             Color color)
+{
+    // Color channels with zero alpha, so that alpha can be simply OR-ed in
+    const __m512i color_bits = _mm512_set1_epi32(
+                                color.red
+                              | color.green << 8
+                              | color.blue  << 16);
+
+    // Products fit lower words of elements, see get_shadow_pixel
+    const __m512i factor = _mm512_set1_epi32(color.alpha + 1);
+
+    for (size_t x = 0; x < count; x += 16)
+    {
+        const __mmask16 pixel_mask = count - x >= 16
+                                   ? (__mmask16) 0xFFFF
+                                   : get_tail_mask16(count - x);
+
+        const __m512i mask_bytes = load_bytes16(mask + x, pixel_mask);
+
+        // Transparent shadow leaves background unchanged
+        if (!_mm512_test_epi32_mask(mask_bytes, mask_bytes))
+            continue;
+
+        const __m512i alpha = _mm512_srli_epi32(
+                                _mm512_mullo_epi16(mask_bytes, factor), 8);
+        const __m512i shadow = _mm512_or_si512(_mm512_slli_epi32(alpha, 24),
+                                               color_bits);
+
+        const __m512i pixels = _mm512_maskz_loadu_epi32(pixel_mask, bg + x);
+        _mm512_mask_storeu_epi32(bg + x, pixel_mask,
+                                 combine_pixels_simd_exact(pixels, shadow));
+    }
+}
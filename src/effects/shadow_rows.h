@@ -0,0 +1,146 @@
+/**
+ * @file shadow_rows.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Alpha extraction, blur and shadow blending kernels, built for
+ * several instruction set levels
+ *
+ * @version 0.1
+ * @date 2023-05-12
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __SHADOW_ROWS_H
+#define __SHADOW_ROWS_H
+
+#include <stdint.h>
+
+#include "commons/definitions.h"
+
+/**
+ * @brief Gaussian taps are weights in 8.8 fixed point, which sum to
+ * `1 << SHADOW_TAP_SHIFT`. Weighted sum of bytes fits 16 bits.
+ */
+#define SHADOW_TAP_SHIFT 8
+
+/**
+ * @brief Box average is computed as `(sum * reciprocal + bias) >> shift`,
+ * see `get_box_reciprocal`
+ */
+#define SHADOW_BOX_SHIFT 24
+#define SHADOW_BOX_BIAS  (1u << (SHADOW_BOX_SHIFT - 1))
+
+/**
+ * @brief Copy alpha of every pixel
+ *
+ * @param[out] dst	    - Destination alpha row
+ * @param[in]  src	    - Source pixel row
+ * @param[in]  count	- Number of pixels in row
+ */
+typedef void extract_alpha_row_t(uint8_t* dst, const Pixel* src,
+                                 size_t count);
+
+/**
+ * @brief Convolve bytes with Gaussian taps:
+ * `dst[x] = sum(weights[k] * src[x + k*step]) >> SHADOW_TAP_SHIFT`, rounded
+ * to nearest. With `step` equal to one the row is blurred horizontally, with
+ * row stride it is blurred vertically.
+ *
+ * @param[out] dst	        - Destination row
+ * @param[in]  src	        - Source bytes, the first tap of `dst[0]`
+ * @param[in]  step	        - Distance between bytes of successive taps
+ * @param[in]  count	    - Number of bytes in destination row
+ * @param[in]  weights	    - Tap weights
+ * @param[in]  tap_count	- Number of taps
+ */
+typedef void blur_taps_row_t(uint8_t* dst, const uint8_t* src, size_t step,
+                             size_t count, const uint16_t* weights,
+                             size_t tap_count);
+
+/**
+ * @brief Horizontal box blur: `dst[x]` is average of
+ * `src[x]...src[x + 2*radius]`, computed from prefix sums
+ *
+ * @param[out] dst	    - Destination row
+ * @param[in]  src	    - Source row, `count + 2*radius` bytes
+ * @param[in]  count	- Number of bytes in destination row
+ * @param[in]  radius	- Box radius
+ * @param[out] sums	    - Scratch, `count + 2*radius + 1` elements
+ */
+typedef void box_blur_row_t(uint8_t* dst, const uint8_t* src, size_t count,
+                            size_t radius, uint32_t* sums);
+
+/**
+ * @brief Vertical box blur: row `y` of destination is average of source
+ * rows `y...y + 2*radius`, computed with running sums of every column
+ *
+ * @param[out] dst	        - Destination rows
+ * @param[in]  src	        - Source rows, `row_count + 2*radius` of them
+ * @param[in]  stride	    - Distance between rows of both images
+ * @param[in]  count	    - Number of bytes in row
+ * @param[in]  row_count	- Number of destination rows
+ * @param[in]  radius	    - Box radius
+ */
+typedef void box_blur_column_t(uint8_t* dst, const uint8_t* src,
+                               size_t stride, size_t count,
+                               size_t row_count, size_t radius);
+
+/**
+ * @brief Blend shadow color on top of background with alpha
+ * `mask * (color.alpha + 1) >> 8` and correctly rounded division
+ *
+ * @param[inout] bg	    - Background row
+ * @param[in]    mask	- Blurred foreground alpha
+ * @param[in]    count	- Number of pixels in row
+ * @param[in]    color	- Shadow color
+ */
+typedef void blend_shadow_row_t(Pixel* bg, const uint8_t* mask, size_t count,
+                                Color color);
+
+extract_alpha_row_t extract_alpha_row_scalar;
+extract_alpha_row_t extract_alpha_row_avx512;
+
+blur_taps_row_t blur_taps_row_scalar;
+blur_taps_row_t blur_taps_row_avx512;
+
+box_blur_row_t box_blur_row_scalar;
+box_blur_row_t box_blur_row_avx512;
+
+box_blur_column_t box_blur_column_scalar;
+box_blur_column_t box_blur_column_avx512;
+
+blend_shadow_row_t blend_shadow_row_scalar;
+blend_shadow_row_t blend_shadow_row_avx512;
+
+/**
+ * @brief Reciprocal of box width, rounded up. For sums of at most
+ * `255 * width` bytes the product with bias fits 32 bits.
+ *
+ * @param[in] radius	- Box radius
+ *
+ * @return Fixed-point `1 / (2*radius + 1)`
+ */
+static inline uint32_t get_box_reciprocal(size_t radius)
+{
+    const uint32_t width = (uint32_t) (2 * radius + 1);
+
+    return ((1u << SHADOW_BOX_SHIFT) + width - 1) / width;
+}
+
+/**
+ * @brief Compute shadow pixel exactly as vector kernels do
+ *
+ * @param[in] mask	- Blurred foreground alpha
+ * @param[in] color	- Shadow color
+ *
+ * @return Shadow color with scaled alpha
+ */
+static inline Pixel get_shadow_pixel(uint8_t mask, Color color)
+{
+    Pixel result = color;
+    result.alpha = (uint8_t) (mask * (color.alpha + 1u) >> 8);
+
+    return result;
+}
+
+#endif /* shadow_rows.h */
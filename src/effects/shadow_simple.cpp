@@ -0,0 +1,79 @@
+#include "blending/blender.h"
+
+#include "shadow_rows.h"
+
+void extract_alpha_row_scalar(uint8_t* dst, const Pixel* src, size_t count)
+{
+    for (size_t x = 0; x < count; ++x)
+        dst[x] = src[x].alpha;
+}
+
+void blur_taps_row_scalar(uint8_t* dst, const uint8_t* src, size_t step,
+                          size_t count, const uint16_t* weights,
+                          size_t tap_count)
+{
+    for (size_t x = 0; x < count; ++x)
+    {
+        uint32_t sum = 1u << (SHADOW_TAP_SHIFT - 1);
+        for (size_t k = 0; k < tap_count; ++k)
+            sum += (uint32_t) weights[k] * src[x + k*step];
+
+        dst[x] = (uint8_t) (sum >> SHADOW_TAP_SHIFT);
+    }
+}
+
+void box_blur_row_scalar(uint8_t* dst, const uint8_t* src, size_t count,
+                         size_t radius, uint32_t* sums)
+{
+    const size_t   width      = 2 * radius + 1;
+    const uint32_t reciprocal = get_box_reciprocal(radius);
+
+    sums[0] = 0;
+    for (size_t x = 0; x < count + width - 1; ++x)
+        sums[x + 1] = sums[x] + src[x];
+
+    for (size_t x = 0; x < count; ++x)
+        dst[x] = (uint8_t) (((sums[x + width] - sums[x]) * reciprocal
+                             + SHADOW_BOX_BIAS) >> SHADOW_BOX_SHIFT);
+}
+
+void box_blur_column_scalar(uint8_t* dst, const uint8_t* src, size_t stride,
+                            size_t count, size_t row_count, size_t radius)
+{
+    const size_t   width      = 2 * radius + 1;
+    const uint32_t reciprocal = get_box_reciprocal(radius);
+
+    for (size_t x = 0; x < count; ++x)
+    {
+        uint32_t sum = 0;
+        for (size_t y = 0; y < width; ++y)
+            sum += src[y*stride + x];
+
+        for (size_t y = 0; y < row_count; ++y)
+        {
+            if (y > 0)
+            {
+                sum += src[(y + width - 1)*stride + x];
+                sum -= src[(y - 1)*stride + x];
+            }
+
+            dst[y*stride + x] = (uint8_t) ((sum * reciprocal
+                                            + SHADOW_BOX_BIAS)
+                                           >> SHADOW_BOX_SHIFT);
+        }
+    }
+}
+
+void blend_shadow_row_scalar(Pixel* bg, const uint8_t* mask, size_t count,
+                             Color color)
+{
+    for (size_t x = 0; x < count; ++x)
+    {
+        // Transparent shadow leaves background unchanged
+        if (!mask[x])
+            continue;
+
+        const Pixel shadow = get_shadow_pixel(mask[x], color);
+        combine_pixels_exact(bg + x, &shadow);
+    }
+}
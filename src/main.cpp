@@ -1,15 +1,26 @@
 #include <stdio.h>
+#include <string.h>
 
 #include "meerkat_assert/asserts.h"
 #include "sfml_wrapped/display.h"
+#include "batch/pipeline.h"
 
-int main()
+static int run_headless(const char* manifest_name);
+
+int main(int argc, char* argv[])
 {
+    // Offline mode: no window is opened
+    if (argc == 3 && strcmp(argv[1], "--batch") == 0)
+        return run_headless(argv[2]);
+
     const RenderConfig config = {
         .fg_pos = { 544, 278 },
         .fg_image_name = "assets/poltorashka_cropped_uneven.bmp",
         .bg_image_name = "assets/wooden_table_scaled.bmp",
-        .font_name     = "assets/" FONTNAME ".ttf"
+        .font_name     = "assets/" FONTNAME ".ttf",
+        .thread_count  = 0,
+        .pin_threads   = true,
+        .streaming     = STREAMING_AUTO
     };
     RenderScene scene = {};
 
@@ -29,3 +40,38 @@ int main()
 
     return 0;
 }
+
+static int run_headless(const char* manifest_name)
+{
+    const BatchConfig config = {
+        .manifest_name  = manifest_name,
+        .worker_count   = 0,
+        .queue_capacity = 0,
+        .blend_mode     = BLEND_MODE_EXACT
+    };
+    BatchStats stats = {};
+
+    const int result = run_batch(&config, &stats);
+
+    if (result != 0 && stats.job_count == 0)
+    {
+        fprintf(stderr, "Failed to run jobs from '%s'\n", manifest_name);
+        return 1;
+    }
+
+    const double seconds = stats.elapsed_seconds > 0
+                         ? stats.elapsed_seconds
+                         : 1e-9;
+    const size_t saved_count = stats.job_count - stats.failed_count;
+
+    printf("%zu images in %.3f s: %.1f images/s, %.1f MPix/s\n",
+           saved_count, stats.elapsed_seconds,
+           (double) saved_count / seconds,
+           (double) stats.pixel_count / seconds * 1e-6);
+
+    if (stats.failed_count > 0)
+        fprintf(stderr, "%zu of %zu jobs failed\n",
+                stats.failed_count, stats.job_count);
+
+    return result == 0 ? 0 : 1;
+}
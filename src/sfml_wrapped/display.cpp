@@ -5,13 +5,20 @@
 #include "meerkat_assert/asserts.h"
 #include "sfml_wrapped/loader.h"
 #include "blending/blender.h"
-#include "effects/halo.h"
+#include "blending/span_index.h"
+#include "composition/frame.h"
+#include "composition/damage.h"
 
 #include "display.h"
 
 static int load_fonts     (RenderScene* scene, const RenderConfig* config);
 static int load_images    (RenderScene* scene, const RenderConfig* config);
 static int allocate_pixels(RenderScene* scene);
+static void* compose_main   (void* scene_ptr);
+static void damage_layer(DamageRegion* damage, FrameRect* previous,
+                         const FrameRect* current);
+static void upload_region(RenderScene* scene, const Pixel* frame_pixels,
+                          const FrameRect* region);
 
 int render_scene_init(RenderScene* scene, const RenderConfig* config)
 {
@@ -23,6 +30,12 @@ int render_scene_init(RenderScene* scene, const RenderConfig* config)
                 load_images(scene, config));
         ASSERT_ZERO(
                 allocate_pixels(scene));
+        ASSERT_ZERO(
+                thread_pool_init(&scene->workers,
+                                 config->thread_count,
+                                 config->pin_threads));
+        ASSERT_ZERO(
+                triple_buffer_init(&scene->frame_handoff));
     }
     SAFE_BLOCK_HANDLE_ERRORS
         return -1;
@@ -31,8 +44,10 @@ int render_scene_init(RenderScene* scene, const RenderConfig* config)
     scene->pos.x = config->fg_pos.x;
     scene->pos.y = config->fg_pos.y;
 
-    const unsigned window_width  = (unsigned) scene->background.size.x;
-    const unsigned window_height = (unsigned) scene->background.size.y;
+    scene->streaming = config->streaming;
+
+    const unsigned window_width  = (unsigned) scene->background.image.size.x;
+    const unsigned window_height = (unsigned) scene->background.image.size.y;
 
     scene->display_texture.create(window_width, window_height);
     scene->display_sprite.setTexture(scene->display_texture);
@@ -47,11 +62,22 @@ int render_scene_init(RenderScene* scene, const RenderConfig* config)
 
 void render_scene_dispose(RenderScene* scene)
 {
-    free(scene->texture_pixels);
-    scene->texture_pixels = 0;
+    thread_pool_dispose(&scene->workers);
+    triple_buffer_dispose(&scene->frame_handoff);
+
+    for (size_t i = 0; i < TRIPLE_BUFFER_COUNT; ++i)
+    {
+        free(scene->frames[i].pixels);
+        scene->frames[i].pixels = 0;
+    }
+
+    free(scene->upload_pixels);
+    scene->upload_pixels = 0;
 
-    unload_image(&scene->foreground);
-    unload_image(&scene->background);
+    span_index_dispose(&scene->foreground_spans);
+
+    unload_image_file(&scene->foreground);
+    unload_image_file(&scene->background);
 }
 
 __always_inline
@@ -62,30 +88,76 @@ static size_t get_halo_radius(double time)
     return result;
 }
 
-void run_main_loop(RenderScene* scene) // TODO: Split into several functions
+void run_main_loop(RenderScene* scene)
 {
     char buffer[16] = "";
 
-    size_t bg_size_x = scene->background.size.x;
-    size_t bg_size_y = scene->background.size.y;
+    pthread_t compositor = {};
+
+    __atomic_store_n(&scene->is_running, true, __ATOMIC_RELEASE);
+    if (pthread_create(&compositor, NULL, compose_main, scene) != 0)
+    {
+        // TODO: Logs
+        return;
+    }
+
+    sf::Clock clock;
+    while (scene->window.isOpen() &&
+           __atomic_load_n(&scene->is_running, __ATOMIC_ACQUIRE))
+    {
+        sf::Event event;
+        while (scene->window.pollEvent(event))
+        {
+            if (event.type == sf::Event::Closed)
+                scene->window.close();
+        }
+
+        scene->window.clear(sf::Color::White);
+        float timeDelta = clock.restart().asSeconds();
+        snprintf(buffer, 16, "%.1f FPS", 1.f/timeDelta);
+        scene->fps_text.setString(buffer);
+
+        // If compositor is late, the previous frame is shown again
+        if (triple_buffer_acquire(&scene->frame_handoff))
+        {
+            const FrameBuffer* frame =
+                    &scene->frames[scene->frame_handoff.front];
+
+            for (size_t i = 0; i < frame->changed.rect_count; ++i)
+                upload_region(scene, frame->pixels, frame->changed.rects + i);
+        }
+
+        scene->window.draw(scene->display_sprite);
+        scene->window.draw(scene->fps_text);
+
+        scene->window.display();
+    }
+
+    __atomic_store_n(&scene->is_running, false, __ATOMIC_RELEASE);
+    triple_buffer_wake(&scene->frame_handoff);
+
+    pthread_join(compositor, NULL);
+}
+
+/*
+ * Compositor thread. Every frame is composed while the previous one is
+ * uploaded and presented by window thread.
+ */
+static void* compose_main(void* scene_ptr)
+{
+    RenderScene* scene = (RenderScene*) scene_ptr;
 
     const MovedImage moved_fg = {
         .size = {
-            .x = scene->foreground.size.x,
-            .y = scene->foreground.size.y,
+            .x = scene->foreground.image.size.x,
+            .y = scene->foreground.image.size.y,
         },
         .pos = {
             .x = scene->pos.x,
             .y = scene->pos.y
         },
-        .pixel_array = scene->foreground.pixel_array
-    };
-    PixelImage texture_image = {
-        .size = {
-            .x = scene->background.size.x,
-            .y = scene->background.size.y,
-        },
-        .pixel_array = scene->texture_pixels
+        .pixel_array = scene->foreground.image.pixel_array,
+        .spans = &scene->foreground_spans
     };
 
     Halo halo = {   // TODO: extract to config
@@ -94,37 +166,132 @@ void run_main_loop(RenderScene* scene) // TODO: Split into several functions
         .color = {244, 221, 144, 255}
     };
 
+    const FrameLayers layers = {
+        .background = &scene->background.image,
+        .halo       = &halo,
+        .foreground = &moved_fg
+    };
+
+    // Nothing is drawn yet, so the whole first frame is damaged
+    const FrameRect whole_frame = {
+        .pos  = {0, 0},
+        .size = scene->background.image.size
+    };
+    DamageRegion damage = {};
+    damage_add_rect(&damage, &whole_frame);
+
+    FrameRect halo_rect = {};
+    FrameRect fg_rect   = {};
+
     sf::Clock clock;
     double time = 0;
-    while (scene->window.isOpen())
+    while (true)
     {
-        sf::Event event;
-        while (scene->window.pollEvent(event))
+        triple_buffer_wait_consumed(&scene->frame_handoff);
+        if (!__atomic_load_n(&scene->is_running, __ATOMIC_ACQUIRE))
+            break;
+
+        time += clock.restart().asSeconds();
+
+        halo.radius_px = get_halo_radius(time);
+
+        const FrameRect new_halo_rect = get_halo_rect(&halo);
+        const FrameRect new_fg_rect   = get_image_rect(&moved_fg);
+        damage_layer(&damage, &halo_rect, &new_halo_rect);
+        damage_layer(&damage, &fg_rect,   &new_fg_rect);
+
+        // Every buffer misses damage of frames, composed into other ones
+        for (size_t i = 0; i < TRIPLE_BUFFER_COUNT; ++i)
+            for (size_t j = 0; j < damage.rect_count; ++j)
+                damage_add_rect(&scene->frames[i].stale, damage.rects + j);
+
+        FrameBuffer* frame = &scene->frames[scene->frame_handoff.back];
+        PixelImage frame_image = {
+            .size        = whole_frame.size,
+            .pixel_array = frame->pixels
+        };
+
+        bool is_composed = true;
+        SAFE_BLOCK_START    // Compose stale regions
         {
-            if (event.type == sf::Event::Closed)
-                scene->window.close();
+            for (size_t i = 0; i < frame->stale.rect_count; ++i)
+                ASSERT_ZERO(compose_frame_region(&frame_image, &layers,
+                                                 frame->stale.rects + i,
+                                                 scene->streaming,
+                                                 &scene->workers));
         }
+        SAFE_BLOCK_HANDLE_ERRORS
+        {
+            // TODO: Logs
+            is_composed = false;
+        }
+        SAFE_BLOCK_END
 
-        scene->window.clear(sf::Color::White);
-        float timeDelta = clock.restart().asSeconds();
-        time += timeDelta;
-        snprintf(buffer, 16, "%.1f FPS", 1.f/timeDelta);
-        scene->fps_text.setString(buffer);
+        // Layers do not fit into frame, so no frame can be composed.
+        // Window thread stops as well.
+        if (!is_composed)
+        {
+            __atomic_store_n(&scene->is_running, false, __ATOMIC_RELEASE);
+            break;
+        }
 
-        memcpy(scene->texture_pixels, scene->background.pixel_array,
-                bg_size_x*bg_size_y*sizeof(*scene->texture_pixels));
+        // Every published frame is acquired, so only this frame's damage
+        // has to be uploaded
+        frame->changed = damage;
+        damage_clear(&frame->stale);
+        damage_clear(&damage);
 
-        halo.radius_px = get_halo_radius(time);
-        add_halo_optimized(&texture_image, &halo);
-        blend_pixels_optimized(&texture_image, &moved_fg);
-        scene->display_texture.update(
-                (const sf::Uint8*) scene->texture_pixels);
+        triple_buffer_publish(&scene->frame_handoff);
+    }
 
-        scene->window.draw(scene->display_sprite);
-        scene->window.draw(scene->fps_text);
+    return NULL;
+}
 
-        scene->window.display();
+/*
+ * Layers are only moved and resized, so a layer is damaged only if its
+ * rectangle has changed. Both old and new rectangles must be recomposed.
+ */
+static void damage_layer(DamageRegion* damage, FrameRect* previous,
+                         const FrameRect* current)
+{
+    if (previous->pos.x  == current->pos.x  &&
+        previous->pos.y  == current->pos.y  &&
+        previous->size.x == current->size.x &&
+        previous->size.y == current->size.y)
+        return;
+
+    const FrameRect changed = get_bounding_rect(previous, current);
+    damage_add_rect(damage, &changed);
+
+    *previous = *current;
+}
+
+static void upload_region(RenderScene* scene, const Pixel* frame_pixels,
+                          const FrameRect* region)
+{
+    const size_t frame_width = scene->background.image.size.x;
+
+    const Pixel* frame_row = frame_pixels
+                           + region->pos.y * frame_width + region->pos.x;
+    const Pixel* upload_pixels = frame_row;
+
+    // Rows of narrower regions are not contiguous and have to be packed
+    if (region->size.x != frame_width)
+    {
+        for (size_t y = 0; y < region->size.y; ++y)
+        {
+            memcpy(scene->upload_pixels + y * region->size.x, frame_row,
+                   region->size.x * sizeof(*frame_row));
+            frame_row += frame_width;
+        }
+        upload_pixels = scene->upload_pixels;
     }
+
+    scene->display_texture.update((const sf::Uint8*) upload_pixels,
+                                  (unsigned) region->size.x,
+                                  (unsigned) region->size.y,
+                                  (unsigned) region->pos.x,
+                                  (unsigned) region->pos.y);
 }
 
 static int load_fonts(RenderScene* scene, const RenderConfig* config)
@@ -182,15 +349,17 @@ static int load_images(RenderScene* scene, const RenderConfig* config)
     {
         // Foreground
         ASSERT_MESSAGE(
-                load_image_from_file(&scene->foreground,
-                                     config->fg_image_name),
+                load_image_file(&scene->foreground,
+                                config->fg_image_name,
+                                /* pool */ NULL),
                 action_result == 0,
                 /* message */ config->fg_image_name);
 
         // Background
         ASSERT_MESSAGE(
-                load_image_from_file(&scene->background,
-                                     config->bg_image_name),
+                load_image_file(&scene->background,
+                                config->bg_image_name,
+                                /* pool */ NULL),
                 action_result == 0,
                 /* message */ config->bg_image_name);
     }
@@ -201,13 +370,30 @@ static int load_images(RenderScene* scene, const RenderConfig* config)
     }
     SAFE_BLOCK_END
 
+    // Foreground never changes, so it is premultiplied only once
+    premultiply_alpha(&scene->foreground.image);
+
+    SAFE_BLOCK_START    // Index foreground runs
+    {
+        ASSERT_ZERO_MESSAGE(
+                span_index_init(&scene->foreground_spans,
+                                &scene->foreground.image),
+                "Failed to build span index");
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Add logs
+        return -1;
+    }
+    SAFE_BLOCK_END
+
     return 0;
 }
 
 static int allocate_pixels(RenderScene* scene)
 {
-    const size_t window_width  = scene->background.size.x;
-    const size_t window_height = scene->background.size.y;
+    const size_t window_width  = scene->background.image.size.x;
+    const size_t window_height = scene->background.image.size.y;
 
     SAFE_BLOCK_START    // Validate input
     {
@@ -231,11 +417,26 @@ static int allocate_pixels(RenderScene* scene)
                 "Integer multiplication overflow",
                 errno = EOVERFLOW);
 
+        // Asserts cannot be used inside loop
+        bool is_allocated = true;
+        for (size_t i = 0; i < TRIPLE_BUFFER_COUNT; ++i)
+        {
+            Pixel** pixels = &scene->frames[i].pixels;
+
+            if (posix_memalign((void**) pixels, PIXEL_ALIGNMENT,
+                               array_size * sizeof(**pixels)) != 0)
+            {
+                *pixels = NULL;
+                is_allocated = false;
+            }
+        }
+        ASSERT_TRUE_MESSAGE(is_allocated, "Failed to allocate memory");
+
         ASSERT_ZERO_MESSAGE(
             posix_memalign(
-                    (void**) &scene->texture_pixels,
+                    (void**) &scene->upload_pixels,
                     PIXEL_ALIGNMENT,
-                    window_height*window_width*sizeof(*scene->texture_pixels)),
+                    window_height*window_width*sizeof(*scene->upload_pixels)),
             "Failed to allocate memory");
     }
     SAFE_BLOCK_HANDLE_ERRORS
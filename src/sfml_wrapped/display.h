@@ -15,21 +15,47 @@
 #include <SFML/Graphics.hpp>
 
 #include "commons/definitions.h"
+#include "commons/thread_pool.h"
+#include "commons/triple_buffer.h"
+#include "blending/span_index.h"
+#include "composition/damage.h"
+#include "bmp/bmp_loader.h"
+
+/**
+ * @brief Frame, composed by compositor thread
+ */
+struct FrameBuffer
+{
+    Pixel*       pixels;
+    DamageRegion stale;     // Changed since pixels were composed.
+                            // Used by compositor thread only
+    DamageRegion changed;   // Changed since previous frame
+};
 
 struct RenderScene
 {
     sf::RenderWindow    window;   
     
     SizeVector2         pos;
-    PixelImage          foreground;
-    PixelImage          background;
+    ImageFile           foreground;     // Premultiplied by alpha
+    ImageFile           background;
+    SpanIndex           foreground_spans;
+
+    FrameBuffer         frames[TRIPLE_BUFFER_COUNT];
+    TripleBuffer        frame_handoff;  // Compositor is producer, window
+                                        // thread is consumer
+    bool                is_running;     // Accessed atomically, cleared
+                                        // by compositor if it fails
 
-    Pixel*              texture_pixels;
+    Pixel*              upload_pixels;  // Damaged regions, packed for upload
     sf::Texture         display_texture;
     sf::Sprite          display_sprite;
 
     sf::Font            fps_font;
     sf::Text            fps_text;
+
+    ThreadPool          workers;
+    StreamingMode       streaming;
 };
 
 /**
@@ -51,7 +77,9 @@ int render_scene_init(RenderScene* scene, const RenderConfig* config);
 void render_scene_dispose(RenderScene* scene);
 
 /**
- * @brief Run main loop on given render scene
+ * @brief Run main loop on given render scene. Frames are composed on a
+ * separate thread, while window thread only polls events and uploads the
+ * latest composed frame.
  *
  * @param[in] scene	            - active render scene
  */
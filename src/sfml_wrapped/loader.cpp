@@ -6,6 +6,9 @@
 
 #include "loader.h"
 
+static int decode_image(PixelImage* image, const char* filename,
+                        PixelPool* pool);
+
 int load_image_from_file(PixelImage* image, const char* filename)
 {
     SAFE_BLOCK_START    // Validate parameters
@@ -21,28 +24,51 @@ int load_image_from_file(PixelImage* image, const char* filename)
     }
     SAFE_BLOCK_END
 
-    SAFE_BLOCK_START    // Load image
-    {
-        sf::Image sf_image;
+    return decode_image(image, filename, NULL);
+}
 
-        ASSERT_TRUE_MESSAGE(
-                sf_image.loadFromFile(filename),
-                "Failed to load image");
-        
-        sf::Vector2u size = sf_image.getSize();
+int load_image_file(ImageFile* file, const char* filename, PixelPool* pool)
+{
+    if (load_bmp_file(file, filename, pool) == 0)
+        return 0;
 
-        image->size.x = size.x;
-        image->size.y = size.y;
+    if (errno != ENOTSUP)
+        return -1;
 
-        ASSERT_ZERO_MESSAGE(
-                posix_memalign((void**) &image->pixel_array,
-                               PIXEL_ALIGNMENT,
-                               size.x * size.y * sizeof(*image->pixel_array)),
-                "Failed to allocate memory");
+    file->mapping      = NULL;
+    file->mapping_size = 0;
+    file->pool         = pool;
 
-        memcpy(image->pixel_array,
-               sf_image.getPixelsPtr(),
-               size.x*size.y*sizeof(*image->pixel_array));
+    return decode_image(&file->image, filename, pool);
+}
+
+int save_image_to_file(const PixelImage* image, const char* filename)
+{
+    SAFE_BLOCK_START    // Validate parameters
+    {
+        ASSERT_TRUE_MESSAGE(image    != NULL, "image");
+        ASSERT_TRUE_MESSAGE(filename != NULL, "filename");
+        ASSERT_TRUE_MESSAGE(image->pixel_array != NULL, "image->pixel_array");
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    SAFE_BLOCK_START    // Save image
+    {
+        sf::Image sf_image;
+
+        sf_image.create((unsigned) image->size.x,
+                        (unsigned) image->size.y,
+                        (const sf::Uint8*) image->pixel_array);
+
+        ASSERT_TRUE_MESSAGE(
+                sf_image.saveToFile(filename),
+                "Failed to save image");
     }
     SAFE_BLOCK_HANDLE_ERRORS
     {
@@ -75,3 +101,33 @@ void unload_image(PixelImage* image)
     image->size.y = 0;
 }
 
+static int decode_image(PixelImage* image, const char* filename,
+                        PixelPool* pool)
+{
+    SAFE_BLOCK_START    // Load image
+    {
+        sf::Image sf_image;
+
+        ASSERT_TRUE_MESSAGE(
+                sf_image.loadFromFile(filename),
+                "Failed to load image");
+        
+        sf::Vector2u size = sf_image.getSize();
+
+        ASSERT_ZERO_MESSAGE(
+                pixel_pool_acquire(pool, image, {size.x, size.y}),
+                "Failed to allocate memory");
+
+        memcpy(image->pixel_array,
+               sf_image.getPixelsPtr(),
+               size.x*size.y*sizeof(*image->pixel_array));
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    return 0;
+}
@@ -13,6 +13,7 @@
 #define __LOADER_H
 
 #include "commons/definitions.h"
+#include "bmp/bmp_loader.h"
 
 /**
  * @brief Load pixels of image from specified file
@@ -24,6 +25,29 @@
  */
 int load_image_from_file(PixelImage* image, const char* filename);
 
+/**
+ * @brief Load image from specified file. Supported BMP files are read
+ * natively with `load_bmp_file`, other formats are decoded by SFML.
+ *
+ * @param[out]   file	    - Loaded image, to be freed with `unload_image_file`
+ * @param[in]    filename	- Name of loaded image file
+ * @param[inout] pool	    - Pool of pixel buffers. May be NULL
+ *
+ * @return 0 upon success, -1 otherwise
+ */
+int load_image_file(ImageFile* file, const char* filename, PixelPool* pool);
+
+/**
+ * @brief Save pixels of image to specified file. File format is selected
+ * by its extension.
+ *
+ * @param[in] image	    - Saved image
+ * @param[in] filename	- Name of created image file
+ *
+ * @return 0 upon success, -1 otherwise
+ */
+int save_image_to_file(const PixelImage* image, const char* filename);
+
 /**
  * @brief Destroys loaded image. Frees associated resources.
  *
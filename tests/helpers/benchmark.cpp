@@ -0,0 +1,258 @@
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <x86intrin.h>
+
+#include "meerkat_assert/asserts.h"
+
+#include "benchmark.h"
+
+#define BENCHMARK_PERCENTILE 0.99
+
+static int    compare_doubles(const void* lhs_ptr, const void* rhs_ptr);
+static double get_percentile (const double* sorted, size_t count,
+                              double fraction);
+static int    find_baseline  (FILE* baseline, const char* name,
+                              double* median_ns);
+
+__always_inline
+static uint64_t get_nanoseconds(void)
+{
+    timespec time = {};
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return (uint64_t) time.tv_sec * 1000000000ull + (uint64_t) time.tv_nsec;
+}
+
+int run_benchmark(const BenchmarkCase* bench_case,
+                  const BenchmarkConfig* config,
+                  BenchmarkResult* result)
+{
+    SAFE_BLOCK_START    // Validate parameters
+    {
+        ASSERT_TRUE_MESSAGE(bench_case != NULL, "bench_case");
+        ASSERT_TRUE_MESSAGE(config     != NULL, "config");
+        ASSERT_TRUE_MESSAGE(result     != NULL, "result");
+
+        ASSERT_TRUE_MESSAGE(bench_case->function != NULL, "function");
+        ASSERT_POSITIVE_MESSAGE(bench_case->pixel_count, "pixel_count");
+        ASSERT_POSITIVE_MESSAGE(config->sample_count, "sample_count");
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    benchmark_fn_t* const function = bench_case->function;
+    void*           const context  = bench_case->context;
+
+    // Warm up caches, branch predictors and CPU frequency. Warm-up time
+    // also tells how many calls fit into one sample
+    const uint64_t warmup_start = get_nanoseconds();
+    for (size_t i = 0; i < config->warmup_count; ++i)
+        function(context);
+    const uint64_t warmup_ns = get_nanoseconds() - warmup_start;
+
+    size_t repeat_count = 1;
+    if (config->warmup_count > 0 && warmup_ns > 0)
+    {
+        const uint64_t call_ns = warmup_ns / config->warmup_count + 1;
+        if (call_ns < config->min_sample_ns)
+            repeat_count = (config->min_sample_ns + call_ns - 1) / call_ns;
+    }
+
+    double* sample_ns     = (double*) calloc(config->sample_count,
+                                             sizeof(*sample_ns));
+    double* sample_cycles = (double*) calloc(config->sample_count,
+                                             sizeof(*sample_cycles));
+    if (!sample_ns || !sample_cycles)
+    {
+        free(sample_ns);
+        free(sample_cycles);
+        return -1;
+    }
+
+    for (size_t sample = 0; sample < config->sample_count; ++sample)
+    {
+        const uint64_t start_ns     = get_nanoseconds();
+        const uint64_t start_cycles = __rdtsc();
+
+        for (size_t r = 0; r < repeat_count; ++r)
+            function(context);
+
+        const uint64_t end_cycles = __rdtsc();
+        const uint64_t end_ns     = get_nanoseconds();
+
+        sample_ns    [sample] = (double) (end_ns     - start_ns)
+                              / (double) repeat_count;
+        sample_cycles[sample] = (double) (end_cycles - start_cycles)
+                              / (double) repeat_count;
+    }
+
+    qsort(sample_ns,     config->sample_count, sizeof(*sample_ns),
+          compare_doubles);
+    qsort(sample_cycles, config->sample_count, sizeof(*sample_cycles),
+          compare_doubles);
+
+    const double median_cycles = get_percentile(sample_cycles,
+                                                config->sample_count, 0.5);
+
+    strncpy(result->name, bench_case->name, BENCHMARK_NAME_LENGTH - 1);
+    result->name[BENCHMARK_NAME_LENGTH - 1] = '\0';
+
+    result->sample_count     = config->sample_count;
+    result->repeat_count     = repeat_count;
+    result->median_ns        = get_percentile(sample_ns,
+                                              config->sample_count, 0.5);
+    result->p99_ns           = get_percentile(sample_ns,
+                                              config->sample_count,
+                                              BENCHMARK_PERCENTILE);
+    result->cycles_per_pixel = median_cycles
+                             / (double) bench_case->pixel_count;
+    // Bytes per nanosecond are gigabytes per second
+    result->gb_per_s         = (double) bench_case->byte_count
+                             / result->median_ns;
+
+    free(sample_ns);
+    free(sample_cycles);
+
+    return 0;
+}
+
+void print_benchmark_header(FILE* stream)
+{
+    fprintf(stream, "%-40s | %11s | %11s | %8s | %7s\n",
+            "benchmark", "median, us", "p99, us", "cyc/pix", "GB/s");
+}
+
+void print_benchmark_result(FILE* stream, const BenchmarkResult* result)
+{
+    fprintf(stream, "%-40s | %11.1lf | %11.1lf | %8.3lf | %7.2lf\n",
+            result->name,
+            result->median_ns / 1000,
+            result->p99_ns    / 1000,
+            result->cycles_per_pixel,
+            result->gb_per_s);
+}
+
+int write_benchmark_json(const char* filename, const char* simd_level,
+                         const BenchmarkResult* results, size_t result_count)
+{
+    FILE* file = fopen(filename, "w");
+    if (!file)
+        return -1;
+
+    fprintf(file, "{\n  \"simd_level\": \"%s\",\n  \"benchmarks\": [\n",
+            simd_level);
+
+    // Median goes right after name, `find_baseline` relies on that
+    for (size_t i = 0; i < result_count; ++i)
+        fprintf(file,
+                "    {\"name\": \"%s\", \"median_ns\": %.1lf, "
+                "\"p99_ns\": %.1lf, \"cycles_per_pixel\": %.4lf, "
+                "\"gb_per_s\": %.3lf, \"samples\": %zu, \"repeats\": %zu}%s\n",
+                results[i].name,
+                results[i].median_ns,
+                results[i].p99_ns,
+                results[i].cycles_per_pixel,
+                results[i].gb_per_s,
+                results[i].sample_count,
+                results[i].repeat_count,
+                i + 1 < result_count ? "," : "");
+
+    fprintf(file, "  ]\n}\n");
+
+    const bool is_written = !ferror(file);
+
+    return fclose(file) == 0 && is_written ? 0 : -1;
+}
+
+int compare_benchmark_baseline(const char* filename,
+                               const BenchmarkResult* results,
+                               size_t result_count, double tolerance)
+{
+    FILE* baseline = fopen(filename, "r");
+    if (!baseline)
+        return -1;
+
+    int regression_count = 0;
+
+    for (size_t i = 0; i < result_count; ++i)
+    {
+        double baseline_ns = 0;
+        if (find_baseline(baseline, results[i].name, &baseline_ns) != 0)
+            continue;
+
+        const double ratio = results[i].median_ns / baseline_ns;
+        if (ratio <= 1 + tolerance)
+            continue;
+
+        printf("REGRESSION %s: %.1lf us, baseline %.1lf us (+%.0lf%%)\n",
+               results[i].name,
+               results[i].median_ns / 1000,
+               baseline_ns / 1000,
+               (ratio - 1) * 100);
+        regression_count++;
+    }
+
+    fclose(baseline);
+
+    return regression_count;
+}
+
+static int compare_doubles(const void* lhs_ptr, const void* rhs_ptr)
+{
+    const double lhs = *(const double*) lhs_ptr;
+    const double rhs = *(const double*) rhs_ptr;
+
+    return (lhs > rhs) - (lhs < rhs);
+}
+
+/*
+ * Nearest-rank percentile: smallest sample, which is not less than
+ * `fraction` of all samples
+ */
+static double get_percentile(const double* sorted, size_t count,
+                             double fraction)
+{
+    size_t rank = (size_t) ceil(fraction * (double) count);
+    if (rank == 0)
+        rank = 1;
+
+    return sorted[rank - 1];
+}
+
+static int find_baseline(FILE* baseline, const char* name, double* median_ns)
+{
+    rewind(baseline);
+
+    char*  line        = NULL;
+    size_t line_length = 0;
+    int    result      = -1;
+
+    char line_name[BENCHMARK_NAME_LENGTH] = "";
+
+    while (getline(&line, &line_length, baseline) >= 0)
+    {
+        double line_median = 0;
+        const int matched = sscanf(line, " {\"name\": \"%63[^\"]\", "
+                                         "\"median_ns\": %lf",
+                                   line_name, &line_median);
+
+        if (matched == 2 && strcmp(line_name, name) == 0 && line_median > 0)
+        {
+            *median_ns = line_median;
+            result     = 0;
+            break;
+        }
+    }
+
+    free(line);
+
+    return result;
+}
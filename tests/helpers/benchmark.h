@@ -0,0 +1,121 @@
+/**
+ * @file benchmark.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Microbenchmark runner with nanosecond timing, order statistics
+ * and JSON reports
+ *
+ * @version 0.1
+ * @date 2023-05-03
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __BENCHMARK_H
+#define __BENCHMARK_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+#define BENCHMARK_NAME_LENGTH 64
+
+/**
+ * @brief Measured function. Called many times with the same context
+ */
+typedef void benchmark_fn_t(void* context);
+
+struct BenchmarkCase
+{
+    char            name[BENCHMARK_NAME_LENGTH];
+
+    benchmark_fn_t* function;
+    void*           context;
+
+    size_t          pixel_count;    // Pixels processed by one call
+    size_t          byte_count;     // Bytes read and written by one call
+};
+
+struct BenchmarkConfig
+{
+    size_t warmup_count;    // Untimed calls before sampling
+    size_t sample_count;
+    size_t min_sample_ns;   // Fast functions are repeated within one sample
+                            // until it takes at least this long
+};
+
+/**
+ * @brief Statistics of a single call
+ */
+struct BenchmarkResult
+{
+    char   name[BENCHMARK_NAME_LENGTH];
+
+    size_t sample_count;
+    size_t repeat_count;    // Calls per sample
+
+    double median_ns;
+    double p99_ns;
+    double cycles_per_pixel;    // Median TSC cycles, divided by pixel count
+    double gb_per_s;            // Bytes, moved by median call
+};
+
+/**
+ * @brief Warm up, calibrate repeat count and collect samples of function
+ * execution time
+ *
+ * @param[in]  bench_case	- Measured function
+ * @param[in]  config	    - Sampling parameters
+ * @param[out] result	    - Collected statistics
+ *
+ * @return 0 upon success, -1 upon error
+ */
+int run_benchmark(const BenchmarkCase* bench_case,
+                  const BenchmarkConfig* config,
+                  BenchmarkResult* result);
+
+/**
+ * @brief Print table header for `print_benchmark_result`
+ *
+ * @param[inout] stream	- Output stream
+ */
+void print_benchmark_header(FILE* stream);
+
+/**
+ * @brief Print human-readable table row
+ *
+ * @param[inout] stream	- Output stream
+ * @param[in]    result	- Benchmark statistics
+ */
+void print_benchmark_result(FILE* stream, const BenchmarkResult* result);
+
+/**
+ * @brief Write results as JSON object with `benchmarks` array. Every
+ * array element is written on a separate line.
+ *
+ * @param[in] filename	    - Output file name
+ * @param[in] simd_level	- Name of the widest enabled instruction set
+ * @param[in] results	    - Benchmark results
+ * @param[in] result_count	- Number of results
+ *
+ * @return 0 upon success, -1 upon error
+ */
+int write_benchmark_json(const char* filename, const char* simd_level,
+                         const BenchmarkResult* results, size_t result_count);
+
+/**
+ * @brief Compare median times against baseline, previously written by
+ * `write_benchmark_json`, and print every benchmark, which is slower than
+ * baseline by more than `tolerance`. Benchmarks, absent from baseline, are
+ * not compared.
+ *
+ * @param[in] filename	    - Baseline file name
+ * @param[in] results	    - Benchmark results
+ * @param[in] result_count	- Number of results
+ * @param[in] tolerance	    - Allowed relative slowdown, e.g. 0.1 for 10%
+ *
+ * @return Number of regressions upon success, -1 upon error
+ */
+int compare_benchmark_baseline(const char* filename,
+                               const BenchmarkResult* results,
+                               size_t result_count, double tolerance);
+
+#endif /* benchmark.h */
@@ -0,0 +1,165 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "meerkat_assert/asserts.h"
+
+#include "bmp_file.h"
+
+#define BMP_FILE_HEADER_SIZE    14
+#define BMP_INFO_HEADER_SIZE    40
+#define BMP_MASKS_OFFSET        54
+#define BMP_COMPRESSION_RGB     0
+#define BMP_PIXELS_PER_METER    2835    // 72 DPI
+#define BMP_SRGB_COLOR_SPACE    0x73524742
+
+static void get_channel_bytes(size_t channel_bytes[4],
+                              const BmpFileFormat* format);
+
+__always_inline
+static void write_u32(uint8_t* bytes, uint32_t value)
+{
+    memcpy(bytes, &value, sizeof(value));
+}
+
+__always_inline
+static void write_u16(uint8_t* bytes, uint16_t value)
+{
+    memcpy(bytes, &value, sizeof(value));
+}
+
+int write_bmp_file(const char* filename, const PixelImage* image,
+                   const BmpFileFormat* format)
+{
+    SAFE_BLOCK_START    // Validate parameters
+    {
+        ASSERT_TRUE_MESSAGE(filename != NULL, "filename");
+        ASSERT_TRUE_MESSAGE(image    != NULL, "image");
+        ASSERT_TRUE_MESSAGE(format   != NULL, "format");
+
+        ASSERT_TRUE_MESSAGE(format->bits_per_pixel == 24 ||
+                            format->bits_per_pixel == 32, "bits_per_pixel");
+        ASSERT_GREATER_EQUAL_MESSAGE(
+                format->info_size, BMP_INFO_HEADER_SIZE, "info_size");
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    const bool has_masks = format->compression != BMP_COMPRESSION_RGB;
+
+    // Masks follow short info header, but are a part of longer ones
+    const size_t header_size =
+            BMP_FILE_HEADER_SIZE + format->info_size
+            + (has_masks && format->info_size == BMP_INFO_HEADER_SIZE
+                ? 3 * sizeof(uint32_t)
+                : 0);
+
+    const size_t pixel_size   = format->bits_per_pixel / 8;
+    const size_t stride       = (image->size.x * pixel_size + 3) & ~(size_t) 3;
+    const size_t pixel_offset = header_size + format->offset_padding;
+    const size_t file_size    = pixel_offset + stride * image->size.y;
+
+    uint8_t* data = (uint8_t*) calloc(file_size, 1);
+    if (!data)
+        return -1;
+
+    const int32_t height = (int32_t) image->size.y;
+
+    data[0] = 'B';
+    data[1] = 'M';
+    write_u32(data +  2, (uint32_t) file_size);
+    write_u32(data + 10, (uint32_t) pixel_offset);
+
+    write_u32(data + 14, format->info_size);
+    write_u32(data + 18, (uint32_t) image->size.x);
+    write_u32(data + 22, (uint32_t) (format->is_top_down ? -height : height));
+    write_u16(data + 26, 1);
+    write_u16(data + 28, (uint16_t) format->bits_per_pixel);
+    write_u32(data + 30, format->compression);
+    write_u32(data + 34, (uint32_t) (stride * image->size.y));
+    write_u32(data + 38, BMP_PIXELS_PER_METER);
+    write_u32(data + 42, BMP_PIXELS_PER_METER);
+
+    if (has_masks)
+    {
+        const size_t mask_count =
+                format->info_size == BMP_INFO_HEADER_SIZE ? 3 : 4;
+
+        for (size_t i = 0; i < mask_count; ++i)
+            write_u32(data + BMP_MASKS_OFFSET + 4*i, format->masks[i]);
+    }
+
+    // Color space of V4 and V5 headers
+    if (format->info_size > BMP_INFO_HEADER_SIZE + 16)
+        write_u32(data + BMP_MASKS_OFFSET + 16, BMP_SRGB_COLOR_SPACE);
+
+    size_t channel_bytes[4] = {};
+    get_channel_bytes(channel_bytes, format);
+
+    for (size_t y = 0; y < image->size.y; ++y)
+    {
+        const size_t file_y = format->is_top_down ? y : image->size.y - 1 - y;
+        uint8_t*     row    = data + pixel_offset + file_y * stride;
+
+        for (size_t x = 0; x < image->size.x; ++x)
+        {
+            const Pixel pixel = image->pixel_array[y * image->size.x + x];
+            const uint8_t channels[4] = {
+                pixel.red, pixel.green, pixel.blue,
+                format->is_alpha_zeroed ? (uint8_t) 0 : pixel.alpha
+            };
+
+            for (size_t c = 0; c < pixel_size; ++c)
+                row[x * pixel_size + channel_bytes[c]] = channels[c];
+        }
+    }
+
+    const size_t written_size = format->truncated_size < file_size
+                              ? file_size - format->truncated_size
+                              : 0;
+
+    FILE* file = fopen(filename, "wb");
+    if (!file)
+    {
+        free(data);
+        return -1;
+    }
+
+    const size_t write_count = fwrite(data, 1, written_size, file);
+    const int    close_error = fclose(file);
+
+    free(data);
+
+    return write_count == written_size && close_error == 0 ? 0 : -1;
+}
+
+/*
+ * Byte of pixel, storing red, green, blue and alpha channel. Pixels
+ * without masks are stored as BGR(A)
+ */
+static void get_channel_bytes(size_t channel_bytes[4],
+                              const BmpFileFormat* format)
+{
+    if (format->compression == BMP_COMPRESSION_RGB)
+    {
+        channel_bytes[0] = 2;
+        channel_bytes[1] = 1;
+        channel_bytes[2] = 0;
+        channel_bytes[3] = 3;
+        return;
+    }
+
+    for (size_t c = 0; c < 4; ++c)
+    {
+        for (size_t byte = 0; byte < 4; ++byte)
+        {
+            if (format->masks[c] == 0xFFu << 8*byte)
+                channel_bytes[c] = byte;
+        }
+    }
+}
@@ -0,0 +1,50 @@
+/**
+ * @file bmp_file.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief BMP encoder for loader checks, writing the same image in
+ * different layouts
+ *
+ * @version 0.1
+ * @date 2023-05-14
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __BMP_FILE_H
+#define __BMP_FILE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "commons/definitions.h"
+
+/**
+ * @brief Layout of written file. Channels are stored at bytes, selected
+ * by masks, which are only written with `BI_BITFIELDS` compression.
+ */
+struct BmpFileFormat
+{
+    uint32_t info_size;         // 40 for BITMAPINFOHEADER, 124 for V5
+    unsigned bits_per_pixel;    // 24 or 32
+    uint32_t compression;       // BI_RGB (0) or BI_BITFIELDS (3)
+    uint32_t masks[4];          // Red, green, blue and alpha
+
+    bool     is_top_down;
+    bool     is_alpha_zeroed;   // Write zero alpha, as some encoders do
+    size_t   offset_padding;    // Bytes between headers and pixels
+    size_t   truncated_size;    // Bytes cut from the end of file
+};
+
+/**
+ * @brief Encode image into BMP file
+ *
+ * @param[in] filename	- Name of written file
+ * @param[in] image	    - Written image
+ * @param[in] format	- Layout of file
+ *
+ * @return 0 upon success, -1 upon error
+ */
+int write_bmp_file(const char* filename, const PixelImage* image,
+                   const BmpFileFormat* format);
+
+#endif /* bmp_file.h */
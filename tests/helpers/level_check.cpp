@@ -0,0 +1,108 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "meerkat_assert/asserts.h"
+
+#include "level_check.h"
+
+static size_t find_mismatch(const LevelCheckCase* check_case,
+                            const uint8_t* expected, size_t* column);
+
+int check_levels(const LevelCheckCase* check_case, SimdLevel max_level,
+                 FILE* stream)
+{
+    SAFE_BLOCK_START    // Validate parameters
+    {
+        ASSERT_TRUE_MESSAGE(check_case != NULL, "check_case");
+        ASSERT_TRUE_MESSAGE(stream     != NULL, "stream");
+
+        ASSERT_TRUE_MESSAGE(check_case->function != NULL, "function");
+        ASSERT_TRUE_MESSAGE(check_case->output   != NULL, "output");
+        ASSERT_LESS_EQUAL_MESSAGE(
+                check_case->row_size, check_case->stride, "row_size");
+    }
+    SAFE_BLOCK_HANDLE_ERRORS
+    {
+        // TODO: Logs
+        errno = EINVAL;
+        return -1;
+    }
+    SAFE_BLOCK_END
+
+    const size_t output_size = check_case->stride * check_case->row_count;
+
+    uint8_t* initial  = (uint8_t*) malloc(output_size);
+    uint8_t* expected = (uint8_t*) malloc(output_size);
+    if (!initial || !expected)
+    {
+        free(initial);
+        free(expected);
+        return -1;
+    }
+
+    memcpy(initial, check_case->output, output_size);
+
+    const SimdLevel saved_level = get_simd_level();
+
+    limit_simd_level(SIMD_LEVEL_SCALAR);
+    check_case->function(check_case->context);
+    memcpy(expected, check_case->output, output_size);
+
+    int mismatch_count = 0;
+    for (int level = SIMD_LEVEL_SCALAR + 1; level <= max_level; ++level)
+    {
+        memcpy(check_case->output, initial, output_size);
+
+        limit_simd_level((SimdLevel) level);
+        check_case->function(check_case->context);
+
+        size_t column = 0;
+        const size_t row = find_mismatch(check_case, expected, &column);
+        if (row == check_case->row_count)
+            continue;
+
+        fprintf(stream, "%s: %s differs from %s in row %zu, byte %zu\n",
+                check_case->name, get_simd_level_name((SimdLevel) level),
+                get_simd_level_name(SIMD_LEVEL_SCALAR), row, column);
+        mismatch_count++;
+    }
+
+    limit_simd_level(saved_level);
+    memcpy(check_case->output, initial, output_size);
+
+    free(initial);
+    free(expected);
+
+    return mismatch_count;
+}
+
+/*
+ * Returns row count, if output matches expected one
+ */
+static size_t find_mismatch(const LevelCheckCase* check_case,
+                            const uint8_t* expected, size_t* column)
+{
+    const uint8_t* output = (const uint8_t*) check_case->output;
+
+    for (size_t y = 0; y < check_case->row_count; ++y)
+    {
+        const size_t offset = y * check_case->stride;
+        if (memcmp(output + offset, expected + offset,
+                   check_case->row_size) == 0)
+            continue;
+
+        for (size_t x = 0; x < check_case->row_size; ++x)
+        {
+            if (output[offset + x] != expected[offset + x])
+            {
+                *column = x;
+                break;
+            }
+        }
+
+        return y;
+    }
+
+    return check_case->row_count;
+}
@@ -0,0 +1,54 @@
+/**
+ * @file level_check.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Comparison of dispatched kernels at every instruction set level
+ * against the scalar one
+ *
+ * @version 0.1
+ * @date 2023-05-12
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __LEVEL_CHECK_H
+#define __LEVEL_CHECK_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+#include "commons/cpu_features.h"
+
+#include "benchmark.h"
+
+/**
+ * @brief Function, writing rows of output. Only the first `row_size` bytes
+ * of every row are compared, as kernels may leave padding untouched.
+ */
+struct LevelCheckCase
+{
+    char            name[BENCHMARK_NAME_LENGTH];
+
+    benchmark_fn_t* function;
+    void*           context;
+
+    void*           output;
+    size_t          row_size;   // Compared bytes of every row
+    size_t          stride;     // Bytes between rows
+    size_t          row_count;
+};
+
+/**
+ * @brief Run function once per instruction set level, restoring output
+ * before every call, and compare output of every level with the scalar one.
+ * Output is restored afterwards, so that cases can share their inputs.
+ *
+ * @param[in] check_case	- Checked function
+ * @param[in] max_level	    - Widest checked level
+ * @param[in] stream	    - Stream, receiving mismatches
+ *
+ * @return Number of mismatching levels, -1 upon error
+ */
+int check_levels(const LevelCheckCase* check_case, SimdLevel max_level,
+                 FILE* stream);
+
+#endif /* level_check.h */
@@ -0,0 +1,77 @@
+#include "commons/pixel_pool.h"
+
+#include "synthetic.h"
+
+#define SPRITE_EDGE_WIDTH 0.1
+
+__always_inline
+static uint32_t next_random(uint32_t* state)
+{
+    // xorshift32
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+
+    return *state;
+}
+
+__always_inline
+static Pixel get_random_pixel(uint32_t* state, uint8_t alpha)
+{
+    const uint32_t bits = next_random(state);
+
+    return {
+        .red   = (uint8_t) (bits      ),
+        .green = (uint8_t) (bits >>  8),
+        .blue  = (uint8_t) (bits >> 16),
+        .alpha = alpha
+    };
+}
+
+int generate_background(PixelImage* image, SizeVector2 size, uint32_t seed)
+{
+    if (pixel_pool_acquire(NULL, image, size) != 0)
+        return -1;
+
+    uint32_t state = seed | 1;  // Zero state is stuck at zero
+
+    const size_t pixel_count = size.x * size.y;
+    for (size_t i = 0; i < pixel_count; ++i)
+        image->pixel_array[i] = get_random_pixel(&state, 255);
+
+    return 0;
+}
+
+int generate_foreground(PixelImage* image, SizeVector2 size, uint32_t seed)
+{
+    if (pixel_pool_acquire(NULL, image, size) != 0)
+        return -1;
+
+    uint32_t state = seed | 1;
+
+    const double half_x = (double) size.x / 2;
+    const double half_y = (double) size.y / 2;
+
+    for (size_t y = 0; y < size.y; ++y)
+    {
+        for (size_t x = 0; x < size.x; ++x)
+        {
+            const double dx = ((double) x + 0.5 - half_x) / half_x;
+            const double dy = ((double) y + 0.5 - half_y) / half_y;
+
+            // Distance from edge, relative to ellipse size
+            const double depth = 1 - (dx*dx + dy*dy);
+
+            uint8_t alpha = 0;
+            if (depth >= SPRITE_EDGE_WIDTH)
+                alpha = 255;
+            else if (depth > 0)
+                alpha = (uint8_t) (255 * depth / SPRITE_EDGE_WIDTH);
+
+            image->pixel_array[y * size.x + x] = get_random_pixel(&state,
+                                                                  alpha);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,43 @@
+/**
+ * @file synthetic.h
+ * @author MeerkatBoss (solodovnikov.ia@phystech.edu)
+ *
+ * @brief Deterministic benchmark images, generated in-process
+ *
+ * @version 0.1
+ * @date 2023-05-03
+ *
+ * @copyright Copyright MeerkatBoss (c) 2023
+ */
+#ifndef __SYNTHETIC_H
+#define __SYNTHETIC_H
+
+#include <stdint.h>
+
+#include "commons/definitions.h"
+
+/**
+ * @brief Create opaque image, filled with pseudo-random noise
+ *
+ * @param[out] image	- Generated image, to be freed with `unload_image`
+ * @param[in]  size	    - Image size
+ * @param[in]  seed	    - Noise seed
+ *
+ * @return 0 upon success, -1 upon error
+ */
+int generate_background(PixelImage* image, SizeVector2 size, uint32_t seed);
+
+/**
+ * @brief Create sprite-like image: noise inside inscribed ellipse is opaque,
+ * its outer tenth fades out and the rest of image is transparent. Rows have
+ * transparent, partial and opaque runs, like a cut-out photo.
+ *
+ * @param[out] image	- Generated image, to be freed with `unload_image`
+ * @param[in]  size	    - Image size
+ * @param[in]  seed	    - Noise seed
+ *
+ * @return 0 upon success, -1 upon error
+ */
+int generate_foreground(PixelImage* image, SizeVector2 size, uint32_t seed);
+
+#endif /* synthetic.h */
@@ -1,69 +1,1752 @@
+#include <errno.h>
+#include <math.h>
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #include "commons/definitions.h"
+#include "commons/cpu_features.h"
+#include "commons/thread_pool.h"
 #include "sfml_wrapped/loader.h"
 #include "blending/blender.h"
+#include "blending/span_index.h"
+#include "blending/planar.h"
+#include "blending/blender16.h"
+#include "blending/transform.h"
+#include "blending/downscale.h"
+#include "effects/halo.h"
+#include "effects/shadow.h"
+#include "composition/frame.h"
+#include "composition/layer_stack.h"
+#include "bmp/bmp_rows.h"
+#include "bmp/bmp_loader.h"
 
-#include "helpers/test_macros.h"
+#include "helpers/benchmark.h"
+#include "helpers/bmp_file.h"
+#include "helpers/level_check.h"
+#include "helpers/synthetic.h"
 
-struct test_args
+#define BACKGROUND_SIZE     (SizeVector2 {1920, 1080})
+#define FOREGROUND_SIZE     (SizeVector2 {1024, 1024})
+#define FOREGROUND_POS      (SizeVector2 { 448,   28})
+#define HALO_RADIUS         256
+#define FRAME_SIZE          (SizeVector2 {3840, 2160})
+#define ROTATION_ANGLE      (M_PI / 6)
+
+// Overlapping halos, placed on a grid inside background
+#define LIGHT_RADIUS        192
+#define LIGHT_SPACING       96
+#define LIGHT_COUNT_X       17
+#define LIGHT_COUNT_Y       8
+#define LIGHT_COUNT         (LIGHT_COUNT_X * LIGHT_COUNT_Y)
+
+// Drop shadows, cast down and right
+#define SHADOW_OFFSET       16
+#define SHADOW_SIGMA_SMALL  2.0
+#define SHADOW_SIGMA_LARGE  16.0
+
+// Full-screen layers, stacked on top of frame
+#define STACK_LAYER_COUNT   4
+
+#define MAX_RESULT_COUNT    256
+
+// Correctness checks use small images of odd sizes, so that kernels run
+// both vector loops and tails, with foregrounds at unaligned positions
+#define CHECK_BACKGROUND_SIZE   (SizeVector2 {157, 93})
+#define CHECK_LAYER_OPACITY     200
+
+static const SizeVector2 CHECK_FOREGROUND_SIZES[] = {
+    { 1,  1}, {15,  3}, {33, 17}, {61, 37}
+};
+
+static const SizeVector2 CHECK_FOREGROUND_POSITIONS[] = {
+    { 0,  0}, { 3,  1}, {77, 50}
+};
+
+static const Halo CHECK_HALOS[] = {
+    {.radius_px =  1, .center = { 5,  4}, .color = {255, 255, 255, 255}},
+    {.radius_px = 17, .center = {40, 30}, .color = {255, 200,  64, 128}},
+    {.radius_px = 45, .center = {99, 47}, .color = { 32, 128, 255, 192}}
+};
+
+#define CHECK_HALO_COUNT    (sizeof(CHECK_HALOS) / sizeof(*CHECK_HALOS))
+
+// Loaded BMP files have odd width, so that row kernels run tails
+// and 24-bit rows are padded
+#define CHECK_BMP_SIZE          (SizeVector2 {37, 5})
+#define CHECK_BMP_TEMPLATE      "/tmp/bmp_check_XXXXXX"
+#define BMP_RGB                 0
+#define BMP_BITFIELDS           3
+#define BMP_V5_HEADER_SIZE      124
+
+// Indexed by SimdLevel. Loader converts rows of mapped files,
+// so its kernels are checked directly
+static bmp_row_t* const CHECK_BMP_ROW_KERNELS[SIMD_LEVEL_COUNT] = {
+    convert_bmp_row_scalar,
+    convert_bmp_row_sse4,
+    convert_bmp_row_avx2,
+    convert_bmp_row_avx512
+};
+
+// Indexed by SimdLevel
+static bmp_rgb_row_t* const CHECK_BMP_RGB_ROW_KERNELS[SIMD_LEVEL_COUNT] = {
+    convert_bmp_rgb_row_scalar,
+    convert_bmp_rgb_row_sse4,
+    convert_bmp_rgb_row_avx2,
+    convert_bmp_rgb_row_avx512
+};
+
+// Channels of 32-bit files with bit masks are usually stored as BGRA
+static const BmpSwizzle CHECK_BGRA_SWIZZLE = {
+    .shuffle = { 2,  1,  0,  3,  6,  5,  4,  7,
+                10,  9,  8, 11, 14, 13, 12, 15},
+    .fill    = 0
+};
+
+struct BlendContext
+{
+    PixelImage*       background;
+    const MovedImage* foreground;
+    ThreadPool*       pool;
+};
+
+struct HaloContext
 {
     PixelImage* background;
-    MovedImage* foreground;
+    const Halo* halo;
+    ThreadPool* pool;
+};
+
+struct HalosContext
+{
+    PixelImage* background;
+    const Halo* halos;
+    size_t      halo_count;
+    ThreadPool* pool;
+};
+
+struct DownscaleContext
+{
+    const PixelImage* source;
+    ImagePyramid*     pyramid;  // Also receives downscaled source
+    ThreadPool*       pool;
+};
+
+struct ShadowContext
+{
+    PixelImage*       background;
+    const MovedImage* foreground;
+    const DropShadow* shadow;
+};
+
+struct TransformContext
+{
+    PixelImage*            background;
+    const PixelImage*      foreground;
+    const AffineTransform* transform;
+};
+
+struct SubpixelContext
+{
+    PixelImage*       background;
+    const PixelImage* foreground;
+    SubpixelVector2   pos;
+};
+
+struct PlanarContext
+{
+    PlanarImage*       background;
+    const PlanarImage* foreground;
+    SizeVector2        pos;
+    BlendMode          mode;
+};
+
+struct ConvertContext
+{
+    PixelImage*  image;
+    PlanarImage* planar;
+};
+
+struct Blend16Context
+{
+    PixelImage16*       background;
+    const MovedImage16* foreground;
+};
+
+struct Halo16Context
+{
+    PixelImage16* background;
+    const Halo*   halo;
+};
+
+struct PackContext
+{
+    PixelImage*         image;
+    const PixelImage16* wide;
+};
+
+struct ComposeContext
+{
+    PixelImage*        frame;
+    const FrameLayers* layers;
+    StreamingMode      streaming;
+    ThreadPool*        pool;
+};
+
+struct LayerContext
+{
+    PixelImage*  target;
+    const Layer* layers;
+    size_t       layer_count;
+};
+
+struct StackContext
+{
+    PixelImage*       target;
+    const MovedImage* layers;       // Premultiplied
+    size_t            layer_count;
+};
+
+struct BmpRowContext
+{
+    Pixel*            dst;
+    const uint8_t*    src;
+    size_t            count;
+    const BmpSwizzle* swizzle;  // Ignored by 24-bit rows
+};
+
+struct BenchmarkSuite
+{
+    BenchmarkConfig config;
+    const char*     filter;     // Only benchmarks, containing it, are run
+
+    BenchmarkResult* results;   // MAX_RESULT_COUNT elements
+    size_t          result_count;
+    size_t          failed_count;
+};
+
+struct CheckSuite
+{
+    SimdLevel   max_level;
+    const char* filter;         // Only checks, containing it, are run
+
+    size_t      case_count;
+    size_t      failed_count;
+};
+
+/**
+ * @brief BMP file, written from generated image and loaded back
+ * at every instruction set level
+ */
+struct BmpFileCheck
+{
+    const char*   name;
+    BmpFileFormat format;
+
+    bool          is_loaded;    // Otherwise loader must fail with ENOTSUP
+    bool          is_view;      // Pixels are used in place
 };
 
-#define EXPAND_ARGS(args) (args.background, args.foreground)
-#define ADAPTER(function) function EXPAND_ARGS
+static const BmpFileCheck CHECK_BMP_FILES[] = {
+    {
+        .name      = "rgb24_odd_width",
+        .format    = {
+            .info_size       = 40,
+            .bits_per_pixel  = 24,
+            .compression     = BMP_RGB,
+            .masks           = {},
+            .is_top_down     = false,
+            .is_alpha_zeroed = false,
+            .offset_padding  = 0,
+            .truncated_size  = 0
+        },
+        .is_loaded = true,
+        .is_view   = false
+    },
+    {
+        .name      = "rgb32_zero_alpha",
+        .format    = {
+            .info_size       = 40,
+            .bits_per_pixel  = 32,
+            .compression     = BMP_RGB,
+            .masks           = {},
+            .is_top_down     = false,
+            .is_alpha_zeroed = true,
+            .offset_padding  = 0,
+            .truncated_size  = 0
+        },
+        .is_loaded = true,
+        .is_view   = false
+    },
+    {
+        .name      = "v5_abgr",
+        .format    = {
+            .info_size       = BMP_V5_HEADER_SIZE,
+            .bits_per_pixel  = 32,
+            .compression     = BMP_BITFIELDS,
+            .masks           = {0xFF000000, 0x00FF0000,
+                                0x0000FF00, 0x000000FF},
+            .is_top_down     = true,
+            .is_alpha_zeroed = false,
+            .offset_padding  = 0,
+            .truncated_size  = 0
+        },
+        .is_loaded = true,
+        .is_view   = false
+    },
+    {
+        // Headers leave pixels at offset 2 modulo 4, so they are copied
+        .name      = "v5_rgba",
+        .format    = {
+            .info_size       = BMP_V5_HEADER_SIZE,
+            .bits_per_pixel  = 32,
+            .compression     = BMP_BITFIELDS,
+            .masks           = {0x000000FF, 0x0000FF00,
+                                0x00FF0000, 0xFF000000},
+            .is_top_down     = true,
+            .is_alpha_zeroed = false,
+            .offset_padding  = 0,
+            .truncated_size  = 0
+        },
+        .is_loaded = true,
+        .is_view   = false
+    },
+    {
+        .name      = "v5_rgba_padded_offset",
+        .format    = {
+            .info_size       = BMP_V5_HEADER_SIZE,
+            .bits_per_pixel  = 32,
+            .compression     = BMP_BITFIELDS,
+            .masks           = {0x000000FF, 0x0000FF00,
+                                0x00FF0000, 0xFF000000},
+            .is_top_down     = true,
+            .is_alpha_zeroed = false,
+            .offset_padding  = 2,
+            .truncated_size  = 0
+        },
+        .is_loaded = true,
+        .is_view   = true
+    },
+    {
+        .name      = "rgb24_truncated",
+        .format    = {
+            .info_size       = 40,
+            .bits_per_pixel  = 24,
+            .compression     = BMP_RGB,
+            .masks           = {},
+            .is_top_down     = false,
+            .is_alpha_zeroed = false,
+            .offset_padding  = 0,
+            .truncated_size  = 1
+        },
+        .is_loaded = false,
+        .is_view   = false
+    }
+};
+
+/**
+ * @brief Inputs and outputs of correctness checks for one foreground
+ * size and position
+ */
+struct CheckImages
+{
+    PixelImage   background;
+    PixelImage   foreground;
+    PixelImage   premultiplied;
+    PixelImage   frame;
+    PixelImage   target;        // Premultiplied, with varying alpha
+
+    SpanIndex    spans;
+    SpanIndex    premultiplied_spans;
+
+    PlanarImage  planar_background;
+    PlanarImage  planar_foreground;
+
+    PixelImage16 wide_background;
+    PixelImage16 wide_foreground;
+
+    ImagePyramid pyramid;       // Downscaled foreground
+};
+
+struct BenchmarkOptions
+{
+    const char* json_name;
+    const char* baseline_name;
+    double      tolerance;
+    bool        check;          // Run correctness checks instead
+};
+
+static void run_blend_simple       (void* context);
+static void run_blend_optimized    (void* context);
+static void run_blend_parallel     (void* context);
+static void run_blend_premultiplied(void* context);
+static void run_blend_linear       (void* context);
+static void run_blend_transformed  (void* context);
+static void run_blend_subpixel     (void* context);
+static void run_blend_planar       (void* context);
+static void run_split_planes       (void* context);
+static void run_merge_planes       (void* context);
+static void run_blend_pixels16     (void* context);
+static void run_halo16             (void* context);
+static void run_pack_pixels16      (void* context);
+static void run_halo_simple        (void* context);
+static void run_halo_optimized     (void* context);
+static void run_halo_parallel      (void* context);
+static void run_halos_sequential   (void* context);
+static void run_halos_batched      (void* context);
+static void run_drop_shadow        (void* context);
+static void run_downscale_half     (void* context);
+static void run_build_pyramid      (void* context);
+static void run_compose_frame      (void* context);
+static void run_composite_layers   (void* context);
+static void run_blend_layers       (void* context);
+static void run_convert_bmp_row    (void* context);
+static void run_convert_bmp_rgb_row(void* context);
+
+static int  parse_options(BenchmarkSuite* suite, BenchmarkOptions* options,
+                          int argc, char* argv[]);
+static void add_benchmark(BenchmarkSuite* suite, benchmark_fn_t* function,
+                          void* context, size_t pixel_count,
+                          size_t byte_count, const char* name_format, ...)
+                          __attribute__((format(printf, 6, 7)));
+static size_t count_halo_pixels(size_t radius);
+static size_t get_cpu_count(void);
+
+static int  run_level_checks  (const char* filter);
+static void check_geometry    (CheckSuite* suite, SizeVector2 fg_size,
+                               SizeVector2 fg_pos);
+static int  check_images_init (CheckImages* images, SizeVector2 fg_size);
+static void check_images_dispose(CheckImages* images);
+static void check_bmp_files   (CheckSuite* suite);
+static void check_bmp_file    (CheckSuite* suite, const BmpFileCheck* check,
+                               const PixelImage* image, const char* filename);
+static int  check_bmp_level   (const char* name, const BmpFileCheck* check,
+                               const PixelImage* image, const char* filename);
+static void add_check(CheckSuite* suite, benchmark_fn_t* function,
+                      void* context, void* output, size_t row_size,
+                      size_t stride, size_t row_count,
+                      const char* name_format, ...)
+                      __attribute__((format(printf, 8, 9)));
 
-int main()
+int main(int argc, char* argv[])
 {
-    PixelImage foreground = {}, background = {};
+    static BenchmarkSuite suite = {
+        .config = {
+            .warmup_count  = 10,
+            .sample_count  = 100,
+            .min_sample_ns = 1000000
+        },
+        .filter       = "",
+        .results      = NULL,
+        .result_count = 0,
+        .failed_count = 0
+    };
+    BenchmarkOptions options = {
+        .json_name     = NULL,
+        .baseline_name = NULL,
+        .tolerance     = 0.1,
+        .check         = false
+    };
+
+    if (parse_options(&suite, &options, argc, argv) != 0)
+    {
+        fprintf(stderr,
+                "Usage: %s [--json <output>] [--baseline <json>] "
+                "[--tolerance <fraction>] [--samples <count>] "
+                "[--filter <substring>] [--check]\n", argv[0]);
+        return 1;
+    }
+
+    if (options.check)
+        return run_level_checks(suite.filter) == 0 ? 0 : 1;
+
+    suite.results = (BenchmarkResult*) calloc(MAX_RESULT_COUNT,
+                                              sizeof(*suite.results));
+    if (!suite.results)
+    {
+        fputs("Failed to allocate results\n", stderr);
+        return 1;
+    }
+
+    PixelImage background = {}, foreground = {}, premultiplied = {};
+    PixelImage frame_background = {}, frame = {};
+    if (generate_background(&background,       BACKGROUND_SIZE, 1) != 0 ||
+        generate_foreground(&foreground,       FOREGROUND_SIZE, 2) != 0 ||
+        generate_foreground(&premultiplied,    FOREGROUND_SIZE, 2) != 0 ||
+        generate_background(&frame_background, FRAME_SIZE,      3) != 0 ||
+        generate_background(&frame,            FRAME_SIZE,      4) != 0)
+    {
+        fputs("Failed to generate images\n", stderr);
+        return 1;
+    }
+    premultiply_alpha(&premultiplied);
+
+    PlanarImage planar_background = {}, planar_foreground = {};
+    if (planar_image_init(&planar_background, BACKGROUND_SIZE) != 0 ||
+        planar_image_init(&planar_foreground, FOREGROUND_SIZE) != 0 ||
+        split_planes(&planar_background, &background, NULL)    != 0 ||
+        split_planes(&planar_foreground, &foreground, NULL)    != 0)
+    {
+        fputs("Failed to split images into planes\n", stderr);
+        return 1;
+    }
+
+    PixelImage16 wide_background = {}, wide_foreground = {};
+    if (pixel_image16_init(&wide_background, BACKGROUND_SIZE)   != 0 ||
+        pixel_image16_init(&wide_foreground, FOREGROUND_SIZE)   != 0 ||
+        widen_pixels(&wide_background, &background, false)      != 0 ||
+        widen_pixels(&wide_foreground, &foreground, true)       != 0)
+    {
+        fputs("Failed to widen images\n", stderr);
+        return 1;
+    }
+
+    PixelImage stack_images[STACK_LAYER_COUNT] = {};
+    for (size_t i = 0; i < STACK_LAYER_COUNT; ++i)
+    {
+        if (generate_foreground(stack_images + i, FRAME_SIZE,
+                                (uint32_t) (8 + i)) != 0)
+        {
+            fputs("Failed to generate layers\n", stderr);
+            return 1;
+        }
+        premultiply_alpha(stack_images + i);
+    }
+
+    ImagePyramid pyramid = {};
+    if (image_pyramid_init(&pyramid, FRAME_SIZE, 0) != 0)
+    {
+        fputs("Failed to allocate image pyramid\n", stderr);
+        return 1;
+    }
+
+    SpanIndex spans = {};
+    if (span_index_init(&spans, &foreground) != 0)
+    {
+        fputs("Failed to build span index\n", stderr);
+        return 1;
+    }
+
+    const MovedImage moved_fg = {
+        .size        = foreground.size,
+        .pos         = FOREGROUND_POS,
+        .pixel_array = foreground.pixel_array,
+        .blend_mode  = BLEND_MODE_FAST,
+        .spans       = NULL,
+        .modulation  = NULL
+    };
+
+    MovedImage exact_fg          = moved_fg;
+    exact_fg.blend_mode          = BLEND_MODE_EXACT;
+
+    MovedImage indexed_fg        = moved_fg;
+    indexed_fg.spans             = &spans;
+
+    // Half-transparent orange tint, as used for fades
+    const Modulation fade = {
+        .tint    = {.red = 255, .green = 160, .blue = 64, .alpha = 255},
+        .opacity = 128
+    };
+
+    MovedImage modulated_fg      = moved_fg;
+    modulated_fg.modulation      = &fade;
+
+    MovedImage premultiplied_fg  = moved_fg;
+    premultiplied_fg.pixel_array = premultiplied.pixel_array;
+
+    MovedImage premultiplied_exact_fg = premultiplied_fg;
+    premultiplied_exact_fg.blend_mode = BLEND_MODE_EXACT;
+
+    const MovedImage16 wide_fg = {
+        .size        = wide_foreground.size,
+        .pos         = FOREGROUND_POS,
+        .pixel_array = wide_foreground.pixel_array
+    };
+
+    // Foreground is rotated around its center, placed at background center
+    const double cos_angle = cos(ROTATION_ANGLE);
+    const double sin_angle = sin(ROTATION_ANGLE);
+    const double fg_center_x = (double) FOREGROUND_SIZE.x / 2;
+    const double fg_center_y = (double) FOREGROUND_SIZE.y / 2;
+    const AffineTransform rotation = {{
+        {
+            cos_angle, -sin_angle,
+            (double) BACKGROUND_SIZE.x / 2
+                - cos_angle * fg_center_x + sin_angle * fg_center_y
+        },
+        {
+            sin_angle,  cos_angle,
+            (double) BACKGROUND_SIZE.y / 2
+                - sin_angle * fg_center_x - cos_angle * fg_center_y
+        }
+    }};
+
+    const Halo halo = {
+        .radius_px = HALO_RADIUS,
+        .center    = {BACKGROUND_SIZE.x / 2, BACKGROUND_SIZE.y / 2},
+        .color     = {.red = 255, .green = 255, .blue = 255, .alpha = 128}
+    };
+
+    const Halo frame_halo = {
+        .radius_px = HALO_RADIUS,
+        .center    = {FRAME_SIZE.x / 2, FRAME_SIZE.y / 2},
+        .color     = {.red = 255, .green = 255, .blue = 255, .alpha = 128}
+    };
+
+    static Halo lights[LIGHT_COUNT] = {};
+    for (size_t i = 0; i < LIGHT_COUNT; ++i)
+    {
+        lights[i] = {
+            .radius_px = LIGHT_RADIUS,
+            .center    = {
+                .x = LIGHT_RADIUS + LIGHT_SPACING * (i % LIGHT_COUNT_X),
+                .y = LIGHT_RADIUS + LIGHT_SPACING * (i / LIGHT_COUNT_X)
+            },
+            .color     = {
+                .red   = 255,
+                .green = (uint8_t) (128 + i % 128),
+                .blue  = 64,
+                .alpha = 192
+            }
+        };
+    }
+
+    // Same layers for the stack and for separate blending. Operators
+    // divide exactly, so blending does too
+    Layer      stack_layers[STACK_LAYER_COUNT] = {};
+    MovedImage stack_fgs[STACK_LAYER_COUNT]    = {};
+    for (size_t i = 0; i < STACK_LAYER_COUNT; ++i)
+    {
+        stack_layers[i] = {
+            .pixel_array = stack_images[i].pixel_array,
+            .size        = FRAME_SIZE,
+            .pos         = {0, 0},
+            .opacity     = 255,
+            .op          = PORTER_DUFF_OVER
+        };
+        stack_fgs[i] = {
+            .size        = FRAME_SIZE,
+            .pos         = {0, 0},
+            .pixel_array = stack_images[i].pixel_array,
+            .blend_mode  = BLEND_MODE_EXACT,
+            .spans       = NULL,
+            .modulation  = NULL
+        };
+    }
+
+    MovedImage frame_fg = premultiplied_fg;
+    frame_fg.spans      = &spans;
+
+    const FrameLayers frame_layers = {
+        .background = &frame_background,
+        .halo       = &frame_halo,
+        .foreground = &frame_fg
+    };
+
+    // Foreground and background are read, background is written
+    const size_t blend_pixels = FOREGROUND_SIZE.x * FOREGROUND_SIZE.y;
+    const size_t blend_bytes  = 3 * sizeof(Pixel) * blend_pixels;
+
+    // Color planes of background and all planes of foreground are read,
+    // color planes of background are written
+    const size_t planar_bytes = 10 * blend_pixels;
+
+    // Same as blend_bytes, but pixels are twice as wide
+    const size_t blend16_bytes = 3 * sizeof(Pixel16) * blend_pixels;
+
+    // Image is read, planes are written, or vice versa
+    const size_t convert_pixels = BACKGROUND_SIZE.x * BACKGROUND_SIZE.y;
+    const size_t convert_bytes  = 2 * sizeof(Pixel) * convert_pixels;
+
+    // Background is read and written
+    const size_t halo_pixels  = count_halo_pixels(HALO_RADIUS);
+    const size_t halo_bytes   = 2 * sizeof(Pixel) * halo_pixels;
+    const size_t halo16_bytes = 2 * sizeof(Pixel16) * halo_pixels;
+    const size_t light_pixels = count_halo_pixels(LIGHT_RADIUS) * LIGHT_COUNT;
+    const size_t light_bytes  = 2 * sizeof(Pixel) * light_pixels;
+
+    // Wide image is read, packed image is written
+    const size_t pack_bytes   = (sizeof(Pixel16) + sizeof(Pixel))
+                              * convert_pixels;
+
+    // Background is read, frame is written. Layers are mostly cached
+    const size_t frame_pixels = FRAME_SIZE.x * FRAME_SIZE.y;
+    const size_t frame_bytes  = 2 * sizeof(Pixel) * frame_pixels;
+
+    // Every layer is read, frame is read and written once
+    const size_t stack_bytes  = (STACK_LAYER_COUNT + 2) * sizeof(Pixel)
+                              * frame_pixels;
+
+    // Frame is read, a quarter or a third of it is written
+    const size_t downscale_bytes = sizeof(Pixel) * frame_pixels * 5 / 4;
+    const size_t pyramid_bytes   = sizeof(Pixel) * frame_pixels * 4 / 3;
+
+    BlendContext blend               = {&background, &moved_fg,  NULL};
+    DownscaleContext downscale_frame = {&frame, &pyramid, NULL};
+    LayerContext composite_stack     = {&frame, stack_layers,
+                                        STACK_LAYER_COUNT};
+    StackContext blend_stack         = {&frame, stack_fgs,
+                                        STACK_LAYER_COUNT};
+    BlendContext blend_exact         = {&background, &exact_fg,  NULL};
+    BlendContext blend_indexed       = {&background, &indexed_fg, NULL};
+    BlendContext blend_modulated     = {&background, &modulated_fg, NULL};
+    BlendContext blend_premul        = {&background, &premultiplied_fg,
+                                        NULL};
+    BlendContext blend_premul_exact  = {&background, &premultiplied_exact_fg,
+                                        NULL};
+    HaloContext  add_halo            = {&background, &halo, NULL};
+    HalosContext add_single_halo     = {&background, &halo, 1, NULL};
+    HalosContext add_lights          = {&background, lights, LIGHT_COUNT,
+                                        NULL};
+
+    const DropShadow small_shadow = {
+        .offset_x = SHADOW_OFFSET,
+        .offset_y = SHADOW_OFFSET,
+        .sigma    = SHADOW_SIGMA_SMALL,
+        .color    = {.red = 0, .green = 0, .blue = 0, .alpha = 160}
+    };
+
+    DropShadow large_shadow = small_shadow;
+    large_shadow.sigma      = SHADOW_SIGMA_LARGE;
+
+    // Shadow is about as large as foreground, only its alpha is read
+    ShadowContext cast_small_shadow  = {&background, &moved_fg,
+                                        &small_shadow};
+    ShadowContext cast_large_shadow  = {&background, &moved_fg,
+                                        &large_shadow};
 
-    load_image_from_file(&foreground, "assets/poltorashka_cropped.bmp");
-    load_image_from_file(&background, "assets/wooden_table_scaled.bmp");
-    
-    MovedImage moved_fg = {
-        .size = {foreground.size.x, foreground.size.y},
-        .pos = {0, 0},
-        .pixel_array = foreground.pixel_array
+    // Rotation keeps area, so the same number of pixels is blended
+    TransformContext blend_rotated   = {&background, &foreground, &rotation};
+
+    // Both fractions are non-zero, so that edges are interpolated too
+    const SubpixelVector2 subpixel_pos = {
+        .x = (uint32_t) FOREGROUND_POS.x << SUBPIXEL_BITS | 0x40,
+        .y = (uint32_t) FOREGROUND_POS.y << SUBPIXEL_BITS | 0xC0
     };
+    SubpixelContext  blend_shifted   = {&background, &foreground,
+                                        subpixel_pos};
+
+    PlanarContext  blend_planar_fast  = {&planar_background,
+                                         &planar_foreground,
+                                         FOREGROUND_POS, BLEND_MODE_FAST};
+    PlanarContext  blend_planar_exact = {&planar_background,
+                                         &planar_foreground,
+                                         FOREGROUND_POS, BLEND_MODE_EXACT};
+    ConvertContext convert_planes     = {&background, &planar_background};
+
+    Blend16Context blend16 = {&wide_background, &wide_fg};
+    Halo16Context  halo16  = {&wide_background, &halo};
+    PackContext    pack16  = {&background, &wide_background};
+
+    limit_simd_level(SIMD_LEVEL_AVX512);
+    const SimdLevel max_level = get_simd_level();
+
+    printf("Widest instruction set: %s\n\n", get_simd_level_name(max_level));
+    print_benchmark_header(stdout);
+
+    add_benchmark(&suite, run_blend_simple, &blend,
+                  blend_pixels, blend_bytes, "blend_simple");
+    add_benchmark(&suite, run_halo_simple, &add_halo,
+                  halo_pixels, halo_bytes, "halo_simple");
 
-    const size_t sample_size = 500;
-    const size_t repeat = 200;
-    size_t* test_data = (size_t*) calloc(sample_size, sizeof(*test_data));
-    
-    const test_args args = { &background, &moved_fg };
+    for (int level = SIMD_LEVEL_SCALAR; level <= max_level; ++level)
+    {
+        limit_simd_level((SimdLevel) level);
+        const char* level_name = get_simd_level_name((SimdLevel) level);
 
-    COLLECT_DATA(ADAPTER(blend_pixels_simple), args, repeat,
-                    test_data, sample_size);
+        add_benchmark(&suite, run_blend_optimized, &blend,
+                      blend_pixels, blend_bytes,
+                      "blend_optimized/fast/%s", level_name);
+        add_benchmark(&suite, run_blend_optimized, &blend_exact,
+                      blend_pixels, blend_bytes,
+                      "blend_optimized/exact/%s", level_name);
+        add_benchmark(&suite, run_blend_optimized, &blend_indexed,
+                      blend_pixels, blend_bytes,
+                      "blend_optimized/spans/%s", level_name);
+        add_benchmark(&suite, run_blend_optimized, &blend_modulated,
+                      blend_pixels, blend_bytes,
+                      "blend_optimized/modulated/%s", level_name);
+        add_benchmark(&suite, run_blend_linear, &blend,
+                      blend_pixels, blend_bytes,
+                      "blend_linear/%s", level_name);
+        add_benchmark(&suite, run_blend_transformed, &blend_rotated,
+                      blend_pixels, blend_bytes,
+                      "blend_transformed/%s", level_name);
+        add_benchmark(&suite, run_blend_subpixel, &blend_shifted,
+                      blend_pixels, blend_bytes,
+                      "blend_subpixel/%s", level_name);
+        add_benchmark(&suite, run_blend_premultiplied, &blend_premul,
+                      blend_pixels, blend_bytes,
+                      "blend_premultiplied/fast/%s", level_name);
+        add_benchmark(&suite, run_blend_premultiplied, &blend_premul_exact,
+                      blend_pixels, blend_bytes,
+                      "blend_premultiplied/exact/%s", level_name);
+        add_benchmark(&suite, run_blend_planar, &blend_planar_fast,
+                      blend_pixels, planar_bytes,
+                      "blend_planar/fast/%s", level_name);
+        add_benchmark(&suite, run_blend_planar, &blend_planar_exact,
+                      blend_pixels, planar_bytes,
+                      "blend_planar/exact/%s", level_name);
+        add_benchmark(&suite, run_split_planes, &convert_planes,
+                      convert_pixels, convert_bytes,
+                      "split_planes/%s", level_name);
+        add_benchmark(&suite, run_merge_planes, &convert_planes,
+                      convert_pixels, convert_bytes,
+                      "merge_planes/%s", level_name);
+        add_benchmark(&suite, run_halo_optimized, &add_halo,
+                      halo_pixels, halo_bytes,
+                      "halo_optimized/%s", level_name);
+        add_benchmark(&suite, run_halos_batched, &add_single_halo,
+                      halo_pixels, halo_bytes,
+                      "halo_batched/%s", level_name);
+        add_benchmark(&suite, run_halos_sequential, &add_lights,
+                      light_pixels, light_bytes,
+                      "halos/sequential/%s", level_name);
+        add_benchmark(&suite, run_halos_batched, &add_lights,
+                      light_pixels, light_bytes,
+                      "halos/batched/%s", level_name);
+        add_benchmark(&suite, run_drop_shadow, &cast_small_shadow,
+                      blend_pixels, blend_bytes,
+                      "drop_shadow/small/%s", level_name);
+        add_benchmark(&suite, run_drop_shadow, &cast_large_shadow,
+                      blend_pixels, blend_bytes,
+                      "drop_shadow/large/%s", level_name);
+        add_benchmark(&suite, run_downscale_half, &downscale_frame,
+                      frame_pixels, downscale_bytes,
+                      "downscale_half/%s", level_name);
+        add_benchmark(&suite, run_build_pyramid, &downscale_frame,
+                      frame_pixels, pyramid_bytes,
+                      "image_pyramid/%s", level_name);
+        add_benchmark(&suite, run_composite_layers, &composite_stack,
+                      frame_pixels, stack_bytes,
+                      "layer_stack/composite/%s", level_name);
+        add_benchmark(&suite, run_blend_layers, &blend_stack,
+                      frame_pixels, stack_bytes,
+                      "layer_stack/sequential/%s", level_name);
+        add_benchmark(&suite, run_blend_pixels16, &blend16,
+                      blend_pixels, blend16_bytes,
+                      "blend_pixels16/%s", level_name);
+        add_benchmark(&suite, run_halo16, &halo16,
+                      halo_pixels, halo16_bytes,
+                      "halo16/%s", level_name);
+        add_benchmark(&suite, run_pack_pixels16, &pack16,
+                      convert_pixels, pack_bytes,
+                      "pack_pixels16/%s", level_name);
+    }
 
-    const double simple_average = get_average_time(test_data, sample_size);
-    const double simple_stddev  = get_time_standard_deviation(simple_average,
-                                                        test_data, sample_size);
+    limit_simd_level(max_level);
 
-    COLLECT_DATA(ADAPTER(blend_pixels_optimized), args, repeat,
-                    test_data, sample_size);
+    // Thread scaling: powers of two and all online CPUs
+    const size_t cpu_count = get_cpu_count();
+    for (size_t thread_count = 1; ;
+         thread_count = thread_count * 2 < cpu_count ? thread_count * 2
+                                                     : cpu_count)
+    {
+        ThreadPool pool = {};
+        if (thread_pool_init(&pool, thread_count, true) != 0)
+        {
+            printf("%zu threads: failed to start threads\n", thread_count);
+            suite.failed_count++;
+            break;
+        }
 
-    const double opt_average = get_average_time(test_data, sample_size);
-    const double opt_stddev  = get_time_standard_deviation(opt_average,
-                                                        test_data, sample_size);
+        BlendContext parallel_blend = {&background, &moved_fg, &pool};
+        HaloContext  parallel_halo  = {&background, &halo,     &pool};
+        HalosContext parallel_lights = {&background, lights, LIGHT_COUNT,
+                                        &pool};
+        DownscaleContext parallel_pyramid = {&frame, &pyramid, &pool};
 
-    const double simple_rel_error = simple_stddev / simple_average;
-    const double opt_rel_error    = opt_stddev    / opt_average;
-    const double combined_rel_error = simple_rel_error + opt_rel_error;
-    const double faster = simple_average / opt_average;
-    const double faster_err = faster * combined_rel_error;
+        ComposeContext cached_frame    = {&frame, &frame_layers,
+                                          STREAMING_NEVER,  &pool};
+        ComposeContext streamed_frame  = {&frame, &frame_layers,
+                                          STREAMING_ALWAYS, &pool};
 
+        add_benchmark(&suite, run_blend_parallel, &parallel_blend,
+                      blend_pixels, blend_bytes,
+                      "blend_parallel/threads=%zu", thread_count);
+        add_benchmark(&suite, run_halo_parallel, &parallel_halo,
+                      halo_pixels, halo_bytes,
+                      "halo_parallel/threads=%zu", thread_count);
+        add_benchmark(&suite, run_halos_batched, &parallel_lights,
+                      light_pixels, light_bytes,
+                      "halos/parallel/threads=%zu", thread_count);
+        add_benchmark(&suite, run_build_pyramid, &parallel_pyramid,
+                      frame_pixels, pyramid_bytes,
+                      "image_pyramid/threads=%zu", thread_count);
+        add_benchmark(&suite, run_compose_frame, &cached_frame,
+                      frame_pixels, frame_bytes,
+                      "compose_frame/cached/threads=%zu", thread_count);
+        add_benchmark(&suite, run_compose_frame, &streamed_frame,
+                      frame_pixels, frame_bytes,
+                      "compose_frame/streaming/threads=%zu", thread_count);
 
-    printf("without SIMD: %.2lfms (~%.2lfms)\n", simple_average, simple_stddev);
-    printf("   with SIMD: %.2lfms (~%.2lfms)\n", opt_average, opt_stddev);
-    puts("");
-    printf("Performance increase: %.2lf (~%.2lf)\n", faster, faster_err);
+        thread_pool_dispose(&pool);
 
+        if (thread_count == cpu_count)
+            break;
+    }
+
+    int exit_code = suite.failed_count > 0 ? 1 : 0;
+
+    if (options.json_name &&
+        write_benchmark_json(options.json_name,
+                             get_simd_level_name(max_level),
+                             suite.results, suite.result_count) != 0)
+    {
+        fprintf(stderr, "Failed to write '%s'\n", options.json_name);
+        exit_code = 1;
+    }
+
+    if (options.baseline_name)
+    {
+        const int regression_count = compare_benchmark_baseline(
+                                            options.baseline_name,
+                                            suite.results,
+                                            suite.result_count,
+                                            options.tolerance);
+        if (regression_count < 0)
+        {
+            fprintf(stderr, "Failed to read '%s'\n", options.baseline_name);
+            exit_code = 1;
+        }
+        else if (regression_count > 0)
+        {
+            printf("%d benchmarks are slower than baseline by more "
+                   "than %.0lf%%\n", regression_count,
+                   options.tolerance * 100);
+            exit_code = 1;
+        }
+    }
+
+    span_index_dispose(&spans);
+    image_pyramid_dispose(&pyramid);
+    for (size_t i = 0; i < STACK_LAYER_COUNT; ++i)
+        unload_image(stack_images + i);
+    pixel_image16_dispose(&wide_foreground);
+    pixel_image16_dispose(&wide_background);
+    planar_image_dispose(&planar_foreground);
+    planar_image_dispose(&planar_background);
+    unload_image(&frame);
+    unload_image(&frame_background);
+    unload_image(&premultiplied);
     unload_image(&foreground);
     unload_image(&background);
 
-    free(test_data);
+    free(suite.results);
+
+    return exit_code;
+}
+
+static void run_blend_simple(void* context)
+{
+    BlendContext* blend = (BlendContext*) context;
+    blend_pixels_simple(blend->background, blend->foreground);
+}
+
+static void run_blend_optimized(void* context)
+{
+    BlendContext* blend = (BlendContext*) context;
+    blend_pixels_optimized(blend->background, blend->foreground);
+}
+
+static void run_blend_parallel(void* context)
+{
+    BlendContext* blend = (BlendContext*) context;
+    blend_pixels_parallel(blend->background, blend->foreground, blend->pool);
+}
+
+static void run_blend_premultiplied(void* context)
+{
+    BlendContext* blend = (BlendContext*) context;
+    blend_premultiplied(blend->background, blend->foreground, blend->pool);
+}
+
+static void run_blend_linear(void* context)
+{
+    BlendContext* blend = (BlendContext*) context;
+    blend_pixels_linear(blend->background, blend->foreground, NULL);
+}
+
+static void run_blend_transformed(void* context)
+{
+    TransformContext* blend = (TransformContext*) context;
+    blend_transformed(blend->background, blend->foreground, blend->transform,
+                      NULL);
+}
+
+static void run_blend_subpixel(void* context)
+{
+    SubpixelContext* blend = (SubpixelContext*) context;
+    blend_subpixel(blend->background, blend->foreground, blend->pos, NULL);
+}
+
+static void run_blend_planar(void* context)
+{
+    PlanarContext* blend = (PlanarContext*) context;
+    blend_planar(blend->background, blend->foreground, blend->pos,
+                 blend->mode, NULL);
+}
+
+static void run_split_planes(void* context)
+{
+    ConvertContext* convert = (ConvertContext*) context;
+    split_planes(convert->planar, convert->image, NULL);
+}
+
+static void run_merge_planes(void* context)
+{
+    ConvertContext* convert = (ConvertContext*) context;
+    merge_planes(convert->image, convert->planar, NULL);
+}
+
+static void run_blend_pixels16(void* context)
+{
+    Blend16Context* blend = (Blend16Context*) context;
+    blend_pixels16(blend->background, blend->foreground, NULL);
+}
+
+static void run_halo16(void* context)
+{
+    Halo16Context* halo = (Halo16Context*) context;
+    add_halo16(halo->background, halo->halo, NULL);
+}
+
+static void run_pack_pixels16(void* context)
+{
+    PackContext* pack = (PackContext*) context;
+    pack_pixels16(pack->image, pack->wide, NULL);
+}
+
+static void run_halo_simple(void* context)
+{
+    HaloContext* halo = (HaloContext*) context;
+    add_halo_simple(halo->background, halo->halo);
+}
+
+static void run_halo_optimized(void* context)
+{
+    HaloContext* halo = (HaloContext*) context;
+    add_halo_optimized(halo->background, halo->halo);
+}
+
+static void run_halo_parallel(void* context)
+{
+    HaloContext* halo = (HaloContext*) context;
+    add_halo_parallel(halo->background, halo->halo, halo->pool);
+}
+
+static void run_halos_sequential(void* context)
+{
+    HalosContext* halos = (HalosContext*) context;
+    for (size_t i = 0; i < halos->halo_count; ++i)
+        add_halo_optimized(halos->background, halos->halos + i);
+}
+
+static void run_halos_batched(void* context)
+{
+    HalosContext* halos = (HalosContext*) context;
+    add_halos(halos->background, halos->halos, halos->halo_count,
+              halos->pool);
+}
+
+static void run_drop_shadow(void* context)
+{
+    ShadowContext* cast = (ShadowContext*) context;
+    add_drop_shadow(cast->background, cast->foreground, cast->shadow, NULL);
+}
+
+static void run_downscale_half(void* context)
+{
+    DownscaleContext* downscale = (DownscaleContext*) context;
+    downscale_half(&downscale->pyramid->levels[0], downscale->source,
+                   downscale->pool);
+}
+
+static void run_build_pyramid(void* context)
+{
+    DownscaleContext* downscale = (DownscaleContext*) context;
+    build_image_pyramid(downscale->pyramid, downscale->source,
+                        downscale->pool);
+}
+
+static void run_compose_frame(void* context)
+{
+    ComposeContext* compose = (ComposeContext*) context;
+    compose_frame(compose->frame, compose->layers, compose->streaming,
+                  compose->pool);
+}
+
+static void run_composite_layers(void* context)
+{
+    LayerContext* composite = (LayerContext*) context;
+    composite_layers(composite->target, composite->layers,
+                     composite->layer_count, NULL);
+}
+
+static void run_blend_layers(void* context)
+{
+    StackContext* stack = (StackContext*) context;
+    for (size_t i = 0; i < stack->layer_count; ++i)
+        blend_premultiplied(stack->target, stack->layers + i, NULL);
+}
+
+static void run_convert_bmp_row(void* context)
+{
+    BmpRowContext* convert = (BmpRowContext*) context;
+    CHECK_BMP_ROW_KERNELS[get_simd_level()](convert->dst, convert->src,
+                                            convert->count, convert->swizzle);
+}
+
+static void run_convert_bmp_rgb_row(void* context)
+{
+    BmpRowContext* convert = (BmpRowContext*) context;
+    CHECK_BMP_RGB_ROW_KERNELS[get_simd_level()](convert->dst, convert->src,
+                                                convert->count);
+}
+
+static int parse_options(BenchmarkSuite* suite, BenchmarkOptions* options,
+                         int argc, char* argv[])
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        // The only option without value
+        if (strcmp(argv[i], "--check") == 0)
+        {
+            options->check = true;
+            continue;
+        }
+
+        if (i + 1 >= argc)
+            return -1;
+
+        const char* option = argv[i];
+        const char* value  = argv[++i];
+
+        if (strcmp(option, "--json") == 0)
+            options->json_name = value;
+        else if (strcmp(option, "--baseline") == 0)
+            options->baseline_name = value;
+        else if (strcmp(option, "--filter") == 0)
+            suite->filter = value;
+        else if (strcmp(option, "--tolerance") == 0)
+        {
+            char* end = NULL;
+            options->tolerance = strtod(value, &end);
+            if (*end != '\0' || !(options->tolerance >= 0))
+                return -1;
+        }
+        else if (strcmp(option, "--samples") == 0)
+        {
+            char* end = NULL;
+            suite->config.sample_count = strtoul(value, &end, 10);
+            if (*end != '\0' || suite->config.sample_count == 0)
+                return -1;
+        }
+        else
+            return -1;
+    }
+
+    return 0;
+}
+
+static void add_benchmark(BenchmarkSuite* suite, benchmark_fn_t* function,
+                          void* context, size_t pixel_count,
+                          size_t byte_count, const char* name_format, ...)
+{
+    BenchmarkCase bench_case = {
+        .name        = "",
+        .function    = function,
+        .context     = context,
+        .pixel_count = pixel_count,
+        .byte_count  = byte_count
+    };
+
+    va_list args;
+    va_start(args, name_format);
+    vsnprintf(bench_case.name, sizeof(bench_case.name), name_format, args);
+    va_end(args);
+
+    if (!strstr(bench_case.name, suite->filter))
+        return;
+
+    if (suite->result_count == MAX_RESULT_COUNT)
+    {
+        printf("%s: too many benchmarks\n", bench_case.name);
+        suite->failed_count++;
+        return;
+    }
+
+    BenchmarkResult* result = &suite->results[suite->result_count];
+    if (run_benchmark(&bench_case, &suite->config, result) != 0)
+    {
+        printf("%s: failed\n", bench_case.name);
+        suite->failed_count++;
+        return;
+    }
+
+    print_benchmark_result(stdout, result);
+    suite->result_count++;
+}
+
+static size_t count_halo_pixels(size_t radius)
+{
+    size_t count = 0;
+    for (size_t dy = 0; dy < 2*radius + 1; ++dy)
+    {
+        for (size_t dx = 0; dx < 2*radius + 1; ++dx)
+        {
+            const size_t x = dx > radius ? dx - radius : radius - dx;
+            const size_t y = dy > radius ? dy - radius : radius - dy;
+
+            count += x*x + y*y < radius*radius;
+        }
+    }
+
+    return count;
+}
+
+static size_t get_cpu_count(void)
+{
+    const long online_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+    return online_cpus > 0 ? (size_t) online_cpus : 1;
+}
+
+static int run_level_checks(const char* filter)
+{
+    limit_simd_level(SIMD_LEVEL_AVX512);
+
+    CheckSuite suite = {
+        .max_level    = get_simd_level(),
+        .filter       = filter,
+        .case_count   = 0,
+        .failed_count = 0
+    };
+
+    printf("Checking against %s up to %s\n\n",
+           get_simd_level_name(SIMD_LEVEL_SCALAR),
+           get_simd_level_name(suite.max_level));
+
+    for (const SizeVector2& fg_size : CHECK_FOREGROUND_SIZES)
+        for (const SizeVector2& fg_pos : CHECK_FOREGROUND_POSITIONS)
+            check_geometry(&suite, fg_size, fg_pos);
+
+    check_bmp_files(&suite);
+
+    printf("%zu checks, %zu failed\n", suite.case_count, suite.failed_count);
+
+    return suite.failed_count > 0 ? -1 : 0;
+}
+
+static void check_geometry(CheckSuite* suite, SizeVector2 fg_size,
+                           SizeVector2 fg_pos)
+{
+    char geometry[BENCHMARK_NAME_LENGTH] = "";
+    snprintf(geometry, sizeof(geometry), "%zux%zu+%zu+%zu",
+             fg_size.x, fg_size.y, fg_pos.x, fg_pos.y);
+
+    CheckImages images = {};
+    if (check_images_init(&images, fg_size) != 0)
+    {
+        printf("%s: failed to generate images\n", geometry);
+        suite->failed_count++;
+        check_images_dispose(&images);
+        return;
+    }
+
+    PixelImage*   background = &images.background;
+    PixelImage16* wide_bg    = &images.wide_background;
+    PlanarImage*  planar_bg  = &images.planar_background;
+
+    const size_t bg_width  = background->size.x;
+    const size_t bg_height = background->size.y;
+    const size_t row_size  = bg_width * sizeof(Pixel);
+
+    const Modulation fade = {
+        .tint    = {.red = 255, .green = 160, .blue = 64, .alpha = 255},
+        .opacity = 128
+    };
+
+    const MovedImage moved_fg = {
+        .size        = fg_size,
+        .pos         = fg_pos,
+        .pixel_array = images.foreground.pixel_array,
+        .blend_mode  = BLEND_MODE_FAST,
+        .spans       = NULL,
+        .modulation  = NULL
+    };
+
+    MovedImage exact_fg = moved_fg;
+    exact_fg.blend_mode = BLEND_MODE_EXACT;
+
+    MovedImage indexed_fg = moved_fg;
+    indexed_fg.spans      = &images.spans;
+
+    MovedImage modulated_fg = indexed_fg;
+    modulated_fg.modulation = &fade;
+
+    MovedImage premultiplied_fg  = moved_fg;
+    premultiplied_fg.pixel_array = images.premultiplied.pixel_array;
+
+    MovedImage premultiplied_exact_fg = premultiplied_fg;
+    premultiplied_exact_fg.blend_mode = BLEND_MODE_EXACT;
+
+    MovedImage premultiplied_indexed_fg = premultiplied_fg;
+    premultiplied_indexed_fg.spans      = &images.premultiplied_spans;
+
+    MovedImage premultiplied_modulated_fg = premultiplied_indexed_fg;
+    premultiplied_modulated_fg.modulation = &fade;
+
+    BlendContext blend_fast      = {background, &moved_fg,      NULL};
+    BlendContext blend_exact     = {background, &exact_fg,      NULL};
+    BlendContext blend_indexed   = {background, &indexed_fg,    NULL};
+    BlendContext blend_modulated = {background, &modulated_fg,  NULL};
+    BlendContext premul_fast     = {background, &premultiplied_fg, NULL};
+    BlendContext premul_exact    = {background, &premultiplied_exact_fg,
+                                    NULL};
+    BlendContext premul_indexed  = {background, &premultiplied_indexed_fg,
+                                    NULL};
+    BlendContext premul_modulated = {background, &premultiplied_modulated_fg,
+                                     NULL};
+
+    add_check(suite, run_blend_optimized, &blend_fast, background->pixel_array,
+              row_size, row_size, bg_height,
+              "blend_optimized/fast/%s", geometry);
+    add_check(suite, run_blend_optimized, &blend_exact,
+              background->pixel_array, row_size, row_size, bg_height,
+              "blend_optimized/exact/%s", geometry);
+    add_check(suite, run_blend_optimized, &blend_indexed,
+              background->pixel_array, row_size, row_size, bg_height,
+              "blend_optimized/spans/%s", geometry);
+    add_check(suite, run_blend_optimized, &blend_modulated,
+              background->pixel_array, row_size, row_size, bg_height,
+              "blend_optimized/modulated/%s", geometry);
+    add_check(suite, run_blend_premultiplied, &premul_fast,
+              background->pixel_array, row_size, row_size, bg_height,
+              "blend_premultiplied/fast/%s", geometry);
+    add_check(suite, run_blend_premultiplied, &premul_exact,
+              background->pixel_array, row_size, row_size, bg_height,
+              "blend_premultiplied/exact/%s", geometry);
+    add_check(suite, run_blend_premultiplied, &premul_indexed,
+              background->pixel_array, row_size, row_size, bg_height,
+              "blend_premultiplied/spans/%s", geometry);
+    add_check(suite, run_blend_premultiplied, &premul_modulated,
+              background->pixel_array, row_size, row_size, bg_height,
+              "blend_premultiplied/modulated/%s", geometry);
+    add_check(suite, run_blend_linear, &blend_indexed,
+              background->pixel_array, row_size, row_size, bg_height,
+              "blend_linear/%s", geometry);
+
+    // Foreground is rotated around its center
+    const double cos_angle = cos(ROTATION_ANGLE);
+    const double sin_angle = sin(ROTATION_ANGLE);
+    const double fg_center_x = (double) fg_pos.x + (double) fg_size.x / 2;
+    const double fg_center_y = (double) fg_pos.y + (double) fg_size.y / 2;
+    const AffineTransform rotation = {{
+        {
+            cos_angle, -sin_angle,
+            fg_center_x - cos_angle * (double) fg_size.x / 2
+                        + sin_angle * (double) fg_size.y / 2
+        },
+        {
+            sin_angle,  cos_angle,
+            fg_center_y - sin_angle * (double) fg_size.x / 2
+                        - cos_angle * (double) fg_size.y / 2
+        }
+    }};
+
+    const SubpixelVector2 subpixel_pos = {
+        .x = (uint32_t) fg_pos.x << SUBPIXEL_BITS | 0x40,
+        .y = (uint32_t) fg_pos.y << SUBPIXEL_BITS | 0xC0
+    };
+
+    TransformContext blend_rotated = {background, &images.foreground,
+                                      &rotation};
+    SubpixelContext  blend_shifted = {background, &images.foreground,
+                                      subpixel_pos};
+
+    add_check(suite, run_blend_transformed, &blend_rotated,
+              background->pixel_array, row_size, row_size, bg_height,
+              "blend_transformed/%s", geometry);
+    add_check(suite, run_blend_subpixel, &blend_shifted,
+              background->pixel_array, row_size, row_size, bg_height,
+              "blend_subpixel/%s", geometry);
+
+    // Planes are stored one after another
+    const size_t plane_rows = PLANE_COUNT * bg_height;
+
+    PlanarContext  planar_fast    = {planar_bg, &images.planar_foreground,
+                                     fg_pos, BLEND_MODE_FAST};
+    PlanarContext  planar_exact   = {planar_bg, &images.planar_foreground,
+                                     fg_pos, BLEND_MODE_EXACT};
+    ConvertContext convert_planes = {background, planar_bg};
+
+    add_check(suite, run_blend_planar, &planar_fast,
+              planar_bg->planes[0], bg_width, planar_bg->stride, plane_rows,
+              "blend_planar/fast/%s", geometry);
+    add_check(suite, run_blend_planar, &planar_exact,
+              planar_bg->planes[0], bg_width, planar_bg->stride, plane_rows,
+              "blend_planar/exact/%s", geometry);
+    add_check(suite, run_split_planes, &convert_planes,
+              planar_bg->planes[0], bg_width, planar_bg->stride, plane_rows,
+              "split_planes/%s", geometry);
+    add_check(suite, run_merge_planes, &convert_planes,
+              background->pixel_array, row_size, row_size, bg_height,
+              "merge_planes/%s", geometry);
+
+    const MovedImage16 wide_fg = {
+        .size        = fg_size,
+        .pos         = fg_pos,
+        .pixel_array = images.wide_foreground.pixel_array
+    };
+    const size_t wide_row_size = bg_width * sizeof(Pixel16);
+
+    Blend16Context blend16 = {wide_bg, &wide_fg};
+    PackContext    pack16  = {background, wide_bg};
+
+    add_check(suite, run_blend_pixels16, &blend16,
+              wide_bg->pixel_array, wide_row_size, wide_row_size, bg_height,
+              "blend_pixels16/%s", geometry);
+    add_check(suite, run_pack_pixels16, &pack16,
+              background->pixel_array, row_size, row_size, bg_height,
+              "pack_pixels16/%s", geometry);
+
+    HaloContext  halos[CHECK_HALO_COUNT] = {};
+    Halo16Context halos16[CHECK_HALO_COUNT] = {};
+    for (size_t i = 0; i < CHECK_HALO_COUNT; ++i)
+    {
+        halos[i]   = {background, CHECK_HALOS + i, NULL};
+        halos16[i] = {wide_bg,    CHECK_HALOS + i};
+
+        add_check(suite, run_halo_optimized, halos + i,
+                  background->pixel_array, row_size, row_size, bg_height,
+                  "halo_optimized/r=%zu/%s", CHECK_HALOS[i].radius_px,
+                  geometry);
+        add_check(suite, run_halo16, halos16 + i,
+                  wide_bg->pixel_array, wide_row_size, wide_row_size,
+                  bg_height, "halo16/r=%zu/%s", CHECK_HALOS[i].radius_px,
+                  geometry);
+    }
+
+    HalosContext batched_halos = {background, CHECK_HALOS, CHECK_HALO_COUNT,
+                                  NULL};
+    add_check(suite, run_halos_batched, &batched_halos,
+              background->pixel_array, row_size, row_size, bg_height,
+              "halos/batched/%s", geometry);
+
+    DropShadow shadow = {
+        .offset_x = -3,
+        .offset_y = 5,
+        .sigma    = SHADOW_SIGMA_SMALL,
+        .color    = {.red = 0, .green = 0, .blue = 0, .alpha = 160}
+    };
+    ShadowContext cast_small_shadow = {background, &modulated_fg, &shadow};
+
+    add_check(suite, run_drop_shadow, &cast_small_shadow,
+              background->pixel_array, row_size, row_size, bg_height,
+              "drop_shadow/small/%s", geometry);
+
+    DropShadow large_shadow = shadow;
+    large_shadow.sigma      = SHADOW_SIGMA_LARGE;
+    ShadowContext cast_large_shadow = {background, &moved_fg, &large_shadow};
+
+    add_check(suite, run_drop_shadow, &cast_large_shadow,
+              background->pixel_array, row_size, row_size, bg_height,
+              "drop_shadow/large/%s", geometry);
+
+    PixelImage* downscaled = &images.pyramid.levels[0];
+    DownscaleContext downscale = {&images.foreground, &images.pyramid, NULL};
+
+    add_check(suite, run_downscale_half, &downscale,
+              downscaled->pixel_array, downscaled->size.x * sizeof(Pixel),
+              downscaled->size.x * sizeof(Pixel), downscaled->size.y,
+              "downscale_half/%s", geometry);
+
+    const FrameLayers frame_layers = {
+        .background = background,
+        .halo       = CHECK_HALOS + 1,
+        .foreground = &premultiplied_modulated_fg
+    };
+
+    ComposeContext cached_frame   = {&images.frame, &frame_layers,
+                                     STREAMING_NEVER,  NULL};
+    ComposeContext streamed_frame = {&images.frame, &frame_layers,
+                                     STREAMING_ALWAYS, NULL};
+
+    add_check(suite, run_compose_frame, &cached_frame,
+              images.frame.pixel_array, row_size, row_size, bg_height,
+              "compose_frame/cached/%s", geometry);
+    add_check(suite, run_compose_frame, &streamed_frame,
+              images.frame.pixel_array, row_size, row_size, bg_height,
+              "compose_frame/streaming/%s", geometry);
+
+    Layer layer = {
+        .pixel_array = images.premultiplied.pixel_array,
+        .size        = fg_size,
+        .pos         = fg_pos,
+        .opacity     = CHECK_LAYER_OPACITY,
+        .op          = PORTER_DUFF_OVER
+    };
+    LayerContext composite = {&images.target, &layer, 1};
+
+    for (int op = PORTER_DUFF_OVER; op < PORTER_DUFF_COUNT; ++op)
+    {
+        layer.op = (PorterDuffOperator) op;
+        add_check(suite, run_composite_layers, &composite,
+                  images.target.pixel_array, row_size, row_size, bg_height,
+                  "composite_layers/op=%d/%s", op, geometry);
+    }
+
+    // Source rows start at odd addresses, converted rows are as long
+    // as the whole foreground
+    const size_t bmp_count = fg_size.x * fg_size.y;
+    BmpRowContext convert_bmp = {
+        .dst     = images.foreground.pixel_array,
+        .src     = (const uint8_t*) background->pixel_array + 2*fg_pos.x + 1,
+        .count   = bmp_count,
+        .swizzle = &CHECK_BGRA_SWIZZLE
+    };
+
+    add_check(suite, run_convert_bmp_row, &convert_bmp,
+              convert_bmp.dst, bmp_count * sizeof(Pixel),
+              bmp_count * sizeof(Pixel), 1,
+              "convert_bmp_row/%s", geometry);
+    add_check(suite, run_convert_bmp_rgb_row, &convert_bmp,
+              convert_bmp.dst, bmp_count * sizeof(Pixel),
+              bmp_count * sizeof(Pixel), 1,
+              "convert_bmp_rgb_row/%s", geometry);
+
+    check_images_dispose(&images);
+}
+
+static int check_images_init(CheckImages* images, SizeVector2 fg_size)
+{
+    const SizeVector2 bg_size = CHECK_BACKGROUND_SIZE;
+
+    if (generate_background(&images->background,    bg_size, 5) != 0 ||
+        generate_foreground(&images->foreground,    fg_size, 6) != 0 ||
+        generate_foreground(&images->premultiplied, fg_size, 6) != 0 ||
+        generate_background(&images->frame,         bg_size, 7) != 0 ||
+        generate_foreground(&images->target,        bg_size, 8) != 0)
+        return -1;
+
+    premultiply_alpha(&images->premultiplied);
+    premultiply_alpha(&images->target);
+
+    if (span_index_init(&images->spans, &images->foreground)       != 0 ||
+        span_index_init(&images->premultiplied_spans,
+                        &images->premultiplied)                    != 0)
+        return -1;
+
+    if (planar_image_init(&images->planar_background, bg_size)      != 0 ||
+        planar_image_init(&images->planar_foreground, fg_size)      != 0 ||
+        split_planes(&images->planar_background,
+                     &images->background, NULL)                     != 0 ||
+        split_planes(&images->planar_foreground,
+                     &images->foreground, NULL)                     != 0)
+        return -1;
+
+    if (pixel_image16_init(&images->wide_background, bg_size)       != 0 ||
+        pixel_image16_init(&images->wide_foreground, fg_size)       != 0 ||
+        widen_pixels(&images->wide_background,
+                     &images->background, false)                    != 0 ||
+        widen_pixels(&images->wide_foreground,
+                     &images->foreground, true)                     != 0)
+        return -1;
+
+    if (image_pyramid_init(&images->pyramid, fg_size, 1) != 0)
+        return -1;
+
+    return 0;
+}
+
+static void check_images_dispose(CheckImages* images)
+{
+    image_pyramid_dispose(&images->pyramid);
+    pixel_image16_dispose(&images->wide_foreground);
+    pixel_image16_dispose(&images->wide_background);
+    planar_image_dispose(&images->planar_foreground);
+    planar_image_dispose(&images->planar_background);
+    span_index_dispose(&images->premultiplied_spans);
+    span_index_dispose(&images->spans);
+
+    if (images->target.pixel_array)
+        unload_image(&images->target);
+    if (images->frame.pixel_array)
+        unload_image(&images->frame);
+    if (images->premultiplied.pixel_array)
+        unload_image(&images->premultiplied);
+    if (images->foreground.pixel_array)
+        unload_image(&images->foreground);
+    if (images->background.pixel_array)
+        unload_image(&images->background);
+}
+
+static void check_bmp_files(CheckSuite* suite)
+{
+    PixelImage image = {};
+    if (generate_foreground(&image, CHECK_BMP_SIZE, 11) != 0)
+    {
+        printf("bmp_file: failed to generate image\n");
+        suite->failed_count++;
+        return;
+    }
+
+    char filename[] = CHECK_BMP_TEMPLATE;
+    const int fd = mkstemp(filename);
+    if (fd < 0)
+    {
+        printf("bmp_file: failed to create file\n");
+        suite->failed_count++;
+        unload_image(&image);
+        return;
+    }
+    close(fd);
+
+    for (const BmpFileCheck& check : CHECK_BMP_FILES)
+        check_bmp_file(suite, &check, &image, filename);
+
+    unlink(filename);
+    unload_image(&image);
+}
+
+static void check_bmp_file(CheckSuite* suite, const BmpFileCheck* check,
+                           const PixelImage* image, const char* filename)
+{
+    char name[BENCHMARK_NAME_LENGTH] = "";
+    snprintf(name, sizeof(name), "bmp_file/%s", check->name);
+
+    if (!strstr(name, suite->filter))
+        return;
+
+    suite->case_count++;
+
+    if (write_bmp_file(filename, image, &check->format) != 0)
+    {
+        printf("%s: failed to write file\n", name);
+        suite->failed_count++;
+        return;
+    }
+
+    const SimdLevel saved_level = get_simd_level();
+
+    size_t mismatch_count = 0;
+    for (int level = SIMD_LEVEL_SCALAR; level <= suite->max_level; ++level)
+    {
+        limit_simd_level((SimdLevel) level);
+        if (check_bmp_level(name, check, image, filename) != 0)
+            mismatch_count++;
+    }
+
+    limit_simd_level(saved_level);
+
+    if (mismatch_count != 0)
+        suite->failed_count++;
+}
+
+/*
+ * Load file at current level and compare it with written image
+ */
+static int check_bmp_level(const char* name, const BmpFileCheck* check,
+                           const PixelImage* image, const char* filename)
+{
+    const char* level_name = get_simd_level_name(get_simd_level());
+
+    ImageFile file = {};
+    errno = 0;
+    if (load_bmp_file(&file, filename, NULL) != 0)
+    {
+        if (!check->is_loaded && errno == ENOTSUP)
+            return 0;
+
+        printf("%s: %s failed to load file: %s\n",
+               name, level_name, strerror(errno));
+        return -1;
+    }
+
+    if (!check->is_loaded)
+    {
+        printf("%s: %s loaded unsupported file\n", name, level_name);
+        unload_image_file(&file);
+        return -1;
+    }
+
+    int result = 0;
+
+    if ((file.mapping != NULL) != check->is_view)
+    {
+        printf("%s: %s %s\n", name, level_name,
+               file.mapping ? "used pixels in place" : "copied pixels");
+        result = -1;
+    }
+
+    if (file.image.size.x != image->size.x ||
+        file.image.size.y != image->size.y)
+    {
+        printf("%s: %s loaded %zux%zu image\n", name, level_name,
+               file.image.size.x, file.image.size.y);
+        unload_image_file(&file);
+        return -1;
+    }
+
+    // Files without alpha, or with all of it zeroed, are opaque
+    const bool is_opaque = check->format.bits_per_pixel == 24
+                        || check->format.is_alpha_zeroed;
+
+    const size_t pixel_count = image->size.x * image->size.y;
+    for (size_t i = 0; i < pixel_count; ++i)
+    {
+        Pixel expected = image->pixel_array[i];
+        if (is_opaque)
+            expected.alpha = 255;
+
+        if (memcmp(&file.image.pixel_array[i], &expected,
+                   sizeof(Pixel)) == 0)
+            continue;
+
+        printf("%s: %s differs from written image in row %zu, pixel %zu\n",
+               name, level_name, i / image->size.x, i % image->size.x);
+        result = -1;
+        break;
+    }
+
+    unload_image_file(&file);
+
+    return result;
+}
+
+static void add_check(CheckSuite* suite, benchmark_fn_t* function,
+                      void* context, void* output, size_t row_size,
+                      size_t stride, size_t row_count,
+                      const char* name_format, ...)
+{
+    LevelCheckCase check_case = {
+        .name      = "",
+        .function  = function,
+        .context   = context,
+        .output    = output,
+        .row_size  = row_size,
+        .stride    = stride,
+        .row_count = row_count
+    };
+
+    va_list args;
+    va_start(args, name_format);
+    vsnprintf(check_case.name, sizeof(check_case.name), name_format, args);
+    va_end(args);
+
+    if (!strstr(check_case.name, suite->filter))
+        return;
+
+    suite->case_count++;
+
+    const int mismatch_count = check_levels(&check_case, suite->max_level,
+                                            stdout);
+    if (mismatch_count < 0)
+        printf("%s: failed\n", check_case.name);
+
+    if (mismatch_count != 0)
+        suite->failed_count++;
 }